@@ -97,3 +97,57 @@ char* pthread_hw_stack_init(void entry(void *), void *paramter, char *stack, voi
     
     return stk;
 }
+
+/*@{*/
+
+/* the cycle counter of the DWT */
+#define HW_DEMCR                    (*(volatile unsigned int *)0xE000EDFCUL)
+#define HW_DEMCR_TRCENA             (1UL << 24)
+#define HW_DWT_CTRL                 (*(volatile unsigned int *)0xE0001000UL)
+#define HW_DWT_CTRL_CYCCNTENA       (1UL << 0)
+#define HW_DWT_CTRL_NOCYCCNT        (1UL << 25)
+#define HW_DWT_CYCCNT               (*(volatile unsigned int *)0xE0001004UL)
+
+/* the frequency of the cycle counter */
+static os_u32 hw_cycle_hz;
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * hw_cycle_init - the function will start the cycle counter of the DWT
+ *
+ * @param freq the core clock in Hz
+ *
+ * @return the result
+ */
+err_t hw_cycle_init(os_u32 freq)
+{
+    if (!freq)
+        return -EINVAL;
+  
+    HW_DEMCR |= HW_DEMCR_TRCENA;
+    
+    if (HW_DWT_CTRL & HW_DWT_CTRL_NOCYCCNT)
+        return -ENODEV;
+    
+    HW_DWT_CYCCNT = 0;
+    HW_DWT_CTRL |= HW_DWT_CTRL_CYCCNTENA;
+    
+    hw_cycle_hz = freq;
+    
+    return 0;
+}
+
+os_u32 hw_cycle_get(void)
+{
+    return HW_DWT_CYCCNT;
+}
+
+os_u32 hw_cycle_freq(void)
+{
+    return hw_cycle_hz;
+}
+
+/*@}*/
@@ -11,6 +11,7 @@
 #include "cpuport.h"
 #include "stdio.h"
 #include "sched.h"
+#include "klog.h"
 
 /*@{*/
 
@@ -137,6 +138,9 @@ char* pthread_hw_stack_init(void entry(void *),
 
 void hard_fault_exception(struct interrupt_stack_frame *interrupt_stack_frame)
 {	
+    /* the klog thread never runs again, the registers are written here */
+    klog_panic();
+
     printk("R0  is 0x%08x .\r\n", interrupt_stack_frame->r0);
     printk("R1  is 0x%08x .\r\n", interrupt_stack_frame->r1);
     printk("R2  is 0x%08x .\r\n", interrupt_stack_frame->r2);
@@ -152,3 +156,126 @@ void hard_fault_exception(struct interrupt_stack_frame *interrupt_stack_frame)
 
 
 /*@}*/
+
+/*@{*/
+
+/* the cycle counter of the DWT */
+#define HW_DEMCR                    (*(volatile unsigned int *)0xE000EDFCUL)
+#define HW_DEMCR_TRCENA             (1UL << 24)
+#define HW_DWT_CTRL                 (*(volatile unsigned int *)0xE0001000UL)
+#define HW_DWT_CTRL_CYCCNTENA       (1UL << 0)
+#define HW_DWT_CTRL_NOCYCCNT        (1UL << 25)
+#define HW_DWT_CYCCNT               (*(volatile unsigned int *)0xE0001004UL)
+
+/* the DWT of the Cortex-M7 is locked after the reset */
+#define HW_DWT_LAR                  (*(volatile unsigned int *)0xE0001FB0UL)
+#define HW_DWT_LAR_KEY              0xC5ACCE55UL
+
+/* the frequency of the cycle counter */
+static os_u32 hw_cycle_hz;
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * hw_cycle_init - the function will start the cycle counter of the DWT
+ *
+ * @param freq the core clock in Hz
+ *
+ * @return the result
+ */
+err_t hw_cycle_init(os_u32 freq)
+{
+    if (!freq)
+        return -EINVAL;
+  
+    HW_DEMCR |= HW_DEMCR_TRCENA;
+    HW_DWT_LAR = HW_DWT_LAR_KEY;
+    
+    if (HW_DWT_CTRL & HW_DWT_CTRL_NOCYCCNT)
+        return -ENODEV;
+    
+    HW_DWT_CYCCNT = 0;
+    HW_DWT_CTRL |= HW_DWT_CTRL_CYCCNTENA;
+    
+    hw_cycle_hz = freq;
+    
+    return 0;
+}
+
+os_u32 hw_cycle_get(void)
+{
+    return HW_DWT_CYCCNT;
+}
+
+os_u32 hw_cycle_freq(void)
+{
+    return hw_cycle_hz;
+}
+
+/*@}*/
+
+#if PTHREAD_STACK_GUARD_SIZE
+
+#if PTHREAD_STACK_GUARD_SIZE < 32 || PTHREAD_STACK_GUARD_SIZE & (PTHREAD_STACK_GUARD_SIZE - 1)
+    #error "the region of the MPU is a power of 2 of 32 bytes at least"
+#endif
+
+/*@{*/
+
+/* the MPU of the Cortex-M7 */
+#define HW_MPU_CTRL                 (*(volatile unsigned int *)0xE000ED94UL)
+#define HW_MPU_CTRL_ENABLE          (1UL << 0)
+#define HW_MPU_CTRL_PRIVDEFENA      (1UL << 2)
+#define HW_MPU_RNR                  (*(volatile unsigned int *)0xE000ED98UL)
+#define HW_MPU_RBAR                 (*(volatile unsigned int *)0xE000ED9CUL)
+#define HW_MPU_RASR                 (*(volatile unsigned int *)0xE000EDA0UL)
+#define HW_MPU_RASR_ENABLE          (1UL << 0)
+#define HW_MPU_RASR_SIZE(size)      ((30UL - hw_clz(size)) << 1)
+#define HW_MPU_RASR_XN              (1UL << 28)
+
+/* the highest region wins the overlap, the access permission 0 is no access */
+#define HW_MPU_GUARD_REGION         7
+
+#if defined (__IAR_SYSTEMS_ICC__)
+    #include <intrinsics.h>
+    #define HW_DSB()                __DSB()
+    #define HW_ISB()                __ISB()
+#elif defined (__CC_ARM)
+    #define HW_DSB()                __dsb(0xF)
+    #define HW_ISB()                __isb(0xF)
+#else
+    #define HW_DSB()                __asm volatile ("dsb" ::: "memory")
+    #define HW_ISB()                __asm volatile ("isb" ::: "memory")
+#endif
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * hw_stack_guard - the function will move the guard region of the MPU to the
+ *                  bottom of the stack of the thread switched to, the thread
+ *                  writing it makes the fault before the memory under the
+ *                  stack is broken. The other memory keeps the default map
+ *
+ * @param addr the address of the guard aligned to its size
+ */
+void hw_stack_guard(char *addr)
+{
+    HW_MPU_RNR  = HW_MPU_GUARD_REGION;
+    HW_MPU_RBAR = (unsigned int)addr;
+    HW_MPU_RASR = HW_MPU_RASR_XN | HW_MPU_RASR_SIZE(PTHREAD_STACK_GUARD_SIZE) | HW_MPU_RASR_ENABLE;
+    
+    if (!(HW_MPU_CTRL & HW_MPU_CTRL_ENABLE))
+        HW_MPU_CTRL = HW_MPU_CTRL_PRIVDEFENA | HW_MPU_CTRL_ENABLE;
+    
+    /* the region is moved before the code after it runs */
+    HW_DSB();
+    HW_ISB();
+}
+
+/*@}*/
+
+#endif
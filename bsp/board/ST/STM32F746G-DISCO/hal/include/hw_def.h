@@ -14,6 +14,7 @@
 /* rtos function definition */
 #define USING_SHELL 1
 #define USING_IPPORT 1
+#define USING_TRACE 1
 
 /* disable the C lib */
 #define USING_MALLOC_LIB 0
@@ -23,6 +24,9 @@
 /* define the hardware bytes align */
 #define HW_ALIGN_SIZE 4
 
+/* the MPU guards the bottom of the stack of the thread running */
+#define PTHREAD_STACK_GUARD_SIZE 32
+
 #define HW_ETH_RX_BUFFER_NUM_MAX 4
 #define HW_ETH_RX_BUFFER_LENGTH_MAX 1560
 
@@ -0,0 +1,42 @@
+#ifndef _QSPI_H_
+#define _QSPI_H_
+
+#include "types.h"
+#include "flashfs.h"
+#include "respack.h"
+
+/* the N25Q128A at the QSPI of the STM32F746G-DISCO */
+#define QSPI_FLASH_SIZE         (16UL * 1024 * 1024)
+#define QSPI_SUBSECTOR_SIZE     4096
+#define QSPI_PAGE_SIZE          256
+
+/* the upper half of the flash holds flashfs */
+#define QSPI_FLASHFS_OFFSET     (8UL * 1024 * 1024)
+#define QSPI_FLASHFS_SIZE       (QSPI_FLASH_SIZE - QSPI_FLASHFS_OFFSET)
+
+/* the lower half holds the resource pack, it is read at the memory mapped */
+#define QSPI_RESPACK_OFFSET     0
+#define QSPI_RESPACK_SIZE       QSPI_FLASHFS_OFFSET
+
+/*
+ * the flash is mapped here after qspi_mmap_enable, programming and erasing
+ * leave the memory mapped mode until they are done, so the resources are read
+ * by the pointer between qspi_mmap_lock and qspi_mmap_unlock, and flashfs
+ * waits for them
+ */
+#define QSPI_MMAP_BASE          0x90000000UL
+
+err_t qspi_configuration(void);
+int qspi_read(os_u32 addr, void *buf, os_u32 size);
+int qspi_prog(os_u32 addr, const void *buf, os_u32 size);
+int qspi_erase(os_u32 addr);
+
+err_t qspi_mmap_enable(void);
+void qspi_mmap_lock(void);
+void qspi_mmap_unlock(void);
+const void *qspi_mmap(os_u32 addr);
+err_t qspi_respack_mount(struct respack *pack);
+
+const struct flashfs_dev *qspi_flashfs_dev(void);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _TIM_H_
+#define _TIM_H_
+
+#include "types.h"
+
+err_t tim_configuration(void);
+
+#endif
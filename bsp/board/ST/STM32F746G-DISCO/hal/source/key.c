@@ -4,6 +4,9 @@
 #include "io.h"
 #include "hal.h"
 
+/* the key is scanned by the timer */
+#define KEY_SCAN_PERIOD                         100     /* ms */
+
 struct key_edge
 {
     bool low_level;
@@ -63,8 +66,10 @@ err_t key_configuration(void)
     timer_create(CLOCK_REALTIME, &sigevent, &timer);
     ASSERT_KERNEL(timer != 0);
     
-    itimerspect.it_interval.tv_nsec = 100;
-    itimerspect.it_value.tv_nsec = 100;
+    itimerspect.it_interval.tv_sec = 0;
+    itimerspect.it_interval.tv_nsec = KEY_SCAN_PERIOD * 1000000L;
+    itimerspect.it_value.tv_sec = 0;
+    itimerspect.it_value.tv_nsec = KEY_SCAN_PERIOD * 1000000L;
     timer_settime(timer, 0, &itimerspect, NULL);
     
     input_open(INPUT_KEY_FALLING_EDGE_EVENT, O_CREAT | O_RDWR);
@@ -0,0 +1,585 @@
+/*
+ * File         : qspi.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-14       DongHeng        create
+ */
+
+#include "qspi.h"
+#include "io.h"
+#include "string.h"
+#include "pthread.h"
+#include "semaphore.h"
+
+/*@{*/
+
+/* the commands of the N25Q128A */
+#define QSPI_CMD_RESET_ENABLE   0x66
+#define QSPI_CMD_RESET_MEMORY   0x99
+#define QSPI_CMD_READ_STATUS    0x05
+#define QSPI_CMD_WRITE_ENABLE   0x06
+#define QSPI_CMD_READ_VOL_CFG   0x85
+#define QSPI_CMD_WRITE_VOL_CFG  0x81
+#define QSPI_CMD_QUAD_READ      0xEB
+#define QSPI_CMD_QUAD_PROG      0x32
+#define QSPI_CMD_SUBSECTOR_ERASE 0x20
+
+#define QSPI_SR_WIP             (1 << 0)
+#define QSPI_SR_WEL             (1 << 1)
+#define QSPI_VCR_DUMMY_MASK     0xF0
+
+/* the dummy cycles of the quad reading */
+#define QSPI_DUMMY_CYCLES       10
+
+/* the D-cache line of the Cortex-M7 */
+#define QSPI_CACHE_LINE         32
+
+#define QSPI_TIMEOUT            HAL_QPSI_TIMEOUT_DEFAULT_VALUE
+#define QSPI_ERASE_TIMEOUT      800
+
+/*@}*/
+
+/*@{*/
+
+static QSPI_HandleTypeDef qspi_handle;
+
+/* the flash is mapped to QSPI_MMAP_BASE, it is left only for programming and erasing */
+static bool qspi_mapped;
+
+/* the indirect commands are taken one by one, the readers of the flash mapped take it to be counted */
+static pthread_mutex_t qspi_mutex;
+
+/* the readers of the flash mapped, the programming waits at qspi_idle until they are gone */
+static volatile os_u32 qspi_readers;
+static volatile bool qspi_waiting;
+static sem_t qspi_idle;
+
+/*@}*/
+
+/*@{*/
+
+static void qspi_gpio_init(void)
+{
+    GPIO_InitTypeDef gpio_init_structure;
+
+    __HAL_RCC_QSPI_CLK_ENABLE();
+    __HAL_RCC_QSPI_FORCE_RESET();
+    __HAL_RCC_QSPI_RELEASE_RESET();
+
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    __HAL_RCC_GPIOD_CLK_ENABLE();
+    __HAL_RCC_GPIOE_CLK_ENABLE();
+
+    gpio_init_structure.Mode  = GPIO_MODE_AF_PP;
+    gpio_init_structure.Speed = GPIO_SPEED_HIGH;
+
+    /* NCS PB6 */
+    gpio_init_structure.Pin       = GPIO_PIN_6;
+    gpio_init_structure.Pull      = GPIO_PULLUP;
+    gpio_init_structure.Alternate = GPIO_AF10_QUADSPI;
+    HAL_GPIO_Init(GPIOB, &gpio_init_structure);
+
+    /* CLK PB2 */
+    gpio_init_structure.Pin       = GPIO_PIN_2;
+    gpio_init_structure.Pull      = GPIO_NOPULL;
+    gpio_init_structure.Alternate = GPIO_AF9_QUADSPI;
+    HAL_GPIO_Init(GPIOB, &gpio_init_structure);
+
+    /* D0 PD11, D1 PD12, D3 PD13 */
+    gpio_init_structure.Pin       = GPIO_PIN_11 | GPIO_PIN_12 | GPIO_PIN_13;
+    HAL_GPIO_Init(GPIOD, &gpio_init_structure);
+
+    /* D2 PE2 */
+    gpio_init_structure.Pin       = GPIO_PIN_2;
+    HAL_GPIO_Init(GPIOE, &gpio_init_structure);
+}
+
+static void qspi_cmd_init(QSPI_CommandTypeDef *cmd, os_u8 instruction)
+{
+    cmd->InstructionMode   = QSPI_INSTRUCTION_1_LINE;
+    cmd->Instruction       = instruction;
+    cmd->AddressMode       = QSPI_ADDRESS_NONE;
+    cmd->AddressSize       = QSPI_ADDRESS_24_BITS;
+    cmd->Address           = 0;
+    cmd->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+    cmd->DataMode          = QSPI_DATA_NONE;
+    cmd->DummyCycles       = 0;
+    cmd->NbData            = 0;
+    cmd->DdrMode           = QSPI_DDR_MODE_DISABLE;
+    cmd->DdrHoldHalfCycle  = QSPI_DDR_HHC_ANALOG_DELAY;
+    cmd->SIOOMode          = QSPI_SIOO_INST_EVERY_CMD;
+}
+
+/* wait until the programming or the erasing is done */
+static int qspi_wait_ready(os_u32 timeout)
+{
+    QSPI_CommandTypeDef cmd;
+    QSPI_AutoPollingTypeDef cfg;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_READ_STATUS);
+    cmd.DataMode = QSPI_DATA_1_LINE;
+
+    cfg.Match           = 0;
+    cfg.Mask            = QSPI_SR_WIP;
+    cfg.MatchMode       = QSPI_MATCH_MODE_AND;
+    cfg.StatusBytesSize = 1;
+    cfg.Interval        = 0x10;
+    cfg.AutomaticStop   = QSPI_AUTOMATIC_STOP_ENABLE;
+
+    return HAL_QSPI_AutoPolling(&qspi_handle, &cmd, &cfg, timeout) == HAL_OK ? 0 : -EIO;
+}
+
+static int qspi_write_enable(void)
+{
+    QSPI_CommandTypeDef cmd;
+    QSPI_AutoPollingTypeDef cfg;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_WRITE_ENABLE);
+    if (HAL_QSPI_Command(&qspi_handle, &cmd, QSPI_TIMEOUT) != HAL_OK)
+        return -EIO;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_READ_STATUS);
+    cmd.DataMode = QSPI_DATA_1_LINE;
+
+    cfg.Match           = QSPI_SR_WEL;
+    cfg.Mask            = QSPI_SR_WEL;
+    cfg.MatchMode       = QSPI_MATCH_MODE_AND;
+    cfg.StatusBytesSize = 1;
+    cfg.Interval        = 0x10;
+    cfg.AutomaticStop   = QSPI_AUTOMATIC_STOP_ENABLE;
+
+    return HAL_QSPI_AutoPolling(&qspi_handle, &cmd, &cfg, QSPI_TIMEOUT) == HAL_OK ? 0 : -EIO;
+}
+
+static int qspi_reset(void)
+{
+    QSPI_CommandTypeDef cmd;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_RESET_ENABLE);
+    if (HAL_QSPI_Command(&qspi_handle, &cmd, QSPI_TIMEOUT) != HAL_OK)
+        return -EIO;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_RESET_MEMORY);
+    if (HAL_QSPI_Command(&qspi_handle, &cmd, QSPI_TIMEOUT) != HAL_OK)
+        return -EIO;
+
+    return qspi_wait_ready(QSPI_TIMEOUT);
+}
+
+/* the memory mapped mode reads the flash by the quad reading like qspi_read */
+static int qspi_mmap_enter(void)
+{
+    QSPI_CommandTypeDef cmd;
+    QSPI_MemoryMappedTypeDef cfg;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_QUAD_READ);
+    cmd.AddressMode = QSPI_ADDRESS_4_LINES;
+    cmd.DataMode    = QSPI_DATA_4_LINES;
+    cmd.DummyCycles = QSPI_DUMMY_CYCLES;
+
+    cfg.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
+    cfg.TimeOutPeriod     = 0;
+
+    return HAL_QSPI_MemoryMapped(&qspi_handle, &cmd, &cfg) == HAL_OK ? 0 : -EIO;
+}
+
+/* take the indirect commands, and wait until the readers of the flash mapped are gone */
+static void qspi_lock(void)
+{
+    phys_reg_t temp;
+    bool wait;
+
+    pthread_mutex_lock(&qspi_mutex);
+
+    temp = hw_interrupt_suspend();
+    wait = qspi_readers ? true : false;
+    qspi_waiting = wait;
+    hw_interrupt_recover(temp);
+
+    if (wait)
+        sem_wait(&qspi_idle);
+}
+
+static void qspi_unlock(void)
+{
+    pthread_mutex_unlock(&qspi_mutex);
+}
+
+/* leave the memory mapped mode before the indirect command */
+static int qspi_mmap_leave(void)
+{
+    if (qspi_mapped && HAL_QSPI_Abort(&qspi_handle) != HAL_OK)
+        return -EIO;
+
+    return 0;
+}
+
+/* map the flash again after the data is changed, the lines cached are stale */
+static int qspi_mmap_restore(os_u32 addr, os_u32 size, int err)
+{
+    os_u32 start;
+
+    if (!qspi_mapped)
+        return err;
+
+    start = (QSPI_MMAP_BASE + addr) & ~(QSPI_CACHE_LINE - 1);
+    SCB_InvalidateDCache_by_Addr((uint32_t *)start, QSPI_MMAP_BASE + addr + size - start);
+
+    if (qspi_mmap_enter() && !err)
+        err = -EIO;
+
+    return err;
+}
+
+/* set the dummy cycles of the quad reading at the volatile configuration */
+static int qspi_dummy_config(void)
+{
+    QSPI_CommandTypeDef cmd;
+    os_u8 reg;
+    int err;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_READ_VOL_CFG);
+    cmd.DataMode = QSPI_DATA_1_LINE;
+    cmd.NbData   = 1;
+    if (HAL_QSPI_Command(&qspi_handle, &cmd, QSPI_TIMEOUT) != HAL_OK ||
+        HAL_QSPI_Receive(&qspi_handle, &reg, QSPI_TIMEOUT) != HAL_OK)
+        return -EIO;
+
+    if ((err = qspi_write_enable()))
+        return err;
+
+    reg = (reg & ~QSPI_VCR_DUMMY_MASK) | (QSPI_DUMMY_CYCLES << 4);
+
+    cmd.Instruction = QSPI_CMD_WRITE_VOL_CFG;
+    if (HAL_QSPI_Command(&qspi_handle, &cmd, QSPI_TIMEOUT) != HAL_OK ||
+        HAL_QSPI_Transmit(&qspi_handle, &reg, QSPI_TIMEOUT) != HAL_OK)
+        return -EIO;
+
+    return 0;
+}
+
+/* program the flash at the indirect mode, the data is split at the page boundary */
+static int qspi_page_prog(os_u32 addr, const void *buf, os_u32 size)
+{
+    QSPI_CommandTypeDef cmd;
+    const os_u8 *p = buf;
+    os_u32 n;
+    int err;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_QUAD_PROG);
+    cmd.AddressMode = QSPI_ADDRESS_1_LINE;
+    cmd.DataMode    = QSPI_DATA_4_LINES;
+
+    while (size)
+    {
+        n = QSPI_PAGE_SIZE - addr % QSPI_PAGE_SIZE;
+        if (n > size)
+            n = size;
+
+        if ((err = qspi_write_enable()))
+            return err;
+
+        cmd.Address = addr;
+        cmd.NbData  = n;
+        if (HAL_QSPI_Command(&qspi_handle, &cmd, QSPI_TIMEOUT) != HAL_OK ||
+            HAL_QSPI_Transmit(&qspi_handle, (uint8_t *)p, QSPI_TIMEOUT) != HAL_OK)
+            return -EIO;
+
+        if ((err = qspi_wait_ready(QSPI_TIMEOUT)))
+            return err;
+
+        addr += n;
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+/* erase the subsector at the indirect mode */
+static int qspi_subsector_erase(os_u32 addr)
+{
+    QSPI_CommandTypeDef cmd;
+    int err;
+
+    if ((err = qspi_write_enable()))
+        return err;
+
+    qspi_cmd_init(&cmd, QSPI_CMD_SUBSECTOR_ERASE);
+    cmd.AddressMode = QSPI_ADDRESS_1_LINE;
+    cmd.Address     = addr;
+    if (HAL_QSPI_Command(&qspi_handle, &cmd, QSPI_TIMEOUT) != HAL_OK)
+        return -EIO;
+
+    return qspi_wait_ready(QSPI_ERASE_TIMEOUT);
+}
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * qspi_configuration - initialize the QSPI and the flash, the clock is 108 MHz
+ *
+ * @return the result
+ */
+err_t qspi_configuration(void)
+{
+    int err;
+
+    qspi_mapped = false;
+    qspi_readers = 0;
+    qspi_waiting = false;
+    pthread_mutex_init(&qspi_mutex, NULL);
+    sem_init(&qspi_idle, 0, 1);
+
+    qspi_gpio_init();
+
+    qspi_handle.Instance                = QUADSPI;
+    qspi_handle.Init.ClockPrescaler     = 1;
+    qspi_handle.Init.FifoThreshold      = 4;
+    qspi_handle.Init.SampleShifting     = QSPI_SAMPLE_SHIFTING_HALFCYCLE;
+    qspi_handle.Init.FlashSize          = POSITION_VAL(QSPI_FLASH_SIZE) - 1;
+    qspi_handle.Init.ChipSelectHighTime = QSPI_CS_HIGH_TIME_6_CYCLE;
+    qspi_handle.Init.ClockMode          = QSPI_CLOCK_MODE_0;
+    qspi_handle.Init.FlashID            = QSPI_FLASH_ID_1;
+    qspi_handle.Init.DualFlash          = QSPI_DUALFLASH_DISABLE;
+
+    if (HAL_QSPI_DeInit(&qspi_handle) != HAL_OK || HAL_QSPI_Init(&qspi_handle) != HAL_OK)
+        return -EIO;
+
+    if ((err = qspi_reset()))
+        return err;
+
+    return qspi_dummy_config();
+}
+
+/**
+ * qspi_read - read the flash at the quad mode
+ *
+ * @param addr the address of the flash
+ * @param buf the buffer
+ * @param size the bytes to be read
+ *
+ * @return the result
+ */
+int qspi_read(os_u32 addr, void *buf, os_u32 size)
+{
+    QSPI_CommandTypeDef cmd;
+    int err = 0;
+
+    if (!size)
+        return 0;
+
+    /* the indirect reading is not allowed at the memory mapped mode */
+    if (qspi_mapped)
+    {
+        qspi_mmap_lock();
+        memcpy(buf, (const void *)(QSPI_MMAP_BASE + addr), size);
+        qspi_mmap_unlock();
+        return 0;
+    }
+
+    qspi_cmd_init(&cmd, QSPI_CMD_QUAD_READ);
+    cmd.AddressMode = QSPI_ADDRESS_4_LINES;
+    cmd.Address     = addr;
+    cmd.DataMode    = QSPI_DATA_4_LINES;
+    cmd.DummyCycles = QSPI_DUMMY_CYCLES;
+    cmd.NbData      = size;
+
+    qspi_lock();
+    if (HAL_QSPI_Command(&qspi_handle, &cmd, QSPI_TIMEOUT) != HAL_OK ||
+        HAL_QSPI_Receive(&qspi_handle, buf, QSPI_TIMEOUT) != HAL_OK)
+        err = -EIO;
+    qspi_unlock();
+
+    return err;
+}
+
+/**
+ * qspi_prog - program the flash, the data is split at the page boundary. It
+ *             waits until the readers of the flash mapped unlock it
+ *
+ * @param addr the address of the flash
+ * @param buf the data, it must not be at the flash mapped
+ * @param size the bytes of the data
+ *
+ * @return the result
+ */
+int qspi_prog(os_u32 addr, const void *buf, os_u32 size)
+{
+    int err;
+
+    qspi_lock();
+
+    if (!(err = qspi_mmap_leave()))
+        err = qspi_mmap_restore(addr, size, qspi_page_prog(addr, buf, size));
+
+    qspi_unlock();
+
+    return err;
+}
+
+/**
+ * qspi_erase - erase the subsector of the flash, it waits until the readers
+ *              of the flash mapped unlock it
+ *
+ * @param addr the address of the subsector
+ *
+ * @return the result
+ */
+int qspi_erase(os_u32 addr)
+{
+    int err;
+
+    qspi_lock();
+
+    if (!(err = qspi_mmap_leave()))
+        err = qspi_mmap_restore(addr, QSPI_SUBSECTOR_SIZE, qspi_subsector_erase(addr));
+
+    qspi_unlock();
+
+    return err;
+}
+
+/**
+ * qspi_mmap_enable - map the flash to QSPI_MMAP_BASE, the flash is read by the
+ *                    pointer since then
+ *
+ * @return the result
+ */
+err_t qspi_mmap_enable(void)
+{
+    int err;
+
+    if (qspi_mapped)
+        return 0;
+
+    if ((err = qspi_mmap_enter()))
+        return err;
+
+    qspi_mapped = true;
+
+    return 0;
+}
+
+/**
+ * qspi_mmap_lock - keep the flash mapped, the programming and the erasing wait
+ *                  until it is unlocked. The readers lock it at the same time,
+ *                  and the one locking it must not program the flash
+ */
+void qspi_mmap_lock(void)
+{
+    phys_reg_t temp;
+
+    /* the new reader waits for the programming which waits for the old ones */
+    pthread_mutex_lock(&qspi_mutex);
+
+    temp = hw_interrupt_suspend();
+    qspi_readers++;
+    hw_interrupt_recover(temp);
+
+    pthread_mutex_unlock(&qspi_mutex);
+}
+
+/**
+ * qspi_mmap_unlock - let the programming and the erasing leave the memory
+ *                    mapped mode
+ */
+void qspi_mmap_unlock(void)
+{
+    phys_reg_t temp;
+
+    temp = hw_interrupt_suspend();
+    if (!--qspi_readers && qspi_waiting)
+    {
+        qspi_waiting = false;
+        sem_post(&qspi_idle);
+    }
+    hw_interrupt_recover(temp);
+}
+
+/**
+ * qspi_mmap - get the pointer of the flash mapped
+ *
+ * @param addr the address of the flash
+ *
+ * @return the pointer, NULL means the flash is not mapped
+ */
+const void *qspi_mmap(os_u32 addr)
+{
+    if (!qspi_mapped || addr >= QSPI_FLASH_SIZE)
+        return NULL;
+
+    return (const void *)(QSPI_MMAP_BASE + addr);
+}
+
+/**
+ * qspi_respack_mount - map the flash and mount the resource pack built by
+ *                      respack.py at QSPI_RESPACK_OFFSET, the data of the
+ *                      resources is read between qspi_mmap_lock and
+ *                      qspi_mmap_unlock when flashfs is used
+ *
+ * @param pack the resource pack
+ *
+ * @return the result
+ */
+err_t qspi_respack_mount(struct respack *pack)
+{
+    err_t err;
+
+    if ((err = qspi_mmap_enable()))
+        return err;
+
+    qspi_mmap_lock();
+    err = respack_mount(pack, qspi_mmap(QSPI_RESPACK_OFFSET), QSPI_RESPACK_SIZE);
+    qspi_mmap_unlock();
+
+    return err;
+}
+
+/*@}*/
+
+/*@{*/
+
+static int qspi_flashfs_read(const struct flashfs_dev *dev, os_u32 block, os_u32 off, void *buf, os_u32 size)
+{
+    return qspi_read(QSPI_FLASHFS_OFFSET + block * dev->block_size + off, buf, size);
+}
+
+static int qspi_flashfs_prog(const struct flashfs_dev *dev, os_u32 block, os_u32 off, const void *buf, os_u32 size)
+{
+    return qspi_prog(QSPI_FLASHFS_OFFSET + block * dev->block_size + off, buf, size);
+}
+
+static int qspi_flashfs_erase(const struct flashfs_dev *dev, os_u32 block)
+{
+    return qspi_erase(QSPI_FLASHFS_OFFSET + block * dev->block_size);
+}
+
+/* every programming waits for its end, nothing is left to be synchronized */
+static const struct flashfs_dev qspi_flashfs =
+{
+    QSPI_SUBSECTOR_SIZE,
+    QSPI_FLASHFS_SIZE / QSPI_SUBSECTOR_SIZE,
+    1,
+    qspi_flashfs_read,
+    qspi_flashfs_prog,
+    qspi_flashfs_erase,
+    NULL,
+    NULL
+};
+
+/**
+ * qspi_flashfs_dev - the flash device of flashfs, it is valid after
+ *                    qspi_configuration
+ */
+const struct flashfs_dev *qspi_flashfs_dev(void)
+{
+    return &qspi_flashfs;
+}
+
+/*@}*/
@@ -1,5 +1,6 @@
 #include "sys_tick.h"
 #include "io.h"
+#include "trace.h"
 
 err_t tick_configuration(void)
 {
@@ -7,6 +8,9 @@ err_t tick_configuration(void)
 
     HAL_NVIC_SetPriority(SysTick_IRQn, TICK_INT_PRIORITY ,0);
     
+    /* the clocks are interpolated by the cycle counter between the ticks */
+    hw_cycle_init(HAL_RCC_GetHCLKFreq());
+    
     return 0;
 }
 
@@ -14,5 +18,9 @@ void SysTick_Handler(void)
 {
     extern void os_timetick(void);
     
+    TRACE_ISR_ENTER(SysTick_IRQn + 16);
+    
     os_timetick();
+    
+    TRACE_ISR_EXIT(SysTick_IRQn + 16);
 }
@@ -0,0 +1,128 @@
+/*
+ * File         : tim.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-21       DongHeng        create
+ */
+
+#include "tim.h"
+#include "io.h"
+#include "hrtimer.h"
+#include "debug.h"
+#include "trace.h"
+
+/*@{*/
+
+/* the 32 bits TIM2 runs freely, the compare of channel 1 is the event of the hrtimer */
+#define HRTIM                   TIM2
+#define HRTIM_IRQn              TIM2_IRQn
+
+/* the event shorter than the interrupt entry and the programming is raised at once */
+#define HRTIM_MIN_NS            2000U
+
+/* the counter wraps in 39 seconds at 108 MHz, the longer expiry takes more events */
+#define HRTIM_MAX_NS            1000000000U
+
+/*@}*/
+
+/*@{*/
+
+static TIM_HandleTypeDef tim_handle;
+
+/* the counts of a nanosecond in 32.32 fixed point */
+static os_u64 tim_mult;
+
+/*@}*/
+
+/*@{*/
+
+static void tim_set_event(os_u32 ns)
+{
+    os_u32 counts = (os_u32)((ns * tim_mult) >> 32);
+
+    HRTIM->DIER &= ~TIM_DIER_CC1IE;
+    HRTIM->CCR1 = HRTIM->CNT + counts;
+    HRTIM->SR = ~TIM_SR_CC1IF;
+    HRTIM->DIER |= TIM_DIER_CC1IE;
+
+    /* the compare passed while it was written is raised by the software */
+    if ((os_s32)(HRTIM->CNT - HRTIM->CCR1) >= 0)
+        HRTIM->EGR = TIM_EGR_CC1G;
+}
+
+static void tim_stop(void)
+{
+    HRTIM->DIER &= ~TIM_DIER_CC1IE;
+    HRTIM->SR = ~TIM_SR_CC1IF;
+}
+
+static const struct hrtimer_dev tim_hrtimer_dev =
+{
+    "tim2",
+    HRTIM_MIN_NS,
+    HRTIM_MAX_NS,
+    tim_set_event,
+    tim_stop
+};
+
+/*@}*/
+
+/**
+ * tim_configuration - start TIM2 at the timer clock of APB1 and register it
+ *                     as the event device of the hrtimer
+ *
+ * @return the result
+ */
+err_t tim_configuration(void)
+{
+    os_u32 freq;
+
+    __HAL_RCC_TIM2_CLK_ENABLE();
+
+    /* the timers of APB1 run at twice the bus clock when it is divided */
+    freq = HAL_RCC_GetPCLK1Freq();
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1)
+        freq *= 2;
+    tim_mult = ((os_u64)freq << 32) / 1000000000ULL;
+
+    tim_handle.Instance               = HRTIM;
+    tim_handle.Init.Prescaler         = 0;
+    tim_handle.Init.CounterMode       = TIM_COUNTERMODE_UP;
+    tim_handle.Init.Period            = 0xFFFFFFFF;
+    tim_handle.Init.ClockDivision     = TIM_CLOCKDIVISION_DIV1;
+    tim_handle.Init.RepetitionCounter = 0;
+    if (HAL_TIM_Base_Init(&tim_handle) != HAL_OK)
+        return -EIO;
+
+    /* the channel 1 is frozen, only its compare flag is used */
+    HRTIM->CCMR1 &= ~TIM_CCMR1_OC1M;
+    tim_stop();
+
+    HAL_NVIC_SetPriority(HRTIM_IRQn, TICK_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(HRTIM_IRQn);
+
+    if (HAL_TIM_Base_Start(&tim_handle) != HAL_OK)
+        return -EIO;
+
+    return hrtimer_register(&tim_hrtimer_dev);
+}
+
+void TIM2_IRQHandler(void)
+{
+    if (!(HRTIM->SR & TIM_SR_CC1IF) || !(HRTIM->DIER & TIM_DIER_CC1IE))
+        return ;
+
+    TRACE_ISR_ENTER(HRTIM_IRQn + 16);
+
+    /* the event is one shot, the hrtimer programs the next one */
+    tim_stop();
+
+    hrtimer_interrupt();
+
+    TRACE_ISR_EXIT(HRTIM_IRQn + 16);
+}
+
+/*@}*/
@@ -11,6 +11,9 @@
 err_t tick_confugration(void)
 {
     SysTick_Config( SystemCoreClock / (ONE_SENCOND / HAL_SYS_TIMER_PERIODIC) );
+    
+    /* the clocks are interpolated by the cycle counter between the ticks */
+    hw_cycle_init(SystemCoreClock);
   
     return 0;
 }
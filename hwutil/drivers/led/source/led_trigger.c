@@ -93,8 +93,10 @@ err_t led_heart_trigger_init(struct led_heart_trigger *trigger)
     timer_create(CLOCK_REALTIME, &sigevent, &timer);    
     ASSERT_KERNEL(timer != 0);
     
-    itimerspect.it_interval.tv_nsec = HEART_TRIGGER_TIME;
-    itimerspect.it_value.tv_nsec = HEART_TRIGGER_TIME;
+    itimerspect.it_interval.tv_sec = 0;
+    itimerspect.it_interval.tv_nsec = HEART_TRIGGER_TIME * 1000000L;
+    itimerspect.it_value.tv_sec = 0;
+    itimerspect.it_value.tv_nsec = HEART_TRIGGER_TIME * 1000000L;
     timer_settime(timer, 0, &itimerspect, NULL);
   
     return 0;
@@ -156,8 +158,10 @@ err_t led_event_trigger_init(struct led_event_trigger *trigger)
     timer_create(CLOCK_REALTIME, &sigevent, &timer);    
     ASSERT_KERNEL(timer != 0);
     
-    itimerspect.it_interval.tv_nsec = EVENT_TRIGGER_TIME;
-    itimerspect.it_value.tv_nsec = EVENT_TRIGGER_TIME;
+    itimerspect.it_interval.tv_sec = 0;
+    itimerspect.it_interval.tv_nsec = EVENT_TRIGGER_TIME * 1000000L;
+    itimerspect.it_value.tv_sec = 0;
+    itimerspect.it_value.tv_nsec = EVENT_TRIGGER_TIME * 1000000L;
     timer_settime(timer, 0, &itimerspect, NULL);
   
     return 0;
@@ -2,6 +2,10 @@
 #define _MMC_H_
 
 #include "mmc_err.h"
+#include "semaphore.h"
+
+/* the bytes of one data block */
+#define MMC_BLOCK_SIZE                 512
 
 typedef struct _SD_CSD
 {
@@ -78,13 +82,32 @@ struct mmc
     
     os_u8 (*read_write) (os_u8 byte);
     
+    /* 
+     * start a full duplex DMA transfer, "tx" is NULL means sending dummy bytes
+     * and "rx" is NULL means discarding the received bytes, the driver should
+     * call "mmc_dma_complete" at its DMA interrupt, it can be NULL
+     */
+    void (*dma_transfer) (struct mmc *mmc, const os_u8 *tx, os_u8 *rx, size_t len);
+    
     sd_card_info_t    sd_card_info;
     
     card_type_t       card_type;
+    
+    /* the DMA transfer completion */
+    sem_t             dma_sem;
 };
 typedef struct mmc mmc_t;
 
 
 sd_err mmc_open(struct mmc *mmc);
+sd_err mmc_read_blocks(struct mmc *mmc, os_u8 *buf, os_u32 sector, os_u32 count);
+sd_err mmc_write_blocks(struct mmc *mmc, const os_u8 *buf, os_u32 sector, os_u32 count);
+sd_err mmc_sync(struct mmc *mmc);
+sd_err mmc_get_sector_count(struct mmc *mmc, os_u32 *count);
+void mmc_dma_complete(struct mmc *mmc);
+
+#if USING_DISK_PORT
+err_t mmc_diskio_register(os_u8 pdrv, struct mmc *mmc);
+#endif
 
 #endif
@@ -21,8 +21,17 @@
 /* card version */
 #define VER_IS_SDHC                      (0x01)
 
+/* the retry times of waiting for the card */
+#define MMC_BUSY_RETRY                   (500000)
+#define MMC_TOKEN_RETRY                  (100000)
+
+/* the address of the block */
+#define MMC_BLOCK_ADDR(mmc, sector) \
+            (VER_IS_SDHC == (mmc)->card_type ? (sector) : (sector) * MMC_BLOCK_SIZE)
+
 /**
-  * the function will send the cmd and get the rsponses
+  * the function will send the cmd and get the rsponses, the caller should
+  * select the card
   *
   * @param mmc  the point of the mmc discription
   * @param cmd  the command
@@ -31,14 +40,12 @@
   *
   * @return the result or the SD_RESPONSE_FAILURE
   */
-static sd_err mmc_send_cmd(struct mmc *mmc, os_u8 cmd, os_u32 arg, os_u8 crc)
+static sd_err __mmc_send_cmd(struct mmc *mmc, os_u8 cmd, os_u32 arg, os_u8 crc)
 {
     int i;
     os_u8 frame[6];
     sd_err resp;
     
-    mmc->select();
-    
     /* fill the frame to be sent */
     frame[0] = (cmd | 0x40);
     frame[1] = (os_u8)(arg >> 24);
@@ -52,6 +59,10 @@ static sd_err mmc_send_cmd(struct mmc *mmc, os_u8 cmd, os_u32 arg, os_u8 crc)
         mmc->read_write(frame[i]);
     }
     
+    /* the stuff byte follows the stop command */
+    if (SD_CMD_STOP_TRANSMISSION == cmd)
+        mmc->read_write(DUMMY_BYTE);
+    
     /* get the responses */
     i = 2000;
     do{
@@ -59,8 +70,6 @@ static sd_err mmc_send_cmd(struct mmc *mmc, os_u8 cmd, os_u32 arg, os_u8 crc)
         i--;
     }while (resp == DUMMY_BYTE && i);
     
-    mmc->release();
-    
     if (i)
     {
         return resp;
@@ -71,6 +80,144 @@ static sd_err mmc_send_cmd(struct mmc *mmc, os_u8 cmd, os_u32 arg, os_u8 crc)
     }
 }
 
+/**
+  * the function will send the cmd and get the rsponses
+  *
+  * @param mmc  the point of the mmc discription
+  * @param cmd  the command
+  * @param arg  the paramter of the command
+  * @param crc  the crc of the command and the paramter
+  *
+  * @return the result or the SD_RESPONSE_FAILURE
+  */
+static sd_err mmc_send_cmd(struct mmc *mmc, os_u8 cmd, os_u32 arg, os_u8 crc)
+{
+    sd_err resp;
+    
+    mmc->select();
+    
+    resp = __mmc_send_cmd(mmc, cmd, arg, crc);
+    
+    mmc->release();
+    
+    return resp;
+}
+
+/**
+  * the function will wait until the card is not busy
+  *
+  * @param mmc  the point of the mmc discription
+  *
+  * @return the result
+  */
+static sd_err mmc_wait_ready(struct mmc *mmc)
+{
+    int i = MMC_BUSY_RETRY;
+    
+    while (mmc->read_write(DUMMY_BYTE) != DUMMY_BYTE)
+    {
+        if (!--i)
+            return SD_RESPONSE_FAILURE;
+    }
+    
+    return SD_RESPONSE_NO_ERROR;
+}
+
+/**
+  * the function will transfer the bytes by DMA if the hardware supports it,
+  * the thread sleeps until the transfer is completed
+  *
+  * @param mmc  the point of the mmc discription
+  * @param tx   the bytes to be sent, NULL means the dummy bytes
+  * @param rx   the buffer to be received, NULL means discarding them
+  * @param len  the bytes to be transfered
+  */
+static void mmc_transfer(struct mmc *mmc, const os_u8 *tx, os_u8 *rx, size_t len)
+{
+    size_t i;
+    os_u8 byte;
+  
+    if (mmc->dma_transfer)
+    {
+        mmc->dma_transfer(mmc, tx, rx, len);
+        
+        sem_wait(&mmc->dma_sem);
+        
+        return ;
+    }
+    
+    for (i = 0; i < len; i++)
+    {
+        byte = mmc->read_write(tx ? tx[i] : DUMMY_BYTE);
+        
+        if (rx)
+            rx[i] = byte;
+    }
+}
+
+/**
+  * the function will receive one data block
+  *
+  * @param mmc  the point of the mmc discription
+  * @param buf  the buffer to be received
+  * @param len  the bytes of the block
+  *
+  * @return the result
+  */
+static sd_err mmc_rx_block(struct mmc *mmc, os_u8 *buf, size_t len)
+{
+    int i = MMC_TOKEN_RETRY;
+    os_u8 token;
+    
+    /* wait for the data token */
+    do{
+        token = mmc->read_write(DUMMY_BYTE);
+    }while (token == DUMMY_BYTE && --i);
+    
+    if (SD_START_DATA_SINGLE_BLOCK_READ != token)
+        return SD_DATA_OTHER_ERROR;
+    
+    mmc_transfer(mmc, NULL, buf, len);
+    
+    /* discard the CRC */
+    mmc->read_write(DUMMY_BYTE);
+    mmc->read_write(DUMMY_BYTE);
+    
+    return SD_RESPONSE_NO_ERROR;
+}
+
+/**
+  * the function will send one data block
+  *
+  * @param mmc    the point of the mmc discription
+  * @param buf    the buffer to be sent
+  * @param token  the start token of the block
+  *
+  * @return the result
+  */
+static sd_err mmc_tx_block(struct mmc *mmc, const os_u8 *buf, os_u8 token)
+{
+    os_u8 resp;
+    
+    if (mmc_wait_ready(mmc))
+        return SD_RESPONSE_FAILURE;
+    
+    mmc->read_write(token);
+    
+    mmc_transfer(mmc, buf, NULL, MMC_BLOCK_SIZE);
+    
+    /* the dummy CRC */
+    mmc->read_write(DUMMY_BYTE);
+    mmc->read_write(DUMMY_BYTE);
+    
+    /* check the data response */
+    resp = mmc->read_write(DUMMY_BYTE) & 0x1F;
+    if (SD_DATA_OK != resp)
+        return resp;
+    
+    return SD_RESPONSE_NO_ERROR;
+}
+
 /**
   * the function will init the sdhc
   *
@@ -128,7 +275,7 @@ static sd_err mmc_sdhc_init(struct mmc *mmc)
   *
   * @param mmc  the point of the mmc discription
   * 
-  * @return the result
+  * @return SD_RESPONSE_NO_ERROR if the card is ready, otherwise the error
   */
 sd_err mmc_open(struct mmc *mmc)
 {
@@ -136,8 +283,11 @@ sd_err mmc_open(struct mmc *mmc)
     sd_err ver;
     int i;
   
+    sem_init(&mmc->dma_sem, 0, 1);
+    
     /* open and init the hardware */
-    err = mmc->open(mmc);
+    if ((err = mmc->open(mmc)) != SD_RESPONSE_NO_ERROR)
+        return err;
     
     mmc->release();
      
@@ -149,21 +299,284 @@ sd_err mmc_open(struct mmc *mmc)
     
     /* set mmc to spi mode */
     err = mmc_send_cmd(mmc, SD_CMD_GO_IDLE_STATE, 0, 0x95);
-    ASSERT_KERNEL(err == SD_IN_IDLE_STATE);
+    if (err != SD_IN_IDLE_STATE)
+        return SD_RESPONSE_FAILURE;
     
     /* check card version and handle */
     ver = mmc_send_cmd(mmc, SD_CMD_CHECK_VER, 0x1AA, 0x87);
-    ASSERT_KERNEL(ver != SD_RESPONSE_FAILURE);    
     switch(ver)
     {
         case VER_IS_SDHC : 
-                ver = mmc_sdhc_init(mmc);
+                err = mmc_sdhc_init(mmc);
                 break;
                 
         default :
-                ver = SD_RESPONSE_FAILURE;
+                err = SD_RESPONSE_FAILURE;
                 break;
     }
   
     return err;
 }
+
+/**
+  * the function will read the blocks, the multiple block reading is used when
+  * the count is more than one
+  *
+  * @param mmc     the point of the mmc discription
+  * @param buf     the buffer to be received
+  * @param sector  the start sector
+  * @param count   the number of the sectors
+  * 
+  * @return the result
+  */
+sd_err mmc_read_blocks(struct mmc *mmc, os_u8 *buf, os_u32 sector, os_u32 count)
+{
+    sd_err err;
+    os_u8 cmd = count > 1 ? SD_CMD_READ_MULT_BLOCK : SD_CMD_READ_SINGLE_BLOCK;
+    
+    if (!count)
+        return SD_PARAMETER_ERROR;
+    
+    mmc->select();
+    
+    if ((err = __mmc_send_cmd(mmc, cmd, MMC_BLOCK_ADDR(mmc, sector), 0xff)))
+        goto out;
+    
+    while (count)
+    {
+        if ((err = mmc_rx_block(mmc, buf, MMC_BLOCK_SIZE)))
+            break;
+        
+        buf += MMC_BLOCK_SIZE;
+        count--;
+    }
+    
+    if (SD_CMD_READ_MULT_BLOCK == cmd)
+    {
+        __mmc_send_cmd(mmc, SD_CMD_STOP_TRANSMISSION, 0, 0xff);
+        mmc_wait_ready(mmc);
+    }
+    
+out:
+    mmc->release();
+    mmc->read_write(DUMMY_BYTE);
+    
+    return err;
+}
+
+/**
+  * the function will write the blocks, the multiple block writing is used when
+  * the count is more than one
+  *
+  * @param mmc     the point of the mmc discription
+  * @param buf     the buffer to be sent
+  * @param sector  the start sector
+  * @param count   the number of the sectors
+  * 
+  * @return the result
+  */
+sd_err mmc_write_blocks(struct mmc *mmc, const os_u8 *buf, os_u32 sector, os_u32 count)
+{
+    sd_err err;
+    
+    if (!count)
+        return SD_PARAMETER_ERROR;
+    
+    mmc->select();
+    
+    if (1 == count)
+    {
+        if (!(err = __mmc_send_cmd(mmc, SD_CMD_WRITE_SINGLE_BLOCK, MMC_BLOCK_ADDR(mmc, sector), 0xff)))
+            err = mmc_tx_block(mmc, buf, SD_START_DATA_SINGLE_BLOCK_WRITE);
+    }
+    else
+    {
+        /* tell the card to pre-erase the blocks for the faster writing */
+        __mmc_send_cmd(mmc, SD_CMD_SET_EX_MODE, 0, 0xff);
+        __mmc_send_cmd(mmc, SD_CMD_SET_BLOCK_COUNT, count, 0xff);
+        
+        if (!(err = __mmc_send_cmd(mmc, SD_CMD_WRITE_MULT_BLOCK, MMC_BLOCK_ADDR(mmc, sector), 0xff)))
+        {
+            while (count)
+            {
+                if ((err = mmc_tx_block(mmc, buf, SD_START_DATA_MULTIPLE_BLOCK_WRITE)))
+                    break;
+                
+                buf += MMC_BLOCK_SIZE;
+                count--;
+            }
+            
+            mmc_wait_ready(mmc);
+            mmc->read_write(SD_STOP_DATA_MULTIPLE_BLOCK_WRITE);
+        }
+    }
+    
+    /* wait for the programming of the card */
+    if (mmc_wait_ready(mmc) && !err)
+        err = SD_RESPONSE_FAILURE;
+    
+    mmc->release();
+    mmc->read_write(DUMMY_BYTE);
+    
+    return err;
+}
+
+/**
+  * the function will wait until the card finishes the programming
+  *
+  * @param mmc  the point of the mmc discription
+  * 
+  * @return the result
+  */
+sd_err mmc_sync(struct mmc *mmc)
+{
+    sd_err err;
+  
+    mmc->select();
+    err = mmc_wait_ready(mmc);
+    mmc->release();
+    
+    return err;
+}
+
+/**
+  * the function will read the CSD and compute the number of the sectors
+  *
+  * @param mmc    the point of the mmc discription
+  * @param count  the number of the sectors
+  * 
+  * @return the result
+  */
+sd_err mmc_get_sector_count(struct mmc *mmc, os_u32 *count)
+{
+    sd_err err;
+    os_u8 csd[16];
+    
+    mmc->select();
+    
+    if (!(err = __mmc_send_cmd(mmc, SD_CMD_SEND_CSD, 0, 0xff)))
+        err = mmc_rx_block(mmc, csd, sizeof(csd));
+    
+    mmc->release();
+    mmc->read_write(DUMMY_BYTE);
+    
+    if (err)
+        return err;
+    
+    if ((csd[0] >> 6) == 1)
+    {
+        /* CSD version 2.0, the capacity is (C_SIZE + 1) * 512KB */
+        os_u32 c_size = ((os_u32)(csd[7] & 0x3F) << 16) | ((os_u32)csd[8] << 8) | csd[9];
+        
+        *count = (c_size + 1) << 10;
+    }
+    else
+    {
+        /* CSD version 1.0 */
+        os_u32 c_size = ((os_u32)(csd[6] & 0x03) << 10) | ((os_u32)csd[7] << 2) | (csd[8] >> 6);
+        os_u8 n = (csd[5] & 0x0F) + ((csd[10] & 0x80) >> 7) + ((csd[9] & 0x03) << 1) + 2;
+        
+        *count = (c_size + 1) << (n - 9);
+    }
+    
+    return SD_RESPONSE_NO_ERROR;
+}
+
+/**
+  * the function will be called at the DMA interrupt when the transfer is
+  * completed
+  *
+  * @param mmc  the point of the mmc discription
+  */
+void mmc_dma_complete(struct mmc *mmc)
+{
+    sem_post(&mmc->dma_sem);
+}
+
+/******************************************************************************/
+
+#if USING_DISK_PORT
+
+#include "diskio.h"
+
+/* the mmc device of the FatFs */
+static struct mmc *mmc_diskio;
+
+/* the card is opened successfully */
+static bool mmc_diskio_ready;
+
+static DSTATUS mmc_disk_status(void)
+{
+    return mmc_diskio_ready ? RES_OK : STA_NOINIT;
+}
+
+static DSTATUS mmc_disk_init(void)
+{
+    mmc_diskio_ready = mmc_diskio && mmc_open(mmc_diskio) == SD_RESPONSE_NO_ERROR;
+  
+    return mmc_diskio_ready ? RES_OK : STA_NOINIT;
+}
+
+static DRESULT mmc_disk_read(BYTE *buff, DWORD sector, UINT count)
+{
+    return mmc_read_blocks(mmc_diskio, buff, sector, count) ? RES_ERROR : RES_OK;
+}
+
+static DRESULT mmc_disk_write(const BYTE *buff, DWORD sector, UINT count)
+{
+    return mmc_write_blocks(mmc_diskio, buff, sector, count) ? RES_ERROR : RES_OK;
+}
+
+static DRESULT mmc_disk_ioctl(BYTE cmd, void *buff)
+{
+    DRESULT res = RES_OK;
+  
+    switch (cmd)
+    {
+        case CTRL_SYNC:
+                if (mmc_sync(mmc_diskio))
+                    res = RES_ERROR;
+                break;
+        case GET_SECTOR_COUNT:
+                if (mmc_get_sector_count(mmc_diskio, (os_u32 *)buff))
+                    res = RES_ERROR;
+                break;
+        case GET_SECTOR_SIZE:
+                *(WORD *)buff = MMC_BLOCK_SIZE;
+                break;
+        case GET_BLOCK_SIZE:
+                *(DWORD *)buff = 1;
+                break;
+        default:
+                res = RES_PARERR;
+                break;
+    }
+    
+    return res;
+}
+
+/**
+  * the function will register the mmc device as the physical drive of FatFs
+  *
+  * @param pdrv  the physical drive number
+  * @param mmc   the point of the mmc discription
+  * 
+  * @return the result
+  */
+err_t mmc_diskio_register(os_u8 pdrv, struct mmc *mmc)
+{
+    struct diskio_port port;
+    
+    mmc_diskio = mmc;
+    mmc_diskio_ready = false;
+    
+    port.disk_status = mmc_disk_status;
+    port.disk_init   = mmc_disk_init;
+    port.disk_read   = mmc_disk_read;
+    port.disk_write  = mmc_disk_write;
+    port.disk_ioctl  = mmc_disk_ioctl;
+    
+    return diskio_port_register(pdrv, &port);
+}
+
+#endif
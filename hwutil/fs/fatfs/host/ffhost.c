@@ -0,0 +1,149 @@
+/*
+ * File         : ffhost.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ * 
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-12       DongHeng        create
+ */
+
+/*
+ * the benchmark of FatFs at the Linux host, it runs ff.c, diskio.c and the 
+ * benchmarks of ffbench.c on the ram disk or the image file mapped:
+ *
+ *   gcc -O2 -I hwutil/fs/host -I hwutil/fs/fatfs/host -I hwutil/fs/fatfs/include 
+ *       -idirafter hwutil/kernel/include
+ *       hwutil/fs/fatfs/host/ffhost.c hwutil/fs/fatfs/host/imgdisk.c
+ *       hwutil/fs/fatfs/source/ff.c
+ *       hwutil/fs/fatfs/source/diskio.c hwutil/fs/fatfs/source/syscall.c 
+ *       hwutil/fs/fatfs/source/ramdisk.c hwutil/fs/fatfs/source/ffbench.c 
+ *       hwutil/fs/fatfs/source/ccsbcs.c -lpthread -o ffhost
+ *
+ *   ./ffhost              run at the ram disk of FFHOST_RAM_SECTORS
+ *   ./ffhost fat.img      run at the image, it is formatted if no FAT found
+ */
+
+#include "ffbench.h"
+#include "ramdisk.h"
+#include "imgdisk.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*@{*/
+
+/* the size of the ram disk, 16 MB */
+#define FFHOST_RAM_SECTORS      (32UL * 1024)
+
+/* the sizes of the benchmarks */
+#define FFHOST_SEQ_SIZE         (8UL * 1024 * 1024)
+#define FFHOST_SEQ_CHUNK        (4U * 1024)
+#define FFHOST_META_NUM         2000
+#define FFHOST_META_SIZE        512
+#define FFHOST_LOG_SIZE         (8UL * 1024 * 1024)
+#define FFHOST_LOG_CHUNK        (512U)
+#define FFHOST_SEEK_SIZE        (4UL * 1024 * 1024)
+#define FFHOST_SEEK_NUM         10000
+
+/*@}*/
+
+/**
+ * get_fattime - the timestamp of FatFs comes from the host clock
+ */
+DWORD get_fattime (void)
+{
+    time_t now = time(NULL);
+    struct tm *tm = localtime(&now);
+    
+    return (DWORD)(tm->tm_year - 80) << 25 | (DWORD)(tm->tm_mon + 1) << 21
+           | (DWORD)tm->tm_mday << 16 | (DWORD)tm->tm_hour << 11
+           | (DWORD)tm->tm_min << 5 | (DWORD)tm->tm_sec >> 1;
+}
+
+int main(int argc, char *argv[])
+{
+    struct ffbench_result seq;
+    struct ffbench_meta_result meta;
+    struct ffbench_append_result append;
+    struct ffbench_seek_result seek;
+    int prealloc;
+    struct diskio_cache_stat stat;
+    FRESULT res;
+    err_t err;
+    
+    diskio_port_init();
+    
+    if (argc > 1)
+        err = imgdisk_register(0, argv[1]);
+    else
+    {
+        BYTE *mem = calloc(FFHOST_RAM_SECTORS, RAMDISK_SECTOR_SIZE);
+        
+        err = mem ? ramdisk_register(0, mem, FFHOST_RAM_SECTORS) : -ENOMEM;
+    }
+    if (err)
+    {
+        fprintf(stderr, "disk failed (%d)\n", err);
+        return 1;
+    }
+    
+    if ((res = ffbench_mount("")) == FR_NO_FILESYSTEM)
+    {
+        if ((res = f_mkfs("", 1, 0)) == FR_OK)
+            res = ffbench_mount("");
+    }
+    if (res != FR_OK)
+    {
+        fprintf(stderr, "mount failed (%d)\n", res);
+        return 1;
+    }
+    
+    if ((res = ffbench_seq("seq.bin", FFHOST_SEQ_SIZE, FFHOST_SEQ_CHUNK, &seq)) != FR_OK)
+        goto fail;
+    printf("sequential %lu KB, chunk %u bytes\n", (unsigned long)seq.bytes / 1024, FFHOST_SEQ_CHUNK);
+    printf("write %lu ms, %lu KB/s\n", (unsigned long)seq.write_ms, 
+           (unsigned long)ffbench_rate(seq.bytes, seq.write_ms));
+    printf("read  %lu ms, %lu KB/s\n", (unsigned long)seq.read_ms, 
+           (unsigned long)ffbench_rate(seq.bytes, seq.read_ms));
+    
+    if ((res = ffbench_meta("meta", FFHOST_META_NUM, FFHOST_META_SIZE, &meta)) != FR_OK)
+        goto fail;
+    printf("small file %u x %u bytes\n", FFHOST_META_NUM, FFHOST_META_SIZE);
+    printf("create %lu ms, open %lu ms, list %lu ms (%lu entries), delete %lu ms\n",
+           (unsigned long)meta.create_ms, (unsigned long)meta.open_ms, (unsigned long)meta.list_ms, 
+           (unsigned long)meta.files, (unsigned long)meta.unlink_ms);
+    
+    for (prealloc = 0; prealloc < 2; prealloc++)
+    {
+        if ((res = ffbench_append("log.bin", FFHOST_LOG_SIZE, FFHOST_LOG_CHUNK, prealloc, &append)) != FR_OK)
+            goto fail;
+        printf("append %s %lu KB in %lu ms, slowest %lu ms\n", prealloc ? "extent" : "chain ",
+               (unsigned long)append.bytes / 1024, (unsigned long)append.total_ms, 
+               (unsigned long)append.max_ms);
+    }
+    
+    if ((res = ffbench_seek("seek.bin", FFHOST_SEEK_SIZE, FFHOST_SEEK_NUM, &seek)) != FR_OK)
+        goto fail;
+    printf("random seek %lu times, FAT chain %lu ms, link map %lu ms (%lu items)\n",
+           (unsigned long)seek.seeks, (unsigned long)seek.chain_ms, 
+           (unsigned long)seek.map_ms, (unsigned long)seek.map_items);
+    
+    diskio_cache_stat(&stat);
+    printf("cache hit %lu, miss %lu, read ahead %lu, write back %lu, bypass %lu\n",
+           (unsigned long)stat.hit, (unsigned long)stat.miss, (unsigned long)stat.read_ahead,
+           (unsigned long)stat.write_back, (unsigned long)stat.bypass);
+    
+    f_mount(NULL, "", 0);
+    imgdisk_close();
+    
+    return 0;
+    
+fail:
+    fprintf(stderr, "benchmark failed (%d)\n", res);
+    f_mount(NULL, "", 0);
+    imgdisk_close();
+    
+    return 1;
+}
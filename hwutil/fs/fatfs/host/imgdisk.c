@@ -0,0 +1,142 @@
+/*
+ * File         : imgdisk.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ * 
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-12       DongHeng        create
+ */
+
+#include "imgdisk.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*@{*/
+
+/* the image file mapped and the sectors of it */
+static int imgdisk_fd = -1;
+static BYTE *imgdisk_mem;
+static DWORD imgdisk_sectors;
+
+/*@}*/
+
+/*@{*/
+
+static DSTATUS imgdisk_status(void)
+{
+    return imgdisk_mem ? RES_OK : STA_NOINIT;
+}
+
+static DSTATUS imgdisk_init(void)
+{
+    return imgdisk_mem ? RES_OK : STA_NOINIT;
+}
+
+static DRESULT imgdisk_read(BYTE *buff, DWORD sector, UINT count)
+{
+    if (sector + count > imgdisk_sectors)
+        return RES_PARERR;
+    
+    memcpy(buff, imgdisk_mem + (size_t)sector * IMGDISK_SECTOR_SIZE, count * IMGDISK_SECTOR_SIZE);
+    
+    return RES_OK;
+}
+
+static DRESULT imgdisk_write(const BYTE *buff, DWORD sector, UINT count)
+{
+    if (sector + count > imgdisk_sectors)
+        return RES_PARERR;
+    
+    memcpy(imgdisk_mem + (size_t)sector * IMGDISK_SECTOR_SIZE, buff, count * IMGDISK_SECTOR_SIZE);
+    
+    return RES_OK;
+}
+
+static DRESULT imgdisk_ioctl(BYTE cmd, void *buff)
+{
+    DRESULT res = RES_OK;
+  
+    switch (cmd)
+    {
+        case CTRL_SYNC:
+                if (msync(imgdisk_mem, (size_t)imgdisk_sectors * IMGDISK_SECTOR_SIZE, MS_SYNC))
+                    res = RES_ERROR;
+                break;
+        case GET_SECTOR_COUNT:
+                *(DWORD *)buff = imgdisk_sectors;
+                break;
+        case GET_SECTOR_SIZE:
+                *(WORD *)buff = IMGDISK_SECTOR_SIZE;
+                break;
+        case GET_BLOCK_SIZE:
+                *(DWORD *)buff = 1;
+                break;
+        default:
+                res = RES_PARERR;
+                break;
+    }
+    
+    return res;
+}
+
+/**
+  * the function will map the image file as the physical drive of FatFs
+  *
+  * @param pdrv  the physical drive number
+  * @param path  the path of the image file, its size is the size of the disk
+  * 
+  * @return the result
+  */
+err_t imgdisk_register(BYTE pdrv, const char *path)
+{
+    struct diskio_port port;
+    struct stat st;
+    void *mem;
+    
+    if ((imgdisk_fd = open(path, O_RDWR)) < 0)
+        return -ENOENT;
+    
+    if (fstat(imgdisk_fd, &st) || st.st_size < IMGDISK_SECTOR_SIZE
+        || (mem = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, imgdisk_fd, 0)) == MAP_FAILED)
+    {
+        close(imgdisk_fd);
+        imgdisk_fd = -1;
+        return -EINVAL;
+    }
+    
+    imgdisk_mem = mem;
+    imgdisk_sectors = st.st_size / IMGDISK_SECTOR_SIZE;
+    
+    port.disk_status = imgdisk_status;
+    port.disk_init   = imgdisk_init;
+    port.disk_read   = imgdisk_read;
+    port.disk_write  = imgdisk_write;
+    port.disk_ioctl  = imgdisk_ioctl;
+    
+    return diskio_port_register(pdrv, &port);
+}
+
+/**
+  * the function will unmap the image file
+  */
+void imgdisk_close(void)
+{
+    if (imgdisk_mem)
+    {
+        munmap(imgdisk_mem, (size_t)imgdisk_sectors * IMGDISK_SECTOR_SIZE);
+        imgdisk_mem = NULL;
+    }
+    
+    if (imgdisk_fd >= 0)
+    {
+        close(imgdisk_fd);
+        imgdisk_fd = -1;
+    }
+}
+
+/*@}*/
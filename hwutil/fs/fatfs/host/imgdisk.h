@@ -0,0 +1,12 @@
+#ifndef _IMGDISK_H_
+#define _IMGDISK_H_
+
+#include "diskio.h"
+
+/* the bytes of one sector of the image */
+#define IMGDISK_SECTOR_SIZE     512
+
+err_t imgdisk_register(BYTE pdrv, const char *path);
+void imgdisk_close(void);
+
+#endif
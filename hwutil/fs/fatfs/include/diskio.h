@@ -79,6 +79,31 @@ DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
 #define ATA_GET_MODEL		21	/* Get model name */
 #define ATA_GET_SN			22	/* Get serial number */
 
+/* the number of the sectors cached, 0 means disabling the cache */
+#ifndef DISKIO_CACHE_NUM
+    #define DISKIO_CACHE_NUM        16
+#endif
+
+/* the number of the sectors read ahead when the reading is sequential */
+#ifndef DISKIO_CACHE_READ_AHEAD
+    #define DISKIO_CACHE_READ_AHEAD 4
+#endif
+
+/* the transfer which is larger than it bypasses the cache */
+#ifndef DISKIO_CACHE_BYPASS
+    #define DISKIO_CACHE_BYPASS     (DISKIO_CACHE_NUM / 2)
+#endif
+
+/* the statistics of the disk cache */
+struct diskio_cache_stat
+{
+    DWORD       hit;
+    DWORD       miss;
+    DWORD       read_ahead;
+    DWORD       write_back;
+    DWORD       bypass;
+};
+
 /* diskio function port structure */
 struct diskio_port
 {
@@ -94,6 +119,7 @@ struct diskio_port
 
 err_t diskio_port_init(void);
 err_t diskio_port_register(BYTE pdrv, struct diskio_port *port);
+void diskio_cache_stat(struct diskio_cache_stat *stat);
 
 #ifdef __cplusplus
 }
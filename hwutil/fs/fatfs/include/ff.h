@@ -28,6 +28,9 @@ extern "C" {
 #if _FATFS != _FFCONF
 #error Wrong configuration file (ffconf.h).
 #endif
+#if _FS_REENTRANT
+#include "pthread.h"	/* Sync object of the re-entrancy */
+#endif
 
 
 
@@ -73,6 +76,21 @@ typedef char TCHAR;
 
 
 
+/* Directory lookup cache structure (DCACHE) */
+
+#if _FS_DCACHE
+typedef struct {
+	DWORD	sclust;			/* Directory start cluster (0:root) */
+	WORD	id;				/* Owner file system mount ID (0:unused) */
+	DWORD	stamp;			/* Last used stamp for the replacement */
+	UINT	size;			/* Number of table items (power of 2) */
+	UINT	count;			/* Number of names in the table */
+	DWORD*	tbl;			/* Table of name hash << 16 | entry index (NULL:linear search) */
+} DCACHE;
+#endif
+
+
+
 /* File system object structure (FATFS) */
 
 typedef struct {
@@ -104,6 +122,10 @@ typedef struct {
 	DWORD	dirbase;		/* Root directory start sector (FAT32:Cluster#) */
 	DWORD	database;		/* Data start sector */
 	DWORD	winsect;		/* Current sector appearing in the win[] */
+#if _FS_DCACHE
+	DWORD	dcstamp;		/* Last used stamp of the directory lookup cache */
+	DCACHE	dcache[_FS_DCACHE];	/* Directory lookup cache */
+#endif
 	BYTE	win[_MAX_SS];	/* Disk access window for Directory, FAT (and file data at tiny cfg) */
 } FATFS;
 
@@ -124,9 +146,11 @@ typedef struct {
 #if !_FS_READONLY
 	DWORD	dir_sect;		/* Sector number containing the directory entry */
 	BYTE*	dir_ptr;		/* Pointer to the directory entry in the win[] */
+	DWORD	ecl;			/* Cluster next to the contiguous extent of f_expand() (0:not contiguous) */
 #endif
 #if _USE_FASTSEEK
 	DWORD*	cltbl;			/* Pointer to the cluster link map table (Nulled on file open) */
+	DWORD*	clmap;			/* Cluster link map built on file open (Freed on close or extend) */
 #endif
 #if _FS_LOCK
 	UINT	lockid;			/* File lock ID origin from 1 (index of file semaphore table Files[]) */
@@ -216,6 +240,7 @@ FRESULT f_write (FIL* fp, const void* buff, UINT btw, UINT* bw);	/* Write data t
 FRESULT f_forward (FIL* fp, UINT(*func)(const BYTE*,UINT), UINT btf, UINT* bf);	/* Forward data to the stream */
 FRESULT f_lseek (FIL* fp, DWORD ofs);								/* Move file pointer of a file object */
 FRESULT f_truncate (FIL* fp);										/* Truncate file */
+FRESULT f_expand (FIL* fp, DWORD fsz, BYTE opt);					/* Allocate a contiguous block to the file */
 FRESULT f_sync (FIL* fp);											/* Flush cached data of a writing file */
 FRESULT f_opendir (DIR* dp, const TCHAR* path);						/* Open a directory */
 FRESULT f_closedir (DIR* dp);										/* Close an open directory */
@@ -268,11 +293,13 @@ DWORD get_fattime (void);
 #if _USE_LFN							/* Unicode - OEM code conversion */
 WCHAR ff_convert (WCHAR chr, UINT dir);	/* OEM-Unicode bidirectional conversion */
 WCHAR ff_wtoupper (WCHAR chr);			/* Unicode upper-case conversion */
-#if _USE_LFN == 3						/* Memory functions */
+#endif
+
+/* Memory functions */
+#if _USE_LFN == 3 || (_USE_FASTSEEK && _FS_FASTSEEK_MIN) || _FS_DCACHE
 void* ff_memalloc (UINT msize);			/* Allocate memory block */
 void ff_memfree (void* mblock);			/* Free memory block */
 #endif
-#endif
 
 /* Sync functions */
 #if _FS_REENTRANT
@@ -327,6 +354,12 @@ int ff_del_syncobj (_SYNC_t sobj);				/* Delete a sync object */
 #define CREATE_LINKMAP	0xFFFFFFFF
 
 
+/* Options of f_expand() */
+#define	EXPAND_HINT		0	/* Find the block and suggest it to the next allocation */
+#define	EXPAND_ALLOC	1	/* Allocate the block and set the file size to it */
+#define	EXPAND_APPEND	2	/* Allocate the block and keep the file size for appending */
+
+
 
 /*--------------------------------*/
 /* Multi-byte word access macros  */
@@ -0,0 +1,62 @@
+#ifndef _FFBENCH_H_
+#define _FFBENCH_H_
+
+#include "ff.h"
+
+/* the result of the benchmark */
+struct ffbench_result
+{
+    /* the bytes transfered */
+    DWORD       bytes;
+    
+    /* the time costs in millisecond */
+    DWORD       write_ms;
+    DWORD       read_ms;
+};
+
+/* the result of the small file benchmark */
+struct ffbench_meta_result
+{
+    /* the number of the files */
+    DWORD       files;
+    
+    /* the time costs in millisecond of creating, opening, listing and deleting all files */
+    DWORD       create_ms;
+    DWORD       open_ms;
+    DWORD       list_ms;
+    DWORD       unlink_ms;
+};
+
+/* the result of the append benchmark */
+struct ffbench_append_result
+{
+    /* the bytes appended */
+    DWORD       bytes;
+    
+    /* the time costs in millisecond of all appending and the slowest one */
+    DWORD       total_ms;
+    DWORD       max_ms;
+};
+
+/* the result of the random seek benchmark */
+struct ffbench_seek_result
+{
+    /* the times of the seeking */
+    DWORD       seeks;
+    
+    /* the items of the cluster link map, 0 means no map */
+    DWORD       map_items;
+    
+    /* the time costs in millisecond by following the FAT chain and the map */
+    DWORD       chain_ms;
+    DWORD       map_ms;
+};
+
+FRESULT ffbench_mount(const TCHAR *path);
+FRESULT ffbench_seq(const TCHAR *path, DWORD size, UINT chunk, struct ffbench_result *result);
+FRESULT ffbench_meta(const TCHAR *dir, UINT files, UINT size, struct ffbench_meta_result *result);
+FRESULT ffbench_append(const TCHAR *path, DWORD size, UINT chunk, bool prealloc, struct ffbench_append_result *result);
+FRESULT ffbench_seek(const TCHAR *path, DWORD size, UINT seeks, struct ffbench_seek_result *result);
+DWORD ffbench_rate(DWORD bytes, DWORD ms);
+
+#endif
@@ -39,14 +39,31 @@
 /  f_findfirst() and f_findnext(). (0:Disable or 1:Enable) */
 
 
-#define	_USE_MKFS		0
+#define	_USE_MKFS		1
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
-#define	_USE_FASTSEEK	0
+#define	_USE_EXPAND		1
+/* This option switches f_expand() function. (0:Disable or 1:Enable)
+/  It is available when _FS_READONLY == 0 and _FS_MINIMIZE == 0. */
+
+
+#define	_USE_FASTSEEK	1
 /* This option switches fast seek feature. (0:Disable or 1:Enable) */
 
 
+#define	_FS_FASTSEEK_MIN	(1024UL * 1024)
+#define	_FS_FASTSEEK_TBL	32
+#define	_FS_FASTSEEK_MAX	512
+/* When the fast seek feature is enabled, f_open() builds the cluster link map
+/  for the file whose size is _FS_FASTSEEK_MIN bytes or larger, and f_lseek() of
+/  it does not follow the FAT chain. 0 disables the building at f_open().
+/  The map starts with _FS_FASTSEEK_TBL items and is enlarged to the size
+/  required, which must not be more than _FS_FASTSEEK_MAX items, two items are
+/  taken by every fragment of the file. The map is memory of ff_memalloc() and
+/  it is dropped when the file is extended. */
+
+
 #define _USE_LABEL		0
 /* This option switches volume label functions, f_getlabel() and f_setlabel().
 /  (0:Disable or 1:Enable) */
@@ -61,7 +78,7 @@
 / Locale and Namespace Configurations
 /---------------------------------------------------------------------------*/
 
-#define _CODE_PAGE	932
+#define _CODE_PAGE	437
 /* This option specifies the OEM code page to be used on the target system.
 /  Incorrect setting of the code page can cause a file open failure.
 /
@@ -90,7 +107,7 @@
 */
 
 
-#define	_USE_LFN	0
+#define	_USE_LFN	3
 #define	_MAX_LFN	255
 /* The _USE_LFN option switches the LFN feature.
 /
@@ -99,13 +116,27 @@
 /   2: Enable LFN with dynamic working buffer on the STACK.
 /   3: Enable LFN with dynamic working buffer on the HEAP.
 /
-/  When enable the LFN feature, Unicode handling functions (option/unicode.c) must
+/  When enable the LFN feature, Unicode handling functions (source/ccsbcs.c) must
 /  be added to the project. The LFN working buffer occupies (_MAX_LFN + 1) * 2 bytes.
 /  When use stack for the working buffer, take care on stack overflow. When use heap
 /  memory for the working buffer, memory management functions, ff_memalloc() and
 /  ff_memfree(), must be added to the project. */
 
 
+#define	_FS_DCACHE		4
+#define	_FS_DCACHE_MIN	32
+#define	_FS_DCACHE_BUDGET	65536
+/* The _FS_DCACHE option switches the directory lookup cache, it is the number of
+/  directories cached on every volume. (0:Disable)
+/  The first lookup in a directory scans it and hashes the names of all entries,
+/  the following lookups only verify the entries whose name hash is matched.
+/  The table of hash is memory of ff_memalloc() and the least recently used
+/  directory is replaced. The directory which has less than _FS_DCACHE_MIN names
+/  is searched linearly without the table, and it does not replace a directory
+/  with the table. The tables of a volume take _FS_DCACHE_BUDGET bytes at most,
+/  the directory is searched linearly when its table is over the budget. */
+
+
 #define	_LFN_UNICODE	0
 /* This option switches character encoding on the API. (0:ANSI/OEM or 1:Unicode)
 /  To use Unicode string for the path name, enable LFN feature and set _LFN_UNICODE
@@ -138,7 +169,7 @@
 / Drive/Volume Configurations
 /---------------------------------------------------------------------------*/
 
-#define _VOLUMES	1
+#define _VOLUMES	2
 /* Number of volumes (logical drives) to be used. */
 
 
@@ -214,7 +245,7 @@
 /  These options have no effect at read-only configuration (_FS_READONLY == 1). */
 
 
-#define	_FS_LOCK	0
+#define	_FS_LOCK	8
 /* The _FS_LOCK option switches file lock feature to control duplicated file open
 /  and illegal operation to open objects. This option must be 0 when _FS_READONLY
 /  is 1.
@@ -226,9 +257,9 @@
 /      lock feature is independent of re-entrancy. */
 
 
-#define _FS_REENTRANT	0
+#define _FS_REENTRANT	1
 #define _FS_TIMEOUT		1000
-#define	_SYNC_t			HANDLE
+#define	_SYNC_t			pthread_mutex_t*
 /* The _FS_REENTRANT option switches the re-entrancy (thread safe) of the FatFs
 /  module itself. Note that regardless of this option, file access to different
 /  volume is always re-entrant and volume control functions, f_mount(), f_mkfs()
@@ -241,7 +272,8 @@
 /      function, must be added to the project. Samples are available in
 /      option/syscall.c.
 /
-/  The _FS_TIMEOUT defines timeout period in unit of time tick.
+/  The _FS_TIMEOUT defines timeout period in unit of time tick. (millisecond in
+/  this port, the sync object is the pthread mutex, see syscall.c)
 /  The _SYNC_t defines O/S dependent sync object type. e.g. HANDLE, ID, OS_EVENT*,
 /  SemaphoreHandle_t and etc.. A header file for O/S definitions needs to be
 /  included somewhere in the scope of ff.c. */
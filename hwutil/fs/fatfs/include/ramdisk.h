@@ -0,0 +1,11 @@
+#ifndef _RAMDISK_H_
+#define _RAMDISK_H_
+
+#include "diskio.h"
+
+/* the bytes of one sector of the ram disk */
+#define RAMDISK_SECTOR_SIZE     512
+
+err_t ramdisk_register(BYTE pdrv, BYTE *mem, DWORD sectors);
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * File         : ccsbcs.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-15       DongHeng        create
+ */
+
+/*
+ * the Unicode handling functions of the LFN feature for the single byte code
+ * page, only the code page 437 is built in to keep the table small
+ */
+
+#include "ff.h"
+
+#if _USE_LFN
+
+#if _CODE_PAGE != 437
+#error ccsbcs.c only has the table of the code page 437
+#endif
+
+/*@{*/
+
+/* the Unicode of the OEM code 0x80 - 0xFF */
+static const WCHAR ff_oem2uni[128] = {
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7,
+    0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9,
+    0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA,
+    0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556,
+    0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F,
+    0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B,
+    0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4,
+    0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248,
+    0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0
+};
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * ff_convert - convert the character between the OEM code and the Unicode
+ *
+ * @param chr the character
+ * @param dir 0 means the Unicode to the OEM code, 1 means the OEM code to the Unicode
+ *
+ * @return the character converted, 0 means no such character
+ */
+WCHAR ff_convert (WCHAR chr, UINT dir)
+{
+    WCHAR c;
+
+    if (chr < 0x80)
+        return chr;
+
+    if (dir)
+        return chr < 0x100 ? ff_oem2uni[chr - 0x80] : 0;
+
+    for (c = 0; c < 0x80; c++) {
+        if (ff_oem2uni[c] == chr)
+            return c + 0x80;
+    }
+
+    return 0;
+}
+
+/**
+ * ff_wtoupper - convert the Unicode character to the upper case, the Latin,
+ *               the Greek and the Cyrillic letters are converted
+ *
+ * @param chr the character
+ *
+ * @return the character in the upper case
+ */
+WCHAR ff_wtoupper (WCHAR chr)
+{
+    if (chr < 0x80)
+        return (chr >= 'a' && chr <= 'z') ? chr - 0x20 : chr;
+
+    if (chr < 0x100) {
+        if (chr == 0xB5) return 0x39C;
+        if (chr == 0xFF) return 0x178;
+        return (chr >= 0xE0 && chr != 0xF7) ? chr - 0x20 : chr;
+    }
+
+    /* the Latin extended letters in pairs, the upper one is even or odd */
+    if ((chr < 0x138 && chr != 0x130 && chr != 0x131) || (chr >= 0x14A && chr < 0x178))
+        return chr & ~1;
+    if ((chr >= 0x139 && chr < 0x149) || (chr >= 0x179 && chr < 0x17F))
+        return (chr & 1) ? chr : chr - 1;
+    if (chr == 0x192)
+        return 0x191;
+
+    /* the Greek letters */
+    if (chr >= 0x3AC && chr < 0x3D0) {
+        if (chr == 0x3AC) return 0x386;
+        if (chr < 0x3B0) return chr - 0x25;
+        if (chr == 0x3B0) return chr;
+        if (chr == 0x3C2) return 0x3A3;
+        if (chr < 0x3CC) return chr - 0x20;
+        if (chr == 0x3CC) return 0x38C;
+        return chr - 0x3F;
+    }
+
+    /* the Cyrillic letters */
+    if (chr >= 0x430 && chr < 0x450)
+        return chr - 0x20;
+    if (chr >= 0x450 && chr < 0x460)
+        return chr - 0x50;
+    if ((chr >= 0x460 && chr < 0x482) || (chr >= 0x48A && chr < 0x4C0))
+        return chr & ~1;
+
+    /* the Roman numerals, the circled letters and the full width letters */
+    if (chr >= 0x2170 && chr < 0x2180)
+        return chr - 0x10;
+    if (chr >= 0x24D0 && chr < 0x24EA)
+        return chr - 0x1A;
+    if (chr >= 0xFF41 && chr < 0xFF5B)
+        return chr - 0x20;
+
+    return chr;
+}
+
+/*@}*/
+
+#endif
@@ -8,10 +8,370 @@
 /*-----------------------------------------------------------------------*/
 
 #include "diskio.h"		/* FatFs lower layer API */
+#include "ffconf.h"
 #include "string.h"
 
+#if DISKIO_CACHE_NUM
+#include "list.h"
+#include "pthread.h"
+#endif
+
 NO_INIT static struct diskio_port diskio_port[DISKIO_DRIVER_MAX];
 
+#if DISKIO_CACHE_NUM
+
+/* the number of the hash bucket of the cache, it must be the power of 2 */
+#define DISKIO_CACHE_HASH_SIZE  16
+
+/* the structure description of one cached sector */
+struct diskio_block
+{
+    /* the data of the sector, it is placed at first for the word alignment */
+    BYTE                data[_MAX_SS];
+  
+    /* the node at the lru list, the head is the oldest one */
+    list_t              lru;
+    
+    /* the node at the hash bucket, it is alone when the block is invalid */
+    list_t              hash;
+    
+    DWORD               sector;
+    BYTE                pdrv;
+    bool                valid;
+    bool                dirty;
+};
+
+NO_INIT static struct diskio_block diskio_block[DISKIO_CACHE_NUM];
+NO_INIT static BYTE diskio_scratch[DISKIO_CACHE_READ_AHEAD ? DISKIO_CACHE_READ_AHEAD : 1][_MAX_SS];
+
+static list_t diskio_lru_list;
+static list_t diskio_hash_list[DISKIO_CACHE_HASH_SIZE];
+
+/* the next sector of the last reading, it is used for detecting sequential reading */
+static DWORD diskio_next_sector[DISKIO_DRIVER_MAX];
+
+static pthread_mutex_t diskio_cache_mutex;
+static struct diskio_cache_stat diskio_stat;
+
+/******************************************************************************/
+
+#define DISKIO_HASH(pdrv, sector) \
+            (&diskio_hash_list[((sector) ^ ((DWORD)(pdrv) << 3)) & (DISKIO_CACHE_HASH_SIZE - 1)])
+
+/**
+ * diskio_cache_find - find the cached block of the sector
+ *
+ * @param pdrv the physical drive number
+ * @param sector the sector address
+ *
+ * @return the block point, NULL means not cached
+ */
+static struct diskio_block *diskio_cache_find(BYTE pdrv, DWORD sector)
+{
+    struct diskio_block *block;
+    list_t *list = DISKIO_HASH(pdrv, sector);
+    
+    LIST_FOR_EACH_ENTRY(block, list, struct diskio_block, hash)
+    {
+        if (block->sector == sector && block->pdrv == pdrv)
+            return block;
+    }
+    
+    return NULL;
+}
+
+/**
+ * diskio_cache_touch - mark the block as the newest one
+ */
+INLINE void diskio_cache_touch(struct diskio_block *block)
+{
+    list_remove_node(&block->lru);
+    list_insert_tail(&diskio_lru_list, &block->lru);
+}
+
+/**
+ * diskio_cache_drop - invalidate the block and make it be reused at first
+ */
+static void diskio_cache_drop(struct diskio_block *block)
+{
+    list_remove_node(&block->hash);
+    list_init(&block->hash);
+    block->valid = false;
+    block->dirty = false;
+    
+    list_remove_node(&block->lru);
+    list_insert_head(&diskio_lru_list, &block->lru);
+}
+
+/**
+ * diskio_cache_alloc - take the oldest block for the sector, the dirty data 
+ *                      of the block will be written back at first
+ *
+ * @param pdrv the physical drive number
+ * @param sector the sector address
+ *
+ * @return the block point, NULL means writing back failed
+ */
+static struct diskio_block *diskio_cache_alloc(BYTE pdrv, DWORD sector)
+{
+    struct diskio_block *block = LIST_HEAD_ENTRY(&diskio_lru_list, struct diskio_block, lru);
+    
+    if (block->dirty)
+    {
+        if (RES_OK != diskio_port[block->pdrv].disk_write(block->data, block->sector, 1))
+            return NULL;
+        diskio_stat.write_back++;
+    }
+    
+    list_remove_node(&block->hash);
+    list_insert_tail(DISKIO_HASH(pdrv, sector), &block->hash);
+    block->pdrv = pdrv;
+    block->sector = sector;
+    block->valid = true;
+    block->dirty = false;
+    diskio_cache_touch(block);
+    
+    return block;
+}
+
+/**
+ * diskio_cache_invalidate - drop all the blocks of the drive without writing back
+ */
+static void diskio_cache_invalidate(BYTE pdrv)
+{
+    int i;
+    
+    for (i = 0; i < DISKIO_CACHE_NUM; i++)
+    {
+        if (diskio_block[i].valid && diskio_block[i].pdrv == pdrv)
+            diskio_cache_drop(&diskio_block[i]);
+    }
+}
+
+/**
+ * diskio_cache_flush - write back all the dirty blocks of the drive, the
+ *                      blocks are written in order of the sector and the
+ *                      consecutive ones are merged into one transfer
+ *
+ * @param pdrv the physical drive number
+ *
+ * @return the result of the writing
+ */
+static DRESULT diskio_cache_flush(BYTE pdrv)
+{
+    DWORD cursor = 0;
+    
+    while (1)
+    {
+        struct diskio_block *first = NULL, *block;
+        UINT count = 1;
+        DRESULT res;
+        UINT i;
+        
+        /* find the dirty block with the lowest sector from the cursor */
+        for (i = 0; i < DISKIO_CACHE_NUM; i++)
+        {
+            block = &diskio_block[i];
+            if (block->dirty && block->pdrv == pdrv && block->sector >= cursor
+                && (!first || block->sector < first->sector))
+                first = block;
+        }
+        if (!first)
+            return RES_OK;
+        
+        /* merge the following dirty sectors into the scratch buffer */
+        memcpy(diskio_scratch[0], first->data, _MAX_SS);
+        while (count < DISKIO_CACHE_READ_AHEAD
+               && (block = diskio_cache_find(pdrv, first->sector + count)) != NULL
+               && block->dirty)
+        {
+            memcpy(diskio_scratch[count++], block->data, _MAX_SS);
+        }
+        
+        if (RES_OK != (res = diskio_port[pdrv].disk_write(diskio_scratch[0], first->sector, count)))
+            return res;
+        
+        for (i = 0; i < count; i++)
+        {
+            diskio_cache_find(pdrv, first->sector + i)->dirty = false;
+            diskio_stat.write_back++;
+        }
+        cursor = first->sector + count;
+    }
+}
+
+/**
+ * diskio_cache_read_ahead - read the following uncached sectors into the cache
+ *
+ * @param pdrv the physical drive number
+ * @param sector the first sector to read
+ */
+static void diskio_cache_read_ahead(BYTE pdrv, DWORD sector)
+{
+    struct diskio_block *block;
+    UINT count = 0, i;
+    
+    while (count < DISKIO_CACHE_READ_AHEAD && !diskio_cache_find(pdrv, sector + count))
+        count++;
+    
+    /* the sector beyond the disk will fail and nothing is cached */
+    if (!count || RES_OK != diskio_port[pdrv].disk_read(diskio_scratch[0], sector, count))
+        return ;
+    
+    for (i = 0; i < count; i++)
+    {
+        if ((block = diskio_cache_alloc(pdrv, sector + i)) == NULL)
+            return ;
+        memcpy(block->data, diskio_scratch[i], _MAX_SS);
+        diskio_stat.read_ahead++;
+    }
+}
+
+/**
+ * diskio_cache_read - read the sectors through the cache
+ */
+static DRESULT diskio_cache_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+    struct diskio_block *block;
+    DRESULT res;
+    UINT i, j, n;
+    
+    /* the large transfer bypasses the cache, but the dirty blocks are newer */
+    if (count > DISKIO_CACHE_BYPASS)
+    {
+        if (RES_OK != (res = diskio_port[pdrv].disk_read(buff, sector, count)))
+            return res;
+        
+        for (i = 0; i < DISKIO_CACHE_NUM; i++)
+        {
+            block = &diskio_block[i];
+            if (block->dirty && block->pdrv == pdrv 
+                && block->sector >= sector && block->sector < sector + count)
+                memcpy(buff + (block->sector - sector) * _MAX_SS, block->data, _MAX_SS);
+        }
+        diskio_stat.bypass++;
+        diskio_next_sector[pdrv] = sector + count;
+        
+        return RES_OK;
+    }
+    
+    for (i = 0; i < count; i += n)
+    {
+        if ((block = diskio_cache_find(pdrv, sector + i)) != NULL)
+        {
+            memcpy(buff + i * _MAX_SS, block->data, _MAX_SS);
+            diskio_cache_touch(block);
+            diskio_stat.hit++;
+            n = 1;
+            continue;
+        }
+        
+        /* read the run of the missing sectors at one time */
+        for (n = 1; i + n < count && !diskio_cache_find(pdrv, sector + i + n); n++);
+        if (RES_OK != (res = diskio_port[pdrv].disk_read(buff + i * _MAX_SS, sector + i, n)))
+            return res;
+        
+        for (j = 0; j < n; j++)
+        {
+            if ((block = diskio_cache_alloc(pdrv, sector + i + j)) == NULL)
+                return RES_ERROR;
+            memcpy(block->data, buff + (i + j) * _MAX_SS, _MAX_SS);
+            diskio_stat.miss++;
+        }
+    }
+    
+    if (DISKIO_CACHE_READ_AHEAD && diskio_next_sector[pdrv] == sector)
+        diskio_cache_read_ahead(pdrv, sector + count);
+    diskio_next_sector[pdrv] = sector + count;
+    
+    return RES_OK;
+}
+
+/**
+ * diskio_cache_write - write the sectors into the cache, they will be written
+ *                      back when evicted or synchronized
+ */
+static DRESULT diskio_cache_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+    struct diskio_block *block;
+    DRESULT res;
+    UINT i;
+    
+    /* the large transfer goes to the disk, and the cached copies are updated */
+    if (count > DISKIO_CACHE_BYPASS)
+    {
+        if (RES_OK != (res = diskio_port[pdrv].disk_write(buff, sector, count)))
+            return res;
+        
+        for (i = 0; i < DISKIO_CACHE_NUM; i++)
+        {
+            block = &diskio_block[i];
+            if (block->valid && block->pdrv == pdrv 
+                && block->sector >= sector && block->sector < sector + count)
+            {
+                memcpy(block->data, buff + (block->sector - sector) * _MAX_SS, _MAX_SS);
+                block->dirty = false;
+            }
+        }
+        diskio_stat.bypass++;
+        
+        return RES_OK;
+    }
+    
+    for (i = 0; i < count; i++)
+    {
+        if ((block = diskio_cache_find(pdrv, sector + i)) != NULL)
+            diskio_cache_touch(block);
+        else if ((block = diskio_cache_alloc(pdrv, sector + i)) == NULL)
+            return RES_ERROR;
+        
+        memcpy(block->data, buff + i * _MAX_SS, _MAX_SS);
+        block->dirty = true;
+    }
+    
+    return RES_OK;
+}
+
+/**
+ * diskio_cache_init - initialize the sector cache
+ */
+static void diskio_cache_init(void)
+{
+    int i;
+    
+    list_init(&diskio_lru_list);
+    for (i = 0; i < DISKIO_CACHE_HASH_SIZE; i++)
+        list_init(&diskio_hash_list[i]);
+    
+    for (i = 0; i < DISKIO_CACHE_NUM; i++)
+    {
+        list_init(&diskio_block[i].hash);
+        list_insert_tail(&diskio_lru_list, &diskio_block[i].lru);
+        diskio_block[i].valid = false;
+        diskio_block[i].dirty = false;
+    }
+    
+    pthread_mutex_init(&diskio_cache_mutex, NULL);
+}
+
+#endif
+
+/**
+ * diskio_cache_stat - get the statistics of the sector cache
+ *
+ * @param stat the point of the statistics
+ */
+void diskio_cache_stat(struct diskio_cache_stat *stat)
+{
+#if DISKIO_CACHE_NUM
+    pthread_mutex_lock(&diskio_cache_mutex);
+    memcpy(stat, &diskio_stat, sizeof(struct diskio_cache_stat));
+    pthread_mutex_unlock(&diskio_cache_mutex);
+#else
+    memset(stat, 0, sizeof(struct diskio_cache_stat));
+#endif
+}
+
 /*-----------------------------------------------------------------------*/
 /* Get Drive Status                                                      */
 /*-----------------------------------------------------------------------*/
@@ -26,6 +386,10 @@ err_t diskio_port_init(void)
         diskio_port[i].inited = false;
     }
     
+#if DISKIO_CACHE_NUM
+    diskio_cache_init();
+#endif
+    
     return 0;
 }
 
@@ -39,6 +403,9 @@ err_t diskio_port_register (BYTE pdrv, struct diskio_port *port)
         }
         memcpy(&diskio_port[pdrv], port, sizeof(struct diskio_port));
         diskio_port[pdrv].used = true;
+        diskio_port[pdrv].inited = false;
+        
+        return 0;
     }
 
     return STA_NOINIT;
@@ -72,6 +439,11 @@ DSTATUS disk_initialize (
     {
         if (false == diskio_port[pdrv].inited)
         {
+#if DISKIO_CACHE_NUM
+            pthread_mutex_lock(&diskio_cache_mutex);
+            diskio_cache_invalidate(pdrv);
+            pthread_mutex_unlock(&diskio_cache_mutex);
+#endif
             diskio_port[pdrv].inited = true;
             ret =  diskio_port[pdrv].disk_init();
         }
@@ -95,7 +467,17 @@ DRESULT disk_read (
 {
     if (pdrv < DISKIO_DRIVER_MAX)
     {
+#if DISKIO_CACHE_NUM
+        DRESULT res;
+        
+        pthread_mutex_lock(&diskio_cache_mutex);
+        res = diskio_cache_read(pdrv, buff, sector, count);
+        pthread_mutex_unlock(&diskio_cache_mutex);
+        
+        return res;
+#else
         return diskio_port[pdrv].disk_read(buff, sector, count);
+#endif
     }
 
     return RES_PARERR;
@@ -117,7 +499,17 @@ DRESULT disk_write (
 {
     if (pdrv < DISKIO_DRIVER_MAX)
     {
+#if DISKIO_CACHE_NUM
+        DRESULT res;
+        
+        pthread_mutex_lock(&diskio_cache_mutex);
+        res = diskio_cache_write(pdrv, buff, sector, count);
+        pthread_mutex_unlock(&diskio_cache_mutex);
+        
+        return res;
+#else
         return diskio_port[pdrv].disk_write(buff, sector, count);
+#endif
     }
 
     return RES_PARERR;
@@ -138,6 +530,18 @@ DRESULT disk_ioctl (
 {
     if (pdrv < DISKIO_DRIVER_MAX)
     {
+#if DISKIO_CACHE_NUM
+        if (CTRL_SYNC == cmd)
+        {
+            DRESULT res;
+            
+            pthread_mutex_lock(&diskio_cache_mutex);
+            res = diskio_cache_flush(pdrv);
+            pthread_mutex_unlock(&diskio_cache_mutex);
+            if (RES_OK != res)
+                return res;
+        }
+#endif
         return diskio_port[pdrv].disk_ioctl(cmd, buff);
     }
 
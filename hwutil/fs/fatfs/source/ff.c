@@ -1067,6 +1067,90 @@ DWORD clmt_clust (	/* <2:Error, >=2:Cluster number */
 	}
 	return cl + *tbl;	/* Return the cluster number */
 }
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Create the cluster link map table of the file          */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT create_linkmap (	/* FR_OK, FR_NOT_ENOUGH_CORE(*cltbl is the size required) or error */
+	FIL* fp					/* Pointer to the file object with the table given */
+)
+{
+	DWORD cl, pcl, ncl, tcl, tlen, ulen, *tbl;
+
+
+	tbl = fp->cltbl;
+	tlen = *tbl++; ulen = 2;	/* Given table size and required table size */
+	cl = fp->sclust;			/* Top of the chain */
+	if (cl) {
+		do {
+			/* Get a fragment */
+			tcl = cl; ncl = 0; ulen += 2;	/* Top, length and used items */
+			do {
+				pcl = cl; ncl++;
+				cl = get_fat(fp->fs, cl);
+				if (cl <= 1) return FR_INT_ERR;
+				if (cl == 0xFFFFFFFF) return FR_DISK_ERR;
+			} while (cl == pcl + 1);
+			if (ulen <= tlen) {		/* Store the length and top of the fragment */
+				*tbl++ = ncl; *tbl++ = tcl;
+			}
+		} while (cl < fp->fs->n_fatent);	/* Repeat until end of chain */
+	}
+	*fp->cltbl = ulen;	/* Number of items used */
+	if (ulen > tlen)
+		return FR_NOT_ENOUGH_CORE;	/* Given table size is smaller than required */
+	*tbl = 0;			/* Terminate table */
+
+	return FR_OK;
+}
+
+
+#if _FS_FASTSEEK_MIN
+/*-----------------------------------------------------------------------*/
+/* FAT handling - Build and drop the link map owned by the file          */
+/*-----------------------------------------------------------------------*/
+
+static
+void open_linkmap (
+	FIL* fp			/* Pointer to the opened file object */
+)
+{
+	DWORD tlen = _FS_FASTSEEK_TBL;
+	FRESULT res;
+
+
+	while (tlen <= _FS_FASTSEEK_MAX) {
+		fp->clmap = ff_memalloc((UINT)(tlen * sizeof (DWORD)));
+		if (!fp->clmap) break;
+		fp->cltbl = fp->clmap;
+		*fp->cltbl = tlen;
+		res = create_linkmap(fp);
+		if (res == FR_OK) return;		/* Fast seek mode */
+		tlen = *fp->cltbl;				/* Size required */
+		ff_memfree(fp->clmap);
+		fp->clmap = 0; fp->cltbl = 0;	/* Normal seek mode on any error */
+		if (res != FR_NOT_ENOUGH_CORE) break;
+	}
+}
+
+
+static
+void close_linkmap (
+	FIL* fp			/* Pointer to the file object */
+)
+{
+	if (fp->clmap) {
+		if (fp->cltbl == fp->clmap) fp->cltbl = 0;
+		ff_memfree(fp->clmap);
+		fp->clmap = 0;
+	}
+}
+#endif
 #endif	/* _USE_FASTSEEK */
 
 
@@ -1451,12 +1535,14 @@ BYTE sum_sfn (
 
 
 /*-----------------------------------------------------------------------*/
-/* Directory handling - Find an object in the directory                  */
+/* Directory handling - Compare the objects in the directory with name   */
 /*-----------------------------------------------------------------------*/
 
 static
-FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
-	DIR* dp			/* Pointer to the directory object linked to the file name */
+FRESULT dir_match (	/* FR_OK(0):matched, FR_NO_FILE:not matched, !=0:error */
+	DIR* dp,		/* Pointer to the directory object linked to the file name */
+	UINT start,		/* Index of the entry to start */
+	int one			/* 0:Search to end of table, 1:Compare only the object at start */
 )
 {
 	FRESULT res;
@@ -1465,7 +1551,7 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 	BYTE a, ord, sum;
 #endif
 
-	res = dir_sdi(dp, 0);			/* Rewind directory object */
+	res = dir_sdi(dp, start);		/* Go to the start entry */
 	if (res != FR_OK) return res;
 
 #if _USE_LFN
@@ -1480,9 +1566,11 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 #if _USE_LFN	/* LFN configuration */
 		a = dir[DIR_Attr] & AM_MASK;
 		if (c == DDEM || ((a & AM_VOL) && a != AM_LFN)) {	/* An entry without valid data */
+			if (one) { res = FR_NO_FILE; break; }	/* The object has gone */
 			ord = 0xFF; dp->lfn_idx = 0xFFFF;	/* Reset LFN sequence */
 		} else {
 			if (a == AM_LFN) {			/* An LFN entry is found */
+				if (one && dp->index == start && !(c & LLEF)) { res = FR_NO_FILE; break; }	/* Not top of an object */
 				if (dp->lfn) {
 					if (c & LLEF) {		/* Is it start of LFN sequence? */
 						sum = dir[LDIR_Chksum];
@@ -1495,12 +1583,14 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 			} else {					/* An SFN entry is found */
 				if (!ord && sum == sum_sfn(dir)) break;	/* LFN matched? */
 				if (!(dp->fn[NSFLAG] & NS_LOSS) && !mem_cmp(dir, dp->fn, 11)) break;	/* SFN matched? */
+				if (one) { res = FR_NO_FILE; break; }	/* The object is not matched */
 				ord = 0xFF; dp->lfn_idx = 0xFFFF;	/* Reset LFN sequence */
 			}
 		}
 #else		/* Non LFN configuration */
 		if (!(dir[DIR_Attr] & AM_VOL) && !mem_cmp(dir, dp->fn, 11)) /* Is it a valid entry? */
 			break;
+		if (one) { res = FR_NO_FILE; break; }
 #endif
 		res = dir_next(dp, 0);		/* Next entry */
 	} while (res == FR_OK);
@@ -1511,6 +1601,388 @@ FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
 
 
 
+#if _FS_DCACHE
+/*-----------------------------------------------------------------------*/
+/* Directory handling - Directory lookup cache                           */
+/*-----------------------------------------------------------------------*/
+/* The table item is the 16-bit name hash and the index of the first entry
+/  of the object (LFN or SFN). The SFN and the LFN of an object are two
+/  items. An item is added when the object is registered and it is left
+/  in the table when the object is removed, it is not matched at verifying
+/  and it is dropped when the table is rebuilt. */
+
+#define DC_EMPTY	0xFFFFFFFF	/* Empty table item */
+#define DC_TBL_MIN	64			/* Number of table items at first */
+#define DC_TBL_MAX	0x10000		/* Maximum number of table items */
+
+
+static
+DWORD dc_mix (		/* Mixed value of a character at the position of name */
+	DWORD chr,
+	UINT pos
+)
+{
+	chr = (chr << 16 | pos) * 0x9E3779B1;
+	chr ^= chr >> 15;
+	chr *= 0x85EBCA6B;
+	return chr ^ (chr >> 13);
+}
+
+
+static
+WORD dc_fold (		/* Returns the 16-bit name hash, 0xFFFF is not used */
+	DWORD hash
+)
+{
+	hash = (hash ^ (hash >> 16)) & 0xFFFF;
+	return (WORD)(hash == 0xFFFF ? 0xFFFE : hash);
+}
+
+
+static
+WORD dc_hash_sfn (
+	const BYTE* sfn		/* Pointer to the SFN (11 bytes) */
+)
+{
+	DWORD hash = 0;
+	UINT i;
+
+	for (i = 0; i < 11; i++) hash += dc_mix(sfn[i], i);
+	return dc_fold(hash);
+}
+
+
+#if _USE_LFN
+static
+WORD dc_hash_lfn (
+	const WCHAR* lfn	/* Pointer to the LFN terminated by 0 */
+)
+{
+	DWORD hash = 0;
+	UINT i;
+
+	for (i = 0; lfn[i]; i++) hash += dc_mix(ff_wtoupper(lfn[i]), i);
+	return dc_fold(hash);
+}
+
+
+static
+int dc_sum_lfn (	/* 1:succeeded, 0:invalid LFN entry */
+	DWORD* hash,	/* Pointer to the sum of the LFN hash */
+	BYTE* dir		/* Pointer to the LFN entry */
+)
+{
+	UINT i, s;
+	WCHAR wc, uc;
+
+
+	if (LD_WORD(dir + LDIR_FstClusLO) != 0) return 0;	/* Check LDIR_FstClusLO */
+
+	i = ((dir[LDIR_Ord] & 0x3F) - 1) * 13;	/* Offset of the characters in the LFN */
+
+	for (wc = 1, s = 0; s < 13; s++) {		/* Sum the characters in the entry, the order of LFN entries does not matter */
+		uc = LD_WORD(dir + LfnOfs[s]);
+		if (wc) {
+			if (i >= _MAX_LFN) return 0;
+			if (uc) *hash += dc_mix(ff_wtoupper(uc), i++);
+			wc = uc;
+		} else {
+			if (uc != 0xFFFF) return 0;		/* Check filler */
+		}
+	}
+
+	return 1;
+}
+#endif
+
+
+static
+DWORD dc_key (		/* Returns the start cluster of the directory, the root of FAT32 is 0 */
+	DIR* dp
+)
+{
+	return (dp->fs->fs_type == FS_FAT32 && dp->sclust == dp->fs->dirbase) ? 0 : dp->sclust;
+}
+
+
+static
+DCACHE* dc_slot (	/* Returns the cache of the directory (NULL:not cached) */
+	DIR* dp
+)
+{
+	DCACHE* dc = dp->fs->dcache;
+	DWORD key = dc_key(dp);
+	UINT i;
+
+	for (i = 0; i < _FS_DCACHE; i++, dc++) {
+		if (dc->id == dp->fs->id && dc->sclust == key) return dc;
+	}
+	return 0;
+}
+
+
+static
+void dc_drop (
+	DCACHE* dc		/* Cache to be dropped */
+)
+{
+	if (dc->tbl) ff_memfree(dc->tbl);
+	dc->tbl = 0; dc->id = 0;
+}
+
+
+static
+void dc_insert (
+	DCACHE* dc,		/* Cache with free table items */
+	WORD hash,		/* Name hash */
+	UINT idx		/* Index of the first entry of the object */
+)
+{
+	UINT i = hash & (dc->size - 1);
+
+	while (dc->tbl[i] != DC_EMPTY) i = (i + 1) & (dc->size - 1);	/* Linear probing */
+	dc->tbl[i] = (DWORD)hash << 16 | idx;
+	dc->count++;
+}
+
+
+static
+int dc_grow (		/* 1:succeeded, 0:out of memory, too many items or over the budget */
+	FATFS* fs,		/* Pointer to the fs object owning the cache */
+	DCACHE* dc,		/* Cache to be grown */
+	UINT need		/* Number of names the table should hold at least */
+)
+{
+	DWORD *tbl = dc->tbl;
+	UINT i, j, size = dc->size, bytes = 0;
+
+
+	i = tbl ? size * 2 : DC_TBL_MIN;
+	while (i < need * 2) i *= 2;
+	if (i > DC_TBL_MAX) return 0;
+	for (j = 0; j < _FS_DCACHE; j++) {	/* Tables of the other directories share the budget of the volume */
+		if (&fs->dcache[j] != dc && fs->dcache[j].tbl) bytes += fs->dcache[j].size * sizeof (DWORD);
+	}
+	if (bytes + i * sizeof (DWORD) > _FS_DCACHE_BUDGET) return 0;
+	dc->tbl = ff_memalloc(i * sizeof (DWORD));
+	if (!dc->tbl) { dc->tbl = tbl; return 0; }
+	dc->size = i; dc->count = 0;
+	while (i) dc->tbl[--i] = DC_EMPTY;
+
+	if (tbl) {						/* Move the items to the new table */
+		for (i = 0; i < size; i++) {
+			if (tbl[i] != DC_EMPTY) dc_insert(dc, (WORD)(tbl[i] >> 16), tbl[i] & 0xFFFF);
+		}
+		ff_memfree(tbl);
+	}
+	return 1;
+}
+
+
+static
+void dc_add (
+	FATFS* fs,		/* Pointer to the fs object owning the cache */
+	DCACHE* dc,		/* Cache being built */
+	WORD hash,		/* Name hash */
+	UINT idx		/* Index of the first entry of the object */
+)
+{
+	if (dc->tbl && (dc->count + 1) * 2 > dc->size && !dc_grow(fs, dc, 0)) {
+		ff_memfree(dc->tbl); dc->tbl = 0;	/* Linear search on out of memory */
+	}
+	if (dc->tbl) {
+		dc_insert(dc, hash, idx);
+	} else {
+		dc->count++;
+	}
+}
+
+
+static
+FRESULT dc_scan (	/* FR_OK(0):succeeded, !=0:error */
+	DIR* dp,		/* Pointer to the directory object */
+	DCACHE* dc		/* Cache to be built, the names are only counted without the table */
+)
+{
+	FRESULT res;
+	BYTE c, *dir;
+	UINT start = 0;
+#if _USE_LFN
+	BYTE a, ord = 0xFF, sum = 0xFF;
+	DWORD hash = 0;
+#endif
+
+
+	res = dir_sdi(dp, 0);
+	while (res == FR_OK) {
+		res = move_window(dp->fs, dp->sect);
+		if (res != FR_OK) break;
+		dir = dp->dir;
+		c = dir[DIR_Name];
+		if (c == 0) break;			/* Reached to end of table */
+#if _USE_LFN	/* LFN configuration */
+		a = dir[DIR_Attr] & AM_MASK;
+		if (c == DDEM || ((a & AM_VOL) && a != AM_LFN)) {	/* An entry without valid data */
+			ord = 0xFF;
+		} else if (a == AM_LFN) {	/* An LFN entry is found */
+			if (c & LLEF) {			/* Is it start of LFN sequence? */
+				sum = dir[LDIR_Chksum];
+				c &= ~LLEF; ord = c;
+				start = dp->index; hash = 0;
+			}
+			ord = (c == ord && sum == dir[LDIR_Chksum] && dc_sum_lfn(&hash, dir)) ? ord - 1 : 0xFF;
+		} else {					/* An SFN entry is found */
+			if (!ord && sum == sum_sfn(dir)) {	/* Has it a valid LFN? */
+				dc_add(dp->fs, dc, dc_fold(hash), start);
+			} else {
+				start = dp->index;
+			}
+			dc_add(dp->fs, dc, dc_hash_sfn(dir), start);
+			ord = 0xFF;
+		}
+#else		/* Non LFN configuration */
+		if (c != DDEM && !(dir[DIR_Attr] & AM_VOL))
+			dc_add(dp->fs, dc, dc_hash_sfn(dir), dp->index);
+#endif
+		res = dir_next(dp, 0);		/* Next entry */
+	}
+	if (res == FR_NO_FILE) res = FR_OK;	/* Reached to end of directory */
+	return res;
+}
+
+
+static
+FRESULT dc_probe (	/* FR_OK(0):matched, FR_NO_FILE:not matched, !=0:error */
+	DIR* dp,		/* Pointer to the directory object linked to the file name */
+	DCACHE* dc,		/* Cache of the directory */
+	WORD hash		/* Name hash */
+)
+{
+	FRESULT res;
+	UINT i = hash & (dc->size - 1);
+
+
+	for ( ; dc->tbl[i] != DC_EMPTY; i = (i + 1) & (dc->size - 1)) {
+		if ((WORD)(dc->tbl[i] >> 16) != hash) continue;
+		res = dir_match(dp, dc->tbl[i] & 0xFFFF, 1);	/* Verify the object */
+		if (res != FR_NO_FILE) return res;
+	}
+	return FR_NO_FILE;
+}
+
+
+static
+int dcache_find (	/* 1:searched in the cache, 0:linear search is needed */
+	DIR* dp,		/* Pointer to the directory object linked to the file name */
+	FRESULT* res	/* Result of the search */
+)
+{
+	FATFS *fs = dp->fs;
+	DCACHE *dc, *lru, cnt;
+	UINT i;
+
+
+	dc = dc_slot(dp);
+	if (!dc) {						/* Replace the unused, the least recently used linear one or the least recently used cache */
+		dc = lru = fs->dcache;
+		for (i = 0; i < _FS_DCACHE; i++, dc++) {
+			if (dc->id != fs->id) { lru = dc; break; }
+			if ((!dc->tbl && lru->tbl) || (!dc->tbl == !lru->tbl && fs->dcstamp - dc->stamp > fs->dcstamp - lru->stamp)) lru = dc;
+		}
+		cnt.size = cnt.count = 0; cnt.tbl = 0;
+		*res = dc_scan(dp, &cnt);	/* Count the names without the table */
+		if (*res != FR_OK) return 1;
+		if (cnt.count < _FS_DCACHE_MIN && lru->id == fs->id && lru->tbl) return 0;	/* Small directory does not replace a table */
+		dc = lru;
+		dc_drop(dc);
+		dc->size = 0; dc->count = cnt.count;
+		if (cnt.count >= _FS_DCACHE_MIN && dc_grow(fs, dc, cnt.count * 2)) {	/* Leave room for the new objects */
+			*res = dc_scan(dp, dc);	/* Linear search if the table is over the budget */
+			if (*res != FR_OK) {
+				dc_drop(dc);
+				return 1;
+			}
+		}
+		dc->sclust = dc_key(dp); dc->id = fs->id;
+	}
+	dc->stamp = ++fs->dcstamp;
+	if (!dc->tbl) return 0;
+
+	*res = FR_NO_FILE;
+#if _USE_LFN
+	if (dp->lfn) *res = dc_probe(dp, dc, dc_hash_lfn(dp->lfn));
+	if (*res == FR_NO_FILE && !(dp->fn[NSFLAG] & NS_LOSS)) *res = dc_probe(dp, dc, dc_hash_sfn(dp->fn));
+#else
+	*res = dc_probe(dp, dc, dc_hash_sfn(dp->fn));
+#endif
+	return 1;
+}
+
+
+#if !_FS_READONLY
+static
+void dcache_add (
+	DIR* dp,		/* Directory object pointing the SFN entry registered */
+	UINT start,		/* Index of the first entry of the object */
+	int lfn			/* 1:The object has LFN entries of dp->lfn */
+)
+{
+	DCACHE* dc = dc_slot(dp);
+	UINT n = lfn ? 2 : 1;
+
+
+	if (!dc) return;
+	if (dc->tbl ? (dc->count + n) * 2 > dc->size : dc->count < _FS_DCACHE_MIN && dc->count + n >= _FS_DCACHE_MIN) {
+		dc_drop(dc);				/* Rebuild it at next search */
+		return;
+	}
+	if (!dc->tbl) { dc->count += n; return; }
+	dc_insert(dc, dc_hash_sfn(dp->fn), start);
+#if _USE_LFN
+	if (lfn) dc_insert(dc, dc_hash_lfn(dp->lfn), start);
+#endif
+}
+
+
+static
+void dcache_drop (
+	FATFS* fs,		/* Pointer to the fs object */
+	DWORD sclust	/* Start cluster of the directory removed or created */
+)
+{
+	DCACHE* dc = fs->dcache;
+	UINT i;
+
+	for (i = 0; i < _FS_DCACHE; i++, dc++) {
+		if (dc->id == fs->id && dc->sclust == sclust) dc_drop(dc);
+	}
+}
+#endif
+#endif	/* _FS_DCACHE */
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* Directory handling - Find an object in the directory                  */
+/*-----------------------------------------------------------------------*/
+
+static
+FRESULT dir_find (	/* FR_OK(0):succeeded, !=0:error */
+	DIR* dp			/* Pointer to the directory object linked to the file name */
+)
+{
+#if _FS_DCACHE
+	FRESULT res;
+
+	if (dcache_find(dp, &res)) return res;
+#endif
+	return dir_match(dp, 0, 0);
+}
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Read an object from the directory                                     */
 /*-----------------------------------------------------------------------*/
@@ -1580,6 +2052,7 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 )
 {
 	FRESULT res;
+	UINT start;
 #if _USE_LFN	/* LFN configuration */
 	UINT n, nent;
 	BYTE sn[12], *fn, sum;
@@ -1611,6 +2084,7 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 		nent = 1;
 	}
 	res = dir_alloc(dp, nent);		/* Allocate entries */
+	start = dp->index + 1 - nent;	/* Index of the first entry of the object */
 
 	if (res == FR_OK && --nent) {	/* Set LFN entry if needed */
 		res = dir_sdi(dp, dp->index - nent);
@@ -1627,6 +2101,7 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 	}
 #else	/* Non LFN configuration */
 	res = dir_alloc(dp, 1);		/* Allocate an entry for SFN */
+	start = dp->index;
 #endif
 
 	if (res == FR_OK) {				/* Set SFN entry */
@@ -1638,6 +2113,13 @@ FRESULT dir_register (	/* FR_OK:succeeded, FR_DENIED:no free entry or too many S
 			dp->dir[DIR_NTres] = dp->fn[NSFLAG] & (NS_BODY | NS_EXT);	/* Put NT flag */
 #endif
 			dp->fs->wflag = 1;
+#if _FS_DCACHE
+#if _USE_LFN
+			dcache_add(dp, start, start != dp->index);	/* Add the names to the lookup cache */
+#else
+			dcache_add(dp, start, 0);
+#endif
+#endif
 		}
 	}
 
@@ -2409,6 +2891,9 @@ FRESULT f_mount (
 	int vol;
 	FRESULT res;
 	const TCHAR *rp = path;
+#if _FS_DCACHE
+	UINT i;
+#endif
 
 
 	vol = get_ldnumber(&rp);
@@ -2416,6 +2901,10 @@ FRESULT f_mount (
 	cfs = FatFs[vol];					/* Pointer to fs object */
 
 	if (cfs) {
+#if !_FS_READONLY
+		if (cfs->fs_type)				/* Flush the window and the disk cache of the old volume */
+			sync_fs(cfs);
+#endif
 #if _FS_LOCK
 		clear_lock(cfs);
 #endif
@@ -2423,10 +2912,16 @@ FRESULT f_mount (
 		if (!ff_del_syncobj(cfs->sobj)) return FR_INT_ERR;
 #endif
 		cfs->fs_type = 0;				/* Clear old fs object */
+#if _FS_DCACHE
+		for (i = 0; i < _FS_DCACHE; i++) dc_drop(&cfs->dcache[i]);	/* Discard the directory lookup cache */
+#endif
 	}
 
 	if (fs) {
 		fs->fs_type = 0;				/* Clear new fs object */
+#if _FS_DCACHE
+		mem_set(fs->dcache, 0, sizeof fs->dcache);
+#endif
 #if _FS_REENTRANT						/* Create sync object for the new volume */
 		if (!ff_cre_syncobj((BYTE)vol, &fs->sobj)) return FR_INT_ERR;
 #endif
@@ -2565,11 +3060,19 @@ FRESULT f_open (
 			fp->fsize = LD_DWORD(dir + DIR_FileSize);	/* File size */
 			fp->fptr = 0;						/* File pointer */
 			fp->dsect = 0;
+#if !_FS_READONLY
+			fp->ecl = 0;						/* Not contiguous */
+#endif
 #if _USE_FASTSEEK
 			fp->cltbl = 0;						/* Normal seek mode */
+			fp->clmap = 0;
 #endif
 			fp->fs = dj.fs;	 					/* Validate file object */
 			fp->id = fp->fs->id;
+#if _USE_FASTSEEK && _FS_FASTSEEK_MIN
+			if (fp->fsize >= _FS_FASTSEEK_MIN)	/* Fast seek mode for the large file */
+				open_linkmap(fp);
+#endif
 		}
 	}
 
@@ -2615,6 +3118,11 @@ FRESULT f_read (
 				if (fp->fptr == 0) {			/* On the top of the file? */
 					clst = fp->sclust;			/* Follow from the origin */
 				} else {						/* Middle or end of the file */
+#if !_FS_READONLY
+					if (fp->clust + 1 < fp->ecl)
+						clst = fp->clust + 1;		/* Next cluster in the contiguous extent */
+					else
+#endif
 #if _USE_FASTSEEK
 					if (fp->cltbl)
 						clst = clmt_clust(fp, fp->fptr);	/* Get cluster# from the CLMT */
@@ -2707,6 +3215,14 @@ FRESULT f_write (
 	if (!(fp->flag & FA_WRITE))				/* Check access mode */
 		LEAVE_FF(fp->fs, FR_DENIED);
 	if (fp->fptr + btw < fp->fptr) btw = 0;	/* File size cannot reach 4GB */
+#if _USE_FASTSEEK
+	if (fp->cltbl && fp->fptr + btw > fp->fsize) {	/* The link map does not cover the new clusters */
+		fp->cltbl = 0;
+#if _FS_FASTSEEK_MIN
+		close_linkmap(fp);
+#endif
+	}
+#endif
 
 	for ( ;  btw;							/* Repeat until all data written */
 		wbuff += wcnt, fp->fptr += wcnt, *bw += wcnt, btw -= wcnt) {
@@ -2718,6 +3234,9 @@ FRESULT f_write (
 					if (clst == 0)			/* When no cluster is allocated, */
 						clst = create_chain(fp->fs, 0);	/* Create a new cluster chain */
 				} else {					/* Middle or end of the file */
+					if (fp->clust + 1 < fp->ecl)
+						clst = fp->clust + 1;		/* Next cluster in the contiguous extent, no FAT access */
+					else
 #if _USE_FASTSEEK
 					if (fp->cltbl)
 						clst = clmt_clust(fp, fp->fptr);	/* Get cluster# from the CLMT */
@@ -2862,6 +3381,13 @@ FRESULT f_close (
 
 
 #if !_FS_READONLY
+#if _USE_EXPAND && _FS_MINIMIZE == 0
+	if (fp->ecl && (fp->flag & FA_WRITE)) {	/* Release the part of the extent not written */
+		res = f_lseek(fp, fp->fsize);
+		if (res == FR_OK) res = f_truncate(fp);
+		if (res != FR_OK) return res;
+	}
+#endif
 	res = f_sync(fp);					/* Flush cached data */
 	if (res == FR_OK)
 #endif
@@ -2871,6 +3397,9 @@ FRESULT f_close (
 #if _FS_REENTRANT
 			FATFS *fs = fp->fs;
 #endif
+#if _USE_FASTSEEK && _FS_FASTSEEK_MIN
+			close_linkmap(fp);			/* Free the link map */
+#endif
 #if _FS_LOCK
 			res = dec_lock(fp->lockid);	/* Decrement file open counter */
 			if (res == FR_OK)
@@ -3034,7 +3563,7 @@ FRESULT f_lseek (
 	FRESULT res;
 	DWORD clst, bcs, nsect, ifptr;
 #if _USE_FASTSEEK
-	DWORD cl, pcl, ncl, tcl, dsc, tlen, ulen, *tbl;
+	DWORD dsc;
 #endif
 
 
@@ -3044,31 +3573,15 @@ FRESULT f_lseek (
 		LEAVE_FF(fp->fs, (FRESULT)fp->err);
 
 #if _USE_FASTSEEK
+#if !_FS_READONLY && _FS_FASTSEEK_MIN
+	if (fp->clmap && fp->cltbl == fp->clmap && ofs != CREATE_LINKMAP
+		&& ofs > fp->fsize && (fp->flag & FA_WRITE))
+		close_linkmap(fp);				/* Expanding the file needs the normal seek */
+#endif
 	if (fp->cltbl) {	/* Fast seek */
 		if (ofs == CREATE_LINKMAP) {	/* Create CLMT */
-			tbl = fp->cltbl;
-			tlen = *tbl++; ulen = 2;	/* Given table size and required table size */
-			cl = fp->sclust;			/* Top of the chain */
-			if (cl) {
-				do {
-					/* Get a fragment */
-					tcl = cl; ncl = 0; ulen += 2;	/* Top, length and used items */
-					do {
-						pcl = cl; ncl++;
-						cl = get_fat(fp->fs, cl);
-						if (cl <= 1) ABORT(fp->fs, FR_INT_ERR);
-						if (cl == 0xFFFFFFFF) ABORT(fp->fs, FR_DISK_ERR);
-					} while (cl == pcl + 1);
-					if (ulen <= tlen) {		/* Store the length and top of the fragment */
-						*tbl++ = ncl; *tbl++ = tcl;
-					}
-				} while (cl < fp->fs->n_fatent);	/* Repeat until end of chain */
-			}
-			*fp->cltbl = ulen;	/* Number of items used */
-			if (ulen <= tlen)
-				*tbl = 0;		/* Terminate table */
-			else
-				res = FR_NOT_ENOUGH_CORE;	/* Given table size is smaller than required */
+			res = create_linkmap(fp);
+			if (res != FR_OK && res != FR_NOT_ENOUGH_CORE) ABORT(fp->fs, res);
 
 		} else {						/* Fast seek */
 			if (ofs > fp->fsize)		/* Clip offset at the file size */
@@ -3485,7 +3998,8 @@ FRESULT f_truncate (
 		}
 	}
 	if (res == FR_OK) {
-		if (fp->fsize > fp->fptr) {
+		if (fp->fsize > fp->fptr || fp->ecl) {	/* The extent may be longer than the file */
+			fp->ecl = 0;			/* The extent is cut at the R/W point */
 			fp->fsize = fp->fptr;	/* Set file size to current R/W point */
 			fp->flag |= FA__WRITTEN;
 			if (fp->fptr == 0) {	/* When set file size to zero, remove entire cluster chain */
@@ -3519,6 +4033,84 @@ FRESULT f_truncate (
 
 
 
+#if _USE_EXPAND && !_FS_READONLY
+/*-----------------------------------------------------------------------*/
+/* Allocate a Contiguous Block to the File                               */
+/*-----------------------------------------------------------------------*/
+
+FRESULT f_expand (
+	FIL* fp,		/* Pointer to the file object */
+	DWORD fsz,		/* File size to be expanded to */
+	BYTE opt		/* Operation mode EXPAND_HINT, EXPAND_ALLOC or EXPAND_APPEND */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD val, clst, stcl, scl, ncl, tcl, lclst;
+
+
+	res = validate(fp);		/* Check validity of the object */
+	if (res != FR_OK) LEAVE_FF(fp->fs, res);
+	if (fp->err)			/* Check error */
+		LEAVE_FF(fp->fs, (FRESULT)fp->err);
+	if (fsz == 0 || opt > EXPAND_APPEND || fp->fsize != 0 || fp->sclust != 0 || !(fp->flag & FA_WRITE))
+		LEAVE_FF(fp->fs, FR_DENIED);	/* The file must be empty */
+
+	fs = fp->fs;
+	tcl = (fsz - 1) / SS(fs) / fs->csize + 1;	/* Number of clusters required */
+	if (tcl > fs->n_fatent - 2) LEAVE_FF(fs, FR_DENIED);
+
+	stcl = fs->last_clust; lclst = 0;
+	if (stcl < 2 || stcl >= fs->n_fatent) stcl = 2;
+	scl = clst = stcl; ncl = 0;
+	for (;;) {				/* Find a contiguous free block */
+		val = get_fat(fs, clst);
+		if (val == 1) { res = FR_INT_ERR; break; }
+		if (val == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+		if (val == 0 && ++ncl == tcl) break;	/* A contiguous block is found */
+		if (++clst >= fs->n_fatent) clst = 2;
+		if (val != 0 || clst == 2) {	/* Not a free cluster, or the block cannot wrap around the end */
+			scl = clst; ncl = 0;
+		}
+		if (clst == stcl) { res = FR_DENIED; break; }	/* No contiguous block */
+	}
+
+	if (res == FR_OK) {
+		if (opt != EXPAND_HINT) {	/* Create the cluster chain on the FAT now */
+			for (clst = scl, ncl = tcl; ncl; clst++, ncl--) {
+				res = put_fat(fs, clst, (ncl == 1) ? 0x0FFFFFFF : clst + 1);
+				if (res != FR_OK) break;
+				lclst = clst;
+			}
+		} else {					/* Suggest it to the next allocation */
+			lclst = scl - 1;
+		}
+	}
+
+	if (res == FR_OK) {
+		fs->last_clust = lclst;
+		if (opt != EXPAND_HINT) {
+			fp->sclust = scl;		/* The file owns the block */
+			fp->ecl = scl + tcl;	/* The writing inside the block needs no FAT access */
+			if (opt == EXPAND_ALLOC)
+				fp->fsize = fsz;
+			fp->flag |= FA__WRITTEN;
+			if (fs->free_clust <= fs->n_fatent - 2) {
+				fs->free_clust -= tcl;
+				fs->fsi_flag |= 1;
+			}
+		}
+	} else if (res != FR_DENIED) {
+		fp->err = (FRESULT)res;
+	}
+
+	LEAVE_FF(fs, res);
+}
+#endif /* _USE_EXPAND && !_FS_READONLY */
+
+
+
+
 /*-----------------------------------------------------------------------*/
 /* Delete a File or Directory                                            */
 /*-----------------------------------------------------------------------*/
@@ -3576,6 +4168,9 @@ FRESULT f_unlink (
 				res = dir_remove(&dj);		/* Remove the directory entry */
 				if (res == FR_OK && dclst)	/* Remove the cluster chain if exist */
 					res = remove_chain(dj.fs, dclst);
+#if _FS_DCACHE
+				if (dclst) dcache_drop(dj.fs, dclst);	/* The cluster may be a directory again */
+#endif
 				if (res == FR_OK) res = sync_fs(dj.fs);
 			}
 		}
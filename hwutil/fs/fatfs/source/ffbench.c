@@ -0,0 +1,633 @@
+/*
+ * File         : ffbench.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ * 
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-08       DongHeng        create
+ */
+
+#include "ffbench.h"
+#include "diskio.h"
+#include "ramdisk.h"
+#include "time.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#if USING_SHELL
+#include "shell.h"
+#endif
+
+/*@{*/
+
+/* the file and the size of the sequential benchmark */
+#define FFBENCH_SEQ_FILE        "sdbench.bin"
+#define FFBENCH_SEQ_SIZE        (256UL * 1024)
+
+/* the chunk is multiple of the sector, so FatFs transfers it directly */
+#define FFBENCH_SEQ_CHUNK       (4U * 1024)
+
+/* the file and the size of the random seek benchmark, the map is built for it */
+#define FFBENCH_SEEK_FILE       "seekbnch.bin"
+#define FFBENCH_SEEK_SIZE       (4UL * 1024 * 1024)
+#define FFBENCH_SEEK_NUM        200
+
+/* the bytes read after every seeking */
+#define FFBENCH_SEEK_READ       16
+
+/* the file, the size and the record of the append benchmark */
+#define FFBENCH_LOG_FILE        "logbench.bin"
+#define FFBENCH_LOG_SIZE        (256UL * 1024)
+#define FFBENCH_LOG_CHUNK       (512U)
+
+/* the directory and the files of the small file benchmark */
+#define FFBENCH_META_DIR        "fsbench"
+#define FFBENCH_META_NUM        32
+#define FFBENCH_META_SIZE       512
+
+/* the long name of the small file, and the maximum length of its path */
+#define FFBENCH_META_NAME       "%s/smallfile_%05u.dat"
+#define FFBENCH_PATH_MAX        48
+
+/* the files are opened again in the order of the prime stride */
+#define FFBENCH_META_STRIDE     7919
+
+/* the ram disk is the physical drive 1, so it is mounted as "1:" */
+#define FFBENCH_RAM_DRV         1
+#define FFBENCH_RAM_PATH        "1:"
+#define FFBENCH_RAM_SECTORS     128
+
+/* the work area of every volume when no one mounts it */
+static FATFS *ffbench_fs[_VOLUMES];
+
+/*@}*/
+
+/*
+ * ffbench_ms - get the current time in millisecond
+ */
+static DWORD ffbench_ms(void)
+{
+    struct timespec ts;
+  
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * ffbench_mount - the function will mount the volume if no one mounts it
+ *
+ * @param path the logical drive, "" means the default volume
+ *
+ * @return the result
+ */
+FRESULT ffbench_mount(const TCHAR *path)
+{
+    DWORD clst;
+    FATFS *fs;
+    FRESULT res;
+    int vol = 0;
+    
+    if ((res = f_getfree(path, &clst, &fs)) != FR_NOT_ENABLED)
+        return res;
+    
+    if (path[0] >= '0' && path[0] < '0' + _VOLUMES && path[1] == ':')
+        vol = path[0] - '0';
+    
+    if (!ffbench_fs[vol] && !(ffbench_fs[vol] = malloc(sizeof(FATFS))))
+        return FR_NOT_ENOUGH_CORE;
+  
+    return f_mount(ffbench_fs[vol], path, 1);
+}
+
+/**
+ * ffbench_seq - the function will write the file sequentially and read it back
+ *
+ * @param path   the file path
+ * @param size   the bytes of the file
+ * @param chunk  the bytes of every reading or writing
+ * @param result the result of the benchmark
+ *
+ * @return the result
+ */
+FRESULT ffbench_seq(const TCHAR *path, DWORD size, UINT chunk, struct ffbench_result *result)
+{
+    FIL *fil;
+    BYTE *buf;
+    DWORD done, start;
+    UINT bw;
+    FRESULT res;
+    
+    memset(result, 0, sizeof(struct ffbench_result));
+    
+    fil = malloc(sizeof(FIL));
+    buf = malloc(chunk);
+    if (!fil || !buf)
+    {
+        res = FR_NOT_ENOUGH_CORE;
+        goto out;
+    }
+    
+    memset(buf, 0x5a, chunk);
+    
+    if ((res = f_open(fil, path, FA_CREATE_ALWAYS | FA_WRITE)) != FR_OK)
+        goto out;
+    
+    start = ffbench_ms();
+    for (done = 0; done < size && res == FR_OK; done += bw)
+    {
+        if ((res = f_write(fil, buf, chunk, &bw)) == FR_OK && bw < chunk)
+            res = FR_DENIED;
+    }
+    if (res == FR_OK)
+        res = f_sync(fil);
+    result->write_ms = ffbench_ms() - start;
+    
+    f_close(fil);
+    
+    if (res != FR_OK)
+        goto out;
+    
+    if ((res = f_open(fil, path, FA_READ)) != FR_OK)
+        goto out;
+    
+    start = ffbench_ms();
+    for (done = 0; done < size && res == FR_OK; done += bw)
+    {
+        if ((res = f_read(fil, buf, chunk, &bw)) == FR_OK && !bw)
+            break;
+    }
+    result->read_ms = ffbench_ms() - start;
+    result->bytes = done;
+    
+    f_close(fil);
+    f_unlink(path);
+    
+out:
+    if (buf)
+        free(buf);
+    if (fil)
+        free(fil);
+    
+    return res;
+}
+
+/**
+ * ffbench_meta - the function will create the small files in the directory, 
+ *                open them again in the scattered order, list the directory 
+ *                and delete them
+ *
+ * @param dir    the directory path, it is created and deleted
+ * @param files  the number of the files
+ * @param size   the bytes of every file
+ * @param result the result of the benchmark
+ *
+ * @return the result
+ */
+FRESULT ffbench_meta(const TCHAR *dir, UINT files, UINT size, struct ffbench_meta_result *result)
+{
+    FIL *fil;
+    BYTE *buf;
+    DIR *dj;
+    FILINFO fno;
+    TCHAR path[FFBENCH_PATH_MAX];
+    DWORD start;
+    UINT i, n, bw;
+    FRESULT res;
+    
+    memset(result, 0, sizeof(struct ffbench_meta_result));
+    
+    if (strlen(dir) + sizeof("/smallfile_00000.dat") > sizeof(path) || files > 100000)
+        return FR_INVALID_NAME;
+    
+    fil = malloc(sizeof(FIL));
+    dj = malloc(sizeof(DIR));
+    buf = malloc(size);
+    if (!fil || !dj || !buf)
+    {
+        res = FR_NOT_ENOUGH_CORE;
+        goto out;
+    }
+    
+    memset(buf, 0x3c, size);
+    
+    if ((res = f_mkdir(dir)) != FR_OK && res != FR_EXIST)
+        goto out;
+    
+    start = ffbench_ms();
+    for (i = 0; i < files && res == FR_OK; i++)
+    {
+        sprintf(path, FFBENCH_META_NAME, dir, i);
+        if ((res = f_open(fil, path, FA_CREATE_ALWAYS | FA_WRITE)) != FR_OK)
+            break;
+        if ((res = f_write(fil, buf, size, &bw)) == FR_OK && bw < size)
+            res = FR_DENIED;
+        if (f_close(fil) != FR_OK && res == FR_OK)
+            res = FR_DISK_ERR;
+    }
+    result->create_ms = ffbench_ms() - start;
+    
+    /* the name is searched in the directory every time */
+    start = ffbench_ms();
+    for (n = 0; n < files && res == FR_OK; n++)
+    {
+        sprintf(path, FFBENCH_META_NAME, dir, (UINT)((DWORD)n * FFBENCH_META_STRIDE % files));
+        if ((res = f_open(fil, path, FA_OPEN_EXISTING | FA_READ)) == FR_OK)
+            res = f_close(fil);
+    }
+    result->open_ms = ffbench_ms() - start;
+    
+    if (res == FR_OK && (res = f_opendir(dj, dir)) == FR_OK)
+    {
+#if _USE_LFN
+        fno.lfname = NULL;
+#endif
+        start = ffbench_ms();
+        while ((res = f_readdir(dj, &fno)) == FR_OK && fno.fname[0])
+            result->files++;
+        result->list_ms = ffbench_ms() - start;
+        f_closedir(dj);
+    }
+    
+    /* the files created are deleted even if the benchmark fails */
+    start = ffbench_ms();
+    while (i--)
+    {
+        sprintf(path, FFBENCH_META_NAME, dir, i);
+        f_unlink(path);
+    }
+    f_unlink(dir);
+    result->unlink_ms = ffbench_ms() - start;
+    
+out:
+    if (buf)
+        free(buf);
+    if (dj)
+        free(dj);
+    if (fil)
+        free(fil);
+    
+    return res;
+}
+
+/**
+ * ffbench_append - the function will append the records to the file like the 
+ *                  logger, and record the slowest appending
+ *
+ * @param path     the file path
+ * @param size     the bytes of the file
+ * @param chunk    the bytes of every record
+ * @param prealloc true means allocating the contiguous extent before appending
+ * @param result   the result of the benchmark
+ *
+ * @return the result
+ */
+FRESULT ffbench_append(const TCHAR *path, DWORD size, UINT chunk, bool prealloc, struct ffbench_append_result *result)
+{
+    FIL *fil;
+    BYTE *buf;
+    DWORD start, now, last;
+    UINT bw;
+    FRESULT res;
+    
+    memset(result, 0, sizeof(struct ffbench_append_result));
+    
+    fil = malloc(sizeof(FIL));
+    buf = malloc(chunk);
+    if (!fil || !buf)
+    {
+        res = FR_NOT_ENOUGH_CORE;
+        goto out;
+    }
+    
+    memset(buf, 0x69, chunk);
+    
+    if ((res = f_open(fil, path, FA_CREATE_ALWAYS | FA_WRITE)) != FR_OK)
+        goto out;
+#if _USE_EXPAND
+    if (prealloc && (res = f_expand(fil, size, EXPAND_APPEND)) != FR_OK)
+    {
+        f_close(fil);
+        goto unlink;
+    }
+#endif
+    
+    start = last = ffbench_ms();
+    while (result->bytes < size)
+    {
+        if ((res = f_write(fil, buf, chunk, &bw)) == FR_OK && bw < chunk)
+            res = FR_DENIED;
+        if (res != FR_OK)
+            break;
+        
+        now = ffbench_ms();
+        if (now - last > result->max_ms)
+            result->max_ms = now - last;
+        last = now;
+        result->bytes += bw;
+    }
+    result->total_ms = ffbench_ms() - start;
+    
+    if (f_close(fil) != FR_OK && res == FR_OK)
+        res = FR_DISK_ERR;
+unlink:
+    f_unlink(path);
+    
+out:
+    if (buf)
+        free(buf);
+    if (fil)
+        free(fil);
+    
+    return res;
+}
+
+/*
+ * ffbench_seek_run - seek the file randomly and read a few bytes every time
+ */
+static FRESULT ffbench_seek_run(FIL *fil, DWORD size, UINT seeks, DWORD *ms)
+{
+    BYTE buf[FFBENCH_SEEK_READ];
+    DWORD seed = 0x1234567, start;
+    UINT i, br;
+    FRESULT res = FR_OK;
+    
+    start = ffbench_ms();
+    for (i = 0; i < seeks && res == FR_OK; i++)
+    {
+        /* the same sequence of the offset is used by every run */
+        seed = seed * 1103515245 + 12345;
+        
+        if ((res = f_lseek(fil, (seed >> 8) % (size - FFBENCH_SEEK_READ))) == FR_OK)
+            res = f_read(fil, buf, FFBENCH_SEEK_READ, &br);
+    }
+    *ms = ffbench_ms() - start;
+    
+    return res;
+}
+
+/**
+ * ffbench_seek - the function will compare the random seeking by following 
+ *                the FAT chain with the one by the cluster link map
+ *
+ * @param path   the file path
+ * @param size   the bytes of the file
+ * @param seeks  the times of the seeking
+ * @param result the result of the benchmark
+ *
+ * @return the result
+ */
+FRESULT ffbench_seek(const TCHAR *path, DWORD size, UINT seeks, struct ffbench_seek_result *result)
+{
+    FIL *fil;
+    BYTE *buf;
+    DWORD done, *map = NULL;
+    UINT bw;
+    FRESULT res;
+    
+    memset(result, 0, sizeof(struct ffbench_seek_result));
+    
+    fil = malloc(sizeof(FIL));
+    buf = malloc(FFBENCH_SEQ_CHUNK);
+    if (!fil || !buf)
+    {
+        res = FR_NOT_ENOUGH_CORE;
+        goto out;
+    }
+    
+    memset(buf, 0xa5, FFBENCH_SEQ_CHUNK);
+    
+    if ((res = f_open(fil, path, FA_CREATE_ALWAYS | FA_WRITE)) != FR_OK)
+        goto out;
+    for (done = 0; done < size && res == FR_OK; done += bw)
+    {
+        if ((res = f_write(fil, buf, FFBENCH_SEQ_CHUNK, &bw)) == FR_OK && bw < FFBENCH_SEQ_CHUNK)
+            res = FR_DENIED;
+    }
+    f_close(fil);
+    if (res != FR_OK)
+        goto unlink;
+    
+    /* the map is built at opening if the file is large enough */
+    if ((res = f_open(fil, path, FA_READ)) != FR_OK)
+        goto unlink;
+#if _USE_FASTSEEK
+    if ((map = fil->cltbl) != NULL)
+        result->map_items = map[0];
+    fil->cltbl = NULL;
+#endif
+    
+    res = ffbench_seek_run(fil, size, seeks, &result->chain_ms);
+    
+#if _USE_FASTSEEK
+    if (res == FR_OK && map)
+    {
+        fil->cltbl = map;
+        res = ffbench_seek_run(fil, size, seeks, &result->map_ms);
+    }
+#endif
+    result->seeks = seeks;
+    
+    f_close(fil);
+unlink:
+    f_unlink(path);
+    
+out:
+    if (buf)
+        free(buf);
+    if (fil)
+        free(fil);
+    
+    return res;
+}
+
+/**
+ * ffbench_rate - the function will compute the throughput
+ *
+ * @param bytes the bytes transfered
+ * @param ms    the time costs in millisecond
+ *
+ * @return the throughput in KB/s
+ */
+DWORD ffbench_rate(DWORD bytes, DWORD ms)
+{
+    if (!ms)
+        ms = 1;
+  
+    return (bytes / ms) * 1000 / 1024;
+}
+
+/******************************************************************************/
+
+#if USING_SHELL
+
+/*
+ * ffbench_report - run the sequential and the small file benchmark of the volume
+ */
+static void ffbench_report(struct shell_dev *shell_dev, const TCHAR *drv, DWORD size)
+{
+    struct ffbench_result result;
+    struct ffbench_meta_result meta;
+    TCHAR path[FFBENCH_PATH_MAX];
+    FRESULT res;
+    
+    sprintf(path, "%s%s", drv, FFBENCH_SEQ_FILE);
+    if ((res = ffbench_seq(path, size, FFBENCH_SEQ_CHUNK, &result)) != FR_OK)
+    {
+        shell_printk(shell_dev, "\r\nbenchmark failed (%d)\r\n", res);
+        return ;
+    }
+    
+    shell_printk(shell_dev, "\r\nsequential %d KB, chunk %d bytes", 
+                            result.bytes / 1024, FFBENCH_SEQ_CHUNK);
+    shell_printk(shell_dev, "\r\nwrite %d ms, %d KB/s",
+                            result.write_ms, ffbench_rate(result.bytes, result.write_ms));
+    shell_printk(shell_dev, "\r\nread  %d ms, %d KB/s",
+                            result.read_ms, ffbench_rate(result.bytes, result.read_ms));
+    
+    sprintf(path, "%s%s", drv, FFBENCH_META_DIR);
+    if ((res = ffbench_meta(path, FFBENCH_META_NUM, FFBENCH_META_SIZE, &meta)) != FR_OK)
+    {
+        shell_printk(shell_dev, "\r\nbenchmark failed (%d)\r\n", res);
+        return ;
+    }
+    
+    shell_printk(shell_dev, "\r\nsmall file %d x %d bytes", FFBENCH_META_NUM, FFBENCH_META_SIZE);
+    shell_printk(shell_dev, "\r\ncreate %d ms, %d us/file", 
+                            meta.create_ms, meta.create_ms * 1000 / FFBENCH_META_NUM);
+    shell_printk(shell_dev, "\r\nopen   %d ms, %d us/file", 
+                            meta.open_ms, meta.open_ms * 1000 / FFBENCH_META_NUM);
+    shell_printk(shell_dev, "\r\nlist   %d ms, %d entries", meta.list_ms, meta.files);
+    shell_printk(shell_dev, "\r\ndelete %d ms, %d us/file\r\n", 
+                            meta.unlink_ms, meta.unlink_ms * 1000 / FFBENCH_META_NUM);
+}
+
+static void sdbench(struct shell_dev *shell_dev)
+{
+    FRESULT res;
+    
+    if ((res = ffbench_mount("")) != FR_OK)
+    {
+        shell_printk(shell_dev, "\r\nmount failed (%d)\r\n", res);
+        return ;
+    }
+    
+    ffbench_report(shell_dev, "", FFBENCH_SEQ_SIZE);
+}
+SHELL_CMD_EXPORT(sdbench, sequential and small file throughput of the disk, 1);
+
+static void rambench(struct shell_dev *shell_dev)
+{
+    static BYTE *mem;
+    FRESULT res;
+    
+    /* the ram disk is formatted at the first time */
+    if (!mem)
+    {
+        if (!(mem = malloc(FFBENCH_RAM_SECTORS * RAMDISK_SECTOR_SIZE)))
+        {
+            shell_printk(shell_dev, "\r\nno memory for the ram disk\r\n");
+            return ;
+        }
+        
+        if (ramdisk_register(FFBENCH_RAM_DRV, mem, FFBENCH_RAM_SECTORS)
+            || (res = ffbench_mount(FFBENCH_RAM_PATH)) != FR_NO_FILESYSTEM
+            || (res = f_mkfs(FFBENCH_RAM_PATH, 1, 0)) != FR_OK)
+        {
+            shell_printk(shell_dev, "\r\nram disk failed\r\n");
+            free(mem);
+            mem = NULL;
+            return ;
+        }
+    }
+    
+    if ((res = ffbench_mount(FFBENCH_RAM_PATH)) != FR_OK)
+    {
+        shell_printk(shell_dev, "\r\nmount failed (%d)\r\n", res);
+        return ;
+    }
+    
+    ffbench_report(shell_dev, FFBENCH_RAM_PATH, FFBENCH_RAM_SECTORS * RAMDISK_SECTOR_SIZE / 4);
+}
+SHELL_CMD_EXPORT(rambench, sequential and small file throughput of the ram disk, 1);
+
+static void logbench(struct shell_dev *shell_dev)
+{
+    struct ffbench_append_result result;
+    FRESULT res;
+    int prealloc;
+    
+    if ((res = ffbench_mount("")) != FR_OK)
+    {
+        shell_printk(shell_dev, "\r\nmount failed (%d)\r\n", res);
+        return ;
+    }
+    
+    shell_printk(shell_dev, "\r\nappend %d KB, record %d bytes", 
+                            FFBENCH_LOG_SIZE / 1024, FFBENCH_LOG_CHUNK);
+    
+    for (prealloc = 0; prealloc < 2; prealloc++)
+    {
+        if ((res = ffbench_append(FFBENCH_LOG_FILE, FFBENCH_LOG_SIZE, FFBENCH_LOG_CHUNK, 
+                                  prealloc, &result)) != FR_OK)
+        {
+            shell_printk(shell_dev, "\r\nbenchmark failed (%d)\r\n", res);
+            return ;
+        }
+        
+        shell_printk(shell_dev, "\r\n%s %d ms, %d KB/s, slowest %d ms", 
+                                prealloc ? "extent" : "chain ", result.total_ms,
+                                ffbench_rate(result.bytes, result.total_ms), result.max_ms);
+    }
+    shell_printk(shell_dev, "\r\n");
+}
+SHELL_CMD_EXPORT(logbench, append latency with and without the contiguous extent, 1);
+
+static void seekbench(struct shell_dev *shell_dev)
+{
+    struct ffbench_seek_result result;
+    FRESULT res;
+    
+    if ((res = ffbench_mount("")) != FR_OK)    {
+        shell_printk(shell_dev, "\r\nmount failed (%d)\r\n", res);
+        return ;
+    }
+    
+    if ((res = ffbench_seek(FFBENCH_SEEK_FILE, FFBENCH_SEEK_SIZE, FFBENCH_SEEK_NUM, &result)) != FR_OK)
+    {
+        shell_printk(shell_dev, "\r\nbenchmark failed (%d)\r\n", res);
+        return ;
+    }
+    
+    shell_printk(shell_dev, "\r\nrandom seek %d times in %d KB", 
+                            result.seeks, FFBENCH_SEEK_SIZE / 1024);
+    shell_printk(shell_dev, "\r\nFAT chain %d ms, %d us/seek",
+                            result.chain_ms, result.chain_ms * 1000 / result.seeks);
+    if (result.map_items)
+        shell_printk(shell_dev, "\r\nlink map  %d ms, %d us/seek, %d items\r\n",
+                                result.map_ms, result.map_ms * 1000 / result.seeks, result.map_items);
+    else
+        shell_printk(shell_dev, "\r\nlink map  not built\r\n");
+}
+SHELL_CMD_EXPORT(seekbench, random seek latency with and without the cluster link map, 1);
+
+static void dcache(struct shell_dev *shell_dev)
+{
+    struct diskio_cache_stat stat;
+    DWORD total;
+    
+    diskio_cache_stat(&stat);
+    total = stat.hit + stat.miss;
+    
+    shell_printk(shell_dev, "\r\nsectors %d, read ahead %d, bypass above %d", 
+                            DISKIO_CACHE_NUM, DISKIO_CACHE_READ_AHEAD, DISKIO_CACHE_BYPASS);
+    shell_printk(shell_dev, "\r\nhit %d, miss %d, hit rate %d%%",
+                            stat.hit, stat.miss, total ? stat.hit * 100 / total : 0);
+    shell_printk(shell_dev, "\r\nread ahead %d, write back %d, bypass %d\r\n",
+                            stat.read_ahead, stat.write_back, stat.bypass);
+}
+SHELL_CMD_EXPORT(dcache, statistics of the disk sector cache, 1);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+ * File         : ramdisk.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ * 
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-12       DongHeng        create
+ */
+
+#include "ramdisk.h"
+#include "string.h"
+
+/*@{*/
+
+/* the memory and the sectors of the ram disk */
+static BYTE *ramdisk_mem;
+static DWORD ramdisk_sectors;
+
+/*@}*/
+
+/*@{*/
+
+static DSTATUS ramdisk_status(void)
+{
+    return ramdisk_mem ? RES_OK : STA_NOINIT;
+}
+
+static DSTATUS ramdisk_init(void)
+{
+    return ramdisk_mem ? RES_OK : STA_NOINIT;
+}
+
+static DRESULT ramdisk_read(BYTE *buff, DWORD sector, UINT count)
+{
+    if (sector + count > ramdisk_sectors)
+        return RES_PARERR;
+    
+    memcpy(buff, ramdisk_mem + sector * RAMDISK_SECTOR_SIZE, count * RAMDISK_SECTOR_SIZE);
+    
+    return RES_OK;
+}
+
+static DRESULT ramdisk_write(const BYTE *buff, DWORD sector, UINT count)
+{
+    if (sector + count > ramdisk_sectors)
+        return RES_PARERR;
+    
+    memcpy(ramdisk_mem + sector * RAMDISK_SECTOR_SIZE, buff, count * RAMDISK_SECTOR_SIZE);
+    
+    return RES_OK;
+}
+
+static DRESULT ramdisk_ioctl(BYTE cmd, void *buff)
+{
+    DRESULT res = RES_OK;
+  
+    switch (cmd)
+    {
+        case CTRL_SYNC:
+                break;
+        case GET_SECTOR_COUNT:
+                *(DWORD *)buff = ramdisk_sectors;
+                break;
+        case GET_SECTOR_SIZE:
+                *(WORD *)buff = RAMDISK_SECTOR_SIZE;
+                break;
+        case GET_BLOCK_SIZE:
+                *(DWORD *)buff = 1;
+                break;
+        default:
+                res = RES_PARERR;
+                break;
+    }
+    
+    return res;
+}
+
+/**
+  * the function will register the memory as the physical drive of FatFs
+  *
+  * @param pdrv     the physical drive number
+  * @param mem      the memory of the disk, it is not initialized here
+  * @param sectors  the number of the sectors of the memory
+  * 
+  * @return the result
+  */
+err_t ramdisk_register(BYTE pdrv, BYTE *mem, DWORD sectors)
+{
+    struct diskio_port port;
+    
+    ramdisk_mem = mem;
+    ramdisk_sectors = sectors;
+    
+    port.disk_status = ramdisk_status;
+    port.disk_init   = ramdisk_init;
+    port.disk_read   = ramdisk_read;
+    port.disk_write  = ramdisk_write;
+    port.disk_ioctl  = ramdisk_ioctl;
+    
+    return diskio_port_register(pdrv, &port);
+}
+
+/*@}*/
@@ -0,0 +1,131 @@
+/*
+ * File         : syscall.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-10       DongHeng        create
+ */
+
+#include "ff.h"
+#include "time.h"
+#include "stdlib.h"
+
+#if _FS_REENTRANT
+
+/*@{*/
+
+/* every volume has its own mutex, so the volumes are accessed in parallel */
+NO_INIT static pthread_mutex_t ff_mutex[_VOLUMES];
+
+/* the mutex is initialized at the first mounting, a thread may still wait on it at the next one */
+static bool ff_mutex_ready[_VOLUMES];
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * ff_cre_syncobj - create the sync object of the volume, it is called at f_mount
+ *
+ * @param vol the logical drive number
+ * @param sobj the point of the sync object created
+ *
+ * @return 1 means success, 0 means failed
+ */
+int ff_cre_syncobj (BYTE vol, _SYNC_t *sobj)
+{
+    if (vol >= _VOLUMES)
+        return 0;
+
+    if (!ff_mutex_ready[vol])
+    {
+        pthread_mutex_init(&ff_mutex[vol], NULL);
+        ff_mutex_ready[vol] = true;
+    }
+    *sobj = &ff_mutex[vol];
+
+    return 1;
+}
+
+/**
+ * ff_del_syncobj - delete the sync object of the volume, it is called at f_mount
+ *
+ * @param sobj the sync object
+ *
+ * @return 1 means success, 0 means failed
+ */
+int ff_del_syncobj (_SYNC_t sobj)
+{
+    /* the mutex is static, nothing is to be freed */
+    return sobj ? 1 : 0;
+}
+
+/**
+ * ff_req_grant - lock the volume, the waiting is stopped after _FS_TIMEOUT
+ *                milliseconds and the calling fails with FR_TIMEOUT
+ *
+ * @param sobj the sync object
+ *
+ * @return 1 means getting the grant, 0 means timeout
+ */
+int ff_req_grant (_SYNC_t sobj)
+{
+    struct timespec abstime;
+
+    clock_gettime(CLOCK_REALTIME, &abstime);
+    abstime.tv_sec  += _FS_TIMEOUT / 1000;
+    abstime.tv_nsec += (_FS_TIMEOUT % 1000) * 1000000;
+    if (abstime.tv_nsec >= 1000000000)
+    {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= 1000000000;
+    }
+
+    return pthread_mutex_timedlock(sobj, &abstime) ? 0 : 1;
+}
+
+/**
+ * ff_rel_grant - unlock the volume
+ *
+ * @param sobj the sync object
+ */
+void ff_rel_grant (_SYNC_t sobj)
+{
+    pthread_mutex_unlock(sobj);
+}
+
+/*@}*/
+
+#endif
+
+#if _USE_LFN == 3 || (_USE_FASTSEEK && _FS_FASTSEEK_MIN) || _FS_DCACHE
+
+/*@{*/
+
+/**
+ * ff_memalloc - allocate the memory block for FatFs
+ *
+ * @param msize the bytes of the block
+ *
+ * @return the point of the block, NULL means failed
+ */
+void* ff_memalloc (UINT msize)
+{
+    return malloc(msize);
+}
+
+/**
+ * ff_memfree - free the memory block allocated by ff_memalloc
+ *
+ * @param mblock the point of the block
+ */
+void ff_memfree (void* mblock)
+{
+    free(mblock);
+}
+
+/*@}*/
+
+#endif
@@ -0,0 +1,401 @@
+/*
+ * File         : fshost.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-14       DongHeng        create
+ */
+
+/*
+ * the benchmark and the power cut test of flashfs at the Linux host, it runs
+ * flashfs.c at the NOR flash simulated:
+ *
+ *   gcc -O2 -I hwutil/fs/host -I hwutil/fs/flashfs/host -I hwutil/fs/flashfs/include
+ *       -idirafter hwutil/kernel/include
+ *       hwutil/fs/flashfs/host/fshost.c hwutil/fs/flashfs/host/norsim.c
+ *       hwutil/fs/flashfs/source/flashfs.c -lpthread -o fshost
+ *
+ *   ./fshost                   run the benchmark
+ *   ./fshost fuzz [n] [seed]   cut the power n times at random points, every
+ *                              file must be the old or the new version after
+ *                              mounted again
+ */
+
+#include "norsim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*@{*/
+
+/* the flash simulated, 1 MB of the 4 KB subsectors like the QSPI flash */
+#define FSHOST_BLOCK_SIZE       4096
+#define FSHOST_BLOCK_COUNT      256
+#define FSHOST_PROG_SIZE        16
+
+/* the sizes of the benchmarks */
+#define FSHOST_SEQ_SIZE         (512UL * 1024)
+#define FSHOST_SEQ_CHUNK        256
+#define FSHOST_SMALL_NUM        24
+#define FSHOST_SMALL_SIZE       64
+#define FSHOST_WEAR_LOOPS       200
+
+/* the files of the power cut test and their maximum size */
+#define FSHOST_FUZZ_FILES       8
+#define FSHOST_FUZZ_SIZE        (3 * FSHOST_BLOCK_SIZE)
+
+/*@}*/
+
+/*@{*/
+
+struct fshost_model
+{
+    os_u8                       data[FSHOST_FUZZ_SIZE];
+    os_u32                      size;
+    bool                        exist;
+};
+
+static struct norsim fshost_sim;
+static struct flashfs fshost_fs;
+
+/*@}*/
+
+/*@{*/
+
+static os_u64 fshost_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (os_u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static os_u32 fshost_rate(os_u64 bytes, os_u64 us)
+{
+    return us ? bytes * 1000000 / us / 1024 : 0;
+}
+
+static void fshost_fill(os_u8 *buf, os_u32 size)
+{
+    while (size--)
+        *buf++ = rand();
+}
+
+static void fshost_name(char *name, int i)
+{
+    sprintf(name, "file%d", i);
+}
+
+/* write the whole file in chunks */
+static int fshost_write(const char *name, const os_u8 *data, os_u32 size, os_u32 chunk, int flag)
+{
+    struct flashfs_file file;
+    os_u32 done, n;
+    int ret;
+
+    if ((ret = flashfs_file_open(&fshost_fs, &file, name, flag)))
+        return ret;
+
+    for (done = 0; done < size; done += n)
+    {
+        n = size - done < chunk ? size - done : chunk;
+        if ((ret = flashfs_file_write(&file, data + done, n)) != (int)n)
+        {
+            flashfs_file_close(&file);
+            return ret < 0 ? ret : -EIO;
+        }
+    }
+
+    return flashfs_file_close(&file);
+}
+
+/* read the whole file, the size read is returned */
+static int fshost_read(const char *name, os_u8 *data, os_u32 size, os_u32 chunk)
+{
+    struct flashfs_file file;
+    os_u32 done = 0;
+    int ret;
+
+    if ((ret = flashfs_file_open(&fshost_fs, &file, name, FLASHFS_O_RDONLY)))
+        return ret;
+
+    while (done < size && (ret = flashfs_file_read(&file, data + done, chunk)) > 0)
+        done += ret;
+
+    flashfs_file_close(&file);
+
+    return ret < 0 ? ret : (int)done;
+}
+
+/*@}*/
+
+/*@{*/
+
+static int fshost_bench(void)
+{
+    os_u8 *data = malloc(FSHOST_SEQ_SIZE), *back = malloc(FSHOST_SEQ_SIZE);
+    struct flashfs_info info;
+    char name[FLASHFS_NAME_MAX];
+    os_u64 prog;
+    os_u64 us;
+    os_u32 i, min, max;
+    int ret;
+
+    fshost_fill(data, FSHOST_SEQ_SIZE);
+
+    prog = fshost_sim.prog_bytes;
+    us = fshost_us();
+    if ((ret = fshost_write("seq.bin", data, FSHOST_SEQ_SIZE, FSHOST_SEQ_CHUNK,
+                            FLASHFS_O_WRONLY | FLASHFS_O_CREAT | FLASHFS_O_TRUNC)))
+        goto out;
+    us = fshost_us() - us;
+    printf("sequential %lu KB, chunk %u bytes\n", FSHOST_SEQ_SIZE / 1024, FSHOST_SEQ_CHUNK);
+    printf("write %lu us, %lu KB/s, %lu bytes programmed per 100 bytes\n", (unsigned long)us,
+           (unsigned long)fshost_rate(FSHOST_SEQ_SIZE, us),
+           (unsigned long)((fshost_sim.prog_bytes - prog) * 100 / FSHOST_SEQ_SIZE));
+
+    us = fshost_us();
+    if ((ret = fshost_read("seq.bin", back, FSHOST_SEQ_SIZE, FSHOST_SEQ_CHUNK)) != FSHOST_SEQ_SIZE)
+        goto out;
+    us = fshost_us() - us;
+    printf("read  %lu us, %lu KB/s\n", (unsigned long)us, (unsigned long)fshost_rate(FSHOST_SEQ_SIZE, us));
+    if (memcmp(data, back, FSHOST_SEQ_SIZE))
+    {
+        ret = -EILSEQ;
+        goto out;
+    }
+
+    prog = fshost_sim.prog_bytes;
+    us = fshost_us();
+    for (i = 0; i < FSHOST_SMALL_NUM; i++)
+    {
+        fshost_name(name, i);
+        if ((ret = fshost_write(name, data, FSHOST_SMALL_SIZE, FSHOST_SMALL_SIZE,
+                                FLASHFS_O_WRONLY | FLASHFS_O_CREAT)))
+            goto out;
+    }
+    us = fshost_us() - us;
+    printf("small file %u x %u bytes, %lu us, %lu bytes programmed per file\n",
+           FSHOST_SMALL_NUM, FSHOST_SMALL_SIZE, (unsigned long)us,
+           (unsigned long)((fshost_sim.prog_bytes - prog) / FSHOST_SMALL_NUM));
+
+    for (i = 0; i < FSHOST_WEAR_LOOPS; i++)
+    {
+        fshost_name(name, i % FSHOST_SMALL_NUM);
+        if ((ret = fshost_write(name, data + i, FSHOST_SMALL_SIZE, FSHOST_SMALL_SIZE,
+                                FLASHFS_O_WRONLY | FLASHFS_O_TRUNC)))
+            goto out;
+    }
+
+    if ((ret = flashfs_unmount(&fshost_fs)))
+        goto out;
+    us = fshost_us();
+    prog = fshost_sim.read_bytes;
+    if ((ret = flashfs_mount(&fshost_fs, &fshost_sim.dev)))
+        goto out;
+    printf("mount %lu us, %lu bytes read\n", (unsigned long)(fshost_us() - us),
+           (unsigned long)(fshost_sim.read_bytes - prog));
+
+    min = max = fshost_sim.erase_count[FLASHFS_META_BLOCKS];
+    for (i = FLASHFS_META_BLOCKS; i < FSHOST_BLOCK_COUNT; i++)
+    {
+        if (fshost_sim.erase_count[i] < min)
+            min = fshost_sim.erase_count[i];
+        if (fshost_sim.erase_count[i] > max)
+            max = fshost_sim.erase_count[i];
+    }
+    flashfs_info(&fshost_fs, &info);
+    printf("erase %lu times, data blocks %lu - %lu, metadata blocks %lu %lu, %lu of %lu blocks free\n",
+           (unsigned long)fshost_sim.erases, (unsigned long)min, (unsigned long)max,
+           (unsigned long)fshost_sim.erase_count[0], (unsigned long)fshost_sim.erase_count[1],
+           (unsigned long)info.block_free, (unsigned long)info.block_count);
+
+    ret = 0;
+
+out:
+    free(data);
+    free(back);
+
+    return ret;
+}
+
+/* check every file is the version of the model, or the version pending */
+static int fshost_verify(struct fshost_model *model, int pending, struct fshost_model *next)
+{
+    static os_u8 back[FSHOST_FUZZ_SIZE];
+    struct flashfs_stat st;
+    char name[FLASHFS_NAME_MAX];
+    int i, ret, files = 0, iter = 0;
+
+    for (i = 0; i < FSHOST_FUZZ_FILES; i++)
+    {
+        fshost_name(name, i);
+        ret = fshost_read(name, back, FSHOST_FUZZ_SIZE, FSHOST_BLOCK_SIZE);
+
+        if (model[i].exist && ret == (int)model[i].size && !memcmp(back, model[i].data, ret))
+            ;
+        else if (!model[i].exist && ret == -ENOENT)
+            ;
+        else if (i == pending && next->exist && ret == (int)next->size && !memcmp(back, next->data, ret))
+            memcpy(&model[i], next, sizeof(struct fshost_model));
+        else if (i == pending && !next->exist && ret == -ENOENT)
+            memcpy(&model[i], next, sizeof(struct fshost_model));
+        else
+        {
+            printf("%s is broken (%d), expected %d bytes\n", name, ret, model[i].exist ? (int)model[i].size : -1);
+            return -EILSEQ;
+        }
+
+        if (model[i].exist)
+            files++;
+    }
+
+    while (flashfs_readdir(&fshost_fs, &iter, &st) > 0)
+        files--;
+
+    return files ? -EILSEQ : 0;
+}
+
+/* one random operation at one file, the model is updated when it is committed */
+static int fshost_operate(struct fshost_model *model, int *pending, struct fshost_model *next)
+{
+    struct flashfs_file file;
+    char name[FLASHFS_NAME_MAX];
+    os_u32 off, size;
+    int i = rand() % FSHOST_FUZZ_FILES, ret;
+
+    fshost_name(name, i);
+
+    /* the model of the file after the operation */
+    *pending = i;
+    next->exist = true;
+    next->size = model[i].exist ? model[i].size : 0;
+    if (model[i].exist)
+        memcpy(next->data, model[i].data, model[i].size);
+
+    switch (rand() % 4)
+    {
+        case 0:
+                size = rand() % FSHOST_FUZZ_SIZE;
+                fshost_fill(next->data, size);
+                next->size = size;
+                ret = fshost_write(name, next->data, size, 1 + rand() % FSHOST_BLOCK_SIZE,
+                                   FLASHFS_O_WRONLY | FLASHFS_O_CREAT | FLASHFS_O_TRUNC);
+                break;
+        case 1:
+                size = rand() % (FSHOST_FUZZ_SIZE - next->size + 1);
+                fshost_fill(next->data + next->size, size);
+                ret = fshost_write(name, next->data + next->size, size, 1 + rand() % FSHOST_BLOCK_SIZE,
+                                   FLASHFS_O_WRONLY | FLASHFS_O_CREAT | FLASHFS_O_APPEND);
+                next->size += size;
+                break;
+        case 2:
+                if (!model[i].exist || !model[i].size)
+                    return 0;
+                off = rand() % model[i].size;
+                size = rand() % (FSHOST_FUZZ_SIZE - off);
+                fshost_fill(next->data + off, size);
+                if (off + size > next->size)
+                    next->size = off + size;
+                if ((ret = flashfs_file_open(&fshost_fs, &file, name, FLASHFS_O_RDWR)))
+                    break;
+                if (flashfs_file_seek(&file, off, FLASHFS_SEEK_SET) != (os_s32)off ||
+                    flashfs_file_write(&file, next->data + off, size) != (int)size)
+                    ret = -EIO;
+                if (flashfs_file_close(&file))
+                    ret = -EIO;
+                break;
+        default:
+                next->exist = false;
+                next->size = 0;
+                ret = flashfs_unlink(&fshost_fs, name);
+                if (!model[i].exist && ret == -ENOENT)
+                    ret = 0;
+                break;
+    }
+
+    if (!ret)
+        memcpy(&model[i], next, sizeof(struct fshost_model));
+
+    return ret;
+}
+
+static int fshost_fuzz(int loops)
+{
+    static struct fshost_model model[FSHOST_FUZZ_FILES], next;
+    os_u32 ops = 0;
+    int loop, pending, ret;
+
+    for (loop = 0; loop < loops; loop++)
+    {
+        norsim_cut(&fshost_sim, 1 + rand() % 400);
+
+        while (!(ret = fshost_operate(model, &pending, &next)))
+            ops++;
+
+        if (!fshost_sim.dead)
+        {
+            printf("loop %d: operation failed (%d) without power cut\n", loop, ret);
+            return ret;
+        }
+
+        /* power on again */
+        flashfs_unmount(&fshost_fs);
+        norsim_revive(&fshost_sim);
+
+        if ((ret = flashfs_mount(&fshost_fs, &fshost_sim.dev)))
+        {
+            printf("loop %d: mount failed (%d)\n", loop, ret);
+            return ret;
+        }
+
+        if ((ret = fshost_verify(model, pending, &next)))
+        {
+            printf("loop %d: verify failed after %lu operations\n", loop, (unsigned long)ops);
+            return ret;
+        }
+    }
+
+    printf("%d power cuts, %lu operations, %lu erases, %lu bytes programmed twice\n",
+           loops, (unsigned long)ops, (unsigned long)fshost_sim.erases,
+           (unsigned long)fshost_sim.overwrite);
+
+    return fshost_sim.overwrite ? -EILSEQ : 0;
+}
+
+/*@}*/
+
+int main(int argc, char *argv[])
+{
+    int ret;
+
+    if (argc > 2 && !strcmp(argv[1], "fuzz"))
+        srand(argc > 3 ? atoi(argv[3]) : time(NULL));
+
+    if ((ret = norsim_init(&fshost_sim, FSHOST_BLOCK_SIZE, FSHOST_BLOCK_COUNT, FSHOST_PROG_SIZE)))
+        return 1;
+
+    if ((ret = flashfs_format(&fshost_sim.dev)) || (ret = flashfs_mount(&fshost_fs, &fshost_sim.dev)))
+    {
+        fprintf(stderr, "format failed (%d)\n", ret);
+        return 1;
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "fuzz"))
+        ret = fshost_fuzz(argc > 2 ? atoi(argv[2]) : 1000);
+    else
+        ret = fshost_bench();
+
+    if (ret)
+        fprintf(stderr, "failed (%d)\n", ret);
+
+    flashfs_unmount(&fshost_fs);
+    norsim_free(&fshost_sim);
+
+    return ret ? 1 : 0;
+}
@@ -0,0 +1,189 @@
+/*
+ * File         : norsim.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-14       DongHeng        create
+ */
+
+#include "norsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*@{*/
+
+static int norsim_read(const struct flashfs_dev *dev, os_u32 block, os_u32 off, void *buf, os_u32 size)
+{
+    struct norsim *sim = dev->priv;
+
+    if (block >= dev->block_count || off + size > dev->block_size)
+        return -EINVAL;
+
+    memcpy(buf, sim->mem + block * dev->block_size + off, size);
+    sim->read_bytes += size;
+
+    return 0;
+}
+
+enum norsim_power
+{
+    NORSIM_ON,
+    NORSIM_CUT,
+    NORSIM_OFF
+};
+
+/*
+ * count the operation down to the power cut, the operation cut is torn, only
+ * the bytes before a random point are done
+ */
+static enum norsim_power norsim_power(struct norsim *sim, os_u32 size, os_u32 *done)
+{
+    *done = 0;
+
+    if (sim->dead)
+        return NORSIM_OFF;
+
+    if (!sim->cut || --sim->cut)
+    {
+        *done = size;
+        return NORSIM_ON;
+    }
+
+    sim->dead = true;
+    *done = rand() % (size + 1);
+
+    return NORSIM_CUT;
+}
+
+static int norsim_prog(const struct flashfs_dev *dev, os_u32 block, os_u32 off, const void *buf, os_u32 size)
+{
+    struct norsim *sim = dev->priv;
+    const os_u8 *src = buf;
+    enum norsim_power power;
+    os_u8 *dst;
+    os_u32 i, n;
+
+    if (block >= dev->block_count || off + size > dev->block_size || off % dev->prog_size)
+        return -EINVAL;
+
+    power = norsim_power(sim, size, &n);
+
+    dst = sim->mem + block * dev->block_size + off;
+    for (i = 0; i < n; i++)
+    {
+        if ((dst[i] & src[i]) != src[i])
+            sim->overwrite++;
+        dst[i] &= src[i];
+    }
+
+    if (power == NORSIM_ON)
+    {
+        sim->prog_bytes += size;
+        return 0;
+    }
+
+    /* the byte at the point cut gets random bits */
+    if (power == NORSIM_CUT && n < size)
+        dst[n] &= src[n] | (os_u8)rand();
+
+    return -EIO;
+}
+
+static int norsim_erase(const struct flashfs_dev *dev, os_u32 block)
+{
+    struct norsim *sim = dev->priv;
+    os_u32 n;
+
+    if (block >= dev->block_count)
+        return -EINVAL;
+
+    /* the erasing cut leaves the block half erased */
+    if (norsim_power(sim, dev->block_size, &n) != NORSIM_ON)
+    {
+        memset(sim->mem + block * dev->block_size, 0xFF, n);
+        return -EIO;
+    }
+
+    memset(sim->mem + block * dev->block_size, 0xFF, dev->block_size);
+    sim->erase_count[block]++;
+    sim->erases++;
+
+    return 0;
+}
+
+static int norsim_sync(const struct flashfs_dev *dev)
+{
+    struct norsim *sim = dev->priv;
+
+    return sim->dead ? -EIO : 0;
+}
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * norsim_init - create the flash simulated, it is erased
+ *
+ * @param sim the flash simulated
+ * @param block_size the bytes of the erasing unit
+ * @param block_count the number of the blocks
+ * @param prog_size the bytes of the programming unit
+ *
+ * @return the result
+ */
+int norsim_init(struct norsim *sim, os_u32 block_size, os_u32 block_count, os_u32 prog_size)
+{
+    memset(sim, 0, sizeof(struct norsim));
+
+    sim->mem = malloc((size_t)block_size * block_count);
+    sim->erase_count = calloc(block_count, sizeof(os_u32));
+    if (!sim->mem || !sim->erase_count)
+    {
+        norsim_free(sim);
+        return -ENOMEM;
+    }
+    memset(sim->mem, 0xFF, (size_t)block_size * block_count);
+
+    sim->dev.block_size = block_size;
+    sim->dev.block_count = block_count;
+    sim->dev.prog_size = prog_size;
+    sim->dev.read = norsim_read;
+    sim->dev.prog = norsim_prog;
+    sim->dev.erase = norsim_erase;
+    sim->dev.sync = norsim_sync;
+    sim->dev.priv = sim;
+
+    return 0;
+}
+
+void norsim_free(struct norsim *sim)
+{
+    free(sim->mem);
+    free(sim->erase_count);
+    sim->mem = NULL;
+    sim->erase_count = NULL;
+}
+
+/**
+ * norsim_cut - cut the power at the programming or the erasing of the number
+ *
+ * @param sim the flash simulated
+ * @param ops the number of the operations, 0 means never
+ */
+void norsim_cut(struct norsim *sim, os_u32 ops)
+{
+    sim->cut = ops;
+}
+
+/* power on again, the flash keeps what it has */
+void norsim_revive(struct norsim *sim)
+{
+    sim->cut = 0;
+    sim->dead = false;
+}
+
+/*@}*/
@@ -0,0 +1,31 @@
+#ifndef _NORSIM_H_
+#define _NORSIM_H_
+
+#include "flashfs.h"
+
+/* the NOR flash simulated at the RAM, the power cut is injected at any operation */
+struct norsim
+{
+    struct flashfs_dev          dev;
+
+    os_u8                       *mem;
+    os_u32                      *erase_count;
+
+    /* the programming and the erasing left before the power cut, 0 means never */
+    os_u32                      cut;
+    bool                        dead;
+
+    /* the bytes programmed with the bits from 0 to 1, it is the bug of the user */
+    os_u32                      overwrite;
+
+    os_u64                      read_bytes;
+    os_u64                      prog_bytes;
+    os_u32                      erases;
+};
+
+int norsim_init(struct norsim *sim, os_u32 block_size, os_u32 block_count, os_u32 prog_size);
+void norsim_free(struct norsim *sim);
+void norsim_cut(struct norsim *sim, os_u32 ops);
+void norsim_revive(struct norsim *sim);
+
+#endif
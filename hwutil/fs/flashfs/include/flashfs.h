@@ -0,0 +1,181 @@
+#ifndef _FLASHFS_H_
+#define _FLASHFS_H_
+
+#include "rtos.h"
+#include "pthread.h"
+
+/*
+ * flashfs is a small log-structured filesystem for the NOR flash, the data
+ * blocks are written copy-on-write and the file table is committed as a log
+ * at the metadata pair, so a power cut at any time leaves the last committed
+ * state of every file
+ */
+
+/* the maximum number of the files */
+#ifndef FLASHFS_FILE_MAX
+    #define FLASHFS_FILE_MAX    32
+#endif
+
+/* the maximum length of the file name, including the end of the string */
+#define FLASHFS_NAME_MAX        16
+
+/* the maximum number of the blocks written and not committed */
+#ifndef FLASHFS_DIRTY_MAX
+    #define FLASHFS_DIRTY_MAX   32
+#endif
+
+/* the minimum block size, the file table must fit one metadata block */
+#define FLASHFS_BLOCK_MIN       1024
+
+/* the blocks of the metadata pair */
+#define FLASHFS_META_BLOCKS     2
+
+/* the block referenced nowhere */
+#define FLASHFS_BLOCK_NONE      0xFFFFFFFF
+
+#define FLASHFS_O_RDONLY        (1 << 0)
+#define FLASHFS_O_WRONLY        (1 << 1)
+#define FLASHFS_O_RDWR          (FLASHFS_O_RDONLY | FLASHFS_O_WRONLY)
+#define FLASHFS_O_CREAT         (1 << 2)
+#define FLASHFS_O_TRUNC         (1 << 3)
+#define FLASHFS_O_APPEND        (1 << 4)
+
+#define FLASHFS_SEEK_SET        0
+#define FLASHFS_SEEK_CUR        1
+#define FLASHFS_SEEK_END        2
+
+/* the command of the file handle opened by flashfs_open */
+#define FLASHFS_CTRL_SYNC       0
+
+/******************************************************************************/
+
+/* the flash device, all the functions return 0 or the negative error code */
+struct flashfs_dev
+{
+    /* the bytes of one erasing unit */
+    os_u32                      block_size;
+    os_u32                      block_count;
+
+    /* the bytes of the minimum programming unit */
+    os_u32                      prog_size;
+
+    int     (*read)             (const struct flashfs_dev *dev, os_u32 block, os_u32 off, void *buf, os_u32 size);
+    int     (*prog)             (const struct flashfs_dev *dev, os_u32 block, os_u32 off, const void *buf, os_u32 size);
+    int     (*erase)            (const struct flashfs_dev *dev, os_u32 block);
+    int     (*sync)             (const struct flashfs_dev *dev);
+
+    void                        *priv;
+};
+
+/* the file at the RAM */
+struct flashfs_node
+{
+    char                        name[FLASHFS_NAME_MAX];
+
+    /* the committed state */
+    os_u32                      size;
+    os_u32                      index;
+
+    /* the working state, it is committed at the syncing */
+    os_u32                      wsize;
+    os_u32                      windex;
+
+    os_u8                       used;
+    os_u8                       dirty;
+    os_u8                       trunc;
+    os_u8                       open;
+};
+
+/* the block written and not committed */
+struct flashfs_dirty
+{
+    os_u8                       id;
+    os_u32                      lblock;
+    os_u32                      phys;
+};
+
+struct flashfs
+{
+    const struct flashfs_dev    *dev;
+
+    pthread_mutex_t             mutex;
+
+    /* the metadata block active, its revision and the offset of the next commit */
+    os_u32                      meta;
+    os_u32                      rev;
+    os_u32                      meta_off;
+
+    /* the next block to be allocated, it rotates for the wear leveling */
+    os_u32                      cursor;
+    os_u32                      free;
+
+    /* the blocks used, and the blocks freed after the next commit */
+    os_u32                      *used;
+    os_u32                      *release;
+    os_u32                      release_num;
+
+    struct flashfs_node         node[FLASHFS_FILE_MAX];
+
+    struct flashfs_dirty        dirty[FLASHFS_DIRTY_MAX];
+    os_u32                      dirty_num;
+
+    /* the write cache holding one data block of one file */
+    os_u8                       *cache;
+    os_s32                      cache_id;
+    os_u32                      cache_lblock;
+    bool                        cache_dirty;
+
+    /* the buffer building the index blocks and the commits */
+    os_u8                       *work;
+
+    bool                        need_compact;
+    bool                        broken;
+};
+
+struct flashfs_file
+{
+    struct flashfs              *fs;
+
+    os_u8                       id;
+    os_u8                       flag;
+    os_u32                      pos;
+};
+
+struct flashfs_stat
+{
+    char                        name[FLASHFS_NAME_MAX];
+    os_u32                      size;
+};
+
+struct flashfs_info
+{
+    os_u32                      block_size;
+    os_u32                      block_count;
+    os_u32                      block_free;
+    os_u32                      files;
+    os_u32                      rev;
+};
+
+/******************************************************************************/
+
+int flashfs_format (const struct flashfs_dev *dev);
+int flashfs_mount (struct flashfs *fs, const struct flashfs_dev *dev);
+int flashfs_unmount (struct flashfs *fs);
+int flashfs_sync (struct flashfs *fs);
+int flashfs_unlink (struct flashfs *fs, const char *name);
+int flashfs_stat (struct flashfs *fs, const char *name, struct flashfs_stat *st);
+int flashfs_readdir (struct flashfs *fs, int *iter, struct flashfs_stat *st);
+int flashfs_info (struct flashfs *fs, struct flashfs_info *info);
+
+int flashfs_file_open (struct flashfs *fs, struct flashfs_file *file, const char *name, int flag);
+int flashfs_file_read (struct flashfs_file *file, void *buf, os_u32 size);
+int flashfs_file_write (struct flashfs_file *file, const void *buf, os_u32 size);
+os_s32 flashfs_file_seek (struct flashfs_file *file, os_s32 off, int from);
+int flashfs_file_sync (struct flashfs_file *file);
+int flashfs_file_close (struct flashfs_file *file);
+
+#if !FLASHFS_HOST
+int flashfs_open (struct flashfs *fs, const char *name, int oflag);
+#endif
+
+#endif
@@ -0,0 +1,1369 @@
+/*
+ * File         : flashfs.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-14       DongHeng        create
+ */
+
+/*
+ * the layout of the flash:
+ *
+ *   block 0, 1     the metadata pair, the active one has the higher revision,
+ *                  it is the header and the commits appended one by one, the
+ *                  first commit is the snapshot of the whole file table
+ *   block 2 ...    the index blocks and the data blocks, one index block of
+ *                  every file is the array of its data blocks
+ *
+ * the data blocks and the index blocks are never rewritten after committed,
+ * the new versions are written to the free blocks and the commit switches the
+ * file table to them, so the commit is the only point of the atomic updating,
+ * and a commit torn by the power cut is dropped by its CRC at mounting
+ */
+
+#include "flashfs.h"
+#include "string.h"
+#include "stdlib.h"
+
+/*@{*/
+
+#define FLASHFS_MAGIC           0x53464c46
+
+#define FLASHFS_REC_FILE        1
+#define FLASHFS_REC_DELETE      2
+
+/* the blocks kept for the commit, one index block of every file and the cache */
+#define FLASHFS_RESERVE         (FLASHFS_FILE_MAX + 1)
+
+#define FLASHFS_ALIGN(dev, x)   (((x) + (dev)->prog_size - 1) / (dev)->prog_size * (dev)->prog_size)
+
+/* the header at the beginning of the metadata block */
+struct flashfs_header
+{
+    os_u32                      magic;
+    os_u32                      rev;
+    os_u32                      block_size;
+    os_u32                      block_count;
+    os_u32                      crc;
+};
+
+/* the head of one commit, the records and the CRC of them follow it */
+struct flashfs_commit
+{
+    os_u16                      len;
+    os_u16                      count;
+    os_u32                      cursor;
+};
+
+struct flashfs_record
+{
+    os_u8                       type;
+    os_u8                       id;
+    os_u16                      reserved;
+    os_u32                      size;
+    os_u32                      index;
+    char                        name[FLASHFS_NAME_MAX];
+};
+
+/*@}*/
+
+/*@{*/
+
+static os_u32 flashfs_crc32(os_u32 crc, const void *buf, os_u32 size)
+{
+    const os_u8 *p = buf;
+    int i;
+
+    crc = ~crc;
+    while (size--)
+    {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+
+    return ~crc;
+}
+
+INLINE bool flashfs_bit_test(const os_u32 *map, os_u32 bit)
+{
+    return (map[bit >> 5] & (1UL << (bit & 31))) ? true : false;
+}
+
+INLINE void flashfs_bit_set(os_u32 *map, os_u32 bit)
+{
+    map[bit >> 5] |= 1UL << (bit & 31);
+}
+
+INLINE void flashfs_bit_clr(os_u32 *map, os_u32 bit)
+{
+    map[bit >> 5] &= ~(1UL << (bit & 31));
+}
+
+INLINE os_u32 flashfs_map_words(const struct flashfs_dev *dev)
+{
+    return (dev->block_count + 31) / 32;
+}
+
+/*
+ * the programming failure leaves the state at the RAM different from the
+ * flash, so the filesystem refuses to work until it is mounted again
+ */
+static int flashfs_prog(struct flashfs *fs, os_u32 block, os_u32 off, const void *buf, os_u32 size)
+{
+    int err = fs->dev->prog(fs->dev, block, off, buf, size);
+
+    if (err)
+        fs->broken = true;
+
+    return err;
+}
+
+static int flashfs_erase(struct flashfs *fs, os_u32 block)
+{
+    int err = fs->dev->erase(fs->dev, block);
+
+    if (err)
+        fs->broken = true;
+
+    return err;
+}
+
+static int flashfs_dev_sync(struct flashfs *fs)
+{
+    int err = fs->dev->sync ? fs->dev->sync(fs->dev) : 0;
+
+    if (err)
+        fs->broken = true;
+
+    return err;
+}
+
+/*@}*/
+
+/*@{*/
+
+/*
+ * flashfs_block_alloc - allocate and erase one free block, the searching
+ *                       starts at the block next to the last one allocated,
+ *                       so the erasing is spread over the whole flash
+ */
+static int flashfs_block_alloc(struct flashfs *fs, os_u32 *block)
+{
+    const struct flashfs_dev *dev = fs->dev;
+    os_u32 i, b;
+    int err;
+
+    for (i = 0; i < dev->block_count; i++)
+    {
+        b = fs->cursor;
+        if (++fs->cursor >= dev->block_count)
+            fs->cursor = FLASHFS_META_BLOCKS;
+
+        if (b < FLASHFS_META_BLOCKS || flashfs_bit_test(fs->used, b))
+            continue;
+
+        if ((err = flashfs_erase(fs, b)))
+            return err;
+
+        flashfs_bit_set(fs->used, b);
+        fs->free--;
+        *block = b;
+
+        return 0;
+    }
+
+    return -ENOSPC;
+}
+
+/* the block committed is freed after the next commit */
+static void flashfs_block_release(struct flashfs *fs, os_u32 block)
+{
+    if (block >= fs->dev->block_count || flashfs_bit_test(fs->release, block))
+        return;
+
+    flashfs_bit_set(fs->release, block);
+    fs->release_num++;
+}
+
+/* the block not committed is freed at once */
+static void flashfs_block_free(struct flashfs *fs, os_u32 block)
+{
+    flashfs_bit_clr(fs->used, block);
+    fs->free++;
+}
+
+static struct flashfs_dirty *flashfs_dirty_find(struct flashfs *fs, os_u8 id, os_u32 lblock)
+{
+    os_u32 i;
+
+    for (i = 0; i < fs->dirty_num; i++)
+        if (fs->dirty[i].id == id && fs->dirty[i].lblock == lblock)
+            return &fs->dirty[i];
+
+    return NULL;
+}
+
+/* drop the blocks written and not committed of the file */
+static void flashfs_dirty_drop(struct flashfs *fs, os_u8 id)
+{
+    os_u32 i = 0;
+
+    while (i < fs->dirty_num)
+    {
+        if (fs->dirty[i].id == id)
+        {
+            flashfs_block_free(fs, fs->dirty[i].phys);
+            fs->dirty[i] = fs->dirty[--fs->dirty_num];
+        }
+        else
+            i++;
+    }
+
+    if (fs->cache_id == id)
+    {
+        fs->cache_id = -1;
+        fs->cache_dirty = false;
+    }
+}
+
+/* get the physical block of the block of the file */
+static int flashfs_block_lookup(struct flashfs *fs, os_u8 id, os_u32 lblock, os_u32 *phys)
+{
+    struct flashfs_node *node = &fs->node[id];
+    struct flashfs_dirty *dirty;
+
+    if ((dirty = flashfs_dirty_find(fs, id, lblock)))
+    {
+        *phys = dirty->phys;
+        return 0;
+    }
+
+    if (node->trunc || node->index == FLASHFS_BLOCK_NONE)
+    {
+        *phys = FLASHFS_BLOCK_NONE;
+        return 0;
+    }
+
+    return fs->dev->read(fs->dev, node->index, lblock * sizeof(os_u32), phys, sizeof(os_u32));
+}
+
+/* read the part of the block of the file, the hole is read as zero */
+static int flashfs_block_read(struct flashfs *fs, os_u8 id, os_u32 lblock, os_u32 off, void *buf, os_u32 size)
+{
+    os_u32 phys;
+    int err;
+
+    if (fs->cache_id == id && fs->cache_lblock == lblock)
+    {
+        memcpy(buf, fs->cache + off, size);
+        return 0;
+    }
+
+    if ((err = flashfs_block_lookup(fs, id, lblock, &phys)))
+        return err;
+
+    if (phys == FLASHFS_BLOCK_NONE)
+    {
+        memset(buf, 0, size);
+        return 0;
+    }
+
+    return fs->dev->read(fs->dev, phys, off, buf, size);
+}
+
+/* write the cache to the flash, the block not committed is rewritten in place */
+static int flashfs_cache_prog(struct flashfs *fs, os_u32 *phys)
+{
+    struct flashfs_dirty *dirty;
+    int err;
+
+    if ((dirty = flashfs_dirty_find(fs, fs->cache_id, fs->cache_lblock)))
+        *phys = dirty->phys;
+    else if ((err = flashfs_block_alloc(fs, phys)))
+        return err;
+
+    if (dirty && (err = flashfs_erase(fs, *phys)))
+        return err;
+
+    return flashfs_prog(fs, *phys, 0, fs->cache, fs->dev->block_size);
+}
+
+/*@}*/
+
+/*@{*/
+
+/*
+ * flashfs_commit_build - build the commit of the files changed, or the
+ *                        snapshot of all the files
+ *
+ * @param fs the filesystem
+ * @param buf the buffer of the commit
+ * @param snapshot true means the snapshot
+ *
+ * @return the bytes of the commit, it is padded to the programming unit
+ */
+static os_u32 flashfs_commit_build(struct flashfs *fs, os_u8 *buf, bool snapshot)
+{
+    struct flashfs_commit *commit = (struct flashfs_commit *)buf;
+    struct flashfs_record *record = (struct flashfs_record *)(commit + 1);
+    struct flashfs_node *node;
+    os_u32 crc, len;
+    int i;
+
+    commit->count = 0;
+    commit->cursor = fs->cursor;
+
+    for (i = 0; i < FLASHFS_FILE_MAX; i++)
+    {
+        node = &fs->node[i];
+
+        if (!(snapshot ? node->used : node->dirty))
+            continue;
+
+        memset(record, 0, sizeof(struct flashfs_record));
+        record->id = i;
+
+        if (node->used)
+        {
+            record->type = FLASHFS_REC_FILE;
+            record->size = node->dirty ? node->wsize : node->size;
+            record->index = node->dirty ? node->windex : node->index;
+            memcpy(record->name, node->name, FLASHFS_NAME_MAX);
+        }
+        else
+            record->type = FLASHFS_REC_DELETE;
+
+        record++;
+        commit->count++;
+    }
+
+    len = (os_u8 *)record - buf;
+    commit->len = len + sizeof(os_u32);
+
+    crc = flashfs_crc32(0, buf, len);
+    memcpy(buf + len, &crc, sizeof(os_u32));
+    len += sizeof(os_u32);
+
+    memset(buf + len, 0xFF, FLASHFS_ALIGN(fs->dev, len) - len);
+
+    return FLASHFS_ALIGN(fs->dev, len);
+}
+
+/*
+ * flashfs_commit_load - load the commit and apply its records to the file table
+ *
+ * @return the bytes of the commit, -ENOENT means no commit here, and -EILSEQ
+ *         means the commit is broken
+ */
+static int flashfs_commit_load(struct flashfs *fs, os_u32 block, os_u32 off)
+{
+    const struct flashfs_dev *dev = fs->dev;
+    struct flashfs_commit *commit = (struct flashfs_commit *)fs->work;
+    struct flashfs_record *record;
+    struct flashfs_node *node;
+    os_u32 crc;
+    int i, err;
+
+    if (off + sizeof(struct flashfs_commit) > dev->block_size)
+        return -ENOENT;
+
+    if ((err = dev->read(dev, block, off, commit, sizeof(struct flashfs_commit))))
+        return err;
+
+    if (commit->len == 0xFFFF && commit->count == 0xFFFF && commit->cursor == 0xFFFFFFFF)
+        return -ENOENT;
+
+    if (commit->count > FLASHFS_FILE_MAX ||
+        commit->len != sizeof(struct flashfs_commit) + commit->count * sizeof(struct flashfs_record) + sizeof(os_u32) ||
+        off + commit->len > dev->block_size ||
+        commit->cursor < FLASHFS_META_BLOCKS || commit->cursor >= dev->block_count)
+        return -EILSEQ;
+
+    if ((err = dev->read(dev, block, off, fs->work, commit->len)))
+        return err;
+
+    memcpy(&crc, fs->work + commit->len - sizeof(os_u32), sizeof(os_u32));
+    if (crc != flashfs_crc32(0, fs->work, commit->len - sizeof(os_u32)))
+        return -EILSEQ;
+
+    record = (struct flashfs_record *)(commit + 1);
+    for (i = 0; i < commit->count; i++, record++)
+    {
+        if (record->id >= FLASHFS_FILE_MAX)
+            return -EILSEQ;
+
+        node = &fs->node[record->id];
+        memset(node, 0, sizeof(struct flashfs_node));
+
+        if (record->type == FLASHFS_REC_FILE)
+        {
+            memcpy(node->name, record->name, FLASHFS_NAME_MAX);
+            node->name[FLASHFS_NAME_MAX - 1] = '\0';
+            node->size = node->wsize = record->size;
+            node->index = node->windex = record->index;
+            node->used = 1;
+        }
+    }
+
+    fs->cursor = commit->cursor;
+
+    return FLASHFS_ALIGN(dev, commit->len);
+}
+
+/* check the header of the metadata block and its first commit */
+static int flashfs_meta_check(struct flashfs *fs, os_u32 block, os_u32 *rev)
+{
+    const struct flashfs_dev *dev = fs->dev;
+    struct flashfs_header header;
+    int ret;
+
+    if ((ret = dev->read(dev, block, 0, &header, sizeof(header))))
+        return ret;
+
+    if (header.magic != FLASHFS_MAGIC ||
+        header.crc != flashfs_crc32(0, &header, sizeof(header) - sizeof(os_u32)) ||
+        header.block_size != dev->block_size ||
+        header.block_count != dev->block_count)
+        return -ENODEV;
+
+    memset(fs->node, 0, sizeof(fs->node));
+    if ((ret = flashfs_commit_load(fs, block, FLASHFS_ALIGN(dev, sizeof(header)))) < 0)
+        return -ENODEV;
+
+    *rev = header.rev;
+
+    return 0;
+}
+
+/*
+ * flashfs_meta_write - write the commit to the active metadata block, or
+ *                      write the snapshot to the other one when the active
+ *                      one is full
+ */
+static int flashfs_meta_write(struct flashfs *fs)
+{
+    const struct flashfs_dev *dev = fs->dev;
+    struct flashfs_header *header = (struct flashfs_header *)fs->work;
+    os_u32 hsize = FLASHFS_ALIGN(dev, sizeof(struct flashfs_header));
+    os_u32 len, meta;
+    int err;
+
+    if (!fs->need_compact)
+    {
+        len = flashfs_commit_build(fs, fs->work, false);
+        if (fs->meta_off + len <= dev->block_size)
+        {
+            if ((err = flashfs_prog(fs, fs->meta, fs->meta_off, fs->work, len)))
+                return err;
+
+            fs->meta_off += len;
+
+            return flashfs_dev_sync(fs);
+        }
+    }
+
+    meta = fs->meta ^ 1;
+
+    header->magic = FLASHFS_MAGIC;
+    header->rev = fs->rev + 1;
+    header->block_size = dev->block_size;
+    header->block_count = dev->block_count;
+    header->crc = flashfs_crc32(0, header, sizeof(struct flashfs_header) - sizeof(os_u32));
+    memset(fs->work + sizeof(struct flashfs_header), 0xFF, hsize - sizeof(struct flashfs_header));
+
+    len = hsize + flashfs_commit_build(fs, fs->work + hsize, true);
+
+    if ((err = flashfs_erase(fs, meta)))
+        return err;
+    if ((err = flashfs_prog(fs, meta, 0, fs->work, len)))
+        return err;
+    if ((err = flashfs_dev_sync(fs)))
+        return err;
+
+    fs->meta = meta;
+    fs->rev++;
+    fs->meta_off = len;
+    fs->need_compact = false;
+
+    return 0;
+}
+
+/*
+ * flashfs_index_build - write the new index block of the file changed
+ *
+ * @param fs the filesystem
+ * @param id the file
+ * @param extra the block of the cache written at this commit, or NULL
+ */
+static int flashfs_index_build(struct flashfs *fs, os_u8 id, const struct flashfs_dirty *extra)
+{
+    const struct flashfs_dev *dev = fs->dev;
+    struct flashfs_node *node = &fs->node[id];
+    os_u32 *index = (os_u32 *)fs->work;
+    os_u32 entries = dev->block_size / sizeof(os_u32);
+    os_u32 i, block;
+    bool changed = node->trunc;
+    int err;
+
+    for (i = 0; i < fs->dirty_num; i++)
+        if (fs->dirty[i].id == id)
+            changed = true;
+    if (extra && extra->id == id)
+        changed = true;
+
+    node->windex = node->index;
+    if (!changed)
+        return 0;
+
+    if (node->index != FLASHFS_BLOCK_NONE)
+    {
+        if ((err = dev->read(dev, node->index, 0, index, dev->block_size)))
+            return err;
+
+        flashfs_block_release(fs, node->index);
+    }
+    else
+        memset(index, 0xFF, dev->block_size);
+
+    if (node->trunc)
+    {
+        for (i = 0; i < entries; i++)
+            flashfs_block_release(fs, index[i]);
+        memset(index, 0xFF, dev->block_size);
+    }
+
+    for (i = 0; i <= fs->dirty_num; i++)
+    {
+        const struct flashfs_dirty *dirty = i < fs->dirty_num ? &fs->dirty[i] : extra;
+
+        if (!dirty || dirty->id != id)
+            continue;
+
+        if (index[dirty->lblock] != dirty->phys)
+            flashfs_block_release(fs, index[dirty->lblock]);
+        index[dirty->lblock] = dirty->phys;
+    }
+
+    node->windex = FLASHFS_BLOCK_NONE;
+    if (!node->wsize)
+    {
+        for (i = 0; i < entries; i++)
+            flashfs_block_release(fs, index[i]);
+        return 0;
+    }
+
+    if ((err = flashfs_block_alloc(fs, &block)))
+        return err;
+    if ((err = flashfs_prog(fs, block, 0, index, dev->block_size)))
+        return err;
+
+    node->windex = block;
+
+    return 0;
+}
+
+/*
+ * flashfs_commit - commit all the files changed, the data blocks and the index
+ *                  blocks reach the flash before the commit does
+ */
+static int flashfs_commit(struct flashfs *fs)
+{
+    struct flashfs_node *node;
+    struct flashfs_dirty extra, *pextra = NULL;
+    os_u32 i, words;
+    int err;
+
+    if (fs->broken)
+        return -EIO;
+
+    if (fs->cache_dirty)
+    {
+        extra.id = fs->cache_id;
+        extra.lblock = fs->cache_lblock;
+        if ((err = flashfs_cache_prog(fs, &extra.phys)))
+            goto failed;
+
+        if (!flashfs_dirty_find(fs, extra.id, extra.lblock))
+            pextra = &extra;
+        fs->cache_dirty = false;
+    }
+
+    for (i = 0; i < FLASHFS_FILE_MAX; i++)
+    {
+        node = &fs->node[i];
+        if (node->dirty && node->used && (err = flashfs_index_build(fs, i, pextra)))
+            goto failed;
+    }
+
+    if ((err = flashfs_dev_sync(fs)))
+        goto failed;
+
+    if ((err = flashfs_meta_write(fs)))
+        goto failed;
+
+    for (i = 0; i < FLASHFS_FILE_MAX; i++)
+    {
+        node = &fs->node[i];
+        if (!node->dirty)
+            continue;
+
+        if (node->used)
+        {
+            node->size = node->wsize;
+            node->index = node->windex;
+            node->trunc = 0;
+            node->dirty = 0;
+        }
+        else
+            memset(node, 0, sizeof(struct flashfs_node));
+    }
+
+    fs->dirty_num = 0;
+
+    words = flashfs_map_words(fs->dev);
+    for (i = 0; i < words; i++)
+    {
+        fs->used[i] &= ~fs->release[i];
+        fs->release[i] = 0;
+    }
+    fs->free += fs->release_num;
+    fs->release_num = 0;
+
+    return 0;
+
+failed:
+    fs->broken = true;
+
+    return err;
+}
+
+/* write the cache back before it holds another block */
+static int flashfs_cache_flush(struct flashfs *fs)
+{
+    struct flashfs_dirty *dirty;
+    os_u32 phys;
+    int err;
+
+    if (!fs->cache_dirty)
+        return 0;
+
+    if (!flashfs_dirty_find(fs, fs->cache_id, fs->cache_lblock))
+    {
+        /* the free blocks left are for the commit only */
+        if (fs->free <= FLASHFS_RESERVE)
+        {
+            if (!fs->release_num)
+                return -ENOSPC;
+            return flashfs_commit(fs);
+        }
+
+        if (fs->dirty_num >= FLASHFS_DIRTY_MAX)
+            return flashfs_commit(fs);
+    }
+
+    if ((err = flashfs_cache_prog(fs, &phys)))
+        return err;
+
+    if (!flashfs_dirty_find(fs, fs->cache_id, fs->cache_lblock))
+    {
+        dirty = &fs->dirty[fs->dirty_num++];
+        dirty->id = fs->cache_id;
+        dirty->lblock = fs->cache_lblock;
+        dirty->phys = phys;
+    }
+
+    fs->cache_dirty = false;
+
+    return 0;
+}
+
+/* load the block of the file to the cache, the part beyond the end is zero */
+static int flashfs_cache_load(struct flashfs *fs, os_u8 id, os_u32 lblock, bool fill)
+{
+    os_u32 bsize = fs->dev->block_size;
+    os_u32 wsize = fs->node[id].wsize;
+    os_u32 start;
+    int err;
+
+    if ((err = flashfs_cache_flush(fs)))
+        return err;
+
+    fs->cache_id = -1;
+
+    if (fill && (err = flashfs_block_read(fs, id, lblock, 0, fs->cache, bsize)))
+        return err;
+
+    if (fill && wsize < (lblock + 1) * bsize)
+    {
+        start = wsize > lblock * bsize ? wsize - lblock * bsize : 0;
+        memset(fs->cache + start, 0, bsize - start);
+    }
+
+    fs->cache_id = id;
+    fs->cache_lblock = lblock;
+
+    return 0;
+}
+
+/* mark the blocks of the file committed as used */
+static int flashfs_node_mark(struct flashfs *fs, struct flashfs_node *node)
+{
+    const struct flashfs_dev *dev = fs->dev;
+    os_u32 *index = (os_u32 *)fs->work;
+    os_u32 i, entries = dev->block_size / sizeof(os_u32);
+    int err;
+
+    if (node->index == FLASHFS_BLOCK_NONE)
+        return 0;
+
+    if (node->index >= dev->block_count)
+        return -EILSEQ;
+
+    if ((err = dev->read(dev, node->index, 0, index, dev->block_size)))
+        return err;
+
+    flashfs_bit_set(fs->used, node->index);
+    for (i = 0; i < entries; i++)
+    {
+        if (index[i] == FLASHFS_BLOCK_NONE)
+            continue;
+        if (index[i] < FLASHFS_META_BLOCKS || index[i] >= dev->block_count)
+            return -EILSEQ;
+        flashfs_bit_set(fs->used, index[i]);
+    }
+
+    return 0;
+}
+
+static int flashfs_node_find(struct flashfs *fs, const char *name)
+{
+    int i;
+
+    for (i = 0; i < FLASHFS_FILE_MAX; i++)
+        if (fs->node[i].used && !strcmp(fs->node[i].name, name))
+            return i;
+
+    return -ENOENT;
+}
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * flashfs_format - make the empty filesystem at the flash
+ *
+ * @param dev the flash device
+ *
+ * @return the result
+ */
+int flashfs_format (const struct flashfs_dev *dev)
+{
+    struct flashfs *fs;
+    int err;
+
+    if (!dev || dev->block_size < FLASHFS_BLOCK_MIN || dev->block_count <= FLASHFS_META_BLOCKS + FLASHFS_RESERVE)
+        return -EINVAL;
+
+    if (!(fs = malloc(sizeof(struct flashfs))))
+        return -ENOMEM;
+    memset(fs, 0, sizeof(struct flashfs));
+
+    fs->dev = dev;
+    fs->meta = 1;
+    fs->cursor = FLASHFS_META_BLOCKS;
+    fs->need_compact = true;
+
+    if (!(fs->work = malloc(dev->block_size)))
+    {
+        free(fs);
+        return -ENOMEM;
+    }
+
+    /* the snapshot goes to the block 0, and the block 1 is left invalid */
+    err = flashfs_erase(fs, 1);
+    if (!err)
+        err = flashfs_meta_write(fs);
+
+    free(fs->work);
+    free(fs);
+
+    return err;
+}
+
+/**
+ * flashfs_mount - mount the filesystem, only the active metadata block and
+ *                 one index block of every file are read
+ *
+ * @param fs the filesystem
+ * @param dev the flash device
+ *
+ * @return the result, -ENODEV means no filesystem at the flash
+ */
+int flashfs_mount (struct flashfs *fs, const struct flashfs_dev *dev)
+{
+    os_u32 rev[FLASHFS_META_BLOCKS], words, off, i;
+    os_u8 *p;
+    bool valid[FLASHFS_META_BLOCKS];
+    int ret;
+
+    if (!fs || !dev || dev->block_size < FLASHFS_BLOCK_MIN || dev->block_count <= FLASHFS_META_BLOCKS + FLASHFS_RESERVE)
+        return -EINVAL;
+
+    memset(fs, 0, sizeof(struct flashfs));
+    fs->dev = dev;
+    fs->cache_id = -1;
+
+    words = flashfs_map_words(dev);
+    fs->used = malloc(words * sizeof(os_u32));
+    fs->release = malloc(words * sizeof(os_u32));
+    fs->cache = malloc(dev->block_size);
+    fs->work = malloc(dev->block_size);
+    if (!fs->used || !fs->release || !fs->cache || !fs->work)
+    {
+        ret = -ENOMEM;
+        goto failed;
+    }
+    memset(fs->used, 0, words * sizeof(os_u32));
+    memset(fs->release, 0, words * sizeof(os_u32));
+
+    for (i = 0; i < FLASHFS_META_BLOCKS; i++)
+        valid[i] = flashfs_meta_check(fs, i, &rev[i]) ? false : true;
+
+    if (!valid[0] && !valid[1])
+    {
+        ret = -ENODEV;
+        goto failed;
+    }
+
+    if (valid[0] && valid[1])
+        fs->meta = (os_s32)(rev[1] - rev[0]) > 0 ? 1 : 0;
+    else
+        fs->meta = valid[1] ? 1 : 0;
+    fs->rev = rev[fs->meta];
+
+    /* replay the log until its end, the commit torn is dropped */
+    memset(fs->node, 0, sizeof(fs->node));
+    off = FLASHFS_ALIGN(dev, sizeof(struct flashfs_header));
+    while ((ret = flashfs_commit_load(fs, fs->meta, off)) > 0)
+        off += ret;
+
+    if (ret == -EILSEQ)
+        fs->need_compact = true;
+    else if (ret != -ENOENT)
+        goto failed;
+    fs->meta_off = off;
+
+    /* the rest must be erased to be programmed, or the log moves at next commit */
+    for (; off < dev->block_size && !fs->need_compact; off += i)
+    {
+        i = dev->block_size - off;
+        if ((ret = dev->read(dev, fs->meta, off, fs->work, i)))
+            goto failed;
+        for (p = fs->work; p < fs->work + i; p++)
+            if (*p != 0xFF)
+                fs->need_compact = true;
+    }
+
+    for (i = 0; i < FLASHFS_META_BLOCKS; i++)
+        flashfs_bit_set(fs->used, i);
+
+    for (i = 0; i < FLASHFS_FILE_MAX; i++)
+    {
+        if (fs->node[i].used && (ret = flashfs_node_mark(fs, &fs->node[i])))
+            goto failed;
+    }
+
+    fs->free = dev->block_count;
+    for (i = 0; i < dev->block_count; i++)
+        if (flashfs_bit_test(fs->used, i))
+            fs->free--;
+
+    pthread_mutex_init(&fs->mutex, NULL);
+
+    return 0;
+
+failed:
+    free(fs->used);
+    free(fs->release);
+    free(fs->cache);
+    free(fs->work);
+    fs->dev = NULL;
+
+    return ret;
+}
+
+/**
+ * flashfs_unmount - commit all the files and release the filesystem
+ *
+ * @param fs the filesystem
+ *
+ * @return the result of the committing
+ */
+int flashfs_unmount (struct flashfs *fs)
+{
+    int ret;
+
+    if (!fs || !fs->dev)
+        return -EINVAL;
+
+    ret = flashfs_sync(fs);
+
+    pthread_mutex_lock(&fs->mutex);
+
+    free(fs->used);
+    free(fs->release);
+    free(fs->cache);
+    free(fs->work);
+    fs->dev = NULL;
+
+    pthread_mutex_unlock(&fs->mutex);
+
+    return ret;
+}
+
+/**
+ * flashfs_sync - commit all the files changed
+ *
+ * @param fs the filesystem
+ *
+ * @return the result
+ */
+int flashfs_sync (struct flashfs *fs)
+{
+    int i, ret = 0;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    if (fs->broken)
+        ret = -EIO;
+    else
+    {
+        for (i = 0; i < FLASHFS_FILE_MAX; i++)
+            if (fs->node[i].dirty)
+                break;
+
+        if (i < FLASHFS_FILE_MAX || fs->cache_dirty)
+            ret = flashfs_commit(fs);
+    }
+
+    pthread_mutex_unlock(&fs->mutex);
+
+    return ret;
+}
+
+/**
+ * flashfs_unlink - remove the file, it is committed at once
+ *
+ * @param fs the filesystem
+ * @param name the name of the file
+ *
+ * @return the result
+ */
+int flashfs_unlink (struct flashfs *fs, const char *name)
+{
+    const struct flashfs_dev *dev = fs->dev;
+    struct flashfs_node *node;
+    os_u32 *index = (os_u32 *)fs->work;
+    os_u32 i;
+    int id, ret;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    if (fs->broken)
+    {
+        ret = -EIO;
+        goto out;
+    }
+
+    if ((id = ret = flashfs_node_find(fs, name)) < 0)
+        goto out;
+
+    node = &fs->node[id];
+    if (node->open)
+    {
+        ret = -EBUSY;
+        goto out;
+    }
+
+    flashfs_dirty_drop(fs, id);
+
+    if (node->index != FLASHFS_BLOCK_NONE)
+    {
+        if ((ret = dev->read(dev, node->index, 0, index, dev->block_size)))
+            goto out;
+
+        for (i = 0; i < dev->block_size / sizeof(os_u32); i++)
+            flashfs_block_release(fs, index[i]);
+        flashfs_block_release(fs, node->index);
+    }
+
+    memset(node, 0, sizeof(struct flashfs_node));
+    node->index = FLASHFS_BLOCK_NONE;
+    node->dirty = 1;
+
+    ret = flashfs_commit(fs);
+
+out:
+    pthread_mutex_unlock(&fs->mutex);
+
+    return ret;
+}
+
+/**
+ * flashfs_stat - get the state of the file
+ *
+ * @param fs the filesystem
+ * @param name the name of the file
+ * @param st the state
+ *
+ * @return the result
+ */
+int flashfs_stat (struct flashfs *fs, const char *name, struct flashfs_stat *st)
+{
+    int id;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    if ((id = flashfs_node_find(fs, name)) >= 0)
+    {
+        memcpy(st->name, fs->node[id].name, FLASHFS_NAME_MAX);
+        st->size = fs->node[id].wsize;
+    }
+
+    pthread_mutex_unlock(&fs->mutex);
+
+    return id < 0 ? id : 0;
+}
+
+/**
+ * flashfs_readdir - get the files one by one
+ *
+ * @param fs the filesystem
+ * @param iter the iterator, it is 0 at the first calling
+ * @param st the state of the file
+ *
+ * @return 1 means one file got, 0 means no more file
+ */
+int flashfs_readdir (struct flashfs *fs, int *iter, struct flashfs_stat *st)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    for (; *iter < FLASHFS_FILE_MAX; (*iter)++)
+    {
+        if (!fs->node[*iter].used)
+            continue;
+
+        memcpy(st->name, fs->node[*iter].name, FLASHFS_NAME_MAX);
+        st->size = fs->node[*iter].wsize;
+        (*iter)++;
+        ret = 1;
+        break;
+    }
+
+    pthread_mutex_unlock(&fs->mutex);
+
+    return ret;
+}
+
+/**
+ * flashfs_info - get the usage of the filesystem
+ *
+ * @param fs the filesystem
+ * @param info the usage
+ *
+ * @return the result
+ */
+int flashfs_info (struct flashfs *fs, struct flashfs_info *info)
+{
+    int i;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    info->block_size = fs->dev->block_size;
+    info->block_count = fs->dev->block_count;
+    info->block_free = fs->free + fs->release_num;
+    info->rev = fs->rev;
+    info->files = 0;
+    for (i = 0; i < FLASHFS_FILE_MAX; i++)
+        if (fs->node[i].used)
+            info->files++;
+
+    pthread_mutex_unlock(&fs->mutex);
+
+    return fs->broken ? -EIO : 0;
+}
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * flashfs_file_open - open the file
+ *
+ * @param fs the filesystem
+ * @param file the file handle
+ * @param name the name of the file
+ * @param flag the FLASHFS_O_* flags
+ *
+ * @return the result
+ */
+int flashfs_file_open (struct flashfs *fs, struct flashfs_file *file, const char *name, int flag)
+{
+    struct flashfs_node *node;
+    int id, len, ret = 0;
+
+    if (!(flag & FLASHFS_O_RDWR))
+        return -EINVAL;
+
+    len = strnlen(name, FLASHFS_NAME_MAX);
+    if (!len)
+        return -EINVAL;
+    if (len >= FLASHFS_NAME_MAX)
+        return -ENAMETOOLONG;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    if (fs->broken)
+    {
+        ret = -EIO;
+        goto out;
+    }
+
+    if ((id = flashfs_node_find(fs, name)) < 0)
+    {
+        if (!(flag & FLASHFS_O_CREAT) || !(flag & FLASHFS_O_WRONLY))
+        {
+            ret = -ENOENT;
+            goto out;
+        }
+
+        /* the slot deleted and not committed is used again */
+        for (id = 0; id < FLASHFS_FILE_MAX; id++)
+            if (!fs->node[id].used)
+                break;
+
+        if (id >= FLASHFS_FILE_MAX)
+        {
+            ret = -ENFILE;
+            goto out;
+        }
+
+        node = &fs->node[id];
+        memset(node, 0, sizeof(struct flashfs_node));
+        memcpy(node->name, name, len);
+        node->index = node->windex = FLASHFS_BLOCK_NONE;
+        node->used = 1;
+        node->dirty = 1;
+    }
+    else if ((flag & FLASHFS_O_TRUNC) && (flag & FLASHFS_O_WRONLY))
+    {
+        node = &fs->node[id];
+
+        flashfs_dirty_drop(fs, id);
+        node->wsize = 0;
+        node->trunc = 1;
+        node->dirty = 1;
+    }
+
+    fs->node[id].open++;
+
+    file->fs = fs;
+    file->id = id;
+    file->flag = flag;
+    file->pos = 0;
+
+out:
+    pthread_mutex_unlock(&fs->mutex);
+
+    return ret;
+}
+
+/**
+ * flashfs_file_read - read the file at its position
+ *
+ * @param file the file handle
+ * @param buf the buffer
+ * @param size the bytes to be read
+ *
+ * @return the bytes read, or the negative error code
+ */
+int flashfs_file_read (struct flashfs_file *file, void *buf, os_u32 size)
+{
+    struct flashfs *fs = file->fs;
+    struct flashfs_node *node = &fs->node[file->id];
+    os_u32 bsize = fs->dev->block_size;
+    os_u32 off, n;
+    os_u8 *p = buf;
+    int err = 0;
+
+    if (!(file->flag & FLASHFS_O_RDONLY))
+        return -EBADF;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    while (size && file->pos < node->wsize)
+    {
+        off = file->pos % bsize;
+        n = bsize - off;
+        if (n > size)
+            n = size;
+        if (n > node->wsize - file->pos)
+            n = node->wsize - file->pos;
+
+        if ((err = flashfs_block_read(fs, file->id, file->pos / bsize, off, p, n)))
+            break;
+
+        file->pos += n;
+        p += n;
+        size -= n;
+    }
+
+    pthread_mutex_unlock(&fs->mutex);
+
+    return (p == buf && err) ? err : p - (os_u8 *)buf;
+}
+
+/**
+ * flashfs_file_write - write the file at its position, the data is seen by
+ *                      the reading at once and it is committed at the syncing
+ *
+ * @param file the file handle
+ * @param buf the data
+ * @param size the bytes of the data
+ *
+ * @return the bytes written, or the negative error code
+ */
+int flashfs_file_write (struct flashfs_file *file, const void *buf, os_u32 size)
+{
+    struct flashfs *fs = file->fs;
+    struct flashfs_node *node = &fs->node[file->id];
+    os_u32 bsize = fs->dev->block_size;
+    os_u32 lblock, off, n;
+    const os_u8 *p = buf;
+    int err = 0;
+
+    if (!(file->flag & FLASHFS_O_WRONLY))
+        return -EBADF;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    if (fs->broken)
+    {
+        pthread_mutex_unlock(&fs->mutex);
+        return -EIO;
+    }
+
+    if (file->flag & FLASHFS_O_APPEND)
+        file->pos = node->wsize;
+
+    while (size)
+    {
+        lblock = file->pos / bsize;
+        off = file->pos % bsize;
+        n = bsize - off;
+        if (n > size)
+            n = size;
+
+        /* one index block limits the size of the file */
+        if (lblock >= bsize / sizeof(os_u32))
+        {
+            err = -EFBIG;
+            break;
+        }
+
+        if (fs->cache_id != file->id || fs->cache_lblock != lblock)
+        {
+            if ((err = flashfs_cache_load(fs, file->id, lblock, n != bsize)))
+                break;
+        }
+
+        memcpy(fs->cache + off, p, n);
+        fs->cache_dirty = true;
+        node->dirty = 1;
+
+        file->pos += n;
+        if (file->pos > node->wsize)
+            node->wsize = file->pos;
+
+        p += n;
+        size -= n;
+    }
+
+    pthread_mutex_unlock(&fs->mutex);
+
+    return (p == buf && err) ? err : p - (const os_u8 *)buf;
+}
+
+/**
+ * flashfs_file_seek - set the position of the file
+ *
+ * @param file the file handle
+ * @param off the offset
+ * @param from FLASHFS_SEEK_SET, FLASHFS_SEEK_CUR or FLASHFS_SEEK_END
+ *
+ * @return the new position, or the negative error code
+ */
+os_s32 flashfs_file_seek (struct flashfs_file *file, os_s32 off, int from)
+{
+    struct flashfs *fs = file->fs;
+    os_s32 pos;
+
+    pthread_mutex_lock(&fs->mutex);
+
+    if (from == FLASHFS_SEEK_SET)
+        pos = off;
+    else if (from == FLASHFS_SEEK_CUR)
+        pos = file->pos + off;
+    else if (from == FLASHFS_SEEK_END)
+        pos = fs->node[file->id].wsize + off;
+    else
+        pos = -EINVAL;
+
+    if (pos < 0)
+        pos = -EINVAL;
+    else
+        file->pos = pos;
+
+    pthread_mutex_unlock(&fs->mutex);
+
+    return pos;
+}
+
+/**
+ * flashfs_file_sync - commit the file, all the other files changed are
+ *                     committed together
+ *
+ * @param file the file handle
+ *
+ * @return the result
+ */
+int flashfs_file_sync (struct flashfs_file *file)
+{
+    return flashfs_sync(file->fs);
+}
+
+/**
+ * flashfs_file_close - close the file, and commit it if it is written
+ *
+ * @param file the file handle
+ *
+ * @return the result of the committing
+ */
+int flashfs_file_close (struct flashfs_file *file)
+{
+    struct flashfs *fs = file->fs;
+
+    pthread_mutex_lock(&fs->mutex);
+    fs->node[file->id].open--;
+    pthread_mutex_unlock(&fs->mutex);
+
+    return (file->flag & FLASHFS_O_WRONLY) ? flashfs_sync(fs) : 0;
+}
+
+/*@}*/
@@ -0,0 +1,122 @@
+/*
+ * File         : flashfs_fd.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-14       DongHeng        create
+ */
+
+#include "flashfs.h"
+#include "unistd.h"
+#include "stdlib.h"
+#include "string.h"
+
+/*@{*/
+
+/* the file opened as the file handle, the stdops must be the first member */
+struct flashfs_fd
+{
+    struct stdops               stdops;
+    struct flashfs_file         file;
+};
+
+/*@}*/
+
+/*@{*/
+
+/* the file keeps its own position like the device, the offset is not used */
+static ssize_t flashfs_fd_read(struct stdops *ops, char __user *buffer, size_t size, loff_t loff)
+{
+    return flashfs_file_read(&((struct flashfs_fd *)ops)->file, buffer, size);
+}
+
+static ssize_t flashfs_fd_write(struct stdops *ops, const char __user *buffer, size_t size, loff_t loff)
+{
+    return flashfs_file_write(&((struct flashfs_fd *)ops)->file, buffer, size);
+}
+
+static loff_t flashfs_fd_lseek(struct stdops *ops, loff_t loff, int from)
+{
+    return flashfs_file_seek(&((struct flashfs_fd *)ops)->file, loff, from);
+}
+
+static err_t flashfs_fd_control(struct stdops *ops, int cmd, void *paramer)
+{
+    if (cmd == FLASHFS_CTRL_SYNC)
+        return flashfs_file_sync(&((struct flashfs_fd *)ops)->file);
+
+    return -EINVAL;
+}
+
+/* the last reference of the file handle is dropped */
+static err_t flashfs_fd_release(struct stdops *ops)
+{
+    err_t ret = flashfs_file_close(&((struct flashfs_fd *)ops)->file);
+
+    free(ops);
+
+    return ret;
+}
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * flashfs_open - open the file as the file handle, it is read and written by
+ *                read, write, lseek, ioctl and close
+ *
+ * @param fs the filesystem mounted
+ * @param name the name of the file
+ * @param oflag the O_* flags
+ *
+ * @return the file handle, or the negative error code
+ */
+int flashfs_open (struct flashfs *fs, const char *name, int oflag)
+{
+    struct flashfs_fd *fd;
+    int flag = 0, ret;
+
+    if (oflag & O_RDONLY)
+        flag |= FLASHFS_O_RDONLY;
+    if (oflag & O_WRONLY)
+        flag |= FLASHFS_O_WRONLY;
+    if (oflag & O_RDWR)
+        flag |= FLASHFS_O_RDWR;
+    if (oflag & O_CREAT)
+        flag |= FLASHFS_O_CREAT;
+    if (oflag & O_TRUNC)
+        flag |= FLASHFS_O_TRUNC;
+    if (oflag & O_APPEND)
+        flag |= FLASHFS_O_APPEND;
+
+    if (!(fd = malloc(sizeof(struct flashfs_fd))))
+        return -ENOMEM;
+    memset(fd, 0, sizeof(struct flashfs_fd));
+
+    if ((ret = flashfs_file_open(fs, &fd->file, name, flag)))
+    {
+        free(fd);
+        return ret;
+    }
+
+    fd->stdops.type      = STDOBJ_FS;
+    fd->stdops.open_flag = oflag;
+    fd->stdops.read      = flashfs_fd_read;
+    fd->stdops.write     = flashfs_fd_write;
+    fd->stdops.lseek     = flashfs_fd_lseek;
+    fd->stdops.control   = flashfs_fd_control;
+    fd->stdops.release   = flashfs_fd_release;
+
+    if ((ret = stdfd_alloc(&fd->stdops, oflag)) < 0)
+    {
+        flashfs_file_close(&fd->file);
+        free(fd);
+    }
+
+    return ret;
+}
+
+/*@}*/
@@ -0,0 +1,50 @@
+/*
+ * File         : rtos.h
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ * 
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-12       DongHeng        create
+ */
+
+/*
+ * the kernel definitions used by the filesystems when they run at the Linux 
+ * host, this directory must be searched before the kernel include directory,
+ * and the kernel include directory must be searched after the system one, so
+ * the POSIX headers come from the host C library:
+ *
+ *   -I hwutil/fs/host -I hwutil/fs/fatfs/include 
+ *   -idirafter hwutil/kernel/include
+ */
+
+#ifndef _RTOS_H_
+#define _RTOS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <errno.h>
+
+#define FATFS_HOST              1
+#define FLASHFS_HOST            1
+
+#define USING_SHELL             0
+#define USING_DISK_PORT         1
+
+#define NO_INIT
+#define STATIC                  static
+#define INLINE                  static inline
+#define __user
+
+typedef uint8_t                 os_u8;
+typedef uint16_t                os_u16;
+typedef uint32_t                os_u32;
+typedef uint64_t                os_u64;
+typedef int8_t                  os_s8;
+typedef int16_t                 os_s16;
+typedef int32_t                 os_s32;
+
+typedef signed int              err_t;
+
+#endif
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+#
+# File         : respack.py
+# This file is part of POSIX-RTOS
+# COPYRIGHT (C) 2015 - 2016, DongHeng
+#
+# Change Logs:
+# DATA             Author          Note
+# 2016-03-16       DongHeng        create
+#
+
+"""
+Build the resource pack of respack.h from the files, the name of a resource is
+the path relative to the root directory:
+
+  respack.py -o res.bin -C assets fonts images/logo.bin
+  respack.py -l res.bin
+
+The image is programmed at QSPI_RESPACK_OFFSET of the QSPI flash, and it must
+not be larger than QSPI_RESPACK_SIZE (8 MB at the STM32F746G-DISCO).
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+RESPACK_MAGIC = 0x4B415052
+RESPACK_VERSION = 1
+RESPACK_ALIGN = 32
+RESPACK_NAME_MAX = 64
+
+# magic, version, align, count, index, size, crc
+HEADER = struct.Struct('<IHHIIII')
+# name, data, size, crc
+ENTRY = struct.Struct('<IIII')
+
+QSPI_RESPACK_SIZE = 8 * 1024 * 1024
+
+
+def align(value, to):
+    return (value + to - 1) // to * to
+
+
+def collect(root, paths):
+    """the resources as (name, path), sorted by the name"""
+    found = {}
+    for path in paths or ['.']:
+        full = os.path.join(root, path)
+        if os.path.isdir(full):
+            files = [os.path.join(d, f) for d, _, fs in os.walk(full) for f in fs]
+        elif os.path.isfile(full):
+            files = [full]
+        else:
+            raise SystemExit('respack: no such file %s' % full)
+        for f in files:
+            name = os.path.relpath(f, root).replace(os.sep, '/')
+            raw = name.encode('ascii', 'replace')
+            if len(raw) + 1 > RESPACK_NAME_MAX or not all(0x20 < c < 0x7F for c in raw):
+                raise SystemExit('respack: bad name %s' % name)
+            found[raw] = f
+    return sorted(found.items())
+
+
+def build(resources):
+    count = len(resources)
+    index = align(HEADER.size, 4)
+    names = index + count * ENTRY.size
+
+    name_offs = []
+    blob = bytearray()
+    for name, _ in resources:
+        name_offs.append(names + len(blob))
+        blob += name + b'\0'
+
+    data = align(names + len(blob), RESPACK_ALIGN)
+    image = bytearray(data)
+    image[names:names + len(blob)] = blob
+
+    for i, (name, path) in enumerate(resources):
+        with open(path, 'rb') as f:
+            content = f.read()
+        data = len(image)
+        image += content
+        image += bytes(align(len(image), RESPACK_ALIGN) - len(image))
+        ENTRY.pack_into(image, index + i * ENTRY.size, name_offs[i], data,
+                        len(content), zlib.crc32(content) & 0xFFFFFFFF)
+
+    crc = zlib.crc32(bytes(image[HEADER.size:])) & 0xFFFFFFFF
+    HEADER.pack_into(image, 0, RESPACK_MAGIC, RESPACK_VERSION, RESPACK_ALIGN,
+                     count, index, len(image), crc)
+    return bytes(image)
+
+
+def dump(image):
+    magic, version, _, count, index, size, crc = HEADER.unpack_from(image, 0)
+    if magic != RESPACK_MAGIC or version != RESPACK_VERSION:
+        raise SystemExit('respack: not a resource pack')
+    if zlib.crc32(image[HEADER.size:size]) & 0xFFFFFFFF != crc:
+        print('respack: crc error')
+    for i in range(count):
+        name, data, length, _ = ENTRY.unpack_from(image, index + i * ENTRY.size)
+        end = image.index(b'\0', name)
+        print('%08x %8u %s' % (data, length, image[name:end].decode('ascii')))
+    print('%u resources, %u bytes' % (count, size))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='build the resource pack')
+    parser.add_argument('-o', '--output', help='the image built')
+    parser.add_argument('-C', '--root', default='.', help='the root of the names')
+    parser.add_argument('-s', '--size', type=int, default=QSPI_RESPACK_SIZE,
+                        help='the maximum bytes of the image')
+    parser.add_argument('-l', '--list', metavar='IMAGE', help='list the image')
+    parser.add_argument('paths', nargs='*', help='the files or the directories')
+    args = parser.parse_args()
+
+    if args.list:
+        with open(args.list, 'rb') as f:
+            dump(f.read())
+        return 0
+
+    if not args.output:
+        parser.error('the output is required')
+
+    image = build(collect(args.root, args.paths))
+    if len(image) > args.size:
+        raise SystemExit('respack: %u bytes is larger than %u' % (len(image), args.size))
+
+    with open(args.output, 'wb') as f:
+        f.write(image)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,164 @@
+/*
+ * File         : rphost.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-16       DongHeng        create
+ */
+
+/*
+ * the check of the resource pack built by respack.py at the Linux host, the
+ * image is loaded to the memory like the QSPI flash mapped:
+ *
+ *   gcc -O2 -I hwutil/fs/host -I hwutil/fs/respack/include
+ *       -idirafter hwutil/kernel/include
+ *       hwutil/fs/respack/host/rphost.c hwutil/fs/respack/source/respack.c
+ *       -o rphost
+ *
+ *   ./rphost res.bin             mount, verify and time the lookup of all names
+ *   ./rphost res.bin name...     print the address and the size of the names
+ */
+
+#include "respack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*@{*/
+
+/* the rounds of looking up every name */
+#define RPHOST_ROUNDS           100
+
+/*@}*/
+
+static os_u64 rphost_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (os_u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void *rphost_load(const char *path, os_u32 *size)
+{
+    FILE *fp;
+    void *buf;
+    long len;
+
+    if (!(fp = fopen(path, "rb")))
+        return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    /* the flash mapped is aligned, so is the image loaded */
+    if (len <= 0 || !(buf = aligned_alloc(RESPACK_ALIGN, (len + RESPACK_ALIGN - 1) / RESPACK_ALIGN * RESPACK_ALIGN)))
+    {
+        fclose(fp);
+        return NULL;
+    }
+
+    if (fread(buf, 1, len, fp) != (size_t)len)
+    {
+        free(buf);
+        buf = NULL;
+    }
+    fclose(fp);
+
+    *size = len;
+
+    return buf;
+}
+
+int main(int argc, char *argv[])
+{
+    struct respack pack;
+    struct respack_res res;
+    const void *data;
+    os_u64 start;
+    os_u32 size, i, round;
+    void *image;
+    err_t err;
+    int ret = 0;
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s image [name...]\n", argv[0]);
+        return 1;
+    }
+
+    if (!(image = rphost_load(argv[1], &size)))
+    {
+        fprintf(stderr, "load %s failed\n", argv[1]);
+        return 1;
+    }
+
+    if ((err = respack_mount(&pack, image, size)))
+    {
+        fprintf(stderr, "mount failed (%d)\n", err);
+        ret = 1;
+        goto out;
+    }
+
+    if (argc > 2)
+    {
+        for (i = 2; i < (os_u32)argc; i++)
+        {
+            if ((data = respack_map(&pack, argv[i], &size)))
+                printf("%s at %lu, %lu bytes\n", argv[i],
+                       (unsigned long)((const os_u8 *)data - pack.base), (unsigned long)size);
+            else
+            {
+                printf("%s not found\n", argv[i]);
+                ret = 1;
+            }
+        }
+        goto out;
+    }
+
+    start = rphost_ns();
+    err = respack_verify(&pack);
+    printf("%lu resources, %lu bytes, verified in %lu us (%d)\n", (unsigned long)pack.count,
+           (unsigned long)pack.size, (unsigned long)((rphost_ns() - start) / 1000), err);
+    if (err)
+    {
+        ret = 1;
+        goto out;
+    }
+
+    /* every name is found at its own position of the index */
+    for (i = 0; i < pack.count; i++)
+    {
+        respack_entry(&pack, i, &res);
+        if (respack_map(&pack, res.name, NULL) != res.data || ((size_t)res.data & (RESPACK_ALIGN - 1)))
+        {
+            printf("%s mismatched\n", res.name);
+            ret = 1;
+            goto out;
+        }
+    }
+
+    start = rphost_ns();
+    for (round = 0; round < RPHOST_ROUNDS; round++)
+    {
+        for (i = 0; i < pack.count; i++)
+        {
+            respack_entry(&pack, i, &res);
+            respack_open(&pack, res.name, &res);
+        }
+    }
+    if (pack.count)
+        printf("lookup %lu ns per name\n",
+               (unsigned long)((rphost_ns() - start) / ((os_u64)RPHOST_ROUNDS * pack.count)));
+
+out:
+    free(image);
+
+    return ret;
+}
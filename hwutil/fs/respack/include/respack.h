@@ -0,0 +1,81 @@
+#ifndef _RESPACK_H_
+#define _RESPACK_H_
+
+#include "rtos.h"
+
+/*
+ * the resource pack is a read-only image of the assets like the fonts, the
+ * images and the lookup tables, it is placed at the flash which is mapped to
+ * the memory, so the resource is used by the pointer with no copy
+ *
+ * the image is built by respack.py at the host:
+ *
+ *   header | index sorted by the name | names | data aligned to RESPACK_ALIGN
+ */
+
+/* "RPAK" at the little endian */
+#define RESPACK_MAGIC           0x4B415052
+#define RESPACK_VERSION         1
+
+/* the alignment of the data, it is the cache line of the Cortex-M7 */
+#define RESPACK_ALIGN           32
+
+/* the maximum length of the name, including the end of the string */
+#define RESPACK_NAME_MAX        64
+
+/******************************************************************************/
+
+/* the header at the beginning of the image, all the offsets are from it */
+struct respack_header
+{
+    os_u32                      magic;
+    os_u16                      version;
+    os_u16                      align;
+
+    /* the number of the resources and the offset of the index */
+    os_u32                      count;
+    os_u32                      index;
+
+    /* the bytes of the image, and the crc32 of the bytes after the header */
+    os_u32                      size;
+    os_u32                      crc;
+};
+
+/* the item of the index */
+struct respack_entry
+{
+    os_u32                      name;
+    os_u32                      data;
+    os_u32                      size;
+
+    /* the crc32 of the data */
+    os_u32                      crc;
+};
+
+/* the resource pack mounted */
+struct respack
+{
+    const os_u8                 *base;
+    os_u32                      size;
+
+    os_u32                      count;
+    const struct respack_entry  *index;
+};
+
+/* the resource opened, the data stays at the flash */
+struct respack_res
+{
+    const char                  *name;
+    const void                  *data;
+    os_u32                      size;
+};
+
+/******************************************************************************/
+
+err_t respack_mount(struct respack *pack, const void *base, os_u32 size);
+err_t respack_open(const struct respack *pack, const char *name, struct respack_res *res);
+const void *respack_map(const struct respack *pack, const char *name, os_u32 *size);
+err_t respack_entry(const struct respack *pack, os_u32 index, struct respack_res *res);
+err_t respack_verify(const struct respack *pack);
+
+#endif
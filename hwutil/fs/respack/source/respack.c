@@ -0,0 +1,237 @@
+/*
+ * File         : respack.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-16       DongHeng        create
+ */
+
+#include "respack.h"
+#include "string.h"
+
+/*@{*/
+
+/* the crc32 of every half byte, the image is verified at the flash mapped */
+static const os_u32 respack_crc_table[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/*@}*/
+
+/*@{*/
+
+static os_u32 respack_crc32(os_u32 crc, const void *buf, os_u32 size)
+{
+    const os_u8 *p = buf;
+
+    crc = ~crc;
+    while (size--)
+    {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ respack_crc_table[crc & 0x0F];
+        crc = (crc >> 4) ^ respack_crc_table[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+
+static const char *respack_name(const struct respack *pack, const struct respack_entry *entry)
+{
+    return (const char *)pack->base + entry->name;
+}
+
+/* the index is sorted by the name, so it is searched by the bisection */
+static const struct respack_entry *respack_find(const struct respack *pack, const char *name)
+{
+    os_u32 low = 0, high = pack->count, mid;
+    int cmp;
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+
+        cmp = strcmp(name, respack_name(pack, &pack->index[mid]));
+        if (!cmp)
+            return &pack->index[mid];
+
+        if (cmp < 0)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    return NULL;
+}
+
+static void respack_fill(const struct respack *pack, const struct respack_entry *entry, struct respack_res *res)
+{
+    res->name = respack_name(pack, entry);
+    res->data = pack->base + entry->data;
+    res->size = entry->size;
+}
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * respack_mount - check the header and the index of the image, the resource
+ *                 opened later never points out of the image
+ *
+ * @param pack the resource pack
+ * @param base the image at the memory, it must be aligned to 4 bytes
+ * @param size the bytes of the memory holding the image
+ *
+ * @return the result
+ */
+err_t respack_mount(struct respack *pack, const void *base, os_u32 size)
+{
+    const struct respack_header *header = base;
+    const struct respack_entry *index;
+    const char *name, *last = NULL;
+    os_u32 i, limit;
+
+    if (!pack || !base || ((unsigned long)base & 3) || size < sizeof(struct respack_header))
+        return -EINVAL;
+
+    if (header->magic != RESPACK_MAGIC || header->version != RESPACK_VERSION)
+        return -EBADMSG;
+
+    if (header->size > size || header->size < sizeof(struct respack_header) ||
+        (header->index & 3) || header->index > header->size ||
+        header->count > (header->size - header->index) / sizeof(struct respack_entry))
+        return -EBADMSG;
+
+    index = (const struct respack_entry *)((const os_u8 *)base + header->index);
+    for (i = 0; i < header->count; i++)
+    {
+        if (index[i].name >= header->size || index[i].data > header->size ||
+            index[i].size > header->size - index[i].data)
+            return -EBADMSG;
+
+        /* the name must end in the image, and be greater than the last one */
+        name = (const char *)base + index[i].name;
+        limit = header->size - index[i].name;
+        if (limit > RESPACK_NAME_MAX)
+            limit = RESPACK_NAME_MAX;
+        if (!name[0] || strnlen(name, limit) >= limit)
+            return -EBADMSG;
+        if (last && strcmp(last, name) >= 0)
+            return -EBADMSG;
+        last = name;
+    }
+
+    pack->base  = base;
+    pack->size  = header->size;
+    pack->count = header->count;
+    pack->index = index;
+
+    return 0;
+}
+
+/**
+ * respack_open - find the resource by the name
+ *
+ * @param pack the resource pack mounted
+ * @param name the name of the resource
+ * @param res the resource found
+ *
+ * @return the result
+ */
+err_t respack_open(const struct respack *pack, const char *name, struct respack_res *res)
+{
+    const struct respack_entry *entry;
+
+    if (!pack || !name || !res)
+        return -EINVAL;
+
+    if (!(entry = respack_find(pack, name)))
+        return -ENOENT;
+
+    respack_fill(pack, entry, res);
+
+    return 0;
+}
+
+/**
+ * respack_map - get the data of the resource at the flash like mmap
+ *
+ * @param pack the resource pack mounted
+ * @param name the name of the resource
+ * @param size the bytes of the data, it can be NULL
+ *
+ * @return the data, NULL means no such resource
+ */
+const void *respack_map(const struct respack *pack, const char *name, os_u32 *size)
+{
+    struct respack_res res;
+
+    if (respack_open(pack, name, &res))
+        return NULL;
+
+    if (size)
+        *size = res.size;
+
+    return res.data;
+}
+
+/**
+ * respack_entry - get the resource by the position at the index, the
+ *                 resources are listed in the order of the name
+ *
+ * @param pack the resource pack mounted
+ * @param index the position at the index
+ * @param res the resource
+ *
+ * @return the result
+ */
+err_t respack_entry(const struct respack *pack, os_u32 index, struct respack_res *res)
+{
+    if (!pack || !res)
+        return -EINVAL;
+
+    if (index >= pack->count)
+        return -ENOENT;
+
+    respack_fill(pack, &pack->index[index], res);
+
+    return 0;
+}
+
+/**
+ * respack_verify - check the crc32 of the image and every resource, it reads
+ *                  the whole image, so it is not done at mounting
+ *
+ * @param pack the resource pack mounted
+ *
+ * @return the result
+ */
+err_t respack_verify(const struct respack *pack)
+{
+    const struct respack_header *header;
+    os_u32 i;
+
+    if (!pack || !pack->base)
+        return -EINVAL;
+
+    header = (const struct respack_header *)pack->base;
+    if (respack_crc32(0, pack->base + sizeof(struct respack_header),
+                      pack->size - sizeof(struct respack_header)) != header->crc)
+        return -EBADMSG;
+
+    for (i = 0; i < pack->count; i++)
+    {
+        if (respack_crc32(0, pack->base + pack->index[i].data, pack->index[i].size) != pack->index[i].crc)
+            return -EBADMSG;
+    }
+
+    return 0;
+}
+
+/*@}*/
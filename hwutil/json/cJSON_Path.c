@@ -0,0 +1,233 @@
+/*
+ * File         : cJSON_Path.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-17       DongHeng        create
+ */
+
+/* Compiled key, path and schema accessors of cJSON. */
+
+#include "string.h"
+#include <ctype.h>
+#include "cJSON_Path.h"
+
+#include "stdlib.h"
+
+/* FNV-1a of the lower case key, so the hash is case insensitive like the compare. */
+static unsigned cJSON_hash(const char *s)
+{
+	unsigned h=2166136261u;
+	while (*s) h=(h^(unsigned)tolower(*(const unsigned char *)s++))*16777619u;
+	return h;
+}
+
+static int cJSON_keycmp(const char *s1,const char *s2)
+{
+	for(; tolower(*(const unsigned char *)s1) == tolower(*(const unsigned char *)s2); ++s1, ++s2)	if(*s1 == 0)	return 0;
+	return 1;
+}
+
+static int cJSON_count(cJSON *object)	{cJSON *c=object->child;int i=0;while(c)i++,c=c->next;return i;}
+
+void cJSON_InitKey(cJSON_Key *key,const char *string)	{key->string=string;key->hash=cJSON_hash(string);}
+
+/* The children are not hashed, the first character skips most of them before the full compare. */
+cJSON *cJSON_GetObjectKey(cJSON *object,const cJSON_Key *key)
+{
+	cJSON *c;int first;
+	if (!object || !key->string) return 0;
+	first=tolower(*(const unsigned char *)key->string);
+	for (c=object->child;c;c=c->next)
+		if (c->string && tolower(*(const unsigned char *)c->string)==first && !cJSON_keycmp(c->string,key->string)) return c;
+	return 0;
+}
+
+/* Build the hash table of the children, the first child of a duplicated key wins like cJSON_GetObjectItem. */
+cJSON_Index *cJSON_CreateIndex(cJSON *object)
+{
+	cJSON_Index *index;cJSON *c;int size=4;unsigned h,s;
+	if (!object || (object->type&255)!=cJSON_Object) return 0;
+	while (size<cJSON_count(object)*2) size<<=1;
+
+	index=(cJSON_Index*)malloc(sizeof(cJSON_Index));
+	if (!index) return 0;
+	index->object=object;index->size=size;
+	index->slot=(cJSON**)malloc(size*sizeof(cJSON*));
+	index->hash=(unsigned*)malloc(size*sizeof(unsigned));
+	if (!index->slot || !index->hash) {cJSON_DeleteIndex(index);return 0;}
+	memset(index->slot,0,size*sizeof(cJSON*));
+
+	for (c=object->child;c;c=c->next)
+	{
+		if (!c->string) continue;
+		h=cJSON_hash(c->string);
+		for (s=h&(size-1);index->slot[s];s=(s+1)&(size-1))
+			if (index->hash[s]==h && !cJSON_keycmp(index->slot[s]->string,c->string)) break;
+		if (!index->slot[s]) {index->slot[s]=c;index->hash[s]=h;}
+	}
+	return index;
+}
+
+cJSON *cJSON_GetIndexKey(const cJSON_Index *index,const cJSON_Key *key)
+{
+	unsigned s;
+	if (!index || !key->string) return 0;
+	for (s=key->hash&(index->size-1);index->slot[s];s=(s+1)&(index->size-1))
+		if (index->hash[s]==key->hash && !cJSON_keycmp(index->slot[s]->string,key->string)) return index->slot[s];
+	return 0;
+}
+
+void cJSON_DeleteIndex(cJSON_Index *index)
+{
+	if (!index) return;
+	if (index->slot) free(index->slot);
+	if (index->hash) free(index->hash);
+	free(index);
+}
+
+void cJSON_DeleteIndexSet(cJSON_IndexSet *set)
+{
+	int i;
+	for (i=0;i<set->count;i++) cJSON_DeleteIndex(set->index[i]);
+	set->count=0;
+}
+
+/* Find the index of object in the set, it is built the first time if the object is large. */
+static cJSON_Index *cJSON_SetIndex(cJSON_IndexSet *set,cJSON *object)
+{
+	cJSON_Index *index;int i;
+	for (i=0;i<set->count;i++) if (set->index[i]->object==object) return set->index[i];
+	if (set->count==cJSON_INDEX_SET || cJSON_count(object)<cJSON_INDEX_MIN) return 0;
+	if (!(index=cJSON_CreateIndex(object))) return 0;
+	set->index[set->count++]=index;
+	return index;
+}
+
+/* The text is copied to the path, and every key is cut in place. */
+int cJSON_CompilePath(cJSON_Path *path,const char *text)
+{
+	char *p=path->text,*key,sep;int n;
+	if (strlen(text)>=cJSON_PATH_TEXT) return -1;
+	memcpy(path->text,text,strlen(text)+1);
+	path->count=0;
+
+	while (*p)
+	{
+		if (path->count==cJSON_PATH_STEPS) return -1;
+		if (*p=='[')
+		{
+			for (n=0,p++;*p>='0' && *p<='9';p++) n=n*10+(*p-'0');
+			if (*p!=']' || p[-1]=='[') return -1;
+			p++;
+			if (*p=='.' && *++p==0) return -1;		/* "a[1]." */
+			path->step[path->count].key.string=0;
+			path->step[path->count++].index=n;
+			continue;
+		}
+		for (key=p;*p && *p!='.' && *p!='[';p++);
+		if (p==key) return -1;					/* empty key */
+		sep=*p;*p=0;						/* the key is cut before it is hashed */
+		cJSON_InitKey(&path->step[path->count].key,key);
+		path->step[path->count++].index=0;
+		if (sep=='.')	{if (!*++p) return -1;}
+		else if (sep=='[')
+		{
+			/* the '[' is cut as the end of the key, so the index is parsed here */
+			p++;
+			for (n=0,key=p;*p>='0' && *p<='9';p++) n=n*10+(*p-'0');
+			if (*p!=']' || p==key || path->count==cJSON_PATH_STEPS) return -1;
+			p++;
+			if (*p=='.' && *++p==0) return -1;
+			path->step[path->count].key.string=0;
+			path->step[path->count++].index=n;
+		}
+	}
+	return path->count?0:-1;
+}
+
+cJSON *cJSON_GetPath(cJSON *root,const cJSON_Path *path,cJSON_IndexSet *set)
+{
+	cJSON *c=root;cJSON_Index *index;int i;
+	for (i=0;c && i<path->count;i++)
+	{
+		if (!path->step[i].key.string)
+		{
+			if ((c->type&255)!=cJSON_Array) return 0;
+			c=cJSON_GetArrayItem(c,path->step[i].index);
+		}
+		else
+		{
+			if ((c->type&255)!=cJSON_Object) return 0;
+			index=set?cJSON_SetIndex(set,c):0;
+			c=index?cJSON_GetIndexKey(index,&path->step[i].key):cJSON_GetObjectKey(c,&path->step[i].key);
+		}
+	}
+	return c;
+}
+
+int cJSON_CompileSchema(cJSON_Schema *schema,const cJSON_Field *field,int count)
+{
+	int i;unsigned s;
+	if (count>cJSON_SCHEMA_FIELDS) return -1;
+	schema->field=field;schema->count=count;
+	memset(schema->slot,0,sizeof(schema->slot));
+	for (i=0;i<count;i++)
+	{
+		schema->hash[i]=cJSON_hash(field[i].key);
+		for (s=schema->hash[i]&(cJSON_SCHEMA_SLOTS-1);schema->slot[s];s=(s+1)&(cJSON_SCHEMA_SLOTS-1));
+		schema->slot[s]=(unsigned char)(i+1);
+	}
+	return 0;
+}
+
+/* Fill a member by the item, returns 0 when the type is not matched. */
+static int cJSON_Fill(cJSON *item,const cJSON_Field *field,char *out)
+{
+	char *member=out+field->offset;int type=item->type&255;size_t len;
+	switch (field->type)
+	{
+		case cJSON_FieldInt:
+			if (type==cJSON_Number)		*(int*)member=item->valueint;
+			else if (type==cJSON_True || type==cJSON_False) *(int*)member=(type==cJSON_True);
+			else return 0;
+			return 1;
+		case cJSON_FieldDouble:		if (type!=cJSON_Number) return 0;*(double*)member=item->valuedouble;return 1;
+		case cJSON_FieldBool:		if (type!=cJSON_True && type!=cJSON_False) return 0;*(int*)member=(type==cJSON_True);return 1;
+		case cJSON_FieldString:
+			if (type!=cJSON_String || !field->size) return 0;
+			len=strlen(item->valuestring);if (len>=field->size) len=field->size-1;
+			memcpy(member,item->valuestring,len);member[len]=0;
+			return 1;
+		case cJSON_FieldStringPtr:	if (type!=cJSON_String) return 0;*(const char**)member=item->valuestring;return 1;
+		case cJSON_FieldItem:		*(cJSON**)member=item;return 1;
+		case cJSON_FieldObject:		if (type!=cJSON_Object || !field->sub) return 0;cJSON_Extract(item,field->sub,member);return 1;
+	}
+	return 0;
+}
+
+/* One pass over the children, every child is matched by the hash table of the schema. */
+int cJSON_Extract(cJSON *object,const cJSON_Schema *schema,void *out)
+{
+	unsigned char done[cJSON_SCHEMA_FIELDS];
+	cJSON *c;int i,n=0;unsigned h,s;
+	if (!object || (object->type&255)!=cJSON_Object) return 0;
+	memset(done,0,schema->count);
+
+	for (c=object->child;c && n<schema->count;c=c->next)
+	{
+		if (!c->string) continue;
+		h=cJSON_hash(c->string);
+		for (s=h&(cJSON_SCHEMA_SLOTS-1);schema->slot[s];s=(s+1)&(cJSON_SCHEMA_SLOTS-1))
+		{
+			i=schema->slot[s]-1;
+			if (schema->hash[i]!=h || done[i] || cJSON_keycmp(schema->field[i].key,c->string)) continue;
+			done[i]=1;	/* the first child of a duplicated key wins */
+			n+=cJSON_Fill(c,&schema->field[i],(char*)out);
+			break;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,122 @@
+/*
+ * File         : cJSON_Path.h
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-17       DongHeng        create
+ */
+
+#ifndef cJSON_Path__h
+#define cJSON_Path__h
+
+#include "cJSON.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Compiled accessors of cJSON. The key is hashed once when it is compiled, so
+ * most children are skipped by the hash instead of cJSON_strcasecmp. The keys
+ * are case insensitive like cJSON_GetObjectItem.
+ */
+
+/* The most steps of a path, and the most bytes of its text. */
+#define cJSON_PATH_STEPS	8
+#define cJSON_PATH_TEXT		64
+
+/* The objects having less children are searched linearly even with an index set. */
+#define cJSON_INDEX_MIN		8
+/* The most objects indexed in an index set. */
+#define cJSON_INDEX_SET		8
+
+/* The most fields of a schema, and the slots of its hash table. */
+#define cJSON_SCHEMA_FIELDS	64
+#define cJSON_SCHEMA_SLOTS	128
+
+/* The types of the fields filled by cJSON_Extract. */
+#define cJSON_FieldInt		0	/* int, from a number or a bool */
+#define cJSON_FieldDouble	1	/* double, from a number */
+#define cJSON_FieldBool		2	/* int 0 or 1, from a bool */
+#define cJSON_FieldString	3	/* char[size], the string is copied and cut to size */
+#define cJSON_FieldStringPtr	4	/* const char *, points to the string of the tree */
+#define cJSON_FieldItem		5	/* cJSON *, the item of any type */
+#define cJSON_FieldObject	6	/* nested struct, filled by the sub schema */
+
+/* A key hashed. */
+typedef struct cJSON_Key {
+	const char *string;
+	unsigned hash;
+} cJSON_Key;
+
+/* A path like "net.dns[1].addr", every step is a key or an array index. */
+typedef struct cJSON_Path {
+	int count;
+	struct {
+		cJSON_Key key;		/* key.string is 0 for an array index */
+		int index;
+	} step[cJSON_PATH_STEPS];
+	char text[cJSON_PATH_TEXT];
+} cJSON_Path;
+
+/* The hash table of the children of an object. */
+typedef struct cJSON_Index {
+	cJSON *object;
+	int size;			/* Slots of the table, power of 2. */
+	cJSON **slot;
+	unsigned *hash;
+} cJSON_Index;
+
+/* The indexes built on demand when the paths are searched in one tree. */
+typedef struct cJSON_IndexSet {
+	int count;
+	cJSON_Index *index[cJSON_INDEX_SET];
+} cJSON_IndexSet;
+
+/* A field of the C struct filled by cJSON_Extract. */
+typedef struct cJSON_Field {
+	const char *key;
+	int type;
+	size_t offset;			/* offsetof the member */
+	size_t size;			/* Bytes of the member for cJSON_FieldString. */
+	struct cJSON_Schema *sub;	/* The schema of the nested object for cJSON_FieldObject. */
+} cJSON_Field;
+
+/* The fields of the C struct, and the hash table of their keys. */
+typedef struct cJSON_Schema {
+	const cJSON_Field *field;
+	int count;
+	unsigned hash[cJSON_SCHEMA_FIELDS];
+	unsigned char slot[cJSON_SCHEMA_SLOTS];	/* field + 1, 0 is empty */
+} cJSON_Schema;
+
+/* Hash the key. The string is not copied. */
+extern void cJSON_InitKey(cJSON_Key *key,const char *string);
+/* Get item of the key from object, like cJSON_GetObjectItem. */
+extern cJSON *cJSON_GetObjectKey(cJSON *object,const cJSON_Key *key);
+
+/* Compile the text of a path. Returns 0 when successful, -1 when the text is malformed or too long. */
+extern int cJSON_CompilePath(cJSON_Path *path,const char *text);
+/* Get item of the path from root. set can be 0, otherwise large objects are indexed the first time they are searched. */
+extern cJSON *cJSON_GetPath(cJSON *root,const cJSON_Path *path,cJSON_IndexSet *set);
+
+/* Build the hash table of the children of object. Returns 0 when out of memory. The index is stale once the object is changed. */
+extern cJSON_Index *cJSON_CreateIndex(cJSON *object);
+extern cJSON *cJSON_GetIndexKey(const cJSON_Index *index,const cJSON_Key *key);
+extern void cJSON_DeleteIndex(cJSON_Index *index);
+/* Delete the indexes of the set, before the tree is deleted or changed. */
+extern void cJSON_DeleteIndexSet(cJSON_IndexSet *set);
+
+/* Hash the keys of the schema, the sub schemas are compiled by their own calls. Returns 0 when successful, -1 on too many fields. */
+extern int cJSON_CompileSchema(cJSON_Schema *schema,const cJSON_Field *field,int count);
+/* Fill out by the children of object in one pass. Returns the number of the fields filled, the others are left unchanged. */
+extern int cJSON_Extract(cJSON *object,const cJSON_Schema *schema,void *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
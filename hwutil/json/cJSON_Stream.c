@@ -0,0 +1,364 @@
+/*
+ * File         : cJSON_Stream.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-18       DongHeng        create
+ */
+
+/* Streaming parser and arena tree of cJSON. */
+
+#include "string.h"
+#include <math.h>
+#include "cJSON_Stream.h"
+
+/* The states of the stream. */
+enum {
+	S_VALUE,S_ARRAY_FIRST,S_OBJECT_FIRST,S_KEY,S_COLON,S_AFTER,
+	S_STRING,S_ESCAPE,S_UNICODE,S_SURROGATE,S_SURROGATE_U,
+	S_NUMBER,S_LITERAL,S_DONE,S_ERROR
+};
+
+static const char *const literal[3]={"false","true","null"};	/* by cJSON_False, cJSON_True and cJSON_NULL */
+static const unsigned char firstByteMark[7] = { 0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC };
+
+#define IS_SPACE(c)	((c)==' ' || (c)=='\t' || (c)=='\n' || (c)=='\r')
+
+void cJSON_StreamInit(cJSON_Stream *s,cJSON_Handler handler,void *user,char *buf,int size)
+{
+	memset(s,0,sizeof(cJSON_Stream));
+	s->handler=handler;s->user=user;
+	s->buf=buf;s->size=size;s->keylen=-1;
+	s->state=S_VALUE;s->error=-1;
+}
+
+void cJSON_StreamBuffer(cJSON_Stream *s,char *buf,int size)	{s->buf=buf;s->size=size;s->len=0;s->keylen=-1;}
+
+/* One byte is kept for the NUL ending the token. */
+static int stream_put(cJSON_Stream *s,int c)	{if (s->len>=s->size-1) return -1;s->buf[s->len++]=(char)c;return 0;}
+
+/* Parse the number like parse_number of cJSON.c, but the whole token must be a JSON number. */
+static int stream_number(const char *num,cJSON_Event *e)
+{
+	double n=0,sign=1,scale=0;int subscale=0,signsubscale=1;
+
+	if (*num=='-') sign=-1,num++;
+	if (*num=='0') num++;
+	else if (*num>='1' && *num<='9')	do	n=(n*10.0)+(*num++ -'0');	while (*num>='0' && *num<='9');
+	else return -1;
+	if (*num=='.')
+	{
+		num++;if (*num<'0' || *num>'9') return -1;
+		do	n=(n*10.0)+(*num++ -'0'),scale--; while (*num>='0' && *num<='9');
+	}
+	if (*num=='e' || *num=='E')
+	{	num++;if (*num=='+') num++;	else if (*num=='-') signsubscale=-1,num++;
+		if (*num<'0' || *num>'9') return -1;
+		while (*num>='0' && *num<='9') subscale=(subscale*10)+(*num++ - '0');
+	}
+	if (*num) return -1;
+
+	n=sign*n*pow(10.0,(scale+subscale*signsubscale));
+	e->valuedouble=n;
+	e->valueint=(int)n;
+	return 0;
+}
+
+/* Give the value ended to the handler, the token is dropped before, so the handler can move the buffer. */
+static int stream_emit(cJSON_Stream *s,int type,int depth)
+{
+	cJSON_Event e;int start=s->keylen>=0?s->keylen+1:0;
+
+	memset(&e,0,sizeof(e));
+	e.type=type;e.depth=depth;
+	if (s->keylen>=0) e.key=s->buf,e.keylength=s->keylen;
+	if (s->len<s->size) s->buf[s->len]=0;	/* the buffer can be empty for the containers and the literals */
+	if (type==cJSON_String)		e.valuestring=s->buf+start,e.length=s->len-start;
+	else if (type==cJSON_Number)	{if (stream_number(s->buf+start,&e)) return -1;}
+	else if (type==cJSON_True)	e.valueint=1;
+
+	s->len=0;s->keylen=-1;
+	return s->handler(s->user,&e)?-1:0;
+}
+
+/* The value of the current level is ended. */
+static void stream_after(cJSON_Stream *s)	{s->state=s->depth?S_AFTER:S_DONE;}
+
+static int stream_push(cJSON_Stream *s,int type)
+{
+	if (s->depth==cJSON_STREAM_DEPTH || stream_emit(s,type,s->depth)) return -1;
+	if (type==cJSON_Object)	s->object|=1u<<s->depth;
+	else			s->object&=~(1u<<s->depth);
+	s->depth++;
+	s->state=type==cJSON_Object?S_OBJECT_FIRST:S_ARRAY_FIRST;
+	return 0;
+}
+
+static int stream_pop(cJSON_Stream *s)
+{
+	s->depth--;
+	if (stream_emit(s,cJSON_EventEnd,s->depth)) return -1;
+	stream_after(s);
+	return 0;
+}
+
+/* Put the unicode char as UTF-8 like parse_string of cJSON.c. */
+static int stream_utf8(cJSON_Stream *s,unsigned uc)
+{
+	char out[4];int len=4,i;
+	if (uc<0x80) len=1;else if (uc<0x800) len=2;else if (uc<0x10000) len=3;
+	switch (len) {
+		case 4: out[3]=(char)((uc | 0x80) & 0xBF); uc >>= 6; /* fall through */
+		case 3: out[2]=(char)((uc | 0x80) & 0xBF); uc >>= 6; /* fall through */
+		case 2: out[1]=(char)((uc | 0x80) & 0xBF); uc >>= 6; /* fall through */
+		case 1: out[0]=(char)(uc | firstByteMark[len]);
+	}
+	for (i=0;i<len;i++) if (stream_put(s,out[i])) return -1;
+	return 0;
+}
+
+static int stream_hex(int c)
+{
+	if (c>='0' && c<='9') return c-'0';
+	if (c>='A' && c<='F') return 10+c-'A';
+	if (c>='a' && c<='f') return 10+c-'a';
+	return -1;
+}
+
+/* Parse one byte, returns -1 on errors. */
+static int stream_byte(cJSON_Stream *s,int c)
+{
+	int h;
+again:
+	switch (s->state)
+	{
+	case S_ARRAY_FIRST:
+		if (IS_SPACE(c)) return 0;
+		if (c==']') return stream_pop(s);
+		s->state=S_VALUE;
+		/* fall through */
+	case S_VALUE:
+		if (IS_SPACE(c)) return 0;
+		if (c=='{') return stream_push(s,cJSON_Object);
+		if (c=='[') return stream_push(s,cJSON_Array);
+		if (c=='\"') {s->state=S_STRING;s->next=0;return 0;}
+		if (c=='-' || (c>='0' && c<='9')) {s->state=S_NUMBER;return stream_put(s,c);}
+		for (h=0;h<3;h++) if (c==literal[h][0]) {s->state=S_LITERAL;s->uc=h;s->next=1;return 0;}
+		return -1;
+
+	case S_OBJECT_FIRST:
+		if (IS_SPACE(c)) return 0;
+		if (c=='}') return stream_pop(s);
+		/* fall through */
+	case S_KEY:
+		if (IS_SPACE(c)) return 0;
+		if (c!='\"') return -1;
+		s->state=S_STRING;s->next=1;
+		return 0;
+
+	case S_COLON:
+		if (IS_SPACE(c)) return 0;
+		if (c!=':') return -1;
+		s->state=S_VALUE;
+		return 0;
+
+	case S_AFTER:
+		if (IS_SPACE(c)) return 0;
+		if (s->object&(1u<<(s->depth-1)))
+		{
+			if (c==',') {s->state=S_KEY;return 0;}
+			if (c=='}') return stream_pop(s);
+		}
+		else
+		{
+			if (c==',') {s->state=S_VALUE;return 0;}
+			if (c==']') return stream_pop(s);
+		}
+		return -1;
+
+	case S_STRING:
+		if (c=='\"')
+		{
+			if (!s->next) {if (stream_emit(s,cJSON_String,s->depth)) return -1;stream_after(s);return 0;}
+			s->buf[s->len]=0;s->keylen=s->len++;	/* the key is kept before the value */
+			if (s->len>=s->size) return -1;
+			s->state=S_COLON;
+			return 0;
+		}
+		if (c=='\\') {s->state=S_ESCAPE;return 0;}
+		if ((unsigned char)c<0x20) return -1;
+		return stream_put(s,c);
+
+	case S_ESCAPE:
+		s->state=S_STRING;
+		switch (c)
+		{
+			case 'b': return stream_put(s,'\b');
+			case 'f': return stream_put(s,'\f');
+			case 'n': return stream_put(s,'\n');
+			case 'r': return stream_put(s,'\r');
+			case 't': return stream_put(s,'\t');
+			case '\"': case '\\': case '/': return stream_put(s,c);
+			case 'u': s->state=S_UNICODE;s->count=0;s->uc=0;return 0;
+		}
+		return -1;
+
+	case S_UNICODE:
+		if ((h=stream_hex(c))<0) return -1;
+		s->uc=(s->uc<<4)|h;
+		if (++s->count<4) return 0;
+		if (s->surrogate)
+		{
+			/* the second half of the surrogate */
+			if (s->uc<0xDC00 || s->uc>0xDFFF) return -1;
+			s->uc=0x10000 + (((s->surrogate&0x3FF)<<10) | (s->uc&0x3FF));
+			s->surrogate=0;
+		}
+		else if (s->uc>=0xD800 && s->uc<=0xDBFF)	{s->surrogate=s->uc;s->state=S_SURROGATE;return 0;}
+		if ((s->uc>=0xDC00 && s->uc<=0xDFFF) || s->uc==0) return -1;
+		s->state=S_STRING;
+		return stream_utf8(s,s->uc);
+
+	case S_SURROGATE:
+		if (c!='\\') return -1;
+		s->state=S_SURROGATE_U;
+		return 0;
+
+	case S_SURROGATE_U:
+		if (c!='u') return -1;
+		s->state=S_UNICODE;s->count=0;s->uc=0;
+		return 0;
+
+	case S_NUMBER:
+		if ((c>='0' && c<='9') || c=='.' || c=='e' || c=='E' || c=='+' || c=='-') return stream_put(s,c);
+		if (stream_emit(s,cJSON_Number,s->depth)) return -1;
+		stream_after(s);
+		goto again;		/* the byte ending the number is parsed at the next state */
+
+	case S_LITERAL:
+		if (c!=literal[s->uc][s->next]) return -1;
+		if (literal[s->uc][++s->next]) return 0;
+		if (stream_emit(s,(int)s->uc,s->depth)) return -1;
+		stream_after(s);
+		return 0;
+
+	case S_DONE:
+		return IS_SPACE(c)?0:-1;
+	}
+	return -1;
+}
+
+int cJSON_StreamFeed(cJSON_Stream *s,const char *chunk,int len)
+{
+	int i,n;
+	if (s->state==S_ERROR) return cJSON_StreamError;
+	for (i=0;i<len;i++,s->offset++)
+	{
+		if (s->state==S_STRING)
+		{
+			/* the plain bytes of the string are copied in one run */
+			for (n=i;n<len && chunk[n]!='\"' && chunk[n]!='\\' && (unsigned char)chunk[n]>=0x20;n++);
+			if (n-i>s->size-1-s->len) {s->offset+=s->size-1-s->len;goto error;}
+			memcpy(s->buf+s->len,chunk+i,n-i);s->len+=n-i;
+			s->offset+=n-i;i=n;
+			if (i==len) break;
+		}
+		if (stream_byte(s,chunk[i])) goto error;
+	}
+	return s->state==S_DONE?cJSON_StreamDone:cJSON_StreamMore;
+error:
+	s->state=S_ERROR;s->error=s->offset;
+	return cJSON_StreamError;
+}
+
+int cJSON_StreamEnd(cJSON_Stream *s)
+{
+	if (s->state==S_NUMBER && !s->depth)
+	{
+		if (stream_emit(s,cJSON_Number,0)) {s->state=S_ERROR;s->error=s->offset;return cJSON_StreamError;}
+		s->state=S_DONE;
+	}
+	if (s->state!=S_DONE) {if (s->state!=S_ERROR) s->state=S_ERROR,s->error=s->offset;return cJSON_StreamError;}
+	return cJSON_StreamDone;
+}
+
+/******************************************************************************/
+
+#define ARENA_ALIGN	8
+
+void cJSON_ArenaInit(cJSON_Arena *arena,void *mem,size_t size)
+{
+	/* the items hold doubles, so the memory is aligned to 8 bytes */
+	size_t skip=(ARENA_ALIGN-((unsigned long)mem&(ARENA_ALIGN-1)))&(ARENA_ALIGN-1);
+	arena->base=(char*)mem+skip;
+	arena->size=size>skip?size-skip:0;
+	arena->used=arena->peak=0;
+}
+
+void cJSON_ArenaReset(cJSON_Arena *arena)	{arena->used=0;}
+
+static int arena_free(const cJSON_Arena *arena)	{size_t n=arena->size-arena->used;return n>0x7FFFFFFF?0x7FFFFFFF:(int)n;}
+
+/* The token is at the free space of the arena, so the key and the string are taken without copying. */
+static int builder_handler(void *user,const cJSON_Event *e)
+{
+	cJSON_Builder *b=(cJSON_Builder*)user;cJSON_Arena *a=b->arena;cJSON *c,*p;
+	const char *end=0;
+
+	if (e->type==cJSON_EventEnd)	{cJSON_StreamBuffer(&b->stream,a->base+a->used,arena_free(a));return 0;}
+
+	if (e->valuestring)	end=e->valuestring+e->length+1;
+	else if (e->key)	end=e->key+e->keylength+1;
+	if (end) a->used=end-a->base;
+	a->used=(a->used+ARENA_ALIGN-1)&~(size_t)(ARENA_ALIGN-1);
+	if (a->used+sizeof(cJSON)>a->size) return -1;
+
+	c=(cJSON*)(a->base+a->used);a->used+=sizeof(cJSON);
+	if (a->used>a->peak) a->peak=a->used;
+	memset(c,0,sizeof(cJSON));
+	c->type=e->type;
+	c->string=(char*)e->key;c->valuestring=(char*)e->valuestring;
+	c->valueint=e->valueint;c->valuedouble=e->valuedouble;
+
+	if (!e->depth) b->root=c;
+	else
+	{
+		p=b->last[e->depth-1];
+		if (p) p->next=c,c->prev=p;
+		else b->parent[e->depth-1]->child=c;
+		b->last[e->depth-1]=c;
+	}
+	if (e->type==cJSON_Object || e->type==cJSON_Array) b->parent[e->depth]=c,b->last[e->depth]=0;
+
+	cJSON_StreamBuffer(&b->stream,a->base+a->used,arena_free(a));
+	return 0;
+}
+
+void cJSON_BuilderInit(cJSON_Builder *b,cJSON_Arena *arena)
+{
+	b->arena=arena;b->root=0;b->mark=arena->used;
+	cJSON_StreamInit(&b->stream,builder_handler,b,arena->base+arena->used,arena_free(arena));
+}
+
+int cJSON_BuilderFeed(cJSON_Builder *b,const char *chunk,int len)
+{
+	int ret=cJSON_StreamFeed(&b->stream,chunk,len);
+	if (ret==cJSON_StreamError) b->arena->used=b->mark;
+	return ret;
+}
+
+cJSON *cJSON_BuilderEnd(cJSON_Builder *b)
+{
+	if (cJSON_StreamEnd(&b->stream)!=cJSON_StreamDone) {b->arena->used=b->mark;return 0;}
+	return b->root;
+}
+
+cJSON *cJSON_ParseArena(cJSON_Arena *arena,const char *value)
+{
+	cJSON_Builder b;
+	cJSON_BuilderInit(&b,arena);
+	if (cJSON_BuilderFeed(&b,value,strlen(value))==cJSON_StreamError) return 0;
+	return cJSON_BuilderEnd(&b);
+}
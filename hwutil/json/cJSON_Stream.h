@@ -0,0 +1,123 @@
+/*
+ * File         : cJSON_Stream.h
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-18       DongHeng        create
+ */
+
+#ifndef cJSON_Stream__h
+#define cJSON_Stream__h
+
+#include "cJSON.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*
+ * Streaming parser of cJSON. The text is fed in chunks of any size, like the
+ * pbufs of a socket, and every value is given to the handler as soon as it
+ * ends, so the text is never held as a whole:
+ *
+ *   for (q = p; q; q = q->next) ret = cJSON_StreamFeed(&stream, q->payload, q->len);
+ *
+ * Only the key and the value being parsed are held, in the token buffer.
+ */
+
+/* The most levels of the nested objects and arrays. */
+#define cJSON_STREAM_DEPTH	32
+
+/* The events given to the handler, besides the value types of cJSON.h. */
+#define cJSON_EventEnd		16	/* The end of the object or the array of event->depth. */
+
+/* The results of cJSON_StreamFeed. */
+#define cJSON_StreamMore	0	/* The value is not ended, feed more. */
+#define cJSON_StreamDone	1	/* The value is ended, the rest of the chunk is only white space. */
+#define cJSON_StreamError	-1	/* Malformed text, the token is too long, or the handler aborts. */
+
+/* A value parsed. */
+typedef struct cJSON_Event {
+	int type;			/* cJSON_False ... cJSON_Object, or cJSON_EventEnd. cJSON_Array and cJSON_Object start the container. */
+	int depth;			/* 0 is the root value. */
+	const char *key;		/* The key in the object, 0 in an array. */
+	int keylength;
+	const char *valuestring;	/* The string of cJSON_String, ended with NUL. */
+	int length;			/* The bytes of the string. */
+	int valueint;
+	double valuedouble;
+} cJSON_Event;
+
+/* Returns 0 to go on, others to abort the parsing. The strings of the event are valid only in the handler. */
+typedef int (*cJSON_Handler)(void *user,const cJSON_Event *event);
+
+typedef struct cJSON_Stream {
+	cJSON_Handler handler;
+	void *user;
+	char *buf;			/* The token buffer, holding the key and the value being parsed. */
+	int size;
+	int len;
+	int keylen;			/* The bytes of the key at the buffer, -1 means no key. */
+	int state;
+	int next;			/* 1 when the string is a key, or the bytes of the literal matched. */
+	int count;			/* The hex digits of the \u escape parsed. */
+	unsigned uc,surrogate;		/* The \u escape being parsed, or the type of the literal. */
+	int depth;
+	unsigned object;		/* Bit n is set when level n + 1 is an object. */
+	int error;			/* The offset of the error since the stream is started. */
+	int offset;
+} cJSON_Stream;
+
+/* Start the parsing of one value. The token buffer must hold the longest key and string plus 2 bytes. */
+extern void cJSON_StreamInit(cJSON_Stream *stream,cJSON_Handler handler,void *user,char *buf,int size);
+/* Parse a chunk of the text. Returns cJSON_StreamMore, cJSON_StreamDone or cJSON_StreamError. */
+extern int cJSON_StreamFeed(cJSON_Stream *stream,const char *chunk,int len);
+/* The text is ended, a number at the root is ended by it. Returns cJSON_StreamDone or cJSON_StreamError. */
+extern int cJSON_StreamEnd(cJSON_Stream *stream);
+/* Move the token buffer, only in the handler. The token of the event is not needed any more then. */
+extern void cJSON_StreamBuffer(cJSON_Stream *stream,char *buf,int size);
+
+/*
+ * The arena of the tree. The items and their strings are allocated one by one
+ * from the memory, and the whole tree is freed by cJSON_ArenaReset. The items
+ * of the arena must not be deleted or changed by cJSON_Delete, cJSON_Detach*
+ * and cJSON_Replace*, but all getters and printers of cJSON work on them.
+ */
+typedef struct cJSON_Arena {
+	char *base;
+	size_t size;
+	size_t used;
+	size_t peak;
+} cJSON_Arena;
+
+/* Builds the tree from the events of a stream. */
+typedef struct cJSON_Builder {
+	cJSON_Stream stream;
+	cJSON_Arena *arena;
+	cJSON *root;
+	cJSON *parent[cJSON_STREAM_DEPTH + 1];	/* The container of every level. */
+	cJSON *last[cJSON_STREAM_DEPTH + 1];	/* The last child of every level. */
+	size_t mark;				/* The arena used before, it is rolled back on errors. */
+} cJSON_Builder;
+
+extern void cJSON_ArenaInit(cJSON_Arena *arena,void *mem,size_t size);
+/* Free all trees of the arena. */
+extern void cJSON_ArenaReset(cJSON_Arena *arena);
+
+/* Parse the text to a tree of the arena. Returns 0 on malformed text or out of the arena. */
+extern cJSON *cJSON_ParseArena(cJSON_Arena *arena,const char *value);
+
+/* Parse the text fed in chunks to a tree of the arena, the token buffer is the free space of the arena. */
+extern void cJSON_BuilderInit(cJSON_Builder *builder,cJSON_Arena *arena);
+extern int cJSON_BuilderFeed(cJSON_Builder *builder,const char *chunk,int len);
+/* Returns the root when the text is ended and the tree is built, otherwise 0 and the arena is rolled back. */
+extern cJSON *cJSON_BuilderEnd(cJSON_Builder *builder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
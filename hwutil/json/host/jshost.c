@@ -0,0 +1,141 @@
+/*
+ * File         : jshost.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-17       DongHeng        create
+ */
+
+/*
+ * the benchmark of the cJSON accessors at the Linux host, it runs the payloads
+ * of jsonbench.c, or looks up the paths in a JSON file:
+ *
+ *   gcc -O2 -I hwutil/fs/host -I hwutil/json -idirafter hwutil/kernel/include
+ *       hwutil/json/host/jshost.c hwutil/json/jsonbench.c
+ *       hwutil/json/cJSON.c hwutil/json/cJSON_Path.c
+ *       hwutil/json/cJSON_Stream.c -lm -o jshost
+ *
+ *   ./jshost                     run the lookup and the parse benchmarks of jsonbench.c
+ *   ./jshost file.json path...   time the lookup of the paths in the file
+ */
+
+#include "jsonbench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*@{*/
+
+/* the rounds of every benchmark */
+#define JSHOST_ROUNDS           100000
+
+/* the bytes of the payloads parsed */
+static const os_u32 jshost_parse[] = { 4 * 1024, 16 * 1024 };
+
+/*@}*/
+
+static char *jshost_load(const char *path)
+{
+    FILE *fp;
+    char *buf;
+    long len;
+
+    if (!(fp = fopen(path, "rb")))
+        return NULL;
+
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (len <= 0 || !(buf = malloc(len + 1)))
+    {
+        fclose(fp);
+        return NULL;
+    }
+
+    if (fread(buf, 1, len, fp) != (size_t)len)
+    {
+        free(buf);
+        buf = NULL;
+    }
+    else
+        buf[len] = 0;
+    fclose(fp);
+
+    return buf;
+}
+
+static void jshost_print(const char *name, const struct jsonbench_result *result)
+{
+    printf("%-8s %2lu paths, item %4lu ns, path %4lu ns, index %4lu ns, build %5lu ns\n", name,
+           (unsigned long)result->paths, (unsigned long)result->item_ns, (unsigned long)result->path_ns,
+           (unsigned long)result->index_ns, (unsigned long)result->build_ns);
+}
+
+int main(int argc, char *argv[])
+{
+    struct jsonbench_result config, status;
+    struct jsonbench_extract_result extract;
+    struct jsonbench_parse_result parse;
+    unsigned i;
+    char *text;
+    err_t err;
+
+    if (argc == 2)
+    {
+        fprintf(stderr, "usage: %s [file.json path...]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc > 2)
+    {
+        if (!(text = jshost_load(argv[1])))
+        {
+            fprintf(stderr, "load %s failed\n", argv[1]);
+            return 1;
+        }
+
+        err = jsonbench_lookup(text, (const char * const *)&argv[2], argc - 2, JSHOST_ROUNDS, &config);
+        free(text);
+        if (err)
+        {
+            fprintf(stderr, "benchmark failed (%d)\n", err);
+            return 1;
+        }
+
+        jshost_print(argv[1], &config);
+        return 0;
+    }
+
+    if ((err = jsonbench_run(JSHOST_ROUNDS, &config, &status, &extract)))
+    {
+        fprintf(stderr, "benchmark failed (%d)\n", err);
+        return 1;
+    }
+
+    jshost_print("config", &config);
+    jshost_print("status", &status);
+    printf("extract  %2lu fields, item %4lu ns, schema %4lu ns\n", (unsigned long)extract.fields,
+           (unsigned long)extract.item_ns, (unsigned long)extract.extract_ns);
+
+    for (i = 0; i < sizeof(jshost_parse) / sizeof(jshost_parse[0]); i++)
+    {
+        if ((err = jsonbench_parse(jshost_parse[i], JSHOST_ROUNDS / 100, &parse)))
+        {
+            fprintf(stderr, "benchmark failed (%d)\n", err);
+            return 1;
+        }
+
+        printf("parse    %5lu bytes, %4lu values\n", (unsigned long)parse.bytes, (unsigned long)parse.values);
+        printf("  cJSON_Parse %4lu us, %4lu heap ops, %6lu bytes\n", (unsigned long)parse.parse_us,
+               (unsigned long)parse.heap_ops, (unsigned long)parse.heap_peak);
+        printf("  arena       %4lu us, chunks %4lu us, %6lu bytes\n", (unsigned long)parse.arena_us,
+               (unsigned long)parse.chunk_us, (unsigned long)parse.arena_peak);
+        printf("  stream      %4lu us, %6lu bytes\n", (unsigned long)parse.stream_us,
+               (unsigned long)parse.stream_ram);
+    }
+
+    return 0;
+}
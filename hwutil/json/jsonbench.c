@@ -0,0 +1,652 @@
+/*
+ * File         : jsonbench.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-17       DongHeng        create
+ */
+
+#include "jsonbench.h"
+#include <stddef.h>
+#include "cJSON_Path.h"
+#include "cJSON_Stream.h"
+#include "time.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#if USING_SHELL
+#include "shell.h"
+#endif
+
+/*@{*/
+
+/* the rounds of the shell command */
+#define JSONBENCH_ROUNDS        200
+
+/* the bytes of the payloads parsed by the shell command */
+#define JSONBENCH_PARSE_SMALL   (4U * 1024)
+#define JSONBENCH_PARSE_LARGE   (16U * 1024)
+
+/* the most bytes of a record of the payload, and the token buffer of the stream */
+#define JSONBENCH_RECORD        160
+#define JSONBENCH_TOKEN         64
+
+/* the text is fed in the segments of the TCP */
+#define JSONBENCH_CHUNK         536U
+
+#define JSONBENCH_COUNT(a)      (sizeof(a) / sizeof((a)[0]))
+
+/* the configuration of the device, most keys are at the top object */
+const char jsonbench_config[] =
+    "{\"name\":\"gateway-0042\",\"id\":42,\"enable\":true,\"model\":\"F746G\",\"serial\":\"SN2016031700042\","
+    "\"interval\":1000,\"threshold\":12.75,\"timezone\":\"Asia/Shanghai\",\"locale\":\"zh_CN\","
+    "\"log_level\":3,\"log_size\":65536,\"log_path\":\"/log/gateway.log\",\"watchdog\":true,"
+    "\"retry\":5,\"retry_delay\":200,\"baud\":115200,\"parity\":\"none\",\"stop_bits\":1,"
+    "\"heartbeat\":30,\"cache_size\":4096,\"display\":{\"brightness\":80,\"rotate\":0,\"sleep\":300},"
+    "\"alarm\":{\"high\":85.5,\"low\":-20.0,\"hysteresis\":1.5},\"units\":\"metric\","
+    "\"ota\":{\"url\":\"https://ota.example.com/fw\",\"check\":86400,\"auto\":false},"
+    "\"net\":{\"dhcp\":false,\"ip\":\"192.168.1.42\",\"mask\":\"255.255.255.0\",\"gateway\":\"192.168.1.1\","
+    "\"mtu\":1500,\"mac\":\"00:80:E1:00:00:42\",\"hostname\":\"gateway-0042\",\"ntp\":\"pool.ntp.org\","
+    "\"dns\":[\"192.168.1.1\",\"8.8.8.8\",\"114.114.114.114\"],\"vlan\":0,\"speed\":100,\"duplex\":\"full\"},"
+    "\"mqtt\":{\"host\":\"mqtt.example.com\",\"port\":8883,\"keepalive\":60,\"qos\":1,\"tls\":true,"
+    "\"client\":\"gateway-0042\",\"topic\":\"site/1/gateway/42\"},"
+    "\"version\":\"1.4.2\",\"build\":\"2016-03-17\"}";
+
+/* the response of the REST API, the data is nested and holds an array of objects */
+const char jsonbench_status[] =
+    "{\"code\":0,\"msg\":\"ok\",\"time\":1458200000,\"data\":{\"uptime\":123456,\"load\":0.42,"
+    "\"heap_free\":81920,\"heap_min\":40960,\"threads\":12,\"cpu\":37,\"temp\":45.5,\"voltage\":3.29,"
+    "\"rssi\":-61,\"link\":true,\"errors\":0,\"resets\":2,\"reset_cause\":\"watchdog\","
+    "\"rx_bytes\":987654,\"tx_bytes\":456789,\"rx_drops\":3,\"tx_drops\":0,\"sd\":\"mounted\","
+    "\"sd_free\":1048576,\"flash_wear\":12,\"battery\":98,\"charging\":false,\"gps\":null,"
+    "\"fw\":{\"version\":\"1.4.2\",\"build\":\"2016-03-17\",\"crc\":\"9A3C55E1\"},"
+    "\"sensors\":[{\"id\":1,\"type\":\"temp\",\"value\":21.5,\"ok\":true},"
+    "{\"id\":2,\"type\":\"humidity\",\"value\":48.0,\"ok\":true},"
+    "{\"id\":3,\"type\":\"pressure\",\"value\":1013.2,\"ok\":true},"
+    "{\"id\":4,\"type\":\"co2\",\"value\":612,\"ok\":false}],"
+    "\"alarms\":0,\"mode\":\"auto\",\"schedule\":\"weekday\",\"next_report\":30,\"seq\":9876}}";
+
+/* the paths looked up in the payloads, the later keys of large objects are searched mostly */
+static const char * const jsonbench_config_paths[] =
+{
+    "name", "interval", "log_level", "heartbeat", "units", "version", "build",
+    "net.ip", "net.gateway", "net.dns[1]", "net.duplex", "mqtt.port", "mqtt.topic",
+    "ota.url", "alarm.high", "display.sleep"
+};
+
+static const char * const jsonbench_status_paths[] =
+{
+    "code", "data.uptime", "data.temp", "data.reset_cause", "data.battery", "data.seq",
+    "data.fw.version", "data.sensors[2].value", "data.sensors[3].ok", "data.next_report",
+    "data.mode", "data.alarms"
+};
+
+/* the struct filled from the configuration */
+struct jsonbench_net
+{
+    char        ip[16];
+    char        gateway[16];
+    int         dhcp;
+    int         mtu;
+};
+
+struct jsonbench_mqtt
+{
+    const char  *host;
+    int         port;
+    int         keepalive;
+    int         tls;
+};
+
+struct jsonbench_conf
+{
+    char        name[32];
+    int         id;
+    int         enable;
+    int         interval;
+    double      threshold;
+    const char  *timezone;
+    int         log_level;
+    int         retry;
+    int         heartbeat;
+    const char  *version;
+    struct jsonbench_net    net;
+    struct jsonbench_mqtt   mqtt;
+};
+
+static cJSON_Schema jsonbench_net_schema;
+static cJSON_Schema jsonbench_mqtt_schema;
+static cJSON_Schema jsonbench_conf_schema;
+
+static const cJSON_Field jsonbench_net_fields[] =
+{
+    {"ip",          cJSON_FieldString,      offsetof(struct jsonbench_net, ip),       16, 0},
+    {"gateway",     cJSON_FieldString,      offsetof(struct jsonbench_net, gateway),  16, 0},
+    {"dhcp",        cJSON_FieldBool,        offsetof(struct jsonbench_net, dhcp),     0,  0},
+    {"mtu",         cJSON_FieldInt,         offsetof(struct jsonbench_net, mtu),      0,  0}
+};
+
+static const cJSON_Field jsonbench_mqtt_fields[] =
+{
+    {"host",        cJSON_FieldStringPtr,   offsetof(struct jsonbench_mqtt, host),      0, 0},
+    {"port",        cJSON_FieldInt,         offsetof(struct jsonbench_mqtt, port),      0, 0},
+    {"keepalive",   cJSON_FieldInt,         offsetof(struct jsonbench_mqtt, keepalive), 0, 0},
+    {"tls",         cJSON_FieldBool,        offsetof(struct jsonbench_mqtt, tls),       0, 0}
+};
+
+static const cJSON_Field jsonbench_conf_fields[] =
+{
+    {"name",        cJSON_FieldString,      offsetof(struct jsonbench_conf, name),      32, 0},
+    {"id",          cJSON_FieldInt,         offsetof(struct jsonbench_conf, id),        0,  0},
+    {"enable",      cJSON_FieldBool,        offsetof(struct jsonbench_conf, enable),    0,  0},
+    {"interval",    cJSON_FieldInt,         offsetof(struct jsonbench_conf, interval),  0,  0},
+    {"threshold",   cJSON_FieldDouble,      offsetof(struct jsonbench_conf, threshold), 0,  0},
+    {"timezone",    cJSON_FieldStringPtr,   offsetof(struct jsonbench_conf, timezone),  0,  0},
+    {"log_level",   cJSON_FieldInt,         offsetof(struct jsonbench_conf, log_level), 0,  0},
+    {"retry",       cJSON_FieldInt,         offsetof(struct jsonbench_conf, retry),     0,  0},
+    {"heartbeat",   cJSON_FieldInt,         offsetof(struct jsonbench_conf, heartbeat), 0,  0},
+    {"version",     cJSON_FieldStringPtr,   offsetof(struct jsonbench_conf, version),   0,  0},
+    {"net",         cJSON_FieldObject,      offsetof(struct jsonbench_conf, net),       0,  &jsonbench_net_schema},
+    {"mqtt",        cJSON_FieldObject,      offsetof(struct jsonbench_conf, mqtt),      0,  &jsonbench_mqtt_schema}
+};
+
+/*@}*/
+
+/*
+ * jsonbench_ns - get the current time in nanosecond
+ */
+static os_u64 jsonbench_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (os_u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * jsonbench_per - get the time costs of every operation in nanosecond
+ */
+static os_u32 jsonbench_per(os_u64 start, os_u32 rounds, os_u32 count)
+{
+    return (os_u32)((jsonbench_ns() - start) / ((os_u64)rounds * count));
+}
+
+/*
+ * jsonbench_walk - look up the compiled path step by step as the application
+ *                  does without it, every key is searched by cJSON_GetObjectItem
+ */
+static cJSON *jsonbench_walk(cJSON *root, const cJSON_Path *path)
+{
+    int i;
+
+    for (i = 0; root && i < path->count; i++)
+    {
+        if (path->step[i].key.string)
+            root = cJSON_GetObjectItem(root, path->step[i].key.string);
+        else
+            root = cJSON_GetArrayItem(root, path->step[i].index);
+    }
+
+    return root;
+}
+
+/**
+ * jsonbench_lookup - the function will look up the paths in the text by
+ *                    cJSON_GetObjectItem, the compiled paths and the indexes
+ *
+ * @param text the JSON text
+ * @param paths the paths looked up
+ * @param count the number of the paths
+ * @param rounds the rounds of looking up all paths
+ * @param result the result
+ *
+ * @return the result
+ */
+err_t jsonbench_lookup(const char *text, const char * const *paths, os_u32 count, os_u32 rounds,
+                       struct jsonbench_result *result)
+{
+    cJSON_IndexSet set;
+    cJSON_Path *compiled;
+    cJSON *root, *item;
+    os_u64 start;
+    os_u32 i, round;
+    err_t ret = 0;
+
+    if (!text || !paths || !count || !rounds || !result)
+        return -EINVAL;
+
+    if (!(root = cJSON_Parse(text)))
+        return -EBADMSG;
+
+    if (!(compiled = malloc(count * sizeof(cJSON_Path))))
+    {
+        cJSON_Delete(root);
+        return -ENOMEM;
+    }
+
+    set.count = 0;
+
+    /* all ways must find the same item before they are timed */
+    for (i = 0; i < count; i++)
+    {
+        if (cJSON_CompilePath(&compiled[i], paths[i]))
+        {
+            ret = -EINVAL;
+            goto out;
+        }
+
+        item = jsonbench_walk(root, &compiled[i]);
+        if (!item || cJSON_GetPath(root, &compiled[i], NULL) != item ||
+            cJSON_GetPath(root, &compiled[i], &set) != item)
+        {
+            ret = -EBADMSG;
+            goto out;
+        }
+    }
+
+    result->paths = count;
+
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+        for (i = 0; i < count; i++)
+            jsonbench_walk(root, &compiled[i]);
+    result->item_ns = jsonbench_per(start, rounds, count);
+
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+        for (i = 0; i < count; i++)
+            cJSON_GetPath(root, &compiled[i], NULL);
+    result->path_ns = jsonbench_per(start, rounds, count);
+
+    /* the indexes are built once for every message parsed, and kept while it is looked up */
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+    {
+        cJSON_DeleteIndexSet(&set);
+        for (i = 0; i < count; i++)
+            cJSON_GetPath(root, &compiled[i], &set);
+    }
+    result->build_ns = jsonbench_per(start, rounds, 1);
+
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+        for (i = 0; i < count; i++)
+            cJSON_GetPath(root, &compiled[i], &set);
+    result->index_ns = jsonbench_per(start, rounds, count);
+
+out:
+    cJSON_DeleteIndexSet(&set);
+    free(compiled);
+    cJSON_Delete(root);
+
+    return ret;
+}
+
+/*
+ * jsonbench_copy - copy the string to the member like cJSON_FieldString
+ */
+static void jsonbench_copy(char *member, size_t size, cJSON *item)
+{
+    size_t len;
+
+    if (!item || item->type != cJSON_String)
+        return ;
+
+    len = strlen(item->valuestring);
+    if (len >= size)
+        len = size - 1;
+    memcpy(member, item->valuestring, len);
+    member[len] = 0;
+}
+
+static void jsonbench_int(int *member, cJSON *item)
+{
+    if (item && (item->type == cJSON_Number))
+        *member = item->valueint;
+    else if (item && (item->type == cJSON_True || item->type == cJSON_False))
+        *member = (item->type == cJSON_True);
+}
+
+static void jsonbench_ptr(const char **member, cJSON *item)
+{
+    if (item && item->type == cJSON_String)
+        *member = item->valuestring;
+}
+
+/*
+ * jsonbench_fill - fill the struct as the application does without the schema
+ */
+static void jsonbench_fill(cJSON *root, struct jsonbench_conf *conf)
+{
+    cJSON *net, *mqtt, *item;
+
+    jsonbench_copy(conf->name, sizeof(conf->name), cJSON_GetObjectItem(root, "name"));
+    jsonbench_int(&conf->id, cJSON_GetObjectItem(root, "id"));
+    jsonbench_int(&conf->enable, cJSON_GetObjectItem(root, "enable"));
+    jsonbench_int(&conf->interval, cJSON_GetObjectItem(root, "interval"));
+    if ((item = cJSON_GetObjectItem(root, "threshold")) && item->type == cJSON_Number)
+        conf->threshold = item->valuedouble;
+    jsonbench_ptr(&conf->timezone, cJSON_GetObjectItem(root, "timezone"));
+    jsonbench_int(&conf->log_level, cJSON_GetObjectItem(root, "log_level"));
+    jsonbench_int(&conf->retry, cJSON_GetObjectItem(root, "retry"));
+    jsonbench_int(&conf->heartbeat, cJSON_GetObjectItem(root, "heartbeat"));
+    jsonbench_ptr(&conf->version, cJSON_GetObjectItem(root, "version"));
+
+    if ((net = cJSON_GetObjectItem(root, "net")))
+    {
+        jsonbench_copy(conf->net.ip, sizeof(conf->net.ip), cJSON_GetObjectItem(net, "ip"));
+        jsonbench_copy(conf->net.gateway, sizeof(conf->net.gateway), cJSON_GetObjectItem(net, "gateway"));
+        jsonbench_int(&conf->net.dhcp, cJSON_GetObjectItem(net, "dhcp"));
+        jsonbench_int(&conf->net.mtu, cJSON_GetObjectItem(net, "mtu"));
+    }
+
+    if ((mqtt = cJSON_GetObjectItem(root, "mqtt")))
+    {
+        jsonbench_ptr(&conf->mqtt.host, cJSON_GetObjectItem(mqtt, "host"));
+        jsonbench_int(&conf->mqtt.port, cJSON_GetObjectItem(mqtt, "port"));
+        jsonbench_int(&conf->mqtt.keepalive, cJSON_GetObjectItem(mqtt, "keepalive"));
+        jsonbench_int(&conf->mqtt.tls, cJSON_GetObjectItem(mqtt, "tls"));
+    }
+}
+
+/**
+ * jsonbench_extract - the function will fill the struct from the configuration
+ *                     by cJSON_GetObjectItem and cJSON_Extract
+ *
+ * @param rounds the rounds of filling the struct
+ * @param result the result
+ *
+ * @return the result
+ */
+err_t jsonbench_extract(os_u32 rounds, struct jsonbench_extract_result *result)
+{
+    struct jsonbench_conf item_conf, extract_conf;
+    cJSON *root;
+    os_u64 start;
+    os_u32 round;
+    err_t ret = 0;
+
+    if (!rounds || !result)
+        return -EINVAL;
+
+    if (cJSON_CompileSchema(&jsonbench_net_schema, jsonbench_net_fields, JSONBENCH_COUNT(jsonbench_net_fields)) ||
+        cJSON_CompileSchema(&jsonbench_mqtt_schema, jsonbench_mqtt_fields, JSONBENCH_COUNT(jsonbench_mqtt_fields)) ||
+        cJSON_CompileSchema(&jsonbench_conf_schema, jsonbench_conf_fields, JSONBENCH_COUNT(jsonbench_conf_fields)))
+        return -EINVAL;
+
+    if (!(root = cJSON_Parse(jsonbench_config)))
+        return -EBADMSG;
+
+    /* both ways must fill the same struct before they are timed */
+    memset(&item_conf, 0, sizeof(item_conf));
+    memset(&extract_conf, 0, sizeof(extract_conf));
+    jsonbench_fill(root, &item_conf);
+    result->fields = cJSON_Extract(root, &jsonbench_conf_schema, &extract_conf);
+    if (result->fields != JSONBENCH_COUNT(jsonbench_conf_fields) ||
+        memcmp((const char *)&item_conf, (const char *)&extract_conf, sizeof(item_conf)))
+    {
+        ret = -EBADMSG;
+        goto out;
+    }
+
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+        jsonbench_fill(root, &item_conf);
+    result->item_ns = jsonbench_per(start, rounds, 1);
+
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+        cJSON_Extract(root, &jsonbench_conf_schema, &extract_conf);
+    result->extract_ns = jsonbench_per(start, rounds, 1);
+
+out:
+    cJSON_Delete(root);
+
+    return ret;
+}
+
+/* the heap used by cJSON_Parse, every block is prefixed by its size */
+static os_u32 jsonbench_heap_ops;
+static os_u32 jsonbench_heap_used;
+static os_u32 jsonbench_heap_peak;
+
+static void *jsonbench_malloc(size_t size)
+{
+    size_t *block;
+
+    if (!(block = malloc(size + sizeof(double))))
+        return NULL;
+
+    *block = size;
+    jsonbench_heap_ops++;
+    jsonbench_heap_used += size;
+    if (jsonbench_heap_used > jsonbench_heap_peak)
+        jsonbench_heap_peak = jsonbench_heap_used;
+
+    return (char *)block + sizeof(double);
+}
+
+static void jsonbench_free(void *ptr)
+{
+    size_t *block = (size_t *)((char *)ptr - sizeof(double));
+
+    jsonbench_heap_ops++;
+    jsonbench_heap_used -= *block;
+    free(block);
+}
+
+/*
+ * jsonbench_payload - build the response of bytes like a list of the REST API
+ */
+static char *jsonbench_payload(os_u32 bytes)
+{
+    char *text, *p;
+    os_u32 id;
+
+    if (!(text = malloc(bytes + JSONBENCH_RECORD)))
+        return NULL;
+
+    p = text + sprintf(text, "{\"code\":0,\"msg\":\"ok\",\"items\":[");
+    for (id = 0; (os_u32)(p - text) < bytes; id++)
+        p += sprintf(p, "%s{\"id\":%d,\"name\":\"sensor-%04d\",\"type\":\"temp\",\"value\":%d.%d,"
+                        "\"ok\":%s,\"tags\":[\"site-1\",\"floor-%d\"]}",
+                     id ? "," : "", (int)id, (int)id, 20 + (int)(id % 10), (int)(id % 7),
+                     (id % 5) ? "true" : "false", (int)(id % 4));
+    sprintf(p, "]}");
+
+    return text;
+}
+
+/* the handler counts the values like the application picking them up */
+static int jsonbench_count(void *user, const cJSON_Event *event)
+{
+    if (event->type != cJSON_EventEnd)
+        (*(os_u32 *)user)++;
+
+    return 0;
+}
+
+/**
+ * jsonbench_parse - the function will parse the payload of bytes by cJSON_Parse,
+ *                   the arena and the stream
+ *
+ * @param bytes the bytes of the payload
+ * @param rounds the rounds of every parse
+ * @param result the result
+ *
+ * @return the result
+ */
+err_t jsonbench_parse(os_u32 bytes, os_u32 rounds, struct jsonbench_parse_result *result)
+{
+    char token[JSONBENCH_TOKEN];
+    cJSON_Hooks hooks = { jsonbench_malloc, jsonbench_free };
+    cJSON_Builder builder;
+    cJSON_Stream stream;
+    cJSON_Arena arena;
+    os_u32 len, round, i, values;
+    os_u64 start;
+    cJSON *root;
+    char *text, *mem = NULL;
+    err_t ret = 0;
+
+    if (!bytes || !rounds || !result)
+        return -EINVAL;
+
+    if (!(text = jsonbench_payload(bytes)))
+        return -ENOMEM;
+    len = strlen(text);
+
+    memset(result, 0, sizeof(*result));
+    result->bytes = len;
+    result->stream_ram = sizeof(stream) + sizeof(token);
+
+    /* the heap of one parse */
+    jsonbench_heap_ops = jsonbench_heap_used = jsonbench_heap_peak = 0;
+    cJSON_InitHooks(&hooks);
+    root = cJSON_Parse(text);
+    cJSON_Delete(root);
+    cJSON_InitHooks(NULL);
+    result->heap_ops = jsonbench_heap_ops;
+    result->heap_peak = jsonbench_heap_peak;
+
+    /* the arena holds the same items and strings, only aligned to 8 bytes */
+    if (!(mem = malloc(result->heap_peak + result->heap_ops * 4)))
+    {
+        ret = -ENOMEM;
+        goto out;
+    }
+    cJSON_ArenaInit(&arena, mem, result->heap_peak + result->heap_ops * 4);
+
+    cJSON_StreamInit(&stream, jsonbench_count, &result->values, token, sizeof(token));
+    if (!root || cJSON_StreamFeed(&stream, text, len) == cJSON_StreamError ||
+        cJSON_StreamEnd(&stream) != cJSON_StreamDone || !cJSON_ParseArena(&arena, text))
+    {
+        ret = -EBADMSG;
+        goto out;
+    }
+    result->arena_peak = arena.peak;
+
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+        cJSON_Delete(cJSON_Parse(text));
+    result->parse_us = jsonbench_per(start, rounds, 1000);
+
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+    {
+        cJSON_ArenaReset(&arena);
+        cJSON_ParseArena(&arena, text);
+    }
+    result->arena_us = jsonbench_per(start, rounds, 1000);
+
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+    {
+        values = 0;
+        cJSON_StreamInit(&stream, jsonbench_count, &values, token, sizeof(token));
+        cJSON_StreamFeed(&stream, text, len);
+        cJSON_StreamEnd(&stream);
+    }
+    result->stream_us = jsonbench_per(start, rounds, 1000);
+
+    /* the text comes in the segments of the TCP */
+    start = jsonbench_ns();
+    for (round = 0; round < rounds; round++)
+    {
+        cJSON_ArenaReset(&arena);
+        cJSON_BuilderInit(&builder, &arena);
+        for (i = 0; i < len; i += JSONBENCH_CHUNK)
+            cJSON_BuilderFeed(&builder, text + i, len - i < JSONBENCH_CHUNK ? len - i : JSONBENCH_CHUNK);
+        if (!cJSON_BuilderEnd(&builder))
+            ret = -EBADMSG;
+    }
+    result->chunk_us = jsonbench_per(start, rounds, 1000);
+
+out:
+    free(mem);
+    free(text);
+
+    return ret;
+}
+
+/**
+ * jsonbench_run - the function will run all benchmarks at the payloads
+ *
+ * @param rounds the rounds of every benchmark
+ * @param config the lookup result of the configuration
+ * @param status the lookup result of the REST response
+ * @param extract the extract result of the configuration
+ *
+ * @return the result
+ */
+err_t jsonbench_run(os_u32 rounds, struct jsonbench_result *config,
+                    struct jsonbench_result *status, struct jsonbench_extract_result *extract)
+{
+    err_t ret;
+
+    if ((ret = jsonbench_lookup(jsonbench_config, jsonbench_config_paths,
+                                JSONBENCH_COUNT(jsonbench_config_paths), rounds, config)))
+        return ret;
+
+    if ((ret = jsonbench_lookup(jsonbench_status, jsonbench_status_paths,
+                                JSONBENCH_COUNT(jsonbench_status_paths), rounds, status)))
+        return ret;
+
+    return jsonbench_extract(rounds, extract);
+}
+
+/******************************************************************************/
+
+#if USING_SHELL
+
+static void jsonbench(struct shell_dev *shell_dev)
+{
+    struct jsonbench_result config, status;
+    struct jsonbench_extract_result extract;
+    err_t ret;
+
+    if ((ret = jsonbench_run(JSONBENCH_ROUNDS, &config, &status, &extract)))
+    {
+        shell_printk(shell_dev, "\r\nbenchmark failed (%d)\r\n", ret);
+        return ;
+    }
+
+    shell_printk(shell_dev, "\r\nconfig %d paths, item %d ns, path %d ns, index %d ns, build %d ns",
+                            config.paths, config.item_ns, config.path_ns, config.index_ns, config.build_ns);
+    shell_printk(shell_dev, "\r\nstatus %d paths, item %d ns, path %d ns, index %d ns, build %d ns",
+                            status.paths, status.item_ns, status.path_ns, status.index_ns, status.build_ns);
+    shell_printk(shell_dev, "\r\nextract %d fields, item %d ns, schema %d ns\r\n",
+                            extract.fields, extract.item_ns, extract.extract_ns);
+}
+SHELL_CMD_EXPORT(jsonbench, lookup time of cJSON by the key and the compiled path, 1);
+
+static void jsonparse(struct shell_dev *shell_dev)
+{
+    static const os_u32 bytes[] = { JSONBENCH_PARSE_SMALL, JSONBENCH_PARSE_LARGE };
+    struct jsonbench_parse_result result;
+    os_u32 i;
+    err_t ret;
+
+    for (i = 0; i < JSONBENCH_COUNT(bytes); i++)
+    {
+        if ((ret = jsonbench_parse(bytes[i], JSONBENCH_ROUNDS / 10, &result)))
+        {
+            shell_printk(shell_dev, "\r\nbenchmark failed (%d)\r\n", ret);
+            return ;
+        }
+
+        shell_printk(shell_dev, "\r\n%d bytes, %d values", result.bytes, result.values);
+        shell_printk(shell_dev, "\r\ncJSON_Parse %d us, %d heap ops, %d bytes",
+                                result.parse_us, result.heap_ops, result.heap_peak);
+        shell_printk(shell_dev, "\r\narena %d us, chunks %d us, %d bytes",
+                                result.arena_us, result.chunk_us, result.arena_peak);
+        shell_printk(shell_dev, "\r\nstream %d us, %d bytes\r\n", result.stream_us, result.stream_ram);
+    }
+}
+SHELL_CMD_EXPORT(jsonparse, parse time and memory of cJSON by the heap the arena and the stream, 1);
+
+#endif
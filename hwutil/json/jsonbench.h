@@ -0,0 +1,65 @@
+#ifndef _JSONBENCH_H_
+#define _JSONBENCH_H_
+
+#include "rtos.h"
+
+/* the result of the lookup benchmark */
+struct jsonbench_result
+{
+    /* the paths looked up every round */
+    os_u32      paths;
+
+    /* the time costs in nanosecond of every lookup by cJSON_GetObjectItem, the compiled path and the index */
+    os_u32      item_ns;
+    os_u32      path_ns;
+    os_u32      index_ns;
+
+    /* the time costs in nanosecond of building the indexes of all paths once */
+    os_u32      build_ns;
+};
+
+/* the result of the extract benchmark */
+struct jsonbench_extract_result
+{
+    /* the fields filled */
+    os_u32      fields;
+
+    /* the time costs in nanosecond of filling the whole struct by cJSON_GetObjectItem and cJSON_Extract */
+    os_u32      item_ns;
+    os_u32      extract_ns;
+};
+
+/* the result of the parse benchmark */
+struct jsonbench_parse_result
+{
+    /* the bytes of the text and the values parsed */
+    os_u32      bytes;
+    os_u32      values;
+
+    /* the heap operations and the most bytes allocated by cJSON_Parse */
+    os_u32      heap_ops;
+    os_u32      heap_peak;
+
+    /* the most bytes of the arena, and the bytes held by the stream */
+    os_u32      arena_peak;
+    os_u32      stream_ram;
+
+    /* the time costs in microsecond of every parse by cJSON_Parse, the arena, the stream, and the arena fed in chunks */
+    os_u32      parse_us;
+    os_u32      arena_us;
+    os_u32      stream_us;
+    os_u32      chunk_us;
+};
+
+/* the payloads of the benchmark */
+extern const char jsonbench_config[];
+extern const char jsonbench_status[];
+
+err_t jsonbench_lookup(const char *text, const char * const *paths, os_u32 count, os_u32 rounds,
+                       struct jsonbench_result *result);
+err_t jsonbench_extract(os_u32 rounds, struct jsonbench_extract_result *result);
+err_t jsonbench_parse(os_u32 bytes, os_u32 rounds, struct jsonbench_parse_result *result);
+err_t jsonbench_run(os_u32 rounds, struct jsonbench_result *config,
+                    struct jsonbench_result *status, struct jsonbench_extract_result *extract);
+
+#endif
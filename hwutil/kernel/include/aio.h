@@ -3,5 +3,61 @@
 
 #include "rtos.h"
 #include "unistd.h"
+#include "pthread.h"
+#include "time.h"
+
+/* the return value of aio_cancel */
+#define AIO_CANCELED            0
+#define AIO_NOTCANCELED         1
+#define AIO_ALLDONE             2
+
+/* the mode of lio_listio */
+#define LIO_WAIT                0
+#define LIO_NOWAIT              1
+
+/* the operation of the lio_listio element */
+#define LIO_READ                0
+#define LIO_WRITE               1
+#define LIO_NOP                 2
+
+/* the structure description of the asynchronous I/O control block */
+struct aiocb
+{
+    /* the file handle */
+    int                         aio_fildes;
+    
+    /* the file offset */
+    loff_t                      aio_offset;
+    
+    /* the buffer and its bytes */
+    volatile void               *aio_buf;
+    size_t                      aio_nbytes;
+    
+    /* the request priority, not used now */
+    int                         aio_reqprio;
+    
+    /* the notification when the operation is completed */
+    struct sigevent             aio_sigevent;
+    
+    /* the operation of lio_listio */
+    int                         aio_lio_opcode;
+    
+    /** the kernel private data **/
+    list_t                      __list;
+    os_pthread_t                *__owner;
+    void                        *__lio;
+    volatile int                __error;
+    volatile ssize_t            __return;
+};
+
+int aio_init (void);
+
+int aio_read (struct aiocb *aiocbp);
+int aio_write (struct aiocb *aiocbp);
+int aio_error (const struct aiocb *aiocbp);
+ssize_t aio_return (struct aiocb *aiocbp);
+int aio_cancel (int fildes, struct aiocb *aiocbp);
+int aio_suspend (const struct aiocb *const list[], int nent, const struct timespec *timeout);
+int lio_listio (int mode, struct aiocb *RESTRICT const list[], int nent, struct sigevent *RESTRICT sig);
 
 #endif
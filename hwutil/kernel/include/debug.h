@@ -2,6 +2,7 @@
 #define _DEBUG_H_
 
 #include "stdio.h"
+#include "klog.h"
 
 /* assert signal result */
 #define ASSERT_KERNEL(signal)                                                         \
@@ -9,6 +10,7 @@
     if (!(signal))                                                                    \
     {                                                                                 \
         volatile bool dummy = true;                                                   \
+        klog_panic();                                                                 \
         printk("(%s) assert failed at %s:%d .\r\n", #signal, __FUNCTION__, __LINE__); \
         while(true == dummy);                                                         \
     }                                                                                 \
@@ -0,0 +1,23 @@
+#ifndef _EDFSIM_H_
+#define _EDFSIM_H_
+
+#include "rtos.h"
+
+/* the most tasks of a task set */
+#define EDFSIM_TASKS_MAX        16
+
+/* the result of the task sets of a utilization */
+struct edfsim_result
+{
+    /* the task sets simulated and their mean utilization in 1/1000 */
+    os_u32      sets;
+    os_u32      util;
+
+    /* the task sets without a deadline miss by the rate monotonic priorities and by EDF */
+    os_u32      rm_ok;
+    os_u32      edf_ok;
+};
+
+err_t edfsim_run(os_u32 util, os_u32 tasks, os_u32 sets, os_u32 seed, struct edfsim_result *result);
+
+#endif
@@ -127,6 +127,7 @@
 #define EDQUOT          122 /* Quota exceeded */
 #define ENOMEDIUM       123 /* No medium found */
 #define EMEDIUMTYPE     124 /* Wrong medium type */
+#define ECANCELED       125 /* Operation Canceled */
 
 #define MAX_ERRNO       4096
 
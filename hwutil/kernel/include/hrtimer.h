@@ -0,0 +1,79 @@
+#ifndef _HRTIMER_H_
+#define _HRTIMER_H_
+
+#include "list.h"
+#include "time.h"
+
+/* the callback of the timer runs at the interrupt of the device */
+#define HRTIMER_MODE_ISR            0
+
+/* the callback of the timer runs at the hrtimer thread */
+#define HRTIMER_MODE_THREAD         1
+
+struct hrtimer;
+typedef void (*hrtimer_func_t)(struct hrtimer *timer);
+
+struct hrtimer
+{
+    /* timer's node at the queue sorted by the expiry, it is empty when the timer is not queued */
+    list_t              list;
+
+    /* timer's node at the list of the thread, it is empty when the callback is not pending */
+    list_t              work;
+
+    /* the absolute expiry of CLOCK_MONOTONIC and the reload interval in nanosecond, the interval 0 means one shot */
+    os_u64              expire;
+    os_u64              interval;
+
+    /* the periods missed since the callback ran last time */
+    os_u32              overrun;
+
+    int                 mode;
+    hrtimer_func_t      func;
+    void                *arg;
+};
+
+/*
+ * the one shot event device of the hrtimer, it is a spare hardware timer of
+ * the board, the hrtimer programs only the earliest expiry to it
+ */
+struct hrtimer_dev
+{
+    const char          *name;
+
+    /* the shortest and the longest event in nanosecond */
+    os_u32              min_ns;
+    os_u32              max_ns;
+
+    /* call hrtimer_interrupt once after the nanoseconds, the event set before is replaced */
+    void                (*set_event)(os_u32 ns);
+
+    /* cancel the event set */
+    void                (*stop)(void);
+};
+
+/* the counters of the hrtimer */
+struct hrtimer_stat
+{
+    /* the events programmed to the device and the interrupts of them */
+    os_u32              events;
+    os_u32              interrupts;
+
+    /* the callbacks run and the periods missed */
+    os_u32              expired;
+    os_u32              overruns;
+
+    /* the latest expiry of a callback in nanosecond */
+    os_u32              max_late_ns;
+};
+
+int hrtimer_system_init(void);
+int hrtimer_register(const struct hrtimer_dev *dev);
+void hrtimer_interrupt(void);
+
+void hrtimer_init(struct hrtimer *timer, hrtimer_func_t func, void *arg, int mode);
+int hrtimer_start(struct hrtimer *timer, const struct timespec *value, const struct timespec *interval, int flags);
+int hrtimer_cancel(struct hrtimer *timer);
+void hrtimer_get_stat(struct hrtimer_stat *stat);
+
+#endif
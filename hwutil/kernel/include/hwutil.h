@@ -44,7 +44,38 @@
 #ifndef hw_interrupt_recover
     extern void hw_interrupt_recover(phys_reg_t temp);
 #endif
+
+/* the free running cycle counter of the cpu, it is started by the board with the core clock */
+#ifndef hw_cycle_init
+    extern err_t hw_cycle_init(os_u32 freq);
+#endif
+
+#ifndef hw_cycle_get
+    extern os_u32 hw_cycle_get(void);
+#endif
+
+/* the frequency of the cycle counter in Hz, 0 means it is not started */
+#ifndef hw_cycle_freq
+    extern os_u32 hw_cycle_freq(void);
+#endif
+    
+/* guard the bytes of PTHREAD_STACK_GUARD_SIZE at the address by the MPU, the board with the MPU defines the size */
+#ifndef hw_stack_guard
+    extern void hw_stack_guard(char *addr);
+#endif
     
+/* count the leading zero bits of the word, the word must not be 0 */
+#ifndef hw_clz
+    #if defined (__IAR_SYSTEMS_ICC__)
+        #include <intrinsics.h>
+        #define hw_clz(x)               __CLZ(x)
+    #elif defined (__CC_ARM)
+        #define hw_clz(x)               __clz(x)
+    #elif defined (__GNUC__)
+        #define hw_clz(x)               __builtin_clz(x)
+    #endif
+#endif
+
 #ifndef SCHED_CYCLE
     #define SCHED_PERIOD 1000
 #endif
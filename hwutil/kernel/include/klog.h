@@ -0,0 +1,38 @@
+#ifndef _KLOG_H_
+#define _KLOG_H_
+
+#include "rtos.h"
+#include "stdio.h"
+
+/* the lines of the ring, it must be a power of 2 */
+#ifndef KLOG_LINE_NUM
+    #define KLOG_LINE_NUM               16
+#endif
+
+/* the bytes of a line formatted, it is the buffer printk had before the ring */
+#ifndef KLOG_LINE_SIZE
+    #define KLOG_LINE_SIZE              256
+#endif
+
+/* the counters of the log */
+struct klog_stat
+{
+    /* the lines written to the ring and the lines dropped as the ring is full */
+    os_u32              lines;
+    os_u32              lost;
+
+    /* the lines at the ring now and the most lines at it */
+    os_u32              pending;
+    os_u32              max_pending;
+
+    /* the output is written by the caller */
+    bool                sync;
+};
+
+int klog_init(void);
+ssize_t klog_vprintf(const char *fmt, va_list args);
+void klog_sync(bool sync);
+void klog_panic(void);
+void klog_get_stat(struct klog_stat *stat);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _PRIOBENCH_H_
+#define _PRIOBENCH_H_
+
+#include "rtos.h"
+
+/* the result of the lookups of the highest ready priority */
+struct priobench_result
+{
+    /* the lookups timed by every method */
+    os_u32      lookups;
+
+    /* the cycles of the call and the loop only, they are not taken out of the others */
+    os_u32      none_cycles;
+
+    /* the cycles of the remap table of 32 priorities and of the bitmap of two levels */
+    os_u32      table_cycles;
+    os_u32      clz_cycles;
+
+    /* the bitmaps of 32 priorities the two methods give different priorities */
+    os_u32      mismatches;
+};
+
+err_t priobench_run(os_u32 maps, os_u32 rounds, os_u32 seed, struct priobench_result *result);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "list.h"
 #include "signal.h"
+#include "time.h"
 
 /******************************************************************************/
 
@@ -32,9 +33,22 @@ struct sched_param
 #define PTHREAD_TICKS_MAX         255  
   
 #define PTHREAD_PRIORITY_MIN      0
-#define PTHREAD_PRIORITY_MAX      31
 
-#define PTHREAD_READY_GROUP_MAX   PTHREAD_PRIORITY_MAX + 1
+/* the board can define less priorities at hw_def.h, a priority costs a list of the ready table */
+#ifndef PTHREAD_PRIORITY_MAX
+    #define PTHREAD_PRIORITY_MAX  255
+#endif
+
+#if PTHREAD_PRIORITY_MAX > 255
+    #error "the priority of the thread is os_u8"
+#endif
+
+#define PTHREAD_READY_GROUP_MAX   (PTHREAD_PRIORITY_MAX + 1)
+
+/* the ready bitmap has a word of 32 priorities, and a bit of the group word for every word */
+#define PTHREAD_READY_WORD_MAX    ((PTHREAD_READY_GROUP_MAX + 31) / 32)
+#define PTHREAD_PRIO_WORD(prio)   ((prio) >> 5)
+#define PTHREAD_PRIO_MASK(prio)   (1UL << ((prio) & 31))
   
     pthread_type_t          type;
     
@@ -70,6 +84,8 @@ struct os_pthread
     /* thread priority */
     os_u8                   init_prio;
     os_u8                   cur_prio;
+    
+    /* the bit of the priority at its word of the ready bitmap */
     os_u32                  prio_mask;  
     
     /* thread function and user data */
@@ -86,9 +102,69 @@ struct os_pthread
     
     /* used signal event table */
     list_t                  sig_list;
+    
+    /* the release of the periodic thread, NULL when it is not periodic */
+    struct pthread_period   *period;
+    
+    /* the parameters of the EDF band, NULL when the thread has a fixed priority */
+    struct sched_dl         *dl;
+    
+    /* the cycles run in all, at the last window, and the cpu usage decayed over the windows */
+    os_u64                  run_cycles;
+    os_u64                  mark_cycles;
+    os_u32                  usage;
+    
+    /* the context switches the thread gave up the cpu by itself, and was preempted */
+    os_u32                  nvcsw;
+    os_u32                  nivcsw;
 };
 typedef struct os_pthread   os_pthread_t;
 
+/* the statistics of the periodic thread */
+struct pthread_period_stat
+{
+    /* the period and the relative deadline in nanosecond */
+    os_u64                  period;
+    os_u64                  deadline;
+    
+    /* the jobs completed, the releases missed and the deadlines missed */
+    os_u32                  jobs;
+    os_u32                  overruns;
+    os_u32                  misses;
+    
+    /* the last and the worst response time from the release to the completion in nanosecond */
+    os_u32                  last_response_ns;
+    os_u32                  worst_response_ns;
+};
+
+/* the byte the stack is painted with at the creation, the bytes still painted were never used */
+#define PTHREAD_STACK_PAINT       0xA5
+#define PTHREAD_STACK_PAINT_WORD  0xA5A5A5A5UL
+
+/* the word at the bottom of the stack, it is checked when the thread is switched out */
+#define PTHREAD_STACK_CANARY      0x5A5AC3C3UL
+
+/* the bytes the MPU guards above the canary, the board with the MPU defines it at hw_def.h */
+#ifndef PTHREAD_STACK_GUARD_SIZE
+    #define PTHREAD_STACK_GUARD_SIZE  0
+#endif
+
+/* the guard is aligned to its size, the bytes under it are not used */
+#if PTHREAD_STACK_GUARD_SIZE
+    #define PTHREAD_STACK_GUARD(x) \
+                ((char *)__ALIGN((phys_addr_t)(x)->stk_addr + sizeof(os_u32), PTHREAD_STACK_GUARD_SIZE))
+#else
+    #define PTHREAD_STACK_GUARD(x) \
+                ((x)->stk_addr + sizeof(os_u32))
+#endif
+
+/* the lowest byte the thread can use */
+#define PTHREAD_STACK_FLOOR(x) \
+            (PTHREAD_STACK_GUARD(x) + PTHREAD_STACK_GUARD_SIZE)
+
+#define PTHREAD_STACK_OVERFLOW(x) \
+            (*(os_u32 *)(x)->stk_addr != PTHREAD_STACK_CANARY)
+
 #define PTHREAD_POINT(x) \
             ((os_pthread_t *)x)
 
@@ -114,10 +190,23 @@ int pthread_attr_setschedparam(pthread_attr_t *RESTRICT attr,
                                const struct sched_param *restrict param);
 
 int pthread_setname_np(pthread_t thread, const char *name);
+int pthread_get_stack_np(pthread_t thread, size_t *used, size_t *size);
+size_t __pthread_stack_used(os_pthread_t *pthread);
 
 int __pthread_int_init (os_pthread_t *pthread, 
                         void *(*start_routine)(void*), 
                         void *RESTRICT arg);
+
+int pthread_make_periodic_np(pthread_t thread, 
+                             const struct timespec *start, 
+                             const struct timespec *period);
+int pthread_set_deadline_np(pthread_t thread, 
+                            const struct timespec *deadline, 
+                            int signo);
+int pthread_wait_period_np(os_u32 *overruns);
+int pthread_get_period_np(pthread_t thread, struct pthread_period_stat *stat);
+
+void __pthread_period_exit(os_pthread_t *pthread);
 /******************************************************************************/
 
 #ifndef MUTEX_RECURSIVE_MAX
@@ -144,6 +233,7 @@ typedef char                 pthread_mutexattr_t;
 
 int pthread_mutex_init (pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
 int pthread_mutex_lock (pthread_mutex_t *mutex);
+int pthread_mutex_timedlock (pthread_mutex_t *mutex, const struct timespec *abstime);
 int pthread_mutex_unlock (pthread_mutex_t * mutex);
 
 #endif
@@ -3,6 +3,75 @@
 
 #include "pthread.h"
 
+/* the priority of the EDF band, its threads run by the earliest absolute deadline */
+#ifndef SCHED_DL_PRIORITY
+    #define SCHED_DL_PRIORITY       (PTHREAD_PRIORITY_MAX - 1)
+#endif
+
+/* the bandwidth of the EDF band in 1/SCHED_DL_BW_UNIT, the admission keeps the rest for the other threads */
+#define SCHED_DL_BW_SHIFT           20
+#define SCHED_DL_BW_UNIT            (1UL << SCHED_DL_BW_SHIFT)
+#ifndef SCHED_DL_BW_MAX
+    #define SCHED_DL_BW_MAX         (SCHED_DL_BW_UNIT / 100 * 95)
+#endif
+
+/* the longest period of the EDF band in nanosecond */
+#define SCHED_DL_PERIOD_MAX         4000000000ULL
+
+/* the state of the current thread at the statistics */
+#define PTHREAD_STATE_RUN           6
+
+/* the most threads shown by top */
+#ifndef SCHED_TOP_THREAD_MAX
+    #define SCHED_TOP_THREAD_MAX    32
+#endif
+
+/* the statistics of a thread */
+struct sched_thread_stat
+{
+    pthread_t               thread;
+    char                    name[STDOBJ_NAME_MAX + 1];
+    
+    pthread_flag_t          status;
+    os_u8                   prio;
+    
+    /* the cpu usage decayed over the windows in 1/1000, and the cycles run in all */
+    os_u32                  usage;
+    os_u64                  run_cycles;
+    
+    /* the context switches the thread gave up the cpu by itself, and was preempted */
+    os_u32                  nvcsw;
+    os_u32                  nivcsw;
+    
+    /* the most stack used by the painting, and the size of the stack in byte */
+    size_t                  stack_used;
+    size_t                  stack_size;
+};
+
+/* the two level bitmap of the ready priorities, a bit of the group is set when its word is not 0 */
+struct sched_bitmap
+{
+    os_u32                  group;
+    os_u32                  word[PTHREAD_READY_WORD_MAX];
+};
+
+/* the parameters and the state of the thread of the EDF band */
+struct sched_dl_stat
+{
+    /* the budget of a period, the relative deadline and the period in nanosecond */
+    os_u64                  runtime;
+    os_u64                  deadline;
+    os_u64                  period;
+    
+    /* the absolute deadline of CLOCK_MONOTONIC and the budget left */
+    os_u64                  abs_deadline;
+    os_s64                  budget;
+    
+    /* the bandwidth in 1/SCHED_DL_BW_UNIT, and the budgets exhausted */
+    os_u32                  bw;
+    os_u32                  exhausted;
+};
+
 void sched_init(void);
 void sched_switch_thread(void);
 void sched_start(void);
@@ -22,6 +91,17 @@ err_t sched_delete_thread(os_pthread_t *thread);
 os_pthread_t* get_current_thread(void);
 os_u16 get_current_usage(void);
 
+int sched_setdeadline_np(pthread_t thread,
+                         const struct timespec *runtime,
+                         const struct timespec *deadline,
+                         const struct timespec *period);
+int sched_getdeadline_np(pthread_t thread, struct sched_dl_stat *stat);
+os_u32 sched_dl_bandwidth(void);
+
+os_u32 sched_bitmap_highest(const struct sched_bitmap *map);
+
+int sched_get_thread_stat(struct sched_thread_stat *stat, int max);
+
 int __sched_report_signal(os_pthread_t *thread,
                           void *(*start_routine)(void*), 
                           void *RESTRICT arg);
@@ -1,7 +1,7 @@
 #ifndef _SIGINFO_H_
 #define _SIGINFO_H_
 
-#include "aio.h"
+#include "unistd.h"
 #include "list.h"
 
 #define SIGEV_NONE          1
@@ -12,6 +12,9 @@ struct timespec
     long tv_nsec;
 };
 
+/* the it_value of timer_settime is the absolute time of the clock */
+#define TIMER_ABSTIME           1
+
 struct itimerspect
 {
     /* the reload time of timer set */
@@ -38,6 +41,12 @@ struct tm
 int timer_init(void);
 int timer_create (clockid_t clockid, struct sigevent *RESTRICT evp, timer_t *RESTRICT timerid);
 int timer_settime (timer_t timerid, int flags, const struct itimerspect *value, struct itimerspect *ovalue);
+int timer_gettime (timer_t timerid, struct itimerspect *value);
+int timer_delete (timer_t timerid);
+int clock_settime (clockid_t clockid, const struct timespec *tp);
+int clock_gettime (clockid_t clockid, struct timespec *tp);
+int clock_nanosleep (clockid_t clockid, int flags, const struct timespec *rqtp, struct timespec *rmtp);
+os_u64 clock_read(clockid_t clockid);
 struct tm *localtime_r(const time_t *time, struct tm *RESTRICT result);
 
 extern void udelay(int us);
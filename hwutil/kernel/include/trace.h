@@ -0,0 +1,71 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "rtos.h"
+
+/* the board enables the trace at hw_def.h */
+#ifndef USING_TRACE
+    #define USING_TRACE                 0
+#endif
+
+/* the events of the ring, it must be a power of 2 */
+#ifndef TRACE_EVENT_MAX
+    #define TRACE_EVENT_MAX             1024
+#endif
+
+/* the types of the event, the info, the data and the argument of every type are in the comment */
+#define TRACE_EV_WRAP                   0       /* -, -, the high word of the cycle counter */
+#define TRACE_EV_SWITCH                 1       /* priority to, state from, thread to */
+#define TRACE_EV_READY                  2       /* priority, -, thread */
+#define TRACE_EV_SUSPEND                3       /* priority, -, thread */
+#define TRACE_EV_SLEEP                  4       /* priority, ticks, thread */
+#define TRACE_EV_ISR_ENTER              5       /* exception number, -, - */
+#define TRACE_EV_ISR_EXIT               6       /* exception number, -, - */
+#define TRACE_EV_MUTEX_LOCK             7       /* -, -, mutex */
+#define TRACE_EV_MUTEX_UNLOCK           8       /* -, -, mutex */
+#define TRACE_EV_SEM_WAIT               9       /* -, value, semaphore */
+#define TRACE_EV_SEM_POST               10      /* -, value, semaphore */
+#define TRACE_EV_MQ_SEND                11      /* -, length or error, message queue */
+#define TRACE_EV_MQ_RECEIVE             12      /* -, length or error, message queue */
+#define TRACE_EV_MARK                   13      /* -, id, value */
+
+/* the event of the ring */
+struct trace_event
+{
+    /* the low word of the cycle counter */
+    os_u32              cycle;
+
+    /* the thread running, NULL before the scheduler starts */
+    os_u32              thread;
+
+    os_u32              arg;
+    os_u16              data;
+    os_u8               info;
+    os_u8               type;
+};
+
+/* the line of the dump is given to the output */
+typedef void (*trace_out_t)(void *arg, const char *line);
+
+#if USING_TRACE
+    #define TRACE_RECORD(type, info, data, arg) \
+        __trace_record(type, (os_u8)(info), (os_u16)(data), (os_u32)(arg))
+
+    void __trace_record(os_u8 type, os_u8 info, os_u16 data, os_u32 arg);
+    void trace_tick(void);
+    void trace_mark(os_u16 id, os_u32 value);
+    void trace_enable(bool enable);
+    int trace_dump(trace_out_t out, void *arg);
+#else
+    #define TRACE_RECORD(type, info, data, arg)
+
+    #define trace_tick()
+    #define trace_mark(id, value)
+    #define trace_enable(enable)
+    #define trace_dump(out, arg)        (-ENOSYS)
+#endif
+
+#define TRACE_ISR_ENTER(vector)         TRACE_RECORD(TRACE_EV_ISR_ENTER, vector, 0, 0)
+#define TRACE_ISR_EXIT(vector)          TRACE_RECORD(TRACE_EV_ISR_EXIT, vector, 0, 0)
+
+#endif
@@ -150,7 +150,7 @@ typedef struct pthread_attr pthread_attr_t;
 enum clockid
 {
     CLOCK_REALTIME = 0,
-  
+    CLOCK_MONOTONIC = 1,
 };
 typedef enum clockid clockid_t;
 
@@ -15,6 +15,11 @@ enum stdobj_type
 
 #define STDOBJ_NAME_MAX         12
 
+/* the maximum number of the file handle, it fits the bitset of select */
+#ifndef STDFD_NUM_MAX
+    #define STDFD_NUM_MAX       32
+#endif
+
 /******************************************************************************/
 
 #define O_RDONLY                (1UL << 0)
@@ -22,12 +27,27 @@ enum stdobj_type
 #define O_RDWR                  (1UL << 2)
 #define O_CREAT                 (1UL << 3)
 #define O_NONBLOCK              (1UL << 4)
+#define O_TRUNC                 (1UL << 5)
+#define O_APPEND                (1UL << 6)
 
 #define SEEK_SET                (0)
 #define SEEK_CUR                (1)
 #define SEEK_END                (2)
+
+/* the maximum number of the I/O vector at one calling */
+#define IOV_MAX                 16
 /******************************************************************************/
 
+/* the structure description of one I/O vector */
+struct iovec
+{
+    /* the start address of the buffer */
+    void                        *iov_base;
+    
+    /* the bytes of the buffer */
+    size_t                      iov_len;
+};
+
 struct stdops
 {
     int                         type;
@@ -43,6 +63,9 @@ struct stdops
     err_t   (*control)          (struct stdops *ops, int cmd, void *paramer);
     loff_t  (*lseek)            (struct stdops *ops, loff_t loff, int from);
     
+    ssize_t (*readv)            (struct stdops *ops, const struct iovec *iov, int iovcnt, loff_t loff);
+    ssize_t (*writev)           (struct stdops *ops, const struct iovec *iov, int iovcnt, loff_t loff);
+    
     ssize_t (*aio_read)         (struct stdops *ops, char __user *buffer, size_t size, loff_t loff);
     ssize_t (*aio_write)        (struct stdops *ops, const char __user *buffer, size_t size, loff_t loff);
     
@@ -64,11 +87,24 @@ struct stdops
 };
 
 int stdobj_create (enum stdobj_type, const char *name, struct stdops *stdops);
+int stdfd_alloc (struct stdops *stdops, int flag);
+struct stdops *stdfd_ops (int fildes);
 
+/*
+ * access returns the file handle (> 0) on success, the handle is shared when
+ * the object is opened already with the access mode asked for. on failure it
+ * returns a negative errno: -EINVAL (no name), -ENOENT (no such object),
+ * -EACCES (opened with another access mode), -EBUSY (being opened by another
+ * thread), -EMFILE (no free handle) or the error of the object's open.
+ */
 int access (const char *name, int flag);
 int close (int fildes);
 ssize_t read (int fildes, void *buf, size_t nbyte);
 ssize_t write (int fildes, const void *buf, size_t nbyte);
+ssize_t pread (int fildes, void *buf, size_t nbyte, loff_t offset);
+ssize_t pwrite (int fildes, const void *buf, size_t nbyte, loff_t offset);
+ssize_t readv (int fildes, const struct iovec *iov, int iovcnt);
+ssize_t writev (int fildes, const struct iovec *iov, int iovcnt);
 loff_t lseek (int fildes, loff_t loff, int from);
 int ioctl (int fildes, int request, ...);
 int lock (int fildes, loff_t offset, size_t length);
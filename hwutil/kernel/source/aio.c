@@ -0,0 +1,627 @@
+/*
+ * File         : aio.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-02       DongHeng        create
+ */
+
+#include "aio.h"
+#include "sched.h"
+#include "signal.h"
+#include "semaphore.h"
+#include "stdlib.h"
+#include "string.h"
+#include "debug.h"
+
+/*@{*/
+
+#ifndef AIO_THREAD_NUM
+    #define AIO_THREAD_NUM              2
+#endif
+
+#ifndef AIO_THREAD_STACK_SIZE
+    #define AIO_THREAD_STACK_SIZE       1024U
+#endif
+
+#ifndef AIO_THREAD_PRIORITY
+    #define AIO_THREAD_PRIORITY         15
+#endif
+
+/* the group of the control blocks submitted by lio_listio */
+struct aio_lio
+{
+    /* the number of the control blocks not completed */
+    int                 pending;
+
+    /* the notification when all control blocks are completed */
+    struct sigevent     sigevent;
+    os_pthread_t        *thread;
+};
+
+/* the thread waiting for the control blocks completed */
+struct aio_waiter
+{
+    list_t              list;
+
+    os_pthread_t        *thread;
+};
+
+/* the control blocks waiting to be handled */
+static list_t aio_request_list;
+
+/* the control blocks being handled by the worker threads */
+static list_t aio_active_list;
+
+/* the threads blocked at aio_suspend */
+static list_t aio_waiter_list;
+
+static sem_t aio_sem;
+
+/*@}*/
+
+/*@{*/
+
+/*
+ * aio_notify - send the completion notification of the sigevent
+ *
+ * @param sigevent the notification
+ * @param thread   the thread which submits the request
+ */
+static void aio_notify(struct sigevent *sigevent, os_pthread_t *thread)
+{
+    switch (sigevent->sigev_notify)
+    {
+        case SIGEV_THREAD:
+                    if (sigevent->sigev_notify_function)
+                        sigevent->sigev_notify_function(sigevent->sigev_value);
+                    break;
+        case SIGEV_SIGNAL:
+                    sigqueue((pid_t)thread, sigevent->sigev_signo, sigevent->sigev_value);
+                    break;
+        default:
+                    break;
+    }
+}
+
+/*
+ * aio_wakeup - wake up all threads blocked at aio_suspend, and they will check
+ *              their control blocks again
+ */
+static void aio_wakeup(void)
+{
+    struct aio_waiter *waiter;
+    phys_reg_t temp = hw_interrupt_suspend();
+
+    LIST_FOR_EACH_HEAD_NEXT(waiter,
+                            &aio_waiter_list,
+                            struct aio_waiter,
+                            list)
+    {
+        list_remove_node(&waiter->list);
+        list_init(&waiter->list);
+
+        if (PTHREAD_STATE_SUSPEND == waiter->thread->status ||
+            PTHREAD_STATE_SLEEP == waiter->thread->status)
+            sched_set_thread_ready(waiter->thread);
+    }
+
+    hw_interrupt_recover(temp);
+
+    sched_switch_thread();
+}
+
+/*
+ * aio_is_busy - check if the control block is queued or being handled, the
+ *               interrupt must be suspended
+ *
+ * @param aiocbp the point of the control block
+ *
+ * @return true if the control block is not completed
+ */
+static bool aio_is_busy(const struct aiocb *aiocbp)
+{
+    struct aiocb *aiocb;
+
+    LIST_FOR_EACH_ENTRY(aiocb, &aio_request_list, struct aiocb, __list)
+        if (aiocb == aiocbp)
+            return true;
+
+    LIST_FOR_EACH_ENTRY(aiocb, &aio_active_list, struct aiocb, __list)
+        if (aiocb == aiocbp)
+            return true;
+
+    return false;
+}
+
+/*
+ * aio_complete - finish the control block and report it, the control block
+ *                belongs to the caller again after the error number is set,
+ *                so it is not touched after that
+ *
+ * @param aiocbp the point of the control block
+ * @param ret    the result of the operation
+ * @param error  the error number of the operation
+ */
+static void aio_complete(struct aiocb *aiocbp, ssize_t ret, int error)
+{
+    struct aio_lio *lio = (struct aio_lio *)aiocbp->__lio;
+    os_pthread_t *owner = aiocbp->__owner;
+    struct sigevent sigevent;
+    phys_reg_t temp;
+    int pending = 1;
+
+    memcpy(&sigevent, &aiocbp->aio_sigevent, sizeof(struct sigevent));
+
+    temp = hw_interrupt_suspend();
+
+    list_remove_node(&aiocbp->__list);
+    list_init(&aiocbp->__list);
+
+    aiocbp->__return = ret;
+    aiocbp->__error = error;
+
+    hw_interrupt_recover(temp);
+
+    aio_notify(&sigevent, owner);
+
+    if (lio)
+    {
+        temp = hw_interrupt_suspend();
+        pending = --lio->pending;
+        hw_interrupt_recover(temp);
+
+        if (!pending)
+        {
+            aio_notify(&lio->sigevent, lio->thread);
+            free(lio);
+        }
+    }
+
+    aio_wakeup();
+}
+
+/*
+ * aio_thread_entry - the worker thread of the asynchronous I/O
+ */
+static void* aio_thread_entry(void *p)
+{
+    struct aiocb *aiocbp;
+    phys_reg_t temp;
+    ssize_t ret;
+
+    while (1)
+    {
+        sem_wait(&aio_sem);
+
+        /* the semaphore count is limited, so handle all queued requests */
+        while (1)
+        {
+            temp = hw_interrupt_suspend();
+
+            if (list_is_empty(&aio_request_list))
+            {
+                hw_interrupt_recover(temp);
+                break;
+            }
+
+            aiocbp = LIST_HEAD_ENTRY(&aio_request_list, struct aiocb, __list);
+            list_remove_node(&aiocbp->__list);
+            list_insert_tail(&aio_active_list, &aiocbp->__list);
+
+            hw_interrupt_recover(temp);
+
+            if (LIO_READ == aiocbp->aio_lio_opcode)
+                ret = pread(aiocbp->aio_fildes,
+                            (void *)aiocbp->aio_buf,
+                            aiocbp->aio_nbytes,
+                            aiocbp->aio_offset);
+            else
+                ret = pwrite(aiocbp->aio_fildes,
+                             (const void *)aiocbp->aio_buf,
+                             aiocbp->aio_nbytes,
+                             aiocbp->aio_offset);
+
+            if (ret < 0)
+                aio_complete(aiocbp, -1, -ret);
+            else
+                aio_complete(aiocbp, ret, 0);
+        }
+    }
+}
+
+/*
+ * aio_enqueue - put the control block into the request queue
+ *
+ * @param aiocbp the point of the control block
+ * @param opcode the operation of the control block
+ * @param lio    the group of the control block
+ *
+ * @return the result
+ */
+static int aio_enqueue(struct aiocb *aiocbp, int opcode, struct aio_lio *lio)
+{
+    phys_reg_t temp;
+
+    if (!aiocbp || aiocbp->aio_fildes <= 0)
+        return -EINVAL;
+
+    temp = hw_interrupt_suspend();
+
+    /* the error number left by the last operation does not mean it is busy */
+    if (aio_is_busy(aiocbp))
+    {
+        hw_interrupt_recover(temp);
+        return -EAGAIN;
+    }
+
+    aiocbp->aio_lio_opcode = opcode;
+    aiocbp->__owner = get_current_thread();
+    aiocbp->__lio = lio;
+    aiocbp->__return = 0;
+    aiocbp->__error = EINPROGRESS;
+
+    list_insert_tail(&aio_request_list, &aiocbp->__list);
+
+    hw_interrupt_recover(temp);
+
+    sem_post(&aio_sem);
+
+    return 0;
+}
+
+/*
+ * aio_list_done - check if all control blocks of the list are completed
+ *
+ * @param list the control blocks list
+ * @param nent the number of the control blocks list
+ * @param all  checking all control blocks or any one
+ *
+ * @return true if the control blocks are completed
+ */
+static bool aio_list_done(const struct aiocb *const list[], int nent, bool all)
+{
+    int i;
+
+    for (i = 0; i < nent; i++)
+    {
+        if (!list[i] || LIO_NOP == list[i]->aio_lio_opcode)
+            continue;
+
+        if (EINPROGRESS != list[i]->__error)
+        {
+            if (!all)
+                return true;
+        }
+        else if (all)
+            return false;
+    }
+
+    return all;
+}
+
+/*
+ * aio_wait - block the current thread until control blocks are completed
+ *
+ * @param list  the control blocks list
+ * @param nent  the number of the control blocks list
+ * @param all   waiting for all control blocks or any one
+ * @param ticks the maximum ticks to be blocked, 0 means forever
+ *
+ * @return the result
+ */
+static int aio_wait(const struct aiocb *const list[], int nent, bool all, os_u32 ticks)
+{
+    struct aio_waiter waiter;
+    phys_reg_t temp;
+
+    waiter.thread = get_current_thread();
+
+    while (1)
+    {
+        temp = hw_interrupt_suspend();
+
+        if (aio_list_done(list, nent, all))
+        {
+            hw_interrupt_recover(temp);
+            return 0;
+        }
+
+        list_insert_tail(&aio_waiter_list, &waiter.list);
+
+        if (ticks)
+        {
+            waiter.thread->sleep_ticks = ticks > OS_U16_MAX ? OS_U16_MAX : ticks;
+            sched_set_thread_sleep(waiter.thread);
+        }
+        else
+        {
+            sched_set_thread_suspend(waiter.thread);
+            list_init(&waiter.thread->list);
+        }
+
+        sched_switch_thread();
+
+        hw_interrupt_recover(temp);
+
+        /* wake up by timeout, so remove the waiter by ourselves */
+        temp = hw_interrupt_suspend();
+        list_remove_node(&waiter.list);
+        hw_interrupt_recover(temp);
+
+        if (ticks)
+        {
+            if (!waiter.thread->sleep_ticks)
+                return aio_list_done(list, nent, all) ? 0 : -EAGAIN;
+
+            ticks = waiter.thread->sleep_ticks;
+        }
+    }
+}
+
+/*@}*/
+
+/*@{*/
+
+/**
+ * aio_read - the function will queue the reading operation
+ *
+ * @param aiocbp the point of the control block
+ *
+ * @return the result
+ */
+int aio_read (struct aiocb *aiocbp)
+{
+    return aio_enqueue(aiocbp, LIO_READ, NULL);
+}
+
+/**
+ * aio_write - the function will queue the writing operation
+ *
+ * @param aiocbp the point of the control block
+ *
+ * @return the result
+ */
+int aio_write (struct aiocb *aiocbp)
+{
+    return aio_enqueue(aiocbp, LIO_WRITE, NULL);
+}
+
+/**
+ * aio_error - the function will return the error status of the control block
+ *
+ * @param aiocbp the point of the control block
+ *
+ * @return EINPROGRESS when it is not completed, 0 when it is successful,
+ *         or the error number
+ */
+int aio_error (const struct aiocb *aiocbp)
+{
+    if (!aiocbp)
+        return EINVAL;
+
+    return aiocbp->__error;
+}
+
+/**
+ * aio_return - the function will return the result of the control block
+ *
+ * @param aiocbp the point of the control block
+ *
+ * @return the result of the reading or writing
+ */
+ssize_t aio_return (struct aiocb *aiocbp)
+{
+    if (!aiocbp || EINPROGRESS == aiocbp->__error)
+        return -EINVAL;
+
+    return aiocbp->__return;
+}
+
+/**
+ * aio_cancel - the function will cancel the control blocks which are still
+ *              in the queue
+ *
+ * @param fildes the file handle
+ * @param aiocbp the point of the control block, NULL means all of the file
+ *
+ * @return the result of canceling
+ */
+int aio_cancel (int fildes, struct aiocb *aiocbp)
+{
+    struct aiocb *aiocb, *n;
+    list_t cancel_list;
+    phys_reg_t temp;
+    int ret = AIO_ALLDONE;
+
+    list_init(&cancel_list);
+
+    temp = hw_interrupt_suspend();
+
+    LIST_FOR_EACH_ENTRY_SAFE(aiocb,
+                             n,
+                             &aio_request_list,
+                             struct aiocb,
+                             __list)
+    {
+        if (aiocb->aio_fildes != fildes)
+            continue;
+
+        if (aiocbp && aiocbp != aiocb)
+            continue;
+
+        list_remove_node(&aiocb->__list);
+        list_insert_tail(&cancel_list, &aiocb->__list);
+        ret = AIO_CANCELED;
+    }
+
+    /* the one being handled by the worker can not be canceled */
+    if (aiocbp && AIO_ALLDONE == ret && aio_is_busy(aiocbp))
+        ret = AIO_NOTCANCELED;
+
+    hw_interrupt_recover(temp);
+
+    LIST_FOR_EACH_HEAD_NEXT(aiocb,
+                            &cancel_list,
+                            struct aiocb,
+                            __list)
+    {
+        aio_complete(aiocb, -1, ECANCELED);
+    }
+
+    return ret;
+}
+
+/**
+ * aio_suspend - the function will block the current thread until at least one
+ *               of the control blocks is completed
+ *
+ * @param list    the control blocks list
+ * @param nent    the number of the control blocks list
+ * @param timeout the maximum time to be blocked, NULL means forever
+ *
+ * @return the result
+ */
+int aio_suspend (const struct aiocb *const list[], int nent, const struct timespec *timeout)
+{
+    os_u32 ticks = 0;
+
+    if (!list || nent <= 0)
+        return -EINVAL;
+
+    if (timeout)
+    {
+        ticks = (timeout->tv_sec * 1000 + timeout->tv_nsec / 1000000) / RTOS_SYS_TICK_PERIOD;
+        if (!ticks)
+            ticks = 1;
+    }
+
+    return aio_wait(list, nent, false, ticks);
+}
+
+/**
+ * lio_listio - the function will queue a list of the control blocks
+ *
+ * @param mode the mode of waiting, LIO_WAIT or LIO_NOWAIT
+ * @param list the control blocks list
+ * @param nent the number of the control blocks list
+ * @param sig  the notification when all control blocks are completed at the
+ *             LIO_NOWAIT mode
+ *
+ * @return the result
+ */
+int lio_listio (int mode, struct aiocb *RESTRICT const list[], int nent, struct sigevent *RESTRICT sig)
+{
+    struct aio_lio *lio = NULL;
+    int i, num = 0, ret = 0, err;
+
+    if (!list || nent <= 0)
+        return -EINVAL;
+
+    if (LIO_WAIT != mode && LIO_NOWAIT != mode)
+        return -EINVAL;
+
+    for (i = 0; i < nent; i++)
+        if (list[i] && LIO_NOP != list[i]->aio_lio_opcode)
+            num++;
+
+    if (!num)
+        return 0;
+
+    if (LIO_NOWAIT == mode && sig && SIGEV_NONE != sig->sigev_notify)
+    {
+        if (!(lio = malloc(sizeof(struct aio_lio))))
+            return -ENOMEM;
+
+        memcpy(&lio->sigevent, sig, sizeof(struct sigevent));
+        lio->thread = get_current_thread();
+
+        /* hold the group until all control blocks are submitted */
+        lio->pending = num + 1;
+    }
+
+    for (i = 0; i < nent; i++)
+    {
+        if (!list[i] || LIO_NOP == list[i]->aio_lio_opcode)
+            continue;
+
+        if ((err = aio_enqueue(list[i], list[i]->aio_lio_opcode, lio)))
+        {
+            ret = -EAGAIN;
+
+            /* the busy one is reported by itself, the invalid one is done here */
+            if (-EINVAL == err)
+            {
+                list[i]->__return = -1;
+                list[i]->__error = EINVAL;
+            }
+
+            if (lio)
+            {
+                phys_reg_t temp = hw_interrupt_suspend();
+                lio->pending--;
+                hw_interrupt_recover(temp);
+            }
+        }
+    }
+
+    if (lio)
+    {
+        phys_reg_t temp = hw_interrupt_suspend();
+        int pending = --lio->pending;
+        hw_interrupt_recover(temp);
+
+        if (!pending)
+        {
+            aio_notify(&lio->sigevent, lio->thread);
+            free(lio);
+        }
+    }
+
+    if (LIO_WAIT == mode)
+        aio_wait((const struct aiocb *const *)list, nent, true, 0);
+
+    return ret;
+}
+
+/**
+ * aio_init - the function will create the worker threads of the asynchronous I/O
+ *
+ * @return the result
+ */
+int aio_init (void)
+{
+    int err;
+    int tid;
+    int i;
+    pthread_attr_t attr;
+    sched_param_t aio_sched_param =
+      SCHED_PARAM_INIT(PTHREAD_TYPE_KERNEL,
+                       PTHREAD_TICKS_MIN,
+                       AIO_THREAD_PRIORITY);
+
+    list_init(&aio_request_list);
+    list_init(&aio_active_list);
+    list_init(&aio_waiter_list);
+
+    sem_init(&aio_sem, 0, SEM_VALUE_MAX);
+
+    pthread_attr_setschedparam(&attr, &aio_sched_param);
+    pthread_attr_setstacksize(&attr, AIO_THREAD_STACK_SIZE);
+
+    for (i = 0; i < AIO_THREAD_NUM; i++)
+    {
+        err = pthread_create(&tid,
+                             &attr,
+                             aio_thread_entry,
+                             NULL);
+        ASSERT_KERNEL(!err);
+        pthread_setname_np(tid, "aio");
+    }
+
+    return 0;
+}
+
+/*@}*/
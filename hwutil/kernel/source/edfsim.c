@@ -0,0 +1,235 @@
+/*
+ * File         : edfsim.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-23       DongHeng        create
+ */
+
+#include "edfsim.h"
+#include "sched.h"
+#include "shell.h"
+
+/*@{*/
+
+/* the task sets of every utilization and the tasks of a set run by the shell command */
+#define EDFSIM_SETS             200
+#define EDFSIM_TASKS            8
+
+/*
+ * the periods divide the hyperperiod, so one hyperperiod from the synchronous
+ * release decides the set. They are not harmonic, as the rates of the control
+ * loops seldom are, the fixed priorities reach the full utilization only by
+ * the harmonic periods
+ */
+#define EDFSIM_HYPERPERIOD      27720
+
+/* the utilization is split in 1/EDFSIM_UTIL_UNIT */
+#define EDFSIM_UTIL_UNIT        1000000UL
+
+#define EDFSIM_COUNT(a)         (sizeof(a) / sizeof((a)[0]))
+
+struct edfsim_task
+{
+    os_u32      period;
+    os_u32      wcet;
+
+    /* the next release, and the time left and the absolute deadline of the job released */
+    os_u32      release;
+    os_u32      left;
+    os_u32      deadline;
+};
+
+static const os_u16 edfsim_periods[] =
+{
+     99, 105, 110, 120, 126, 140, 154, 165, 180, 198, 210, 231, 252, 280, 308, 330,
+    360, 385, 396, 420, 462, 495, 504, 616, 630, 660, 693, 770, 792, 840, 924, 990
+};
+
+/*@}*/
+
+/*@{*/
+
+static os_u32 edfsim_rand(os_u32 *seed)
+{
+    os_u32 x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *seed = x;
+}
+
+/*
+ * edfsim_generate - split the utilization over the tasks uniformly by the
+ *                   sorted cuts, and return the utilization after the time
+ *                   costs are rounded in 1/EDFSIM_UTIL_UNIT
+ */
+static os_u32 edfsim_generate(struct edfsim_task *task, os_u32 tasks, os_u32 util, os_u32 *seed)
+{
+    os_u32 cut[EDFSIM_TASKS_MAX + 1];
+    os_u32 i, j, c, total = 0;
+
+    cut[0] = 0;
+    cut[tasks] = util;
+
+    for (i = 1; i < tasks; i++)
+    {
+        c = edfsim_rand(seed) % (util + 1);
+
+        for (j = i; j > 1 && cut[j - 1] > c; j--)
+            cut[j] = cut[j - 1];
+        cut[j] = c;
+    }
+
+    for (i = 0; i < tasks; i++)
+    {
+        task[i].period = edfsim_periods[edfsim_rand(seed) % EDFSIM_COUNT(edfsim_periods)];
+        task[i].wcet = (os_u32)((os_u64)(cut[i + 1] - cut[i]) * task[i].period / EDFSIM_UTIL_UNIT);
+        if (!task[i].wcet)
+            task[i].wcet = 1;
+
+        total += (os_u32)((os_u64)task[i].wcet * EDFSIM_UTIL_UNIT / task[i].period);
+    }
+
+    return total;
+}
+
+/*
+ * edfsim_simulate - run the tasks preemptively for a hyperperiod
+ *
+ * @param edf true for the earliest deadline, false for the shortest period
+ *
+ * @return true without a deadline miss
+ */
+static bool edfsim_simulate(struct edfsim_task *task, os_u32 tasks, bool edf)
+{
+    os_u32 t = 0, i, run, next, slice;
+
+    for (i = 0; i < tasks; i++)
+    {
+        task[i].release = 0;
+        task[i].left = 0;
+    }
+
+    while (t < EDFSIM_HYPERPERIOD)
+    {
+        /* the job left at its release passed its deadline, the deadline is the period */
+        for (i = 0; i < tasks; i++)
+        {
+            if (task[i].release != t)
+                continue;
+
+            if (task[i].left)
+                return false;
+
+            task[i].left = task[i].wcet;
+            task[i].deadline = t + task[i].period;
+            task[i].release = t + task[i].period;
+        }
+
+        run = tasks;
+        next = EDFSIM_HYPERPERIOD;
+        for (i = 0; i < tasks; i++)
+        {
+            if (task[i].release < next)
+                next = task[i].release;
+
+            if (!task[i].left)
+                continue;
+
+            if (run == tasks ||
+                (edf ? task[i].deadline < task[run].deadline : task[i].period < task[run].period))
+                run = i;
+        }
+
+        /* run the job until the next release or its completion */
+        if (run < tasks)
+        {
+            slice = next - t < task[run].left ? next - t : task[run].left;
+            task[run].left -= slice;
+            t += slice;
+        }
+        else
+            t = next;
+    }
+
+    for (i = 0; i < tasks; i++)
+    {
+        if (task[i].left)
+            return false;
+    }
+
+    return true;
+}
+
+/*@}*/
+
+/**
+ * edfsim_run - the function will simulate the random task sets of the
+ *              utilization by the rate monotonic priorities and by EDF
+ *
+ * @param util the utilization in 1/1000
+ * @param tasks the tasks of a set
+ * @param sets the task sets
+ * @param seed the seed of the task sets, the same seed gives the same sets
+ * @param result the result
+ *
+ * @return the result
+ */
+err_t edfsim_run(os_u32 util, os_u32 tasks, os_u32 sets, os_u32 seed, struct edfsim_result *result)
+{
+    struct edfsim_task task[EDFSIM_TASKS_MAX];
+    os_u64 total = 0;
+    os_u32 i;
+
+    if (!result || !sets || tasks < 2 || tasks > EDFSIM_TASKS_MAX || !util || util > 2000)
+        return -EINVAL;
+
+    result->sets   = sets;
+    result->rm_ok  = 0;
+    result->edf_ok = 0;
+
+    if (!seed)
+        seed = 1;
+
+    for (i = 0; i < sets; i++)
+    {
+        total += edfsim_generate(task, tasks, util * (EDFSIM_UTIL_UNIT / 1000), &seed);
+
+        if (edfsim_simulate(task, tasks, false))
+            result->rm_ok++;
+        if (edfsim_simulate(task, tasks, true))
+            result->edf_ok++;
+    }
+
+    result->util = (os_u32)(total / sets / (EDFSIM_UTIL_UNIT / 1000));
+
+    return 0;
+}
+
+/******************************************************************************/
+
+static void edfsim(struct shell_dev *shell_dev)
+{
+    struct edfsim_result result;
+    os_u32 util;
+
+    shell_printk(shell_dev, "\r\n%d tasks, %d sets, admitted bandwidth of the band %d/%d",
+                            EDFSIM_TASKS, EDFSIM_SETS, sched_dl_bandwidth(), SCHED_DL_BW_UNIT);
+    shell_printk(shell_dev, "\r\n%-10s%-10s%-10s", "util(%)", "rm(%)", "edf(%)");
+
+    for (util = 600; util <= 1000; util += 50)
+    {
+        if (edfsim_run(util, EDFSIM_TASKS, EDFSIM_SETS, util, &result))
+            return ;
+
+        shell_printk(shell_dev, "\r\n%-10d%-10d%-10d", result.util / 10,
+                                                       result.rm_ok * 100 / result.sets,
+                                                       result.edf_ok * 100 / result.sets);
+    }
+}
+SHELL_CMD_EXPORT(edfsim, schedulable task sets by the fixed priorities and EDF, 1);
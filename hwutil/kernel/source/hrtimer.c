@@ -0,0 +1,441 @@
+/*
+ * File         : hrtimer.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-21       DongHeng        create
+ */
+
+#include "hrtimer.h"
+#include "string.h"
+#include "semaphore.h"
+#include "debug.h"
+#include "pthread.h"
+#include "shell.h"
+
+#define HRTIMER_THREAD_STACK_SIZE       512U
+
+/* the nanoseconds of a second */
+#define HRTIMER_NSEC_PER_SEC            1000000000ULL
+
+/* no event is programmed */
+#define HRTIMER_EXPIRE_NEVER            (~(os_u64)0)
+
+/* the queued timers sorted by the expiry, the earliest is the head */
+static list_t hrtimer_list;
+
+/* the timers of HRTIMER_MODE_THREAD expired, their callbacks are waiting for the thread */
+static list_t hrtimer_work;
+static sem_t hrtimer_sem;
+
+/* the hrtimer thread is woken up and has not run yet */
+static volatile int hrtimer_pending;
+
+static const struct hrtimer_dev *hrtimer_dev;
+
+/* the time the event programmed fires at */
+static os_u64 hrtimer_event = HRTIMER_EXPIRE_NEVER;
+
+static struct hrtimer_stat hrtimer_stat;
+
+/*@{*/
+
+/*
+ * hrtimer_ns - convert the time to nanosecond, the invalid one is HRTIMER_EXPIRE_NEVER
+ */
+INLINE os_u64 hrtimer_ns(const struct timespec *ts)
+{
+    if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= (long)HRTIMER_NSEC_PER_SEC)
+        return HRTIMER_EXPIRE_NEVER;
+
+    return (os_u64)ts->tv_sec * HRTIMER_NSEC_PER_SEC + ts->tv_nsec;
+}
+
+/*
+ * hrtimer_enqueue - insert the timer by the expiry, the timers of the same
+ *                   expiry expire in the order of starting. The interrupt
+ *                   must be suspended.
+ */
+STATIC void hrtimer_enqueue(struct hrtimer *timer, os_u64 expire)
+{
+    struct hrtimer *pos;
+    list_t *next;
+
+    timer->expire = expire;
+
+    /* most timers are started later than the others, so the queue is searched from the tail */
+    for (next = &hrtimer_list; next->prev != &hrtimer_list; next = next->prev)
+    {
+        pos = LIST_ENTRY(next->prev, struct hrtimer, list);
+        if (pos->expire <= expire)
+            break;
+    }
+
+    __list_insert(next->prev, next, &timer->list);
+}
+
+/*
+ * hrtimer_dequeue - the interrupt must be suspended
+ */
+INLINE void hrtimer_dequeue(struct hrtimer *timer)
+{
+    if (list_is_empty(&timer->list))
+        return ;
+
+    list_remove_node(&timer->list);
+    list_init(&timer->list);
+}
+
+/*
+ * hrtimer_program - program the expiry of the head timer to the device, the
+ *                   interrupt must be suspended
+ */
+STATIC void hrtimer_program(os_u64 now)
+{
+    os_u64 expire, delta;
+
+    if (list_is_empty(&hrtimer_list))
+    {
+        if (HRTIMER_EXPIRE_NEVER != hrtimer_event)
+        {
+            hrtimer_dev->stop();
+            hrtimer_event = HRTIMER_EXPIRE_NEVER;
+        }
+        return ;
+    }
+
+    /* the event programmed fires early enough, the head is checked again at its interrupt */
+    expire = LIST_HEAD_ENTRY(&hrtimer_list, struct hrtimer, list)->expire;
+    if (hrtimer_event <= expire)
+        return ;
+
+    /* the long expiry is reached by several events */
+    delta = expire > now ? expire - now : 0;
+    if (delta < hrtimer_dev->min_ns)
+        delta = hrtimer_dev->min_ns;
+    else if (delta > hrtimer_dev->max_ns)
+        delta = hrtimer_dev->max_ns;
+
+    hrtimer_dev->set_event((os_u32)delta);
+    hrtimer_event = now + delta;
+    hrtimer_stat.events++;
+}
+
+/*@}*/
+
+/**
+ * hrtimer_init - the function will initialize the timer, it is not queued
+ *
+ * @param timer the timer
+ * @param func the callback
+ * @param arg the argument of the callback, it is timer->arg
+ * @param mode HRTIMER_MODE_ISR or HRTIMER_MODE_THREAD
+ */
+void hrtimer_init(struct hrtimer *timer, hrtimer_func_t func, void *arg, int mode)
+{
+    list_init(&timer->list);
+    list_init(&timer->work);
+
+    timer->expire   = 0;
+    timer->interval = 0;
+    timer->overrun  = 0;
+
+    timer->mode = mode;
+    timer->func = func;
+    timer->arg  = arg;
+}
+
+/**
+ * hrtimer_start - the function will queue the timer, the timer queued
+ *                 before is moved to the new expiry
+ *
+ * @param timer the timer
+ * @param value the expiry, the time of CLOCK_MONOTONIC with TIMER_ABSTIME, otherwise the time from now
+ * @param interval the reload interval, it can be NULL for one shot
+ * @param flags TIMER_ABSTIME or 0
+ *
+ * @return the result
+ */
+int hrtimer_start(struct hrtimer *timer,
+                  const struct timespec *value,
+                  const struct timespec *interval,
+                  int flags)
+{
+    os_u64 expire, period = 0, now;
+    phys_reg_t temp;
+
+    if (!timer || !value || !timer->func)
+        return -EINVAL;
+
+    if (!hrtimer_dev)
+        return -ENODEV;
+
+    expire = hrtimer_ns(value);
+    if (interval)
+        period = hrtimer_ns(interval);
+    if (HRTIMER_EXPIRE_NEVER == expire || HRTIMER_EXPIRE_NEVER == period)
+        return -EINVAL;
+
+    temp = hw_interrupt_suspend();
+
+    now = clock_read(CLOCK_MONOTONIC);
+
+    hrtimer_dequeue(timer);
+    timer->interval = period;
+    timer->overrun  = 0;
+
+    /* the absolute time passed already expires at the shortest event */
+    if (!(flags & TIMER_ABSTIME))
+        expire += now;
+    hrtimer_enqueue(timer, expire);
+
+    hrtimer_program(now);
+
+    hw_interrupt_recover(temp);
+
+    return 0;
+}
+
+/**
+ * hrtimer_cancel - the function will dequeue the timer and drop its pending
+ *                  callback, the callback running now is not waited for
+ *
+ * @param timer the timer
+ *
+ * @return the result
+ */
+int hrtimer_cancel(struct hrtimer *timer)
+{
+    phys_reg_t temp;
+
+    if (!timer)
+        return -EINVAL;
+
+    temp = hw_interrupt_suspend();
+
+    hrtimer_dequeue(timer);
+
+    if (!list_is_empty(&timer->work))
+    {
+        list_remove_node(&timer->work);
+        list_init(&timer->work);
+    }
+
+    if (hrtimer_dev)
+        hrtimer_program(clock_read(CLOCK_MONOTONIC));
+
+    hw_interrupt_recover(temp);
+
+    return 0;
+}
+
+/**
+ * hrtimer_interrupt - the function is called by the interrupt of the device,
+ *                     it runs the expired timers and programs the next event
+ */
+void hrtimer_interrupt(void)
+{
+    struct hrtimer *timer;
+    phys_reg_t temp;
+    os_u64 now, next, missed;
+    int wake = 0;
+
+    temp = hw_interrupt_suspend();
+
+    hrtimer_stat.interrupts++;
+    hrtimer_event = HRTIMER_EXPIRE_NEVER;
+
+    now = clock_read(CLOCK_MONOTONIC);
+
+    while (!list_is_empty(&hrtimer_list))
+    {
+        timer = LIST_HEAD_ENTRY(&hrtimer_list, struct hrtimer, list);
+        if (timer->expire > now)
+            break;
+
+        if (now - timer->expire > hrtimer_stat.max_late_ns)
+            hrtimer_stat.max_late_ns = (os_u32)(now - timer->expire);
+        hrtimer_stat.expired++;
+
+        hrtimer_dequeue(timer);
+
+        /* the periods missed are skipped, so the timer keeps its phase */
+        if (timer->interval)
+        {
+            next = timer->expire + timer->interval;
+            if (next <= now)
+            {
+                missed = (now - next) / timer->interval + 1;
+                next += missed * timer->interval;
+
+                timer->overrun += (os_u32)missed;
+                hrtimer_stat.overruns += (os_u32)missed;
+            }
+            hrtimer_enqueue(timer, next);
+        }
+
+        if (HRTIMER_MODE_ISR == timer->mode)
+        {
+            /* the callback can start or cancel the timers */
+            hw_interrupt_recover(temp);
+            timer->func(timer);
+            temp = hw_interrupt_suspend();
+
+            now = clock_read(CLOCK_MONOTONIC);
+        }
+        else if (list_is_empty(&timer->work))
+        {
+            list_insert_tail(&hrtimer_work, &timer->work);
+            wake = 1;
+        }
+        else
+        {
+            /* the callback of the last expiry has not run yet */
+            timer->overrun++;
+            hrtimer_stat.overruns++;
+        }
+    }
+
+    hrtimer_program(now);
+
+    if (wake && !hrtimer_pending)
+    {
+        hrtimer_pending = 1;
+        sem_post(&hrtimer_sem);
+    }
+
+    hw_interrupt_recover(temp);
+}
+
+/**
+ * hrtimer_register - the function will register the event device, the board
+ *                    registers its spare hardware timer once after the cycle
+ *                    counter is started
+ *
+ * @param dev the device
+ *
+ * @return the result
+ */
+int hrtimer_register(const struct hrtimer_dev *dev)
+{
+    phys_reg_t temp;
+
+    if (!dev || !dev->set_event || !dev->stop || dev->min_ns > dev->max_ns)
+        return -EINVAL;
+
+    if (hrtimer_dev)
+        return -EBUSY;
+
+    /* CLOCK_MONOTONIC only moves at the tick without the cycle counter, the events would fire again and again */
+    if (!hw_cycle_freq())
+        return -ENODEV;
+
+    temp = hw_interrupt_suspend();
+    hrtimer_dev = dev;
+    hrtimer_program(clock_read(CLOCK_MONOTONIC));
+    hw_interrupt_recover(temp);
+
+    return 0;
+}
+
+void hrtimer_get_stat(struct hrtimer_stat *stat)
+{
+    phys_reg_t temp;
+
+    temp = hw_interrupt_suspend();
+    memcpy(stat, &hrtimer_stat, sizeof(struct hrtimer_stat));
+    hw_interrupt_recover(temp);
+}
+
+/******************************************************************************/
+
+/*
+ * hrtimer_thread_entry - the thread runs the callbacks of HRTIMER_MODE_THREAD
+ *                        in the order of the expiry
+ */
+static void* hrtimer_thread_entry(void *p)
+{
+    struct hrtimer *timer;
+    phys_reg_t temp;
+
+    while (1)
+    {
+        sem_wait(&hrtimer_sem);
+
+        hrtimer_pending = 0;
+
+        while (1)
+        {
+            temp = hw_interrupt_suspend();
+
+            if (list_is_empty(&hrtimer_work))
+            {
+                hw_interrupt_recover(temp);
+                break;
+            }
+
+            timer = LIST_HEAD_ENTRY(&hrtimer_work, struct hrtimer, work);
+            list_remove_node(&timer->work);
+            list_init(&timer->work);
+
+            hw_interrupt_recover(temp);
+
+            timer->func(timer);
+        }
+    }
+}
+
+int hrtimer_system_init(void)
+{
+    int err;
+    int tid;
+    pthread_attr_t attr;
+    sched_param_t hrtimer_sched_param =
+      SCHED_PARAM_INIT(PTHREAD_TYPE_KERNEL,
+                       PTHREAD_TICKS_MIN,
+                       PTHREAD_PRIORITY_MAX);
+
+    list_init(&hrtimer_list);
+    list_init(&hrtimer_work);
+
+    /* the semaphore holds one wake up at most */
+    sem_init(&hrtimer_sem, 0, 1);
+
+    pthread_attr_setschedparam(&attr, &hrtimer_sched_param);
+    pthread_attr_setstacksize(&attr, HRTIMER_THREAD_STACK_SIZE);
+
+    err = pthread_create(&tid,
+                         &attr,
+                         hrtimer_thread_entry,
+                         NULL);
+    ASSERT_KERNEL(!err);
+    pthread_setname_np(tid, "hrtimer");
+
+    return 0;
+}
+
+/******************************************************************************/
+
+static void hrtimer(struct shell_dev *shell_dev)
+{
+    struct hrtimer_stat stat;
+
+    hrtimer_get_stat(&stat);
+
+    shell_printk(shell_dev, "\r\n%-10s%-10s%-12s%-10s%-10s%-10s", "device",
+                                                                  "events",
+                                                                  "interrupts",
+                                                                  "expired",
+                                                                  "overruns",
+                                                                  "late(ns)");
+
+    shell_printk(shell_dev, "\r\n%-10s%-10u%-12u%-10u%-10u%-10u", hrtimer_dev ? hrtimer_dev->name : "none",
+                                                                  stat.events,
+                                                                  stat.interrupts,
+                                                                  stat.expired,
+                                                                  stat.overruns,
+                                                                  stat.max_late_ns);
+}
+SHELL_CMD_EXPORT(hrtimer, show the high resolution timers, 1);
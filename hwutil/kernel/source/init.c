@@ -22,6 +22,9 @@
 #include "ipport.h"
 #include "shell.h"
 #include "time.h"
+#include "hrtimer.h"
+#include "klog.h"
+#include "aio.h"
 
 /*@{*/ 
 
@@ -96,7 +99,10 @@ static void rtos_kernel_init(void)
     signal_init();
 
     ASSERT_KERNEL(!timer_init());
+    ASSERT_KERNEL(!hrtimer_system_init());
+    ASSERT_KERNEL(!klog_init());
     ASSERT_KERNEL(!stdobj_init());
+    ASSERT_KERNEL(!aio_init());
          
     ASSERT_KERNEL(!shell_init());
     ASSERT_KERNEL(!ipport_system_init());
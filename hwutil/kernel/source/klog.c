@@ -0,0 +1,345 @@
+/*
+ * File         : klog.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-27       DongHeng        create
+ */
+
+#include "klog.h"
+#include "semaphore.h"
+#include "pthread.h"
+#include "debug.h"
+#include "shell.h"
+
+#if KLOG_LINE_NUM & (KLOG_LINE_NUM - 1)
+    #error "KLOG_LINE_NUM must be a power of 2"
+#endif
+
+#ifndef KLOG_THREAD_STACK_SIZE
+    #define KLOG_THREAD_STACK_SIZE      512U
+#endif
+
+/* the thread runs when the others have nothing to do but the idle thread */
+#ifndef KLOG_THREAD_PRIORITY
+    #define KLOG_THREAD_PRIORITY        (PTHREAD_PRIORITY_MIN + 1)
+#endif
+
+/* the line of the ring */
+struct klog_line
+{
+    /* the line is formatted, the one reserved is not ready until it is formatted */
+    volatile bool       ready;
+
+    volatile ssize_t    len;
+
+    /* the lines dropped after the line as the ring is full */
+    os_u32              lost;
+
+    char                buf[KLOG_LINE_SIZE];
+};
+
+/*
+ * the caller reserves a line with the interrupt suspended for a few
+ * instructions, formats into it and returns, the klog thread writes the
+ * lines from the oldest one to the UART
+ */
+static struct klog_line klog_ring[KLOG_LINE_NUM];
+
+/* the lines reserved and the lines written since the boot, the oldest line is at klog_tail */
+static volatile os_u32 klog_head;
+static volatile os_u32 klog_tail;
+
+/* a caller or the klog thread is writing the lines */
+static volatile bool klog_busy;
+
+/* the klog thread is woken up and has not run yet */
+static volatile bool klog_pending;
+static sem_t klog_sem;
+
+/* the klog thread runs, the lines before it are written by the callers */
+static volatile bool klog_running;
+
+/* the lines are written by the callers, the panic writes them with the interrupt suspended */
+static volatile bool klog_sync_on;
+static volatile bool klog_panic_on;
+
+static os_u32 klog_lines;
+static os_u32 klog_lost;
+static os_u32 klog_max_pending;
+
+/*@{*/
+
+/*
+ * klog_write - write the bytes to the UART by the board
+ */
+static void klog_write(const char *buf, ssize_t len)
+{
+    extern int fputc(char ch);
+
+    for (ssize_t i = 0; i < len; i++)
+    {
+        fputc(buf[i]);
+    }
+}
+
+/*
+ * klog_take - take the writing of the lines, the panic takes it from the one
+ *             interrupted
+ */
+static bool klog_take(void)
+{
+    phys_reg_t temp;
+    bool take = false;
+
+    temp = hw_interrupt_suspend();
+    if (!klog_busy || klog_panic_on)
+    {
+        klog_busy = true;
+        take = true;
+    }
+    hw_interrupt_recover(temp);
+
+    return take;
+}
+
+/*
+ * klog_drain - write the lines ready from the oldest one, the writing must be
+ *              taken. It stops at the line being formatted, the caller of it
+ *              writes or wakes up the klog thread when it is ready
+ */
+static void klog_drain(void)
+{
+    struct klog_line *line;
+    phys_reg_t temp;
+    char note[32];
+    os_u32 tail, lost = 0;
+
+    while (1)
+    {
+        temp = hw_interrupt_suspend();
+
+        tail = klog_tail;
+        line = &klog_ring[tail & (KLOG_LINE_NUM - 1)];
+        if (tail == klog_head || (!line->ready && !klog_panic_on))
+        {
+            klog_busy = false;
+            hw_interrupt_recover(temp);
+            break;
+        }
+
+        hw_interrupt_recover(temp);
+
+        /* the panic never sees the line of the caller interrupted formatted */
+        if (line->ready)
+            klog_write(line->buf, line->len);
+        else
+            klog_lost++;
+
+        /* the panic may have written the line when the writing is taken from it */
+        temp = hw_interrupt_suspend();
+        if (klog_tail == tail)
+        {
+            lost = line->lost;
+            line->lost = 0;
+            line->ready = false;
+            klog_tail++;
+        }
+        hw_interrupt_recover(temp);
+
+        /* the lines dropped are noted where they were */
+        if (lost)
+        {
+            klog_write(note, sprintf(note, "klog: %u lines lost\r\n", lost));
+            lost = 0;
+        }
+    }
+}
+
+/*
+ * the entry of the klog thread
+ */
+static void *klog_thread_entry(void *p)
+{
+    klog_running = true;
+
+    while (1)
+    {
+        klog_pending = false;
+
+        if (klog_take())
+            klog_drain();
+
+        sem_wait(&klog_sem);
+    }
+}
+
+/*@}*/
+
+/**
+ * klog_vprintf - the function will format the line to the ring and return,
+ *                the line is written by the klog thread later, or by the
+ *                caller before the thread runs and at the synchronous mode
+ *
+ * @param fmt the string should be printed
+ * @param args the arguments of the string
+ *
+ * @return the number of printed character, 0 when the ring is full
+ */
+ssize_t klog_vprintf(const char *fmt, va_list args)
+{
+    struct klog_line *line;
+    phys_reg_t temp;
+    os_u32 pending;
+    ssize_t len;
+
+    temp = hw_interrupt_suspend();
+
+    pending = klog_head - klog_tail;
+    if (pending >= KLOG_LINE_NUM)
+    {
+        klog_ring[(klog_head - 1) & (KLOG_LINE_NUM - 1)].lost++;
+        klog_lost++;
+        hw_interrupt_recover(temp);
+        return 0;
+    }
+
+    line = &klog_ring[klog_head++ & (KLOG_LINE_NUM - 1)];
+
+    if (++pending > klog_max_pending)
+        klog_max_pending = pending;
+    klog_lines++;
+
+    hw_interrupt_recover(temp);
+
+    len = vsprintf(line->buf, fmt, args);
+    line->len = len;
+    line->ready = true;
+
+    if (!klog_running || klog_sync_on)
+    {
+        if (klog_take())
+            klog_drain();
+    }
+    else
+    {
+        temp = hw_interrupt_suspend();
+        if (!klog_pending)
+        {
+            klog_pending = true;
+            sem_post(&klog_sem);
+        }
+        hw_interrupt_recover(temp);
+    }
+
+    return len;
+}
+
+/**
+ * klog_sync - the function will make the callers write the lines, the lines
+ *             at the ring are written first
+ *
+ * @param sync true to write the lines by the callers
+ */
+void klog_sync(bool sync)
+{
+    klog_sync_on = sync;
+
+    if (sync && klog_take())
+        klog_drain();
+}
+
+/**
+ * klog_panic - the function will write the lines at the ring with the
+ *              interrupt suspended, and the lines after it are written by
+ *              the callers. It is called before the kernel stops
+ */
+void klog_panic(void)
+{
+    phys_reg_t temp;
+
+    temp = hw_interrupt_suspend();
+
+    klog_panic_on = true;
+    klog_sync_on = true;
+
+    klog_take();
+    klog_drain();
+
+    hw_interrupt_recover(temp);
+}
+
+/**
+ * klog_get_stat - the function will get the counters of the log
+ *
+ * @param stat the counters
+ */
+void klog_get_stat(struct klog_stat *stat)
+{
+    phys_reg_t temp;
+
+    temp = hw_interrupt_suspend();
+
+    stat->lines       = klog_lines;
+    stat->lost        = klog_lost;
+    stat->pending     = klog_head - klog_tail;
+    stat->max_pending = klog_max_pending;
+    stat->sync        = !klog_running || klog_sync_on;
+
+    hw_interrupt_recover(temp);
+}
+
+/**
+ * klog_init - the function will start the klog thread, the lines are written
+ *             by the callers until it runs
+ *
+ * @return the result
+ */
+int klog_init(void)
+{
+    int err;
+    int tid;
+    pthread_attr_t attr;
+    sched_param_t klog_sched_param =
+      SCHED_PARAM_INIT(PTHREAD_TYPE_KERNEL,
+                       PTHREAD_TICKS_MIN,
+                       KLOG_THREAD_PRIORITY);
+
+    /* the semaphore holds one wake up at most */
+    sem_init(&klog_sem, 0, 1);
+
+    pthread_attr_setschedparam(&attr, &klog_sched_param);
+    pthread_attr_setstacksize(&attr, KLOG_THREAD_STACK_SIZE);
+
+    err = pthread_create(&tid,
+                         &attr,
+                         klog_thread_entry,
+                         NULL);
+    ASSERT_KERNEL(!err);
+    pthread_setname_np(tid, "klog");
+
+    return 0;
+}
+
+/******************************************************************************/
+
+static void klog(struct shell_dev *shell_dev)
+{
+    struct klog_stat stat;
+
+    klog_get_stat(&stat);
+
+    shell_printk(shell_dev, "\r\n%-10s%-10s%-10s%-10s%-10s", "lines",
+                                                             "lost",
+                                                             "pending",
+                                                             "max",
+                                                             "mode");
+    shell_printk(shell_dev, "\r\n%-10u%-10u%-10u%-10u%-10s", stat.lines,
+                                                             stat.lost,
+                                                             stat.pending,
+                                                             stat.max_pending,
+                                                             stat.sync ? "sync" : "async");
+}
+SHELL_CMD_EXPORT(klog, counters of the log of printk, 1);
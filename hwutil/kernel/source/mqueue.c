@@ -15,6 +15,7 @@
 #include "stdio.h"
 #include "stdlib.h"
 #include "semaphore.h"
+#include "trace.h"
 
 /* class of the message queue */
 struct mq
@@ -174,6 +175,8 @@ ssize_t mq_send (mqd_t mqdes, const char *msg_ptr, size_t msg_len, unsigned int
 check_failed:
 	pthread_mutex_unlock(&mq->w_mutex);
 
+	TRACE_RECORD(TRACE_EV_MQ_SEND, 0, ret ? ret : (ssize_t)msg_len, mq);
+
 	return ret;
 }
 
@@ -231,6 +234,8 @@ ssize_t mq_receive(mqd_t mqdes, char *msg_ptr, size_t msg_len, unsigned int *msg
 check_failed:
     pthread_mutex_unlock(&mq->r_mutex);
 
+    TRACE_RECORD(TRACE_EV_MQ_RECEIVE, 0, ret, mq);
+
     return ret;
 }
 
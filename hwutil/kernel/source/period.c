@@ -0,0 +1,322 @@
+/*
+ * File         : period.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-22       DongHeng        create
+ */
+
+#include "pthread.h"
+#include "sched.h"
+#include "semaphore.h"
+#include "hrtimer.h"
+#include "signal.h"
+#include "stdlib.h"
+#include "string.h"
+
+/* the nanoseconds of a second */
+#define PERIOD_NSEC_PER_SEC             1000000000ULL
+
+/* the thread has not been released yet */
+#define PERIOD_RELEASE_NONE             (~(os_u64)0)
+
+struct pthread_period
+{
+    /* the hrtimer releases the thread by the semaphore at the absolute release time */
+    struct hrtimer      timer;
+    sem_t               sem;
+
+    /* the release of the current job and the next one, the time of CLOCK_MONOTONIC in nanosecond */
+    os_u64              release;
+    os_u64              next;
+
+    /* the period and the relative deadline in nanosecond */
+    os_u64              period;
+    os_u64              deadline;
+
+    /* the signal queued to the thread on a deadline miss, 0 means none */
+    int                 signo;
+
+    os_u32              jobs;
+    os_u32              overruns;
+    os_u32              misses;
+    os_u32              last_response_ns;
+    os_u32              worst_response_ns;
+};
+
+/*@{*/
+
+/*
+ * period_ns - convert the time to nanosecond, the invalid one is 0
+ */
+INLINE os_u64 period_ns(const struct timespec *ts)
+{
+    if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= (long)PERIOD_NSEC_PER_SEC)
+        return 0;
+
+    return (os_u64)ts->tv_sec * PERIOD_NSEC_PER_SEC + ts->tv_nsec;
+}
+
+/*
+ * period_release - the callback of the hrtimer at the interrupt, it wakes up the thread
+ */
+static void period_release(struct hrtimer *timer)
+{
+    struct pthread_period *period = (struct pthread_period *)timer->arg;
+
+    sem_post(&period->sem);
+}
+
+/*
+ * period_sleep - sleep until the absolute time, the thread is released by the
+ *                hrtimer, or by the ticks when the board has no hrtimer
+ */
+STATIC void period_sleep(struct pthread_period *period, os_u64 wake)
+{
+    struct timespec ts;
+
+    ts.tv_sec  = (time_t)(wake / PERIOD_NSEC_PER_SEC);
+    ts.tv_nsec = (long)(wake % PERIOD_NSEC_PER_SEC);
+
+    if (hrtimer_start(&period->timer, &ts, NULL, TIMER_ABSTIME))
+    {
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        return ;
+    }
+
+    /* the semaphore can hold a wake up of the release cancelled before */
+    while (clock_read(CLOCK_MONOTONIC) < wake)
+        sem_wait(&period->sem);
+}
+
+/*@}*/
+
+/**
+ * pthread_make_periodic_np - the function will make the thread periodic, it
+ *                            is released at start, start + period, ... by
+ *                            pthread_wait_period_np
+ *
+ * @param thread the thread
+ * @param start the first release, the time of CLOCK_MONOTONIC. NULL means now
+ * @param period the period, NULL or 0 makes the thread not periodic. Only
+ *               the thread itself can do it, as the others may be waiting
+ *               for the release at the time
+ *
+ * @return the result
+ */
+int pthread_make_periodic_np(pthread_t thread,
+                             const struct timespec *start,
+                             const struct timespec *period)
+{
+    os_pthread_t *pthread = PTHREAD_POINT(thread);
+    struct pthread_period *p;
+    os_u64 first, ns;
+    phys_reg_t temp;
+
+    if (!pthread)
+        return -EINVAL;
+
+    if (!period || !(ns = period_ns(period)))
+    {
+        /* the releases are freed, so they must not be waited for */
+        if (pthread != get_current_thread())
+            return -EPERM;
+
+        __pthread_period_exit(pthread);
+        return 0;
+    }
+
+    if (start)
+    {
+        if (!(first = period_ns(start)) && (start->tv_sec || start->tv_nsec))
+            return -EINVAL;
+    }
+    else
+        first = clock_read(CLOCK_MONOTONIC);
+
+    if (!(p = pthread->period))
+    {
+        if (!(p = malloc(sizeof(struct pthread_period))))
+            return -ENOMEM;
+
+        memset(p, 0, sizeof(struct pthread_period));
+        hrtimer_init(&p->timer, period_release, p, HRTIMER_MODE_ISR);
+        sem_init(&p->sem, 0, 1);
+    }
+
+    temp = hw_interrupt_suspend();
+
+    p->release = PERIOD_RELEASE_NONE;
+    p->next    = first;
+    p->period  = ns;
+
+    /* the deadline is the period unless it is set shorter */
+    if (!p->deadline || p->deadline > ns)
+        p->deadline = ns;
+
+    pthread->period = p;
+
+    hw_interrupt_recover(temp);
+
+    return 0;
+}
+
+/**
+ * pthread_set_deadline_np - the function will set the relative deadline of
+ *                           the periodic thread
+ *
+ * @param thread the thread
+ * @param deadline the deadline from the release, NULL means the period
+ * @param signo the signal queued to the thread on a deadline miss, 0 means none.
+ *              The value of the signal is the deadlines missed
+ *
+ * @return the result
+ */
+int pthread_set_deadline_np(pthread_t thread,
+                            const struct timespec *deadline,
+                            int signo)
+{
+    os_pthread_t *pthread = PTHREAD_POINT(thread);
+    struct pthread_period *p;
+    os_u64 ns = 0;
+
+    if (!pthread || !(p = pthread->period))
+        return -EPERM;
+
+    if (deadline && !(ns = period_ns(deadline)))
+        return -EINVAL;
+
+    p->deadline = (ns && ns < p->period) ? ns : p->period;
+    p->signo    = signo;
+
+    return 0;
+}
+
+/**
+ * pthread_wait_period_np - the function will complete the job of the current
+ *                          thread and wait for its next release
+ *
+ * @param overruns the releases missed since the last call, it can be NULL
+ *
+ * @return 0 when the thread waited for the release, -ETIMEDOUT when releases
+ *         were missed and it returns at once for the latest one
+ */
+int pthread_wait_period_np(os_u32 *overruns)
+{
+    os_pthread_t *pthread = get_current_thread();
+    struct pthread_period *p;
+    union sigval value;
+    os_u64 now, response;
+    os_u32 missed = 0;
+
+    if (!pthread || !(p = pthread->period))
+        return -EPERM;
+
+    now = clock_read(CLOCK_MONOTONIC);
+
+    /* account the job completed now */
+    if (PERIOD_RELEASE_NONE != p->release)
+    {
+        response = now - p->release;
+
+        p->jobs++;
+        p->last_response_ns = response < OS_U32_MAX ? (os_u32)response : OS_U32_MAX;
+        if (p->last_response_ns > p->worst_response_ns)
+            p->worst_response_ns = p->last_response_ns;
+
+        if (response > p->deadline)
+        {
+            p->misses++;
+
+            if (p->signo)
+            {
+                value.sival_int = (int)p->misses;
+                sigqueue((pid_t)pthread, p->signo, value);
+            }
+        }
+    }
+
+    if (now < p->next)
+        period_sleep(p, p->next);
+    else
+    {
+        /* the releases passed but the latest are dropped, so the thread keeps its phase */
+        missed = (os_u32)((now - p->next) / p->period);
+
+        p->next     += (os_u64)missed * p->period;
+        p->overruns += missed;
+    }
+
+    p->release = p->next;
+    p->next   += p->period;
+
+    if (overruns)
+        *overruns = missed;
+
+    return missed ? -ETIMEDOUT : 0;
+}
+
+/**
+ * pthread_get_period_np - the function will get the statistics of the
+ *                         periodic thread
+ *
+ * @param thread the thread
+ * @param stat the statistics
+ *
+ * @return the result
+ */
+int pthread_get_period_np(pthread_t thread, struct pthread_period_stat *stat)
+{
+    os_pthread_t *pthread = PTHREAD_POINT(thread);
+    struct pthread_period *p;
+    phys_reg_t temp;
+
+    if (!pthread || !stat)
+        return -EINVAL;
+
+    temp = hw_interrupt_suspend();
+
+    if (!(p = pthread->period))
+    {
+        hw_interrupt_recover(temp);
+        return -EPERM;
+    }
+
+    stat->period            = p->period;
+    stat->deadline          = p->deadline;
+    stat->jobs              = p->jobs;
+    stat->overruns          = p->overruns;
+    stat->misses            = p->misses;
+    stat->last_response_ns  = p->last_response_ns;
+    stat->worst_response_ns = p->worst_response_ns;
+
+    hw_interrupt_recover(temp);
+
+    return 0;
+}
+
+/*
+ * __pthread_period_exit - the function will stop the releases of the thread
+ *                         and free them, it is called by the thread itself
+ *                         when it exits or stops being periodic
+ *
+ * @param pthread the thread
+ */
+void __pthread_period_exit(os_pthread_t *pthread)
+{
+    struct pthread_period *p;
+    phys_reg_t temp;
+
+    temp = hw_interrupt_suspend();
+    p = pthread->period;
+    pthread->period = NULL;
+    hw_interrupt_recover(temp);
+
+    if (!p)
+        return ;
+
+    hrtimer_cancel(&p->timer);
+    free(p);
+}
@@ -0,0 +1,230 @@
+/*
+ * File         : priobench.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-24       DongHeng        create
+ */
+
+#include "priobench.h"
+#include "sched.h"
+#include "stdlib.h"
+#include "string.h"
+#include "shell.h"
+
+/*@{*/
+
+/* the bitmaps and the rounds over them run by the shell command */
+#define PRIOBENCH_MAPS          32
+#define PRIOBENCH_ROUNDS        64
+
+/* the most threads ready of a bitmap besides the idle thread */
+#define PRIOBENCH_READY_MAX     4
+
+typedef os_u32 (*priobench_func_t)(const struct sched_bitmap *map);
+
+/*@}*/
+
+/*@{*/
+
+static os_u32 priobench_rand(os_u32 *seed)
+{
+    os_u32 x = *seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    return *seed = x;
+}
+
+/*
+ * priobench_none - the call and the loop only
+ */
+static os_u32 priobench_none(const struct sched_bitmap *map)
+{
+    return map->group;
+}
+
+/*
+ * priobench_table - the remap table of the scheduler of 32 priorities, the
+ *                   byte of the highest bit is found by the branches
+ */
+static os_u32 priobench_table(const struct sched_bitmap *map)
+{
+    static OS_RO os_u8 priobench_remap_table[OS_U8_MAX + 1] =
+    {
+        0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,
+
+        4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+
+        5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+        5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+
+        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+
+        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    };
+    os_u32 read_group = map->word[0];
+    os_u32 offset = 0;
+
+    if (read_group & 0xff000000)
+    {
+        read_group >>= 24;
+        offset = 24;
+    }
+    else if (read_group & 0x00ff0000)
+    {
+        read_group >>= 16;
+        offset = 16;
+    }
+    else if (read_group & 0x0000ff00)
+    {
+        read_group >>= 8;
+        offset = 8;
+    }
+
+    return priobench_remap_table[read_group] + offset;
+}
+
+/*
+ * priobench_fill - set the idle thread and some threads of the random
+ *                  priorities lower than the limit ready
+ */
+static void priobench_fill(struct sched_bitmap *map, os_u32 limit, os_u32 *seed)
+{
+    os_u32 i, ready, prio;
+
+    memset(map, 0, sizeof(struct sched_bitmap));
+
+    ready = priobench_rand(seed) % PRIOBENCH_READY_MAX + 1;
+    for (i = 0; i <= ready; i++)
+    {
+        prio = i ? priobench_rand(seed) % limit : PTHREAD_PRIORITY_MIN;
+
+        map->word[PTHREAD_PRIO_WORD(prio)] |= PTHREAD_PRIO_MASK(prio);
+        map->group |= 1UL << PTHREAD_PRIO_WORD(prio);
+    }
+}
+
+/*
+ * priobench_time - the cycles of the lookups of the bitmaps, the function is
+ *                  called by the volatile point so it is not inlined
+ */
+static os_u32 priobench_time(priobench_func_t volatile func,
+                             const struct sched_bitmap *map,
+                             os_u32 maps,
+                             os_u32 rounds)
+{
+    volatile os_u32 sink = 0;
+    os_u32 start, i, j;
+
+    start = hw_cycle_get();
+
+    for (i = 0; i < rounds; i++)
+    {
+        for (j = 0; j < maps; j++)
+            sink += func(&map[j]);
+    }
+
+    return hw_cycle_get() - start;
+}
+
+/*@}*/
+
+/**
+ * priobench_run - the function will time the lookup of the highest ready
+ *                 priority by the remap table of 32 priorities and by the
+ *                 bitmap of two levels of all priorities
+ *
+ * @param maps the random bitmaps
+ * @param rounds the rounds over the bitmaps
+ * @param seed the seed of the bitmaps, the same seed gives the same bitmaps
+ * @param result the result
+ *
+ * @return the result
+ */
+err_t priobench_run(os_u32 maps, os_u32 rounds, os_u32 seed, struct priobench_result *result)
+{
+    struct sched_bitmap *low, *all;
+    phys_reg_t temp;
+    os_u32 i;
+
+    if (!result || !maps || !rounds)
+        return -EINVAL;
+
+    if (!hw_cycle_freq())
+        return -ENODEV;
+
+    if (!(low = malloc(2 * maps * sizeof(struct sched_bitmap))))
+        return -ENOMEM;
+    all = low + maps;
+
+    if (!seed)
+        seed = 1;
+
+    result->lookups    = maps * rounds;
+    result->mismatches = 0;
+
+    /* the table knows 32 priorities, the bitmap of two levels is timed by all of them */
+    for (i = 0; i < maps; i++)
+    {
+        priobench_fill(&low[i], 32, &seed);
+        priobench_fill(&all[i], PTHREAD_READY_GROUP_MAX, &seed);
+
+        if (priobench_table(&low[i]) != sched_bitmap_highest(&low[i]))
+            result->mismatches++;
+    }
+
+    /* the interrupt is suspended, so the cycles are of the lookups only */
+    temp = hw_interrupt_suspend();
+
+    result->none_cycles  = priobench_time(priobench_none, low, maps, rounds);
+    result->table_cycles = priobench_time(priobench_table, low, maps, rounds);
+    result->clz_cycles   = priobench_time(sched_bitmap_highest, all, maps, rounds);
+
+    hw_interrupt_recover(temp);
+
+    free(low);
+
+    return 0;
+}
+
+/******************************************************************************/
+
+static void priobench(struct shell_dev *shell_dev)
+{
+    struct priobench_result result;
+    os_u32 none, table, clz;
+
+    if (priobench_run(PRIOBENCH_MAPS, PRIOBENCH_ROUNDS, 1, &result))
+    {
+        shell_printk(shell_dev, "\r\nthe cycle counter is not started");
+        return ;
+    }
+
+    /* the cycles of a lookup in 1/100 */
+    none  = (os_u32)((os_u64)result.none_cycles * 100 / result.lookups);
+    table = (os_u32)((os_u64)result.table_cycles * 100 / result.lookups);
+    clz   = (os_u32)((os_u64)result.clz_cycles * 100 / result.lookups);
+
+    shell_printk(shell_dev, "\r\n%d priorities, %d lookups, %d mismatches",
+                            PTHREAD_READY_GROUP_MAX, result.lookups, result.mismatches);
+    shell_printk(shell_dev, "\r\n%-10s%-10s", "lookup", "cycles");
+    shell_printk(shell_dev, "\r\n%-10s%d.%02d", "none", none / 100, none % 100);
+    shell_printk(shell_dev, "\r\n%-10s%d.%02d", "table", table / 100, table % 100);
+    shell_printk(shell_dev, "\r\n%-10s%d.%02d", "clz", clz / 100, clz % 100);
+}
+SHELL_CMD_EXPORT(priobench, cycles of the lookup of the highest ready priority, 1);
@@ -9,9 +9,11 @@
 
 #include "pthread.h"
 #include "sched.h"
+#include "time.h"
 #include "debug.h"
 #include "stdlib.h"
 #include "string.h"
+#include "trace.h"
 
 /*@{*/
 #define USR_INIT_TYPE_DEFAULT       PTHREAD_TYPE_USER
@@ -22,6 +24,9 @@
 
 #define PTHREAD_STACK_SIZE_MIN      256
 
+/* the words of the stack scanned at once with the interrupt suspended */
+#define PTHREAD_STACK_SCAN_WORDS    64
+
 /*@}*/
 
 /*@{*/
@@ -43,6 +48,69 @@ int pthread_setname_np(pthread_t thread, const char *name) {
 	return 0;
 }
 
+/*
+ * __pthread_stack_used - the function will find the deepest byte of the stack
+ *                        not painted any more. The stack is scanned by pieces
+ *                        with the interrupt suspended, and the scan stops when
+ *                        the thread is closed, so the interrupt is not blocked
+ *                        for the whole stack and a closed stack is not read.
+ *                        The caller must not suspend the interrupt.
+ *
+ * @param pthread the thread
+ *
+ * @return the most bytes of the stack used, 0 if the thread is closed
+ */
+size_t __pthread_stack_used(os_pthread_t *pthread) {
+	os_u32 *stk = (os_u32 *) ALIGN((phys_addr_t) PTHREAD_STACK_FLOOR(pthread));
+	os_u32 *top = (os_u32 *) ((phys_addr_t) (pthread->stk_addr + pthread->stk_size) & ~(sizeof(os_u32) - 1));
+	os_u32 *end;
+	phys_reg_t temp;
+
+	while (stk < top) {
+		end = top - stk > PTHREAD_STACK_SCAN_WORDS ? stk + PTHREAD_STACK_SCAN_WORDS : top;
+
+		temp = hw_interrupt_suspend();
+
+		if (PTHREAD_STATE_CLOSED == pthread->status) {
+			hw_interrupt_recover(temp);
+			return 0;
+		}
+
+		while (stk < end && PTHREAD_STACK_PAINT_WORD == *stk)
+		stk++;
+
+		hw_interrupt_recover(temp);
+
+		if (stk < end)
+		break;
+	}
+
+	return (size_t)((char *) top - (char *) stk);
+}
+
+/*
+ * pthread_get_stack_np - the function will get the high water mark of the
+ *                        stack of the thread
+ *
+ * @param thread the handle of the thread
+ * @param used the most bytes of the stack used
+ * @param size the bytes of the stack
+ *
+ * @return the result
+ */
+int pthread_get_stack_np(pthread_t thread, size_t *used, size_t *size) {
+	os_pthread_t *pthread = (os_pthread_t *) thread;
+
+	if (!pthread || !used)
+	return -EINVAL;
+
+	*used = __pthread_stack_used(pthread);
+	if (size)
+	*size = pthread->stk_size;
+
+	return 0;
+}
+
 /*
  * pthread_attr_setstacksize - the function will set the stack address point and
  *                             the stack size of the thread
@@ -108,8 +176,11 @@ int pthread_attr_setschedparam(pthread_attr_t *RESTRICT attr,
 			&& param->type != PTHREAD_TYPE_KERNEL)
 	return -EINVAL;
 
+#if PTHREAD_PRIORITY_MAX < 255
+	/* the priority of os_u8 only goes over the maximum configured lower */
 	if (param->init_prio > PTHREAD_PRIORITY_MAX)
 	return -EINVAL;
+#endif
 	if (param->init_ticks == 0)
 	return -EINVAL;
 
@@ -137,8 +208,10 @@ bool __pthread_attr_check(const pthread_attr_t *RESTRICT pthread_attr)
 	return false;
 	if (pthread_attr->stk_size < PTHREAD_STACK_SIZE_MIN)
 	return false;
+#if PTHREAD_PRIORITY_MAX < 255
 	if (pthread_attr->init_prio > PTHREAD_PRIORITY_MAX)
 	return false;
+#endif
 	if (pthread_attr->init_ticks == 0)
 	return false;
 
@@ -159,6 +232,12 @@ void __pthread_exit_entry(void *arg) {
 	phys_reg_t temp;
 	os_pthread_t *thread;
 
+	/* the releases of the periodic thread are stopped before it is closed */
+	__pthread_period_exit(get_current_thread());
+
+	/* the bandwidth of the EDF band is given back */
+	sched_setdeadline_np((pthread_t)get_current_thread(), NULL, NULL, NULL);
+
 	temp = hw_interrupt_suspend();
 
 	thread = get_current_thread();
@@ -244,7 +323,7 @@ os_pthread_t* __pthread_create(const pthread_attr_t *RESTRICT pthread_attr,
 
 	pthread->init_prio = thread_attr_init.init_prio;
 	pthread->cur_prio = pthread->init_prio;
-	pthread->prio_mask = 1 << pthread->cur_prio;
+	pthread->prio_mask = PTHREAD_PRIO_MASK(pthread->cur_prio);
 
 	pthread->init_ticks = thread_attr_init.init_ticks;
 	pthread->cur_ticks = pthread->init_ticks;
@@ -252,6 +331,10 @@ os_pthread_t* __pthread_create(const pthread_attr_t *RESTRICT pthread_attr,
 	pthread->status = PTHREAD_STATE_INIT;
 	pthread->type = thread_attr_init.type;
 
+	/* the bytes still painted are never used, the canary is under them */
+	memset(pthread->stk_addr, PTHREAD_STACK_PAINT, pthread->stk_size);
+	*(os_u32 *) pthread->stk_addr = PTHREAD_STACK_CANARY;
+
 	pthread->sp = pthread_hw_stack_init(pthread->start_routine,
 			pthread->arg,
 			(char *)((size_t)pthread->stk_addr + pthread->stk_size - 4),
@@ -338,15 +421,26 @@ int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
 	return 0;
 }
 
+/* the structure description of the thread waiting for the mutex */
+struct pthread_mutex_waiter
+{
+	/* the node at the wait list of the mutex */
+	list_t list;
+
+	/* the thread waiting */
+	os_pthread_t *thread;
+};
+
 /*
  * __pthread_mutex_lock - the function will try to take the mutex if it is 
  *                        now owned, otherwise will suspend the current thread
  *
  * @param mutex the point of the mutex
+ * @param ticks the point of the left ticks to wait, NULL means waiting forever
  *
  * @return the result of taking the mutex
  */
-INLINE int __pthread_mutex_lock(pthread_mutex_t *mutex) {
+INLINE int __pthread_mutex_lock(pthread_mutex_t *mutex, os_u32 *ticks) {
 	phys_reg_t temp;
 	os_pthread_t *thread;
 	int ret;
@@ -363,6 +457,7 @@ INLINE int __pthread_mutex_lock(pthread_mutex_t *mutex) {
 	if (NULL == mutex->own_thread) {
 		/* the current thread owns the mutex */
 		mutex->own_thread = thread;
+		TRACE_RECORD(TRACE_EV_MUTEX_LOCK, 0, 0, mutex);
 
 		ret = 0;
 	} else /* if the mutex is locked */
@@ -370,7 +465,12 @@ INLINE int __pthread_mutex_lock(pthread_mutex_t *mutex) {
 		/* if the thread already has the lock */
 		if (thread == mutex->own_thread) {
 			ret = -EDEADLK;
+		} else if (ticks && !*ticks) {
+			ret = -ETIMEDOUT;
 		} else {
+			struct pthread_mutex_waiter waiter;
+			os_u16 sleep_ticks = 0;
+
 			/* priority inversion */
 			if (thread->cur_prio > (mutex->own_thread)->cur_prio) {
 				/* change the priority of the thread owned the mutex, then wakeup it */
@@ -380,14 +480,31 @@ INLINE int __pthread_mutex_lock(pthread_mutex_t *mutex) {
 				 thread->cur_priority);
 				 */
 			}
-			/* set current thread wait state */
-			sched_set_thread_suspend(thread);
 
 			/* insert the current thread to the wait list */
-			list_insert_tail(&mutex->wait_list, &thread->list);
+			waiter.thread = thread;
+			list_insert_tail(&mutex->wait_list, &waiter.list);
+
+			/* set current thread wait state */
+			if (ticks) {
+				sleep_ticks = *ticks > OS_U16_MAX ? OS_U16_MAX : *ticks;
+				thread->sleep_ticks = sleep_ticks;
+				sched_set_thread_sleep(thread);
+			} else {
+				sched_set_thread_suspend(thread);
+				list_init(&thread->list);
+			}
 
 			sched_switch_thread();
 
+			hw_interrupt_recover(temp);
+
+			/* wake up by timeout, so remove the waiter by ourselves */
+			temp = hw_interrupt_suspend();
+			list_remove_node(&waiter.list);
+			if (ticks)
+				*ticks -= sleep_ticks - thread->sleep_ticks;
+
 			ret = -EAGAIN;
 		}
 	}
@@ -411,13 +528,44 @@ int pthread_mutex_lock(pthread_mutex_t *mutex) {
 	int ret;
 
 	for (i = MUTEX_RECURSIVE_MAX; i > 0; i--) {
-		if ((ret = __pthread_mutex_lock(mutex)) != -EAGAIN)
+		if ((ret = __pthread_mutex_lock(mutex, NULL)) != -EAGAIN)
 			break;
 	}
 
 	return ret;
 }
 
+/*
+ * pthread_mutex_timedlock - the function will try to take the mutex if it is 
+ *                           now owned, otherwise will suspend the current 
+ *                           thread until the absolute time of CLOCK_REALTIME
+ *
+ * @param mutex the point of the mutex
+ * @param abstime the absolute time when the waiting is stopped
+ *
+ * @return the result of taking the mutex, -ETIMEDOUT means timeout
+ */
+int pthread_mutex_timedlock(pthread_mutex_t *mutex, const struct timespec *abstime) {
+	struct timespec now;
+	os_s32 ms;
+	os_u32 ticks;
+	int ret;
+
+	if (!abstime || abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000)
+		return -EINVAL;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	ms = (abstime->tv_sec - now.tv_sec) * 1000 
+	     + (abstime->tv_nsec - now.tv_nsec) / 1000000;
+
+	/* the time passed only tries to take the mutex once */
+	ticks = ms > 0 ? (ms + RTOS_SYS_TICK_PERIOD - 1) / RTOS_SYS_TICK_PERIOD : 0;
+
+	while ((ret = __pthread_mutex_lock(mutex, &ticks)) == -EAGAIN);
+
+	return ret;
+}
+
 /*
  * the function will try to release the mutex if it is now owned, otherwise will 
  * suspend the current thread
@@ -440,9 +588,10 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex) {
 
 	/* check if current thread owns it */
 	if (thread == mutex->own_thread) {
-		os_pthread_t *thread_wait;
+		struct pthread_mutex_waiter *waiter;
 
 		mutex->own_thread = NULL;
+		TRACE_RECORD(TRACE_EV_MUTEX_UNLOCK, 0, 0, mutex);
 
 		/* recover the prioity current thread */
 		if (thread->cur_prio != thread->init_prio) {
@@ -454,11 +603,14 @@ int pthread_mutex_unlock(pthread_mutex_t *mutex) {
 		}
 
 		/* wakeup one thread in the wait queue */
-		LIST_FOR_EACH_HEAD_NEXT(thread_wait,
+		LIST_FOR_EACH_HEAD_NEXT(waiter,
 				&mutex->wait_list,
-				os_pthread_t,
+				struct pthread_mutex_waiter,
 				list) {
-			sched_set_thread_ready(thread_wait);
+			list_remove_node(&waiter->list);
+			list_init(&waiter->list);
+
+			sched_set_thread_ready(waiter->thread);
 			sched_switch_thread();
 			break;
 		}
@@ -13,6 +13,9 @@
 #include "string.h"
 #include "debug.h"
 #include "stdio.h"
+#include "stdlib.h"
+#include "shell.h"
+#include "trace.h"
 
 /*@{*/
 
@@ -25,6 +28,14 @@
 #define SCHED_IS_LOCKED      1
 #define SCHED_IS_UNLOCKED    0
 
+/*
+ * the cpu usage of the thread is decayed exponentially, the last window
+ * weighs 1/(1 << SCHED_USAGE_DECAY), and it keeps SCHED_USAGE_SHIFT bits
+ * of fraction in 1/1000
+ */
+#define SCHED_USAGE_DECAY    2
+#define SCHED_USAGE_SHIFT    8
+
 /******************************************************************************/
 
 /* CPU usage structure description */
@@ -43,7 +54,7 @@ struct usage
 /* scheduler structure description */
 struct sched
 {
-    os_u32              thread_ready_group;
+    struct sched_bitmap ready;
     list_t              thread_ready_table[PTHREAD_READY_GROUP_MAX];
     
     list_t              thread_sleep_list;
@@ -55,6 +66,31 @@ struct sched
     struct usage        usage;
     
     os_u32              locked;
+    
+    /* the bandwidth admitted to the EDF band in 1/SCHED_DL_BW_UNIT */
+    os_u32              dl_bw;
+    
+    /* the cycle the current thread is switched in, and the last window of the cpu usage */
+    os_u32              switch_cycle;
+    os_u32              window_start;
+    os_u32              window_cycles;
+};
+
+/* the thread of the EDF band, it is a constant bandwidth server of its budget */
+struct sched_dl
+{
+    /* the budget of a period, the relative deadline and the period in nanosecond */
+    os_u64              runtime;
+    os_u64              deadline;
+    os_u64              period;
+    
+    /* the absolute deadline of CLOCK_MONOTONIC, the budget left, and the time the thread is switched in */
+    os_u64              abs_deadline;
+    os_s64              budget;
+    os_u64              stamp;
+    
+    os_u32              bw;
+    os_u32              exhausted;
 };
 
 /*@}*/
@@ -72,57 +108,233 @@ NO_INIT os_u32 interrupt_to_thread KERNEL_SECTION;
 /*@{*/
 
 /**
- * This function will get the highest priority thread
+ * This function will get the highest priority thread, the word of the group
+ * and the priority at the word are found by a CLZ each
  *
- * @param read_group the read threads record bit group
+ * @param map the ready bitmap, the idle thread keeps it not empty
  *
  * @return thread number which has the highest priority
  */
-INLINE os_u16 sched_get_highest_ready_group(os_u32 read_group)
+INLINE os_u32 sched_get_highest_ready_group(const struct sched_bitmap *map)
+{
+    os_u32 word = 31 - hw_clz(map->group);
+    
+    return (word << 5) + 31 - hw_clz(map->word[word]);
+}
+
+/**
+ * This function will set the priority of the thread ready at the bitmap
+ *
+ * @param thread the thread point to be handled
+ */
+INLINE void sched_ready_set(os_pthread_t *thread)
+{
+    os_u32 word = PTHREAD_PRIO_WORD(thread->cur_prio);
+    
+    sched.ready.word[word] |= thread->prio_mask;
+    sched.ready.group |= 1UL << word;
+}
+
+/**
+ * This function will clear the priority of the thread at the bitmap when no
+ * thread of the priority is ready
+ *
+ * @param thread the thread point to be handled
+ */
+INLINE void sched_ready_clear(os_pthread_t *thread)
+{
+    os_u32 word;
+    
+    if (!list_is_empty(&sched.thread_ready_table[thread->cur_prio]))
+        return ;
+    
+    word = PTHREAD_PRIO_WORD(thread->cur_prio);
+    if (!(sched.ready.word[word] &= ~thread->prio_mask))
+        sched.ready.group &= ~(1UL << word);
+}
+
+/**
+ * This function will convert the time to nanosecond, the invalid one is 0
+ */
+INLINE os_u64 sched_dl_ns(const struct timespec *ts)
+{
+    if (ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000L)
+        return 0;
+    
+    return (os_u64)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+/**
+ * This function will charge the time run to the budget
+ *
+ * @param dl the parameters of the thread
+ * @param now the time of CLOCK_MONOTONIC
+ *
+ * @return true if the budget is exhausted
+ */
+INLINE bool sched_dl_charge(struct sched_dl *dl, os_u64 now)
 {
-	os_u16 offset = 0;
-    /* scheduler thread priority mapped table */
-    STATIC OS_RO os_u8 sched_priority_remap_table[OS_U8_MAX + 1] =
+    dl->budget -= (os_s64)(now - dl->stamp);
+    dl->stamp = now;
+    
+    if (dl->budget > 0)
+        return false;
+    
+    dl->exhausted++;
+    
+    return true;
+}
+
+/**
+ * This function will recharge the exhausted budget at once and postpone the
+ * deadline by the period, so the thread keeps its bandwidth
+ *
+ * @param dl the parameters of the thread
+ */
+INLINE void sched_dl_postpone(struct sched_dl *dl)
+{
+    while (dl->budget <= 0)
     {
-        0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3,
-    
-        4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
-    
-        5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 
-        5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
-    
-        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-        6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
-    
-        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-        7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
-    };
-  
-    if (read_group & 0xff000000)
+        dl->budget += dl->runtime;
+        dl->abs_deadline += dl->period;
+    }
+}
+
+/**
+ * This function will give the thread woken up a new deadline unless the budget
+ * left fits in the bandwidth until the current deadline, the thread throttled
+ * is recharged here too
+ *
+ * @param dl the parameters of the thread
+ * @param now the time of CLOCK_MONOTONIC
+ */
+INLINE void sched_dl_wakeup(struct sched_dl *dl, os_u64 now)
+{
+    if (dl->abs_deadline <= now || dl->budget <= 0 ||
+        (os_u64)dl->budget * dl->period > (dl->abs_deadline - now) * dl->runtime)
     {
-        read_group >>= 24;
-        offset = 24;
+        dl->abs_deadline = now + dl->deadline;
+        dl->budget = dl->runtime;
     }
-    else if (read_group & 0x00ff0000)
+}
+
+/**
+ * This function will insert the thread into the tail of the thread-ready list,
+ * the threads of the EDF band are inserted by the absolute deadline
+ *
+ * @param thread the thread point to be handled
+ */
+INLINE void sched_ready_insert(os_pthread_t *thread)
+{
+    list_t *head = &sched.thread_ready_table[thread->cur_prio];
+    list_t *next;
+    os_pthread_t *pos;
+    
+    if (thread->dl)
     {
-        read_group >>= 16;
-        offset = 16;
+        /* the threads of the same deadline run in the order of readiness */
+        for (next = head->next; next != head; next = next->next)
+        {
+            pos = LIST_ENTRY(next, os_pthread_t, list);
+            if (pos->dl && pos->dl->abs_deadline > thread->dl->abs_deadline)
+                break;
+        }
+        
+        __list_insert(next->prev, next, &thread->list);
     }
-    else if (read_group & 0x0000ff00)
+    else
+        list_insert_tail(head, &thread->list);
+    
+    sched_ready_set(thread);
+}
+
+/**
+ * This function will throttle the thread ready whose budget is exhausted as
+ * the hard CBS does, it sleeps until its deadline and is recharged when it is
+ * woken up. The thread of the signal handler can not sleep, so its deadline
+ * is postponed instead
+ *
+ * @param thread the thread point to be handled
+ * @param now the time of CLOCK_MONOTONIC
+ */
+STATIC void sched_dl_throttle(os_pthread_t *thread, os_u64 now)
+{
+    struct sched_dl *dl = thread->dl;
+    os_u64 ticks;
+    
+    if (PTHREAD_STATE_READY == thread->status && dl->abs_deadline > now)
+    {
+        ticks = (dl->abs_deadline - now + RTOS_SYS_TICK_PERIOD * 1000000ULL - 1) /
+                (RTOS_SYS_TICK_PERIOD * 1000000ULL);
+        thread->sleep_ticks = ticks > OS_U16_MAX ? OS_U16_MAX : (os_u16)ticks;
+        
+        sched_set_thread_sleep(thread);
+        return ;
+    }
+    
+    sched_dl_postpone(dl);
+    
+    /* the thread is moved by its new deadline */
+    if (PTHREAD_STATE_READY == thread->status || PTHREAD_STATE_INT == thread->status)
     {
-        read_group >>= 8;
-        offset = 8;
+        list_remove_node(&thread->list);
+        sched_ready_insert(thread);
     }
+}
+
+/**
+ * This function will charge the cycles from the last context switch to the
+ * thread run in them
+ *
+ * @param thread the thread point to be handled
+ * @param cycle the cycle counter now
+ */
+INLINE void sched_account(os_pthread_t *thread, os_u32 cycle)
+{
+    thread->run_cycles += (os_u32)(cycle - sched.switch_cycle);
+    sched.switch_cycle = cycle;
+}
+
+/**
+ * This function will stop the kernel when the thread has overwritten the
+ * canary under its stack, the memory under the stack is broken
+ *
+ * @param thread the thread point to be handled
+ */
+STATIC void sched_stack_overflow(os_pthread_t *thread)
+{
+    volatile bool dummy = true;
     
-    return sched_priority_remap_table[read_group] + offset;
+    klog_panic();
+    printk("thread [%s] 0x%08x stack 0x%08x - 0x%08x overflowed.\r\n", thread->name,
+                                                                        thread,
+                                                                        thread->stk_addr,
+                                                                        thread->stk_addr + thread->stk_size);
+    while(true == dummy);
+}
+
+/**
+ * This function will move the thread to the priority, the thread ready is
+ * moved to the thread-ready list of the priority
+ *
+ * @param thread the thread point to be handled
+ * @param priority the new priority
+ */
+STATIC void sched_move_thread(os_pthread_t *thread, os_u8 priority)
+{
+    bool ready = (PTHREAD_STATE_READY == thread->status || PTHREAD_STATE_INT == thread->status);
+    
+    if (ready)
+    {
+        list_remove_node(&thread->list);
+        sched_ready_clear(thread);
+    }
+    
+    thread->cur_prio = priority;
+    thread->prio_mask = PTHREAD_PRIO_MASK(priority);
+    
+    if (ready)
+        sched_ready_insert(thread);
 }
 
 /**
@@ -132,11 +344,26 @@ void sched_start(void)
 {
     extern void hw_context_switch_to(phys_reg_t sp);
   
-    os_u32 thread_ready_group_num = sched_get_highest_ready_group(sched.thread_ready_group);
+    os_u32 thread_ready_group_num = sched_get_highest_ready_group(&sched.ready);
+    os_pthread_t *thread;
     
-    sched.current_thread = LIST_HEAD_ENTRY(&sched.thread_ready_table[thread_ready_group_num],
-                                           os_pthread_t,
-                                           list);
+    thread = LIST_HEAD_ENTRY(&sched.thread_ready_table[thread_ready_group_num],
+                             os_pthread_t,
+                             list);
+    
+    TRACE_RECORD(TRACE_EV_SWITCH, thread->cur_prio, PTHREAD_STATE_INIT, thread);
+    
+    sched.current_thread = thread;
+    
+    if (sched.current_thread->dl)
+        sched.current_thread->dl->stamp = clock_read(CLOCK_MONOTONIC);
+    
+    sched.switch_cycle = hw_cycle_get();
+    sched.window_start = sched.switch_cycle;
+    
+#if PTHREAD_STACK_GUARD_SIZE
+    hw_stack_guard(PTHREAD_STACK_GUARD(thread));
+#endif
     
     hw_context_switch_to((phys_reg_t)&sched.current_thread->sp);
 }
@@ -149,12 +376,22 @@ void sched_switch_thread(void)
     phys_reg_t temp;
     os_u32 thread_ready_group_num;
     os_pthread_t *to_thread;
+    os_u64 now = 0;
     extern void hw_context_switch(phys_reg_t from_thread, phys_reg_t to_thread);
     
     /* suspend the hardware interrupt for the preparing for context switching */
     temp = hw_interrupt_suspend();
+    
+    /* the thread of the EDF band is charged before the choice, it is throttled when its budget is exhausted */
+    if (sched.current_thread && sched.current_thread->dl)
+    {
+        now = clock_read(CLOCK_MONOTONIC);
+        
+        if (sched_dl_charge(sched.current_thread->dl, now))
+            sched_dl_throttle(sched.current_thread, now);
+    }
       
-    thread_ready_group_num = sched_get_highest_ready_group(sched.thread_ready_group);
+    thread_ready_group_num = sched_get_highest_ready_group(&sched.ready);
     
     to_thread = LIST_HEAD_ENTRY(&sched.thread_ready_table[thread_ready_group_num],
                                 os_pthread_t,
@@ -167,8 +404,29 @@ void sched_switch_thread(void)
         phys_reg_t from_sp, to_sp;
         
         from_thread = sched.current_thread;
+        
+        /* the canary is overwritten only when the thread ran under its stack */
+        if (PTHREAD_STACK_OVERFLOW(from_thread))
+            sched_stack_overflow(from_thread);
+        
+        TRACE_RECORD(TRACE_EV_SWITCH, to_thread->cur_prio, from_thread->status, to_thread);
+        
         sched.current_thread = to_thread;
         
+        /* the thread still ready is preempted, the others gave up the cpu by themselves */
+        sched_account(from_thread, hw_cycle_get());
+        if (PTHREAD_STATE_READY == from_thread->status || PTHREAD_STATE_INT == from_thread->status)
+            from_thread->nivcsw++;
+        else
+            from_thread->nvcsw++;
+        
+#if PTHREAD_STACK_GUARD_SIZE
+        hw_stack_guard(PTHREAD_STACK_GUARD(to_thread));
+#endif
+        
+        if (to_thread->dl)
+            to_thread->dl->stamp = now ? now : clock_read(CLOCK_MONOTONIC);
+        
         SCHED_DEBUG(SCHED_DEBUG_ENABLE, "from thread [0x%08x] to [0x%08x]\r\n",
         									from_thread, to_thread);
         
@@ -216,6 +474,32 @@ INLINE void sched_wakeup_sleep_thread(void)
     }
 }
 
+/**
+ * This function will close the window of the cpu usage of every thread and
+ * decay its usage by the window
+ */
+INLINE void sched_proc_thread_usage(void)
+{
+    os_pthread_t *thread;
+    os_u32 cycle = hw_cycle_get();
+    os_u32 usage;
+    
+    /* the current thread is charged to now, so the window has all of its cycles */
+    sched_account(sched.current_thread, cycle);
+    
+    sched.window_cycles = cycle - sched.window_start;
+    sched.window_start = cycle;
+    
+    LIST_FOR_EACH_ENTRY(thread, &sched.thread_list, os_pthread_t, tlist)
+    {
+        usage = sched.window_cycles ?
+                (os_u32)(((thread->run_cycles - thread->mark_cycles) * 1000 << SCHED_USAGE_SHIFT) / sched.window_cycles) : 0;
+        thread->mark_cycles = thread->run_cycles;
+        
+        thread->usage = thread->usage - (thread->usage >> SCHED_USAGE_DECAY) + (usage >> SCHED_USAGE_DECAY);
+    }
+}
+
 /**
  * This function will wake up the sleeping thread if it is timeout
  */
@@ -233,6 +517,8 @@ INLINE void sched_proc_cpu_usage(void)
     if (sched.usage.cur_ticks >= sched.usage.min_ticks)
     {
     	sched.usage.usage = sched.usage.run_count / sched.usage.min_ticks;
+    	
+    	sched_proc_thread_usage();
       
     	sched.usage.run_count = 0;
     	sched.usage.cur_ticks = 0;
@@ -323,11 +609,16 @@ void sched_insert_thread(os_pthread_t *thread)
  */
 void sched_set_thread_ready(os_pthread_t *thread)
 { 
+    /* the thread of the EDF band woken up takes a new deadline by the CBS rule */
+    if (thread->dl && PTHREAD_STATE_READY != thread->status && PTHREAD_STATE_INT != thread->status)
+        sched_dl_wakeup(thread->dl, clock_read(CLOCK_MONOTONIC));
+  
     list_remove_node(&thread->list);
 
-    list_insert_tail(&sched.thread_ready_table[thread->cur_prio], &thread->list);
-    sched.thread_ready_group |= (1 << thread->cur_prio);
+    sched_ready_insert(thread);
     thread->status = PTHREAD_STATE_READY;
+    
+    TRACE_RECORD(TRACE_EV_READY, thread->cur_prio, 0, thread);
 }
 
 /**
@@ -340,8 +631,7 @@ void sched_set_thread_int(os_pthread_t *thread)
 { 
     list_remove_node(&thread->list);
 
-    list_insert_tail(&sched.thread_ready_table[thread->cur_prio], &thread->list);
-    sched.thread_ready_group |= (1 << thread->cur_prio);
+    sched_ready_insert(thread);
     thread->status = PTHREAD_STATE_INT;
 }
 
@@ -354,10 +644,11 @@ void sched_set_thread_int(os_pthread_t *thread)
 void sched_set_thread_suspend(os_pthread_t *thread)
 { 
     list_remove_node(&thread->list); 
-    if (list_is_empty(&sched.thread_ready_table[thread->cur_prio]))
-    	sched.thread_ready_group &= ~(1 << (thread->cur_prio));
+    sched_ready_clear(thread);
     
     thread->status = PTHREAD_STATE_SUSPEND;
+    
+    TRACE_RECORD(TRACE_EV_SUSPEND, thread->cur_prio, 0, thread);
 }
 
 /**
@@ -368,11 +659,12 @@ void sched_set_thread_suspend(os_pthread_t *thread)
 void sched_set_thread_sleep(os_pthread_t *thread)
 {
     list_remove_node(&thread->list);
-    if (list_is_empty(&sched.thread_ready_table[thread->cur_prio]))
-    	sched.thread_ready_group &= ~(1 << (thread->cur_prio));
+    sched_ready_clear(thread);
     
     list_insert_tail(&sched.thread_sleep_list, &thread->list);
     thread->status = PTHREAD_STATE_SLEEP;
+    
+    TRACE_RECORD(TRACE_EV_SLEEP, thread->cur_prio, thread->sleep_ticks, thread);
 }
 
 /**
@@ -383,8 +675,7 @@ void sched_set_thread_sleep(os_pthread_t *thread)
 void sched_set_thread_close(os_pthread_t *thread)
 {
     list_remove_node(&thread->list);   
-    if (list_is_empty(&sched.thread_ready_table[thread->cur_prio]))
-    	sched.thread_ready_group &= ~(1 << (thread->cur_prio));
+    sched_ready_clear(thread);
     
     thread->status = PTHREAD_STATE_CLOSED;
 }
@@ -505,6 +796,211 @@ os_u16 get_current_usage(void)
     return sched.usage.usage;
 }
 
+/**
+ * sched_setdeadline_np - the function will move the thread to the EDF band,
+ *                        it runs by the earliest absolute deadline and its
+ *                        budget is enforced as a constant bandwidth server
+ *
+ * @param thread the thread
+ * @param runtime the budget of a period, NULL moves the thread back to its priority
+ * @param deadline the relative deadline, NULL means the period
+ * @param period the period
+ *
+ * @return the result, -EBUSY when the bandwidth of the band is not enough
+ */
+int sched_setdeadline_np(pthread_t thread,
+                         const struct timespec *runtime,
+                         const struct timespec *deadline,
+                         const struct timespec *period)
+{
+    os_pthread_t *pthread = PTHREAD_POINT(thread);
+    struct sched_dl *dl, *alloc = NULL;
+    os_u64 q, d, p, now;
+    os_u32 bw, old_bw;
+    phys_reg_t temp;
+    
+    if (!pthread)
+        return -EINVAL;
+    
+    if (!runtime)
+    {
+        temp = hw_interrupt_suspend();
+        
+        if ((dl = pthread->dl))
+        {
+            sched.dl_bw -= dl->bw;
+            pthread->dl = NULL;
+            sched_move_thread(pthread, pthread->init_prio);
+        }
+        
+        hw_interrupt_recover(temp);
+        
+        free(dl);
+        sched_switch_thread();
+        
+        return 0;
+    }
+    
+    if (!period)
+        return -EINVAL;
+    
+    q = sched_dl_ns(runtime);
+    p = sched_dl_ns(period);
+    d = deadline ? sched_dl_ns(deadline) : p;
+    if (!q || q > d || d > p || p > SCHED_DL_PERIOD_MAX)
+        return -EINVAL;
+    
+    bw = (os_u32)((q << SCHED_DL_BW_SHIFT) / p);
+    
+    if (!pthread->dl && !(alloc = calloc(sizeof(struct sched_dl))))
+        return -ENOMEM;
+    
+    temp = hw_interrupt_suspend();
+    
+    /* the admission keeps the total bandwidth of the band schedulable */
+    old_bw = pthread->dl ? pthread->dl->bw : 0;
+    if (sched.dl_bw - old_bw + bw > SCHED_DL_BW_MAX)
+    {
+        hw_interrupt_recover(temp);
+        free(alloc);
+        return -EBUSY;
+    }
+    
+    if (!pthread->dl)
+        pthread->dl = alloc;
+    dl = pthread->dl;
+    
+    sched.dl_bw += bw - old_bw;
+    
+    now = clock_read(CLOCK_MONOTONIC);
+    
+    dl->runtime      = q;
+    dl->deadline     = d;
+    dl->period       = p;
+    dl->bw           = bw;
+    dl->abs_deadline = now + d;
+    dl->budget       = (os_s64)q;
+    dl->stamp        = now;
+    
+    sched_move_thread(pthread, SCHED_DL_PRIORITY);
+    
+    hw_interrupt_recover(temp);
+    
+    sched_switch_thread();
+    
+    return 0;
+}
+
+/**
+ * sched_getdeadline_np - the function will get the parameters and the state
+ *                        of the thread of the EDF band
+ *
+ * @param thread the thread
+ * @param stat the parameters and the state
+ *
+ * @return the result, -EPERM when the thread is not in the EDF band
+ */
+int sched_getdeadline_np(pthread_t thread, struct sched_dl_stat *stat)
+{
+    os_pthread_t *pthread = PTHREAD_POINT(thread);
+    struct sched_dl *dl;
+    phys_reg_t temp;
+    
+    if (!pthread || !stat)
+        return -EINVAL;
+    
+    temp = hw_interrupt_suspend();
+    
+    if (!(dl = pthread->dl))
+    {
+        hw_interrupt_recover(temp);
+        return -EPERM;
+    }
+    
+    stat->runtime      = dl->runtime;
+    stat->deadline     = dl->deadline;
+    stat->period       = dl->period;
+    stat->abs_deadline = dl->abs_deadline;
+    stat->budget       = dl->budget;
+    stat->bw           = dl->bw;
+    stat->exhausted    = dl->exhausted;
+    
+    hw_interrupt_recover(temp);
+    
+    return 0;
+}
+
+/**
+ * This function will get the highest priority set at the ready bitmap
+ *
+ * @param map the ready bitmap, it must not be empty
+ *
+ * @return the highest priority
+ */
+os_u32 sched_bitmap_highest(const struct sched_bitmap *map)
+{
+    return sched_get_highest_ready_group(map);
+}
+
+/**
+ * This function will return the bandwidth admitted to the EDF band
+ *
+ * @return the bandwidth in 1/SCHED_DL_BW_UNIT
+ */
+os_u32 sched_dl_bandwidth(void)
+{
+    return sched.dl_bw;
+}
+
+/**
+ * sched_get_thread_stat - the function will get the statistics of the threads
+ *
+ * @param stat the statistics
+ * @param max the most threads
+ *
+ * @return the threads got
+ */
+int sched_get_thread_stat(struct sched_thread_stat *stat, int max)
+{
+    os_pthread_t *thread;
+    phys_reg_t temp;
+    int num = 0, i;
+    
+    if (!stat || max <= 0)
+        return -EINVAL;
+    
+    temp = hw_interrupt_suspend();
+    
+    LIST_FOR_EACH_ENTRY(thread, &sched.thread_list, os_pthread_t, tlist)
+    {
+        if (num >= max)
+            break;
+        
+        stat->thread = (pthread_t)thread;
+        memcpy(stat->name, thread->name, STDOBJ_NAME_MAX);
+        stat->name[STDOBJ_NAME_MAX] = '\0';
+        
+        stat->status     = thread == sched.current_thread ? PTHREAD_STATE_RUN : thread->status;
+        stat->prio       = thread->cur_prio;
+        stat->usage      = (thread->usage + (1U << (SCHED_USAGE_SHIFT - 1))) >> SCHED_USAGE_SHIFT;
+        stat->run_cycles = thread->run_cycles;
+        stat->nvcsw      = thread->nvcsw;
+        stat->nivcsw     = thread->nivcsw;
+        stat->stack_size = thread->stk_size;
+        
+        stat++;
+        num++;
+    }
+    
+    hw_interrupt_recover(temp);
+    
+    /* the stacks are scanned by pieces out of the lock, a thread closed since then reports 0 */
+    for (i = 0, stat -= num; i < num; i++, stat++)
+        stat->stack_used = __pthread_stack_used(PTHREAD_POINT(stat->thread));
+    
+    return num;
+}
+
 /**
   * the function will report the current thread
   */
@@ -548,3 +1044,90 @@ int __sched_report_signal(os_pthread_t *thread,
 }
 
 /*@}*/
+
+/******************************************************************************/
+
+static void top(struct shell_dev *shell_dev)
+{
+    static const char *top_state[] =
+    {
+        "init", "ready", "suspend", "sleep", "closed", "int", "run"
+    };
+    struct sched_thread_stat *stat;
+    os_u32 freq = hw_cycle_freq() / 1000;
+    int i, num;
+    
+    if (!(stat = malloc(SCHED_TOP_THREAD_MAX * sizeof(struct sched_thread_stat))))
+        return ;
+    
+    num = sched_get_thread_stat(stat, SCHED_TOP_THREAD_MAX);
+    
+    shell_printk(shell_dev, "\r\n%-14s%-9s%-6s%-8s%-10s%-8s%-8s%-12s", "thread",
+                                                                      "state",
+                                                                      "prio",
+                                                                      "cpu(%)",
+                                                                      "time(ms)",
+                                                                      "vcsw",
+                                                                      "ivcsw",
+                                                                      "stack(B)");
+    
+    for (i = 0; i < num; i++)
+    {
+        if (stat[i].name[0])
+            shell_printk(shell_dev, "\r\n%-14s", stat[i].name);
+        else
+            shell_printk(shell_dev, "\r\n0x%08x    ", stat[i].thread);
+        
+        shell_printk(shell_dev, "%-9s%-6d%3d.%d   %-10u%-8u%-8u%u/%u", top_state[stat[i].status],
+                                                                 stat[i].prio,
+                                                                 stat[i].usage / 10,
+                                                                 stat[i].usage % 10,
+                                                                 freq ? (os_u32)(stat[i].run_cycles / freq) : 0,
+                                                                 stat[i].nvcsw,
+                                                                 stat[i].nivcsw,
+                                                                 stat[i].stack_used,
+                                                                 stat[i].stack_size);
+    }
+    
+    free(stat);
+}
+SHELL_CMD_EXPORT(top, show the cpu usage and the stack of the threads, 1);
+
+static void stack(struct shell_dev *shell_dev)
+{
+    struct sched_thread_stat *stat;
+    size_t total = 0, used = 0;
+    int i, num;
+    
+    if (!(stat = malloc(SCHED_TOP_THREAD_MAX * sizeof(struct sched_thread_stat))))
+        return ;
+    
+    num = sched_get_thread_stat(stat, SCHED_TOP_THREAD_MAX);
+    
+    shell_printk(shell_dev, "\r\n%-14s%-10s%-10s%-10s%-8s", "thread",
+                                                          "size(B)",
+                                                          "used(B)",
+                                                          "free(B)",
+                                                          "used(%)");
+    
+    for (i = 0; i < num; i++)
+    {
+        if (stat[i].name[0])
+            shell_printk(shell_dev, "\r\n%-14s", stat[i].name);
+        else
+            shell_printk(shell_dev, "\r\n0x%08x    ", stat[i].thread);
+        
+        shell_printk(shell_dev, "%-10u%-10u%-10u%u", stat[i].stack_size,
+                                                     stat[i].stack_used,
+                                                     stat[i].stack_size - stat[i].stack_used,
+                                                     stat[i].stack_used * 100 / stat[i].stack_size);
+        
+        total += stat[i].stack_size;
+        used  += stat[i].stack_used;
+    }
+    
+    shell_printk(shell_dev, "\r\n%-14s%-10u%-10u%-10u", "total", total, used, total - used);
+    
+    free(stat);
+}
+SHELL_CMD_EXPORT(stack, show the high water mark of the stack of the threads, 1);
@@ -12,6 +12,7 @@
 #include "pthread.h"
 #include "sched.h"
 #include "stdio.h"
+#include "trace.h"
 
 #define CONTROLLER_DEBUG_LEVEL  10
 
@@ -95,6 +96,8 @@ INLINE int __sem_wait (sem_t* sem)
  */
 int sem_wait (sem_t* sem)
 {
+    TRACE_RECORD(TRACE_EV_SEM_WAIT, 0, sem->value, sem);
+    
     while (__sem_wait(sem))
     {}
           
@@ -121,6 +124,8 @@ int sem_post (sem_t* sem)
     if (sem->value < sem->init_value)
         ++sem->value;
     
+    TRACE_RECORD(TRACE_EV_SEM_POST, 0, sem->value, sem);
+    
     /* wake up one thread in the wait queue */
     LIST_FOR_EACH_HEAD_NEXT(thread_wait,
                             &sem->wait_list,
@@ -9,6 +9,7 @@
  */
 #include "stdio.h"
 #include "string.h"
+#include "klog.h"
 
 int getchar(void)
 {
@@ -933,7 +934,8 @@ int sprintf(char *buf, const char *fmt, ...)
 /*@{*/
 
 /**
- * This function will print the information of kernel
+ * This function will print the information of kernel, the line is formatted
+ * to the ring of the log and written by the klog thread
  *
  * @param fmt the string should be printed
  *
@@ -943,31 +945,17 @@ ssize_t printk(const char *fmt, ...)
 {
     va_list args;
     ssize_t send_bytes;
-    static char printk_buf[256] KERNEL_SECTION;
-    extern int fputc( char ch );
-    
-#if _ATOM_
-    phys_reg_t temp;  
-    
-    temp = hw_interrupt_suspend();
-#endif
+
     va_start(args, fmt);
-    send_bytes = vsprintf(printk_buf, fmt, args);
+    send_bytes = klog_vprintf(fmt, args);
     va_end(args);
-    
-    for(ssize_t i = 0; i < send_bytes; i++)
-    {
-        fputc(printk_buf[i]);
-    }
-#if _ATOM_    
-    hw_interrupt_recover(temp);
-#endif
-    
+
     return send_bytes;
 }
 
 /**
- * This function will print the information of kernel
+ * This function will print the information of kernel, the line is formatted
+ * to the ring of the log and written by the klog thread
  *
  * @param fmt the string should be printed
  *
@@ -977,24 +965,10 @@ ssize_t printf(const char *fmt, ...)
 {
     va_list args;
     ssize_t send_bytes;
-    static char printk_buf[128] KERNEL_SECTION;
-    extern int fputc(char ch);
-#if _ATOM_
-    phys_reg_t temp;  
-    
-    temp = hw_interrupt_suspend();
-#endif
+
     va_start(args, fmt);
-    send_bytes = vsprintf(printk_buf, fmt, args);
+    send_bytes = klog_vprintf(fmt, args);
     va_end(args);
-    
-    for(ssize_t i = 0; i < send_bytes; i++)
-    {
-        fputc(printk_buf[i]);
-    }
-#if _ATOM_    
-    hw_interrupt_recover(temp);
-#endif
-    
+
     return send_bytes;
 }
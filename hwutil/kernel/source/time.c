@@ -16,6 +16,7 @@
 #include "debug.h"
 #include "pthread.h"
 #include "sched.h"
+#include "trace.h"
 
 #define TIMER_THREAD_STACK_SIZE         512U
 #define TIME_DEBUG_LEVEL  10
@@ -31,52 +32,223 @@
     #define TIME_DEBUG(level, x)
 #endif
 
-#define ITIMERSPECT_COPY(form, to) \
-            (form)->it_interval.tv_nsec = (to)->it_interval.tv_nsec; \
-            (form)->it_interval.tv_sec  = (to)->it_interval.tv_sec; \
-            (form)->it_value.tv_nsec    = (to)->it_value.tv_nsec; \
-            (form)->it_value.tv_sec     = (to)->it_value.tv_sec; \
+/* the nanoseconds of a second */
+#define TIME_NSEC_PER_SEC               1000000000ULL
+
+/* no timer is armed */
+#define TIMER_EXPIRE_NEVER              (~(os_u64)0)
 
 struct __timer
 {
-    /* timer's node list */
+    /* timer's node at the list sorted by the expiry, it is empty when the timer is disarmed */
     list_t              list;
   
     /* timer's source clock */
     clockid_t           clockid;
   
-    /* timer's time plan */
-    struct itimerspect  itimerspect;
+    /* the absolute expiry and the reload interval in nanosecond, the interval 0 means one shot */
+    os_u64              expire;
+    os_u64              interval;
+  
+    /* the expiry of the realtime clock for the absolute realtime timer, 0 means it follows the monotonic clock */
+    os_u64              realtime;
   
     /* timer's signal trigger */
     struct sigevent     igevent;
 };
 
+/* the nanoseconds of a tick */
+#define TIME_NSEC_PER_TICK              (RTOS_SYS_TICK_PERIOD * 1000000ULL)
+
+/* the most ticks slept once, the sleep_ticks of the thread is 16 bits */
+#define TIME_SLEEP_TICKS_MAX            0xFFFFU
+
+/* the armed timers sorted by the expiry, the earliest is the head */
 static list_t timer_list;
 static sem_t timer_sem;
 static os_u64 local_time;
 
+/* the expiry of the head timer, the tick only compares it */
+static os_u64 timer_next = TIMER_EXPIRE_NEVER;
+
+/* the timer thread is woken up and has not run yet */
+static volatile int timer_pending;
+
+/*
+ * the clocks are the ticks interpolated by the cycle counter: the cycles of
+ * a tick, the cycle count expected at the last tick, and the nanoseconds of
+ * a cycle in 32.32 fixed point, all 0 when there is no cycle counter
+ */
+static os_u32 tick_cycles;
+static os_u32 tick_cycle;
+static os_u64 cycle_mult;
+
+/* the offset of the realtime clock to the monotonic clock in nanosecond */
+static os_s64 realtime_offset;
+
+/*@{*/
+
+/*
+ * timespec_to_ns - convert the time to nanosecond, the invalid one is TIMER_EXPIRE_NEVER
+ */
+INLINE os_u64 timespec_to_ns(const struct timespec *ts)
+{
+    if (ts->tv_nsec < 0 || ts->tv_nsec >= (long)TIME_NSEC_PER_SEC)
+        return TIMER_EXPIRE_NEVER;
+    
+    return (os_u64)ts->tv_sec * TIME_NSEC_PER_SEC + ts->tv_nsec;
+}
+
+INLINE void ns_to_timespec(os_u64 ns, struct timespec *ts)
+{
+    ts->tv_sec  = (time_t)(ns / TIME_NSEC_PER_SEC);
+    ts->tv_nsec = (long)(ns % TIME_NSEC_PER_SEC);
+}
+
+/*
+ * timer_now - get the time of the timers in nanosecond, the interrupt must be suspended
+ */
+INLINE os_u64 timer_now(void)
+{
+    return local_time * 1000000ULL;
+}
+
+/*
+ * clock_now - get the monotonic time in nanosecond interpolated by the cycles
+ *             since the last tick, the interrupt must be suspended
+ */
+INLINE os_u64 clock_now(void)
+{
+    os_u32 delta;
+  
+    if (!tick_cycles)
+        return timer_now();
+    
+    /* the tick pending at the interrupt suspended is not counted yet, so the time stays below the next tick */
+    delta = hw_cycle_get() - tick_cycle;
+    if (delta >= tick_cycles)
+        delta = tick_cycles - 1;
+    
+    return timer_now() + ((delta * cycle_mult) >> 32);
+}
+
+/**
+ * clock_read - the function will get the time of the clock in nanosecond,
+ *              it is cheaper than clock_gettime for the drivers
+ *
+ * @param clockid the clock, CLOCK_REALTIME or CLOCK_MONOTONIC
+ *
+ * @return the time
+ */
+os_u64 clock_read(clockid_t clockid)
+{
+    phys_reg_t temp;
+    os_u64 now;
+  
+    /* the 64 bits time can not be read atomically */
+    temp = hw_interrupt_suspend();
+    
+    now = clock_now();
+    if (CLOCK_REALTIME == clockid)
+        now += realtime_offset;
+    
+    hw_interrupt_recover(temp);
+    
+    return now;
+}
+
+/*
+ * timer_update_next - the interrupt must be suspended
+ */
+INLINE void timer_update_next(void)
+{
+    if (list_is_empty(&timer_list))
+        timer_next = TIMER_EXPIRE_NEVER;
+    else
+        timer_next = LIST_HEAD_ENTRY(&timer_list, struct __timer, list)->expire;
+}
+
+/*
+ * timer_arm - insert the timer by the expiry, the timers of the same expiry
+ *             expire in the order of arming. The interrupt must be suspended.
+ */
+STATIC void timer_arm(struct __timer *timer, os_u64 expire)
+{
+    struct __timer *pos;
+    list_t *next;
+    
+    timer->expire = expire;
+    
+    /* most timers are armed later than the others, so the list is searched from the tail */
+    for (next = &timer_list; next->prev != &timer_list; next = next->prev)
+    {
+        pos = LIST_ENTRY(next->prev, struct __timer, list);
+        if (pos->expire <= expire)
+            break;
+    }
+    
+    __list_insert(next->prev, next, &timer->list);
+    
+    timer_update_next();
+}
+
+/*
+ * timer_disarm - the interrupt must be suspended
+ */
+STATIC void timer_disarm(struct __timer *timer)
+{
+    if (list_is_empty(&timer->list))
+        return ;
+  
+    list_remove_node(&timer->list);
+    list_init(&timer->list);
+    
+    timer_update_next();
+}
+
+/*
+ * timer_realtime_expire - get the monotonic expiry of the realtime expiry,
+ *                         the time passed already expires at the next tick
+ */
+INLINE os_u64 timer_realtime_expire(os_u64 realtime)
+{
+    return (os_s64)realtime > realtime_offset ? realtime - realtime_offset : 1;
+}
+
+/*
+ * timer_remain - get the time plan left of the timer, the interrupt must be suspended
+ */
+STATIC void timer_remain(struct __timer *timer, struct itimerspect *value)
+{
+    os_u64 now = clock_now();
+  
+    if (list_is_empty(&timer->list))
+        ns_to_timespec(0, &value->it_value);
+    else
+        ns_to_timespec(timer->expire > now ? timer->expire - now : 1, &value->it_value);
+    
+    ns_to_timespec(timer->interval, &value->it_interval);
+}
+
+/*@}*/
+
 INLINE timer_t __timer_create(clockid_t clockid, 
                               struct sigevent *RESTRICT evp)
 {
     struct __timer *timer;
-    phys_reg_t temp;
     
     if (!(timer = malloc(sizeof(struct __timer))))
         return 0;
   
     memcpy(&timer->igevent, evp, sizeof(struct sigevent));
-    timer->clockid = clockid;
+    timer->clockid  = clockid;
+    timer->expire   = 0;
+    timer->interval = 0;
+    timer->realtime = 0;
     
+    /* the timer is disarmed until it is set */
     list_init(&timer->list);
     
-    /* suspend the hardware interrupt for the preparing for context switching */
-    temp = hw_interrupt_suspend();
-    
-    list_insert_tail(&timer_list, &timer->list);
-    
-    hw_interrupt_recover(temp);
-    
     return (timer_t)timer;
 }
 
@@ -84,7 +256,7 @@ int timer_create (clockid_t clockid, struct sigevent *RESTRICT evp, timer_t *RES
 {
     *timerid = 0;
   
-    if (CLOCK_REALTIME != clockid)
+    if (CLOCK_REALTIME != clockid && CLOCK_MONOTONIC != clockid)
         return -EINVAL;
     
     if (!evp)
@@ -93,77 +265,355 @@ int timer_create (clockid_t clockid, struct sigevent *RESTRICT evp, timer_t *RES
     switch (evp->sigev_notify)
     {
         case SIGEV_THREAD:
-                    *timerid = __timer_create(clockid, evp);
+                    if (!(*timerid = __timer_create(clockid, evp)))
+                        return -ENOMEM;
                     break;
         default:
-                    break;
+                    return -EINVAL;
     }
   
     return 0;
 }
 
+/**
+ * timer_settime - the function will arm or disarm the timer
+ *
+ * @param timerid the timer
+ * @param flags TIMER_ABSTIME means it_value is the time of the clock, otherwise the time from now
+ * @param value the time plan, it_value 0 disarms the timer
+ * @param ovalue the time plan left before, it can be NULL
+ *
+ * @return the result
+ */
 int timer_settime (timer_t timerid, 
                    int flags, 
                    const struct itimerspect *value, 
                    struct itimerspect *ovalue)
 {
     struct __timer *timer = (struct __timer *)timerid;
+    os_u64 expire, interval;
     phys_reg_t temp;
     
     if (!timerid || !value)
         return -EINVAL;
   
+    expire   = timespec_to_ns(&value->it_value);
+    interval = timespec_to_ns(&value->it_interval);
+    if (TIMER_EXPIRE_NEVER == expire || TIMER_EXPIRE_NEVER == interval)
+        return -EINVAL;
+    
     /* suspend the hardware interrupt for the preparing for context switching */
     temp = hw_interrupt_suspend();
     
     if (ovalue)
-        ITIMERSPECT_COPY(ovalue, &timer->itimerspect);
+        timer_remain(timer, ovalue);
+    
+    timer_disarm(timer);
+    timer->interval = interval;
+    timer->realtime = 0;
+    
+    if (expire)
+    {
+        /*
+         * the relative time starts from the interpolated clock, so the timer
+         * never expires early, and the absolute realtime timer is re-keyed
+         * when the realtime clock is set
+         */
+        if (!(flags & TIMER_ABSTIME))
+            expire += clock_now();
+        else if (CLOCK_REALTIME == timer->clockid)
+        {
+            timer->realtime = expire;
+            expire = timer_realtime_expire(expire);
+        }
+        
+        timer_arm(timer, expire);
+    }
+    
+    hw_interrupt_recover(temp);
+  
+    return 0;
+}
+
+/**
+ * clock_settime - the function will set the realtime clock, the absolute
+ *                 realtime timers are re-keyed to the new time, the monotonic
+ *                 clock and the relative timers are not changed
+ *
+ * @param clockid the clock, only CLOCK_REALTIME can be set
+ * @param tp the time
+ *
+ * @return the result
+ */
+int clock_settime (clockid_t clockid, const struct timespec *tp)
+{
+    struct __timer *timer;
+    list_t *pos, *next;
+    list_t realtime_list;
+    phys_reg_t temp;
+    os_u64 ns;
+  
+    if (!tp || CLOCK_REALTIME != clockid)
+        return -EINVAL;
+    
+    if (TIMER_EXPIRE_NEVER == (ns = timespec_to_ns(tp)))
+        return -EINVAL;
+    
+    list_init(&realtime_list);
+    
+    temp = hw_interrupt_suspend();
+    
+    realtime_offset = (os_s64)(ns - clock_now());
     
-    ITIMERSPECT_COPY(&timer->itimerspect, value);
+    /* the absolute realtime timers are taken out and armed again by the new expiry */
+    for (pos = timer_list.next; pos != &timer_list; pos = next)
+    {
+        next = pos->next;
+        
+        if (LIST_ENTRY(pos, struct __timer, list)->realtime)
+        {
+            list_remove_node(pos);
+            list_insert_tail(&realtime_list, pos);
+        }
+    }
+    
+    while (!list_is_empty(&realtime_list))
+    {
+        timer = LIST_HEAD_ENTRY(&realtime_list, struct __timer, list);
+        list_remove_node(&timer->list);
+        
+        timer_arm(timer, timer_realtime_expire(timer->realtime));
+    }
     
     hw_interrupt_recover(temp);
+    
+    return 0;
+}
+
+/**
+ * clock_gettime - the function will get the time of the clock, it is
+ *                 interpolated by the cycle counter to the sub-microsecond
+ *
+ * @param clockid the clock
+ * @param tp the time
+ *
+ * @return the result
+ */
+int clock_gettime (clockid_t clockid, struct timespec *tp)
+{
+    if (!tp)
+        return -EINVAL;
+    
+    if (CLOCK_REALTIME != clockid && CLOCK_MONOTONIC != clockid)
+        return -EINVAL;
+    
+    ns_to_timespec(clock_read(clockid), tp);
+    
+    return 0;
+}
+
+/**
+ * clock_nanosleep - the function will suspend the thread until the time of
+ *                   the clock, the whole ticks are slept and the rest is spun
+ *                   on the cycle counter
+ *
+ * @param clockid the clock
+ * @param flags TIMER_ABSTIME means rqtp is the time of the clock, otherwise the time from now
+ * @param rqtp the time
+ * @param rmtp the time left, it is always 0 as the sleep is not interrupted. It can be NULL
+ *
+ * @return the result
+ */
+int clock_nanosleep (clockid_t clockid, int flags, 
+                     const struct timespec *rqtp, struct timespec *rmtp)
+{
+    os_pthread_t *current_pthread;
+    phys_reg_t temp;
+    os_u64 wake, now, ticks;
   
+    if (!rqtp)
+        return -EINVAL;
+    
+    if (CLOCK_REALTIME != clockid && CLOCK_MONOTONIC != clockid)
+        return -EINVAL;
+    
+    if (TIMER_EXPIRE_NEVER == (wake = timespec_to_ns(rqtp)))
+        return -EINVAL;
+    
+    now = clock_read(clockid);
+    if (!(flags & TIMER_ABSTIME))
+        wake += now;
+    
+    current_pthread = get_current_thread();
+    
+    while (wake > now)
+    {
+        /* the whole ticks left are slept, so the thread wakes up a little early but never late */
+        if (current_pthread && (ticks = (wake - now) / TIME_NSEC_PER_TICK))
+        {
+            temp = hw_interrupt_suspend();
+            
+            current_pthread->sleep_ticks = ticks < TIME_SLEEP_TICKS_MAX ? ticks : TIME_SLEEP_TICKS_MAX;
+            sched_set_thread_sleep(current_pthread);
+            
+            sched_switch_thread();
+            
+            hw_interrupt_recover(temp);
+        }
+        
+        now = clock_read(clockid);
+    }
+    
+    if (rmtp)
+        ns_to_timespec(0, rmtp);
+    
     return 0;
 }
 
-int clock_settime (clockid_t, const struct timespec *);
+/*
+ * udelay - spin for the microseconds on the cycle counter, or on the ticks
+ *          when there is no cycle counter
+ */
+void udelay(int us)
+{
+    os_u32 start, cycles, freq;
+    os_u64 wake;
+  
+    if (us <= 0)
+        return ;
+    
+    if ((freq = hw_cycle_freq()))
+    {
+        start = hw_cycle_get();
+        
+        /* the counter wraps in some seconds, so the long delays are split */
+        while (us)
+        {
+            cycles = (us < 1000000 ? us : 1000000);
+            us -= cycles;
+            cycles = (os_u32)((os_u64)cycles * freq / 1000000);
+            
+            while (hw_cycle_get() - start < cycles);
+            start += cycles;
+        }
+    }
+    else
+    {
+        wake = clock_read(CLOCK_MONOTONIC) + (os_u64)us * 1000;
+        while (clock_read(CLOCK_MONOTONIC) < wake);
+    }
+}
+
+void mdelay(int ms)
+{
+    while (ms-- > 0)
+        udelay(1000);
+}
 
+/**
+ * timer_gettime - the function will get the time left to the expiry and the
+ *                 reload interval of the timer
+ *
+ * @param timerid the timer
+ * @param value the time plan left, it_value 0 means the timer is disarmed
+ *
+ * @return the result
+ */
 int timer_gettime (timer_t timerid, struct itimerspect *value)
 {
+    struct __timer *timer = (struct __timer *)timerid;
+    phys_reg_t temp;
+  
+    if (!timerid || !value)
+        return -EINVAL;
+    
+    temp = hw_interrupt_suspend();
+    timer_remain(timer, value);
+    hw_interrupt_recover(temp);
+    
     return 0; 
 }
 
+/**
+ * timer_delete - the function will disarm and free the timer, the callback
+ *                running now is not waited for
+ *
+ * @param timerid the timer
+ *
+ * @return the result
+ */
 int timer_delete (timer_t timerid)
 {
+    struct __timer *timer = (struct __timer *)timerid;
+    phys_reg_t temp;
+  
+    if (!timerid)
+        return -EINVAL;
+    
+    temp = hw_interrupt_suspend();
+    timer_disarm(timer);
+    hw_interrupt_recover(temp);
+    
+    free(timer);
+    
     return 0;
 }
 
 /******************************************************************************/
 
+/*
+ * timer_thread_entry - the thread is woken up only when the head timer
+ *                      expires, and it takes the expired timers one by one
+ *                      from the head, so the cost does not grow with the
+ *                      timers armed
+ */
 static void* timer_thread_entry(void *p)
 {
     struct __timer *timer;
+    struct sigevent igevent;
+    phys_reg_t temp;
+    os_u64 now, expire;
   
     while (1)
     {
         sem_wait(&timer_sem);
         
-        LIST_FOR_EACH_ENTRY(timer,
-                            &timer_list,
-                            struct __timer,
-                            list)
+        timer_pending = 0;
+        
+        while (1)
         {
-            if (timer->itimerspect.it_value.tv_nsec > 0)
+            temp = hw_interrupt_suspend();
+            
+            now = timer_now();
+            if (timer_next > now)
+            {
+                hw_interrupt_recover(temp);
+                break;
+            }
+            
+            timer = LIST_HEAD_ENTRY(&timer_list, struct __timer, list);
+            timer_disarm(timer);
+            
+            /* the periods missed are skipped, so the timer keeps its phase */
+            if (timer->interval)
             {
-                timer->itimerspect.it_value.tv_nsec -= RTOS_SYS_TICK_PERIOD;
-                if (!timer->itimerspect.it_value.tv_nsec)
-                {
-                    timer->igevent.sigev_notify_function(timer->igevent.sigev_value);
+                expire = timer->expire + timer->interval;
+                if (expire <= now)
+                    expire += ((now - expire) / timer->interval + 1) * timer->interval;
                 
-                    if (timer->itimerspect.it_interval.tv_nsec)
-                        timer->itimerspect.it_value.tv_nsec = timer->itimerspect.it_interval.tv_nsec;
-                }
+                /* the realtime expiry moves with the periods, so it can still be re-keyed */
+                if (timer->realtime)
+                    timer->realtime += expire - timer->expire;
+                
+                timer_arm(timer, expire);
             }
+            
+            /* the timer can be deleted while its callback is running */
+            memcpy(&igevent, &timer->igevent, sizeof(struct sigevent));
+            
+            hw_interrupt_recover(temp);
+            
+            igevent.sigev_notify_function(igevent.sigev_value);
         }
     }
 }
@@ -178,6 +628,11 @@ int timer_init(void)
                        PTHREAD_TICKS_MIN,
                        PTHREAD_PRIORITY_MAX);
     
+    list_init(&timer_list);
+  
+    /* the semaphore holds one wake up at most */
+    sem_init(&timer_sem, 0, 1);
+    
     pthread_attr_setschedparam(&attr, &timer_sched_param);
     pthread_attr_setstacksize(&attr, TIMER_THREAD_STACK_SIZE);
     
@@ -188,10 +643,6 @@ int timer_init(void)
     ASSERT_KERNEL(!err);  
     pthread_setname_np(tid, "timer");
     
-    list_init(&timer_list);
-  
-    sem_init(&timer_sem, 0, 1);
-    
     return 0;
 }
 
@@ -201,9 +652,34 @@ void os_timetick(void)
         
     sched_proc();
   
-    sem_post(&timer_sem);
-    
     local_time += RTOS_SYS_TICK_PERIOD;
+    
+    /* the trace sees every wrap of the cycle counter */
+    trace_tick();
+    
+    /* the cycles of a tick are known only after the board starts the cycle counter */
+    if (tick_cycles)
+    {
+        /* the tick anchors the cycles expected, so the jitter of the interrupt does not drift the clock */
+        tick_cycle += tick_cycles;
+        
+        /* the ticks delayed too long are resynchronized, the clock only goes forward */
+        if ((os_u32)(hw_cycle_get() - tick_cycle) >= tick_cycles)
+            tick_cycle = hw_cycle_get();
+    }
+    else if (hw_cycle_freq())
+    {
+        tick_cycles = (os_u32)((os_u64)hw_cycle_freq() * RTOS_SYS_TICK_PERIOD / 1000);
+        cycle_mult  = (TIME_NSEC_PER_SEC << 32) / hw_cycle_freq();
+        tick_cycle  = hw_cycle_get();
+    }
+    
+    /* the timer thread is woken up only when the head timer expires */
+    if (timer_next <= timer_now() && !timer_pending)
+    {
+        timer_pending = 1;
+        sem_post(&timer_sem);
+    }
 }
 
 struct tm *localtime_r(const time_t *time, struct tm *RESTRICT result)
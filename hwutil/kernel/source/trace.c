@@ -0,0 +1,216 @@
+/*
+ * File         : trace.c
+ * This file is part of POSIX-RTOS
+ * COPYRIGHT (C) 2015 - 2016, DongHeng
+ *
+ * Change Logs:
+ * DATA             Author          Note
+ * 2016-03-26       DongHeng        create
+ */
+
+#include "trace.h"
+#include "sched.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "shell.h"
+
+#if USING_TRACE
+
+#if TRACE_EVENT_MAX & (TRACE_EVENT_MAX - 1)
+    #error "TRACE_EVENT_MAX must be a power of 2"
+#endif
+
+/*@{*/
+
+/* the version of the dump read by tools/trace2json.py */
+#define TRACE_DUMP_VERSION              1
+
+/*
+ * the events are written with the interrupt suspended for a few instructions,
+ * so the threads and the interrupts never wait for each other at the ring
+ */
+static struct trace_event trace_ring[TRACE_EVENT_MAX];
+
+/* the events recorded since the ring was cleared, the newest is at (trace_head - 1) */
+static os_u32 trace_head;
+
+/* the high word of the cycle counter and the low word read last time */
+static os_u32 trace_cycle_hi;
+static os_u32 trace_cycle_last;
+
+static volatile bool trace_on = true;
+
+/*@}*/
+
+/*@{*/
+
+/*
+ * trace_write - write the event to the ring, the interrupt must be suspended
+ */
+INLINE void trace_write(os_u32 cycle, os_u8 type, os_u8 info, os_u16 data, os_u32 arg)
+{
+    struct trace_event *event = &trace_ring[trace_head++ & (TRACE_EVENT_MAX - 1)];
+
+    event->cycle  = cycle;
+    event->thread = (os_u32)get_current_thread();
+    event->arg    = arg;
+    event->data   = data;
+    event->info   = info;
+    event->type   = type;
+}
+
+/*
+ * trace_cycle - read the cycle counter, the wrap of it is recorded before the
+ *               events after it. The interrupt must be suspended
+ */
+INLINE os_u32 trace_cycle(void)
+{
+    os_u32 cycle = hw_cycle_get();
+
+    if (cycle < trace_cycle_last)
+    {
+        trace_cycle_hi++;
+        if (trace_on)
+            trace_write(cycle, TRACE_EV_WRAP, 0, 0, trace_cycle_hi);
+    }
+    trace_cycle_last = cycle;
+
+    return cycle;
+}
+
+/*@}*/
+
+/**
+ * __trace_record - the function will record the event, it is called by
+ *                  TRACE_RECORD at the threads and the interrupts
+ *
+ * @param type the type of the event
+ * @param info the info of the event
+ * @param data the data of the event
+ * @param arg the argument of the event
+ */
+void __trace_record(os_u8 type, os_u8 info, os_u16 data, os_u32 arg)
+{
+    phys_reg_t temp;
+
+    temp = hw_interrupt_suspend();
+    if (trace_on)
+        trace_write(trace_cycle(), type, info, data, arg);
+    hw_interrupt_recover(temp);
+}
+
+/**
+ * trace_tick - the function is called by the tick, so every wrap of the
+ *              cycle counter is seen even when no event is recorded
+ */
+void trace_tick(void)
+{
+    phys_reg_t temp;
+
+    temp = hw_interrupt_suspend();
+    trace_cycle();
+    hw_interrupt_recover(temp);
+}
+
+/**
+ * trace_mark - the function will record the marker of the user
+ *
+ * @param id the id of the marker
+ * @param value the value of the marker
+ */
+void trace_mark(os_u16 id, os_u32 value)
+{
+    __trace_record(TRACE_EV_MARK, 0, id, value);
+}
+
+/**
+ * trace_enable - the function will start or stop the recording, the events
+ *                recorded are kept
+ *
+ * @param enable true to start the recording
+ */
+void trace_enable(bool enable)
+{
+    trace_on = enable;
+}
+
+/**
+ * trace_dump - the function will stop the recording and write the threads
+ *              and the events from the oldest one as text lines, then it
+ *              clears the ring and starts the recording again
+ *
+ * @param out the output of the lines
+ * @param arg the argument of the output
+ *
+ * @return the events written
+ */
+int trace_dump(trace_out_t out, void *arg)
+{
+    struct sched_thread_stat *stat;
+    struct trace_event *event;
+    char line[64];
+    os_u32 head, first, i;
+    int num;
+
+    if (!out)
+        return -EINVAL;
+
+    trace_on = false;
+
+    head  = trace_head;
+    first = head > TRACE_EVENT_MAX ? head - TRACE_EVENT_MAX : 0;
+
+    sprintf(line, "#trace %d %u %u %u %u", TRACE_DUMP_VERSION,
+                                           hw_cycle_freq(),
+                                           head - first,
+                                           first,
+                                           trace_cycle_hi);
+    out(arg, line);
+
+    if ((stat = malloc(SCHED_TOP_THREAD_MAX * sizeof(struct sched_thread_stat))))
+    {
+        num = sched_get_thread_stat(stat, SCHED_TOP_THREAD_MAX);
+        for (i = 0; (int)i < num; i++)
+        {
+            sprintf(line, "#thread %08x %d %s", stat[i].thread, stat[i].prio, stat[i].name);
+            out(arg, line);
+        }
+
+        free(stat);
+    }
+
+    for (i = first; i != head; i++)
+    {
+        event = &trace_ring[i & (TRACE_EVENT_MAX - 1)];
+
+        sprintf(line, "%08x %08x %08x %04x %02x %02x", event->cycle,
+                                                       event->thread,
+                                                       event->arg,
+                                                       event->data,
+                                                       event->info,
+                                                       event->type);
+        out(arg, line);
+    }
+
+    out(arg, "#end");
+
+    trace_head = 0;
+    trace_on = true;
+
+    return (int)(head - first);
+}
+
+/******************************************************************************/
+
+static void trace_shell_out(void *arg, const char *line)
+{
+    shell_printk((struct shell_dev *)arg, "\r\n%s", line);
+}
+
+static void trace(struct shell_dev *shell_dev)
+{
+    trace_dump(trace_shell_out, shell_dev);
+}
+SHELL_CMD_EXPORT(trace, dump the events of the trace for tools/trace2json.py, 1);
+
+#endif
@@ -16,20 +16,45 @@
 #include "stdio.h"
 #include "pthread.h"
 
+/*@{*/
+
+#ifndef STDOBJ_HASH_SIZE
+    #define STDOBJ_HASH_SIZE    16
+#endif
+
+#define STDOBJ_FLAG_ANONYMOUS   (1UL << 0)
+
+/* the file handle is reserved and the object is being opened */
+#define STDOBJ_FLAG_OPENING     (1UL << 1)
+
 struct stdobj
 {
     /* the stand object node list */
     list_t                      list;
   
-    /* the stand object name */
+    /* the stand object name and its hash value */
     char                        name[STDOBJ_NAME_MAX];
+    os_u32                      hash;
     
     /* the stand object operations */
     struct stdops               *stdops;
     
+    /* the file handle when it is opened */
+    int                         fd;
+    int                         flag;
+    
     pthread_mutex_t             mutex;
 };   
 
+/* the file handle table entry */
+struct stdfd
+{
+    struct stdobj               *stdobj;
+    
+    /* the opened count and the calling count being handled */
+    os_u32                      ref;
+};
+
 static const char *stdobj_name[] = 
 {
     "/dev/",
@@ -38,14 +63,178 @@ static const char *stdobj_name[] =
 };
 static const int stdobj_num = sizeof(stdobj_name) / sizeof(stdobj_name[0]);
 
-static list_t stdobj_list[STDOBJ_NUM_MAX] KERNEL_SECTION;
+static list_t stdobj_list[STDOBJ_NUM_MAX][STDOBJ_HASH_SIZE] KERNEL_SECTION;
 
-int stdobj_init(void)
+/* the file handle 0 is reserved for the failure of access */
+static struct stdfd stdfd_table[STDFD_NUM_MAX] KERNEL_SECTION;
+
+/*@}*/
+
+/*@{*/
+
+/*
+ * stdobj_hash - compute the hash value of the object name
+ *
+ * @param name the object name
+ *
+ * @return the hash value
+ */
+INLINE os_u32 stdobj_hash(const char *name)
 {
+    os_u32 hash = 5381;
     int i;
+    
+    for (i = 0; i < STDOBJ_NAME_MAX - 1 && name[i]; i++)
+        hash = (hash << 5) + hash + (os_u8)name[i];
+    
+    return hash;
+}
+
+/*
+ * stdfd_bind - bind a free file handle to the object, the interrupt must be
+ *              suspended
+ *
+ * @param stdobj the object point
+ *
+ * @return the file handle, 0 means no free handle
+ */
+static int stdfd_bind(struct stdobj *stdobj)
+{
+    int fd;
+    
+    for (fd = 1; fd < STDFD_NUM_MAX; fd++)
+    {
+        if (!stdfd_table[fd].stdobj)
+        {
+            stdfd_table[fd].stdobj = stdobj;
+            stdfd_table[fd].ref = 1;
+            stdobj->fd = fd;
+            return fd;
+        }
+    }
+    
+    return 0;
+}
+
+/*
+ * stdfd_alloc_entry - bind a free file handle to the object
+ *
+ * @param stdobj the object point
+ *
+ * @return the file handle, 0 means no free handle
+ */
+static int stdfd_alloc_entry(struct stdobj *stdobj)
+{
+    phys_reg_t temp;
+    int fd;
+    
+    temp = hw_interrupt_suspend();
+    
+    fd = stdfd_bind(stdobj);
+    
+    hw_interrupt_recover(temp);
+    
+    return fd;
+}
+
+/*
+ * stdfd_flag_cover - check if the access mode opened covers the one asked for
+ *
+ * @param opened the flag the object is opened with
+ * @param flag the flag asked for
+ *
+ * @return true if the file handle can be shared
+ */
+INLINE bool stdfd_flag_cover(int opened, int flag)
+{
+    if ((flag & (O_RDONLY | O_RDWR)) && !(opened & (O_RDONLY | O_RDWR)))
+        return false;
+    
+    if ((flag & (O_WRONLY | O_RDWR)) && !(opened & (O_WRONLY | O_RDWR)))
+        return false;
+    
+    return true;
+}
+
+/*
+ * stdfd_get - get the object of the file handle and hold it
+ *
+ * @param fildes the file handle
+ *
+ * @return the object point, NULL means the file handle is bad
+ */
+static struct stdobj *stdfd_get(int fildes)
+{
+    struct stdobj *stdobj;
+    phys_reg_t temp;
+  
+    if (fildes <= 0 || fildes >= STDFD_NUM_MAX)
+        return NULL;
+    
+    temp = hw_interrupt_suspend();
+    
+    /* the handle reserved by access is not valid until the object is opened */
+    if ((stdobj = stdfd_table[fildes].stdobj) && (stdobj->flag & STDOBJ_FLAG_OPENING))
+        stdobj = NULL;
+    
+    if (stdobj)
+        stdfd_table[fildes].ref++;
+    
+    hw_interrupt_recover(temp);
+    
+    return stdobj;
+}
+
+/*
+ * stdfd_put - give the file handle back, and release the object when it is
+ *             not used by anyone
+ *
+ * @param fildes the file handle
+ *
+ * @return the result of the releasing
+ */
+static err_t stdfd_put(int fildes)
+{
+    struct stdobj *stdobj;
+    phys_reg_t temp;
+    os_u32 ref;
+    err_t ret = 0;
+    
+    temp = hw_interrupt_suspend();
+    
+    stdobj = stdfd_table[fildes].stdobj;
+    
+    if ((ref = --stdfd_table[fildes].ref) == 0)
+    {
+        stdfd_table[fildes].stdobj = NULL;
+        stdobj->fd = 0;
+    }
+    
+    hw_interrupt_recover(temp);
+    
+    if (ref)
+        return 0;
+    
+    if (stdobj->stdops->release)
+        ret = stdobj->stdops->release(stdobj->stdops);
+    
+    if (stdobj->flag & STDOBJ_FLAG_ANONYMOUS)
+        free(stdobj);
+    
+    return ret;
+}
+
+/*@}*/
+
+int stdobj_init(void)
+{
+    int i, j;
   
     for (i = 0; i < STDOBJ_NUM_MAX; i++)
-        list_init(&stdobj_list[i]);
+        for (j = 0; j < STDOBJ_HASH_SIZE; j++)
+            list_init(&stdobj_list[i][j]);
+    
+    memset(stdfd_table, 0, sizeof(stdfd_table));
   
     return 0;
 }
@@ -53,109 +242,295 @@ int stdobj_init(void)
 int stdobj_create (enum stdobj_type obj, const char *name, struct stdops *stdops)
 {
     struct stdobj *stdobj;
+    phys_reg_t temp;
   
     if (obj >= STDOBJ_NUM_MAX)
         return -EINVAL;
   
-    if (!stdops)
+    if (!stdops || !name)
         return -EINVAL;
     
     if (!(stdobj = calloc(sizeof(struct stdobj))))
         return -EINVAL;
     
     memcpy(&stdobj->name, name , STDOBJ_NAME_MAX - 1);
+    stdobj->hash = stdobj_hash(stdobj->name);
     stdobj->stdops = stdops;
     list_init(&stdobj->list);
     pthread_mutex_init(&stdobj->mutex, NULL);
     
-    list_insert_tail(&stdobj_list[obj], &stdobj->list);
+    temp = hw_interrupt_suspend();
+    
+    list_insert_tail(&stdobj_list[obj][stdobj->hash % STDOBJ_HASH_SIZE], &stdobj->list);
+    
+    hw_interrupt_recover(temp);
     
     return 0;
 }
 
+int stdfd_alloc (struct stdops *stdops, int flag)
+{
+    struct stdobj *stdobj;
+    int fd;
+  
+    if (!stdops)
+        return -EINVAL;
+    
+    if (!(stdobj = calloc(sizeof(struct stdobj))))
+        return -ENOMEM;
+    
+    stdobj->stdops = stdops;
+    stdobj->flag = STDOBJ_FLAG_ANONYMOUS;
+    list_init(&stdobj->list);
+    pthread_mutex_init(&stdobj->mutex, NULL);
+    
+    stdops->flag = flag;
+    
+    if (!(fd = stdfd_alloc_entry(stdobj)))
+    {
+        free(stdobj);
+        return -EMFILE;
+    }
+    
+    return fd;
+}
+
+struct stdops *stdfd_ops (int fildes)
+{
+    if (fildes <= 0 || fildes >= STDFD_NUM_MAX || !stdfd_table[fildes].stdobj)
+        return NULL;
+    
+    return stdfd_table[fildes].stdobj->stdops;
+}
+
 int access (const char *name, int flag)
 {
     const char *str;
-    int type;
+    int type, len, fd;
+    os_u32 hash;
     struct stdobj *stdobj;
+    phys_reg_t temp;
+    bool opening = false;
+    err_t err;
   
     if (!name)
-        return 0;
+        return -EINVAL;
     
     for (type = 0; type < stdobj_num; type++)
     {
-        if (strstr(name, stdobj_name[type]))
+        len = strlen(stdobj_name[type]);
+        
+        if (!strncmp(name, stdobj_name[type], len))
             break;
     }
     
     if (type >= stdobj_num)
-        return 0;
+        return -ENOENT;
     
-    str = name + strlen(stdobj_name[type]);
+    str = name + len;
+    hash = stdobj_hash(str);
     
     LIST_FOR_EACH_ENTRY(stdobj,
-                        &stdobj_list[type],
+                        &stdobj_list[type][hash % STDOBJ_HASH_SIZE],
                         struct stdobj,
                         list)
     {
-        if (!strcmp(stdobj->name, str))
+        if (stdobj->hash != hash || strncmp(stdobj->name, str, STDOBJ_NAME_MAX - 1))
+            continue;
+        
+        /* the handle is shared or reserved at once, so only one caller opens the object */
+        temp = hw_interrupt_suspend();
+        
+        if ((fd = stdobj->fd))
         {
-            stdobj->stdops->flag = flag;
-            
-            if (stdobj->stdops->open)               
-                if (stdobj->stdops->open(stdobj->stdops) < 0)
-                    return -1;
-          
-            return (int)stdobj;
+            if (stdobj->flag & STDOBJ_FLAG_OPENING)
+                fd = -EBUSY;
+            else if (!stdfd_flag_cover(stdobj->stdops->flag, flag))
+                fd = -EACCES;
+            else
+                stdfd_table[fd].ref++;
+        }
+        else if ((fd = stdfd_bind(stdobj)))
+        {
+            stdobj->flag |= STDOBJ_FLAG_OPENING;
+            opening = true;
         }
+        else
+            fd = -EMFILE;
+        
+        hw_interrupt_recover(temp);
+        
+        if (!opening)
+            return fd;
+        
+        stdobj->stdops->flag = flag;
+        
+        err = stdobj->stdops->open ? stdobj->stdops->open(stdobj->stdops) : 0;
+        
+        temp = hw_interrupt_suspend();
+        
+        stdobj->flag &= ~STDOBJ_FLAG_OPENING;
+        
+        /* the handle reserved is given back when the opening fails */
+        if (err < 0)
+        {
+            stdfd_table[fd].stdobj = NULL;
+            stdfd_table[fd].ref = 0;
+            stdobj->fd = 0;
+        }
+        
+        hw_interrupt_recover(temp);
+      
+        return err < 0 ? err : fd;
     }
     
-    return 0;
+    return -ENOENT;
 }
 
 ssize_t read (int fildes, void *buf, size_t nbyte)
+{ 
+    return pread(fildes, buf, nbyte, 0);
+}
+
+ssize_t write (int fildes, const void *buf, size_t nbyte)
+{ 
+    return pwrite(fildes, buf, nbyte, 0);
+}
+
+ssize_t pread (int fildes, void *buf, size_t nbyte, loff_t offset)
+{ 
+    struct stdobj *stdobj;
+    ssize_t ret = -EINVAL;
+  
+    if (!(stdobj = stdfd_get(fildes)))
+        return -EBADF;
+    
+    if (stdobj->stdops->read)
+        ret = stdobj->stdops->read(stdobj->stdops, buf, nbyte, offset);
+    
+    stdfd_put(fildes);
+    
+    return ret;
+}
+
+ssize_t pwrite (int fildes, const void *buf, size_t nbyte, loff_t offset)
 { 
     struct stdobj *stdobj;
+    ssize_t ret = -EINVAL;
   
-    if (fildes <= 0)
+    if (!(stdobj = stdfd_get(fildes)))
+        return -EBADF;
+    
+    if (stdobj->stdops->write)
+        ret = stdobj->stdops->write(stdobj->stdops, buf, nbyte, offset);
+    
+    stdfd_put(fildes);
+    
+    return ret;
+}
+
+ssize_t readv (int fildes, const struct iovec *iov, int iovcnt)
+{ 
+    struct stdobj *stdobj;
+    ssize_t ret = -EINVAL, total = 0;
+    int i;
+  
+    if (!iov || iovcnt <= 0 || iovcnt > IOV_MAX)
         return -EINVAL;
   
-    stdobj = (struct stdobj *)fildes;
+    if (!(stdobj = stdfd_get(fildes)))
+        return -EBADF;
     
-    if (stdobj->stdops->read)
-        return stdobj->stdops->read(stdobj->stdops, buf, nbyte, 0);
+    /* the driver can fill the whole vector at one transfer */
+    if (stdobj->stdops->readv)
+        total = stdobj->stdops->readv(stdobj->stdops, iov, iovcnt, 0);
+    else if (!stdobj->stdops->read)
+        total = -EINVAL;
     else
-        return -EINVAL;
+    {
+        /* or fill the vector one by one, and stop at a short reading */
+        for (i = 0; i < iovcnt; i++)
+        {
+            if (!iov[i].iov_len)
+                continue;
+          
+            ret = stdobj->stdops->read(stdobj->stdops, iov[i].iov_base, iov[i].iov_len, 0);
+            if (ret < 0)
+            {
+                if (!total)
+                    total = ret;
+                break;
+            }
+            
+            total += ret;
+            
+            if (ret < iov[i].iov_len)
+                break;
+        }
+    }
+    
+    stdfd_put(fildes);
+    
+    return total;
 }
 
-ssize_t write (int fildes, const void *buf, size_t nbyte)
+ssize_t writev (int fildes, const struct iovec *iov, int iovcnt)
 { 
     struct stdobj *stdobj;
+    ssize_t ret = -EINVAL, total = 0;
+    int i;
   
-    if (fildes <= 0)
+    if (!iov || iovcnt <= 0 || iovcnt > IOV_MAX)
         return -EINVAL;
   
-    stdobj = (struct stdobj *)fildes;
+    if (!(stdobj = stdfd_get(fildes)))
+        return -EBADF;
     
-    if (stdobj->stdops->write)
-        return stdobj->stdops->write(stdobj->stdops, buf, nbyte, 0);
+    if (stdobj->stdops->writev)
+        total = stdobj->stdops->writev(stdobj->stdops, iov, iovcnt, 0);
+    else if (!stdobj->stdops->write)
+        total = -EINVAL;
     else
-        return -EINVAL;
+    {
+        for (i = 0; i < iovcnt; i++)
+        {
+            if (!iov[i].iov_len)
+                continue;
+          
+            ret = stdobj->stdops->write(stdobj->stdops, iov[i].iov_base, iov[i].iov_len, 0);
+            if (ret < 0)
+            {
+                if (!total)
+                    total = ret;
+                break;
+            }
+            
+            total += ret;
+            
+            if (ret < iov[i].iov_len)
+                break;
+        }
+    }
+    
+    stdfd_put(fildes);
+    
+    return total;
 }
 
 loff_t lseek (int fildes, loff_t loff, int from)
 { 
     struct stdobj *stdobj;
+    loff_t ret = -EINVAL;
   
-    if (fildes <= 0)
-        return -EINVAL;
-  
-    stdobj = (struct stdobj *)fildes;
+    if (!(stdobj = stdfd_get(fildes)))
+        return -EBADF;
     
     if (stdobj->stdops->lseek)
-        return stdobj->stdops->lseek(stdobj->stdops, loff, from);
-    else
-        return -EINVAL;
+        ret = stdobj->stdops->lseek(stdobj->stdops, loff, from);
+    
+    stdfd_put(fildes);
+    
+    return ret;
 }
 
 int ioctl (int fildes, int request, ...)
@@ -163,58 +538,72 @@ int ioctl (int fildes, int request, ...)
     struct stdobj *stdobj;
     va_list args;
     void *ioctl_arg;
+    int ret = -EINVAL;
   
-    if (fildes <= 0)
-        return -EINVAL;
+    if (!(stdobj = stdfd_get(fildes)))
+        return -EBADF;
     
     va_start(args, request);
     ioctl_arg = (void *)(*(int *)args);
-  
-    stdobj = (struct stdobj *)fildes;
     
     if (stdobj->stdops->control)
-        return stdobj->stdops->control(stdobj->stdops, request, ioctl_arg);
-    else
-        return -EINVAL;
+        ret = stdobj->stdops->control(stdobj->stdops, request, ioctl_arg);
+    
+    stdfd_put(fildes);
+    
+    return ret;
 }
 
 int lock (int fildes, loff_t offset, size_t length)
 {
     struct stdobj *stdobj;
+    int ret;
   
-    if (fildes <= 0)
-        return -EINVAL;
-
-    stdobj = (struct stdobj *)fildes;
+    if (!(stdobj = stdfd_get(fildes)))
+        return -EBADF;
+    
+    ret = pthread_mutex_lock(&stdobj->mutex);
     
-    return pthread_mutex_lock(&stdobj->mutex);
+    stdfd_put(fildes);
+    
+    return ret;
 }
 
 int unlock (int fildes, loff_t offset, size_t length)
 {
     struct stdobj *stdobj;
+    int ret;
   
-    if (fildes <= 0)
-        return -EINVAL;
+    if (!(stdobj = stdfd_get(fildes)))
+        return -EBADF;
+    
+    ret = pthread_mutex_unlock(&stdobj->mutex);
     
-    stdobj = (struct stdobj *)fildes;
+    stdfd_put(fildes);
     
-    return pthread_mutex_unlock(&stdobj->mutex);
+    return ret;
 }
 
 int close (int fildes)
 {
-    struct stdobj *stdobj;
-  
-    if (fildes <= 0)
-        return -EINVAL;
+    phys_reg_t temp;
+    int ret = 0;
+    
+    if (fildes <= 0 || fildes >= STDFD_NUM_MAX)
+        return -EBADF;
   
-    stdobj = (struct stdobj *)fildes;
+    temp = hw_interrupt_suspend();
     
-    if (stdobj->stdops->release)
-        return stdobj->stdops->release(stdobj->stdops);
-    else
-        return 0;
+    if (!stdfd_table[fildes].stdobj)
+        ret = -EBADF;
+    
+    hw_interrupt_recover(temp);
+    
+    if (ret)
+        return ret;
+    
+    /* drop the reference of the opening */
+    return stdfd_put(fildes);
 }
 
 /******************************************************************************/
@@ -2,7 +2,9 @@
 #define _SOCKET_H_
 
 #include "rtos.h"
+#include "unistd.h"
 #include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
 
 #define SOCK_STREAM                                 1
 #define SOCK_PACKET                                 2
@@ -53,14 +55,43 @@ struct timeval
 
 #define INADDR_ANY    ip_addr_any.addr
 
+/* the flags of the message */
+#define MSG_TRUNC                    0x20
+
+/* the structure description of the message of sendmsg and recvmsg */
+struct msghdr
+{
+    /* the remote address, not used now */
+    void            *msg_name;
+    socklen_t       msg_namelen;
+    
+    /* the I/O vector of the message */
+    struct iovec    *msg_iov;
+    int             msg_iovlen;
+    
+    /* the ancillary data, not used now */
+    void            *msg_control;
+    socklen_t       msg_controllen;
+    
+    /* the flags of the received message */
+    int             msg_flags;
+};
+
+/* the completion callback of the zero-copy sending, the buffer can be reused */
+typedef void (*sock_zc_done_t)(void *buf, void *arg);
+
 int socket(int domain, int type, int protocol);
 int bind(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
 int listen(int sockfd, int backlog);
 int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen);
 int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen);
-ssize_t read(int fd, void *buf, size_t count);
-ssize_t write(int fd, const void *buf, size_t count);
-int close(int fd);
 err_t socket_init(void);
 
+ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags);
+ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags);
+
+ssize_t recv_zc(int sockfd, struct pbuf **pbuf, int flags);
+void recv_zc_release(int sockfd, struct pbuf *pbuf);
+ssize_t send_zc(int sockfd, const void *buf, size_t len, sock_zc_done_t done, void *arg);
+
 #endif
@@ -13,6 +13,7 @@
 #include "ippkg.h"
 
 #include "stdlib.h"
+#include "list.h"
 
 #include "lwip/udp.h"
 #include "lwip/tcp.h"
@@ -20,17 +21,295 @@
 /* the structure description of socket */
 struct socket
 { 
+    /* the operations of the file handle */
+    struct stdops stdops;
+  
     int domain;
     int type;
     int protocol;
     
-    /* for LWIP TCP or UDP PCB */
+    /* for LWIP TCP or UDP PCB, it is the listen pcb of the TCP server */
     void *pcb;
+    
+    /* the TCP pcb of the connection, the one connected or accepted */
+    struct tcp_pcb *conn;
+    
+    /* the file handle is closed, the socket waits for the zero-copy buffers acknowledged */
+    int          closing;
 
     mqd_t        rx_mqd;
     mqd_t        tx_mqd;
+    
+    /* the TCP package chain which is not read totally */
+    struct pbuf  *rx_pbuf;
+    
+    /* the remote host closes the TCP connection */
+    int          rx_closed;
+    
+    /* TCP stream bytes queued to LWIP and acknowledged by the peer */
+    os_u32       tx_queued;
+    os_u32       tx_acked;
+    
+    /* zero-copy buffers waiting for the peer acknowledgement */
+    list_t       zc_tx_list;
 };
 
+/* the structure description of a zero-copy buffer in flight */
+struct socket_zc_tx
+{
+    list_t          list;
+    
+    /* the application owned buffer */
+    const void      *buf;
+    
+    /* the stream position when the buffer is sent totally */
+    os_u32          end;
+    
+    /* completion callback and its paramter */
+    sock_zc_done_t  done;
+    void            *arg;
+};
+
+/**
+  * socket_get - the function will get the socket of the file handle
+  *
+  * @param sockfd the handle of the socket
+  *
+  * @return the point of the socket, NULL means it is not a socket
+  */
+INLINE struct socket *socket_get(int sockfd)
+{
+    struct stdops *stdops = stdfd_ops(sockfd);
+    
+    if (!stdops || STDOBJ_SOCKET != stdops->type)
+        return NULL;
+  
+    return (struct socket *)stdops->priv;
+}
+
+/**
+  * socket_free - the function will free the socket and the package chain not
+  *               read
+  *
+  * @param socket the point of the socket
+  */
+static void socket_free(struct socket *socket)
+{
+    if (socket->rx_pbuf)
+        pbuf_free(socket->rx_pbuf);
+    
+    free(socket);
+}
+
+/**
+  * socket_tcp_detach - the function will stop LWIP callbacking the socket
+  *                     by the pcb
+  *
+  * @param pcb the point of the tcp pcb
+  */
+static void socket_tcp_detach(struct tcp_pcb *pcb)
+{
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_err(pcb, NULL);
+}
+
+/**
+  * socket_zc_tx_complete - the function will call the completion callback of
+  *                         the zero-copy buffers which are acknowledged
+  *
+  * @param socket the point of the socket
+  */
+static void socket_zc_tx_complete(struct socket *socket)
+{
+    struct socket_zc_tx *zc_tx;
+  
+    LIST_FOR_EACH_HEAD_NEXT(zc_tx,
+                            &socket->zc_tx_list,
+                            struct socket_zc_tx,
+                            list)
+    {
+        /* the stream position may wrap, so compare the distance */
+        if ((os_s32)(socket->tx_acked - zc_tx->end) < 0)
+            break;
+        
+        list_remove_node(&zc_tx->list);
+        
+        if (zc_tx->done)
+            zc_tx->done((void *)zc_tx->buf, zc_tx->arg);
+        
+        free(zc_tx);
+    }
+}
+
+/**
+  * socket_tcp_sent - the function will be callbacked by LWIP when the data
+  *                   is acknowledged by the remote host
+  *
+  * @param arg  the user private point
+  * @param pcb  the point of the target tcp pcb
+  * @param len  the bytes acknowledged
+  *
+  * @return the result
+  */
+static err_t socket_tcp_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    struct socket *socket = (struct socket *)arg;
+  
+    socket->tx_acked += len;
+    
+    socket_zc_tx_complete(socket);
+    
+    /* the socket closed is freed when LWIP refers to no buffer of the application */
+    if (socket->closing && list_is_empty(&socket->zc_tx_list))
+    {
+        socket_tcp_detach(pcb);
+        socket_free(socket);
+    }
+  
+    return ERR_OK;
+}
+
+/**
+  * socket_tcp_err - the function will be callbacked by LWIP when the pcb of
+  *                  the connection is freed by the reset or the abort
+  *
+  * @param arg  the user private point
+  * @param err  the error of the connection
+  */
+static void socket_tcp_err(void *arg, err_t err)
+{
+    struct socket *socket = (struct socket *)arg;
+    struct pbuf *pbuf = NULL;
+    
+    /* the pcb of the client is the connection, it is freed as well */
+    if (socket->pcb == socket->conn)
+        socket->pcb = NULL;
+    socket->conn = NULL;
+    
+    /* the segments are freed, so no buffer of the application is referred */
+    socket->tx_acked = socket->tx_queued;
+    socket_zc_tx_complete(socket);
+    
+    if (socket->closing)
+    {
+        socket_free(socket);
+        return ;
+    }
+    
+    /* wake the reader up as the connection is closed */
+    mq_send(socket->rx_mqd, (const char *)&pbuf, sizeof(struct pbuf *), 0);
+}
+
+/**
+  * socket_rx_fetch - the function will get the package chain to be read, the
+  *                   rest of the last TCP package is used firstly
+  *
+  * @param socket the point of the socket
+  *
+  * @return the package chain, NULL means the connection is closed or error
+  */
+static struct pbuf *socket_rx_fetch(struct socket *socket)
+{
+    os_u32 data;
+  
+    if (socket->rx_pbuf || socket->rx_closed)
+        return socket->rx_pbuf;
+    
+    if (mq_receive(socket->rx_mqd, (char *)&data, sizeof(os_u32), 0) <= 0)
+        return NULL;
+    
+    if (!(socket->rx_pbuf = (struct pbuf *)data))
+        socket->rx_closed = 1;
+    
+    return socket->rx_pbuf;
+}
+
+/**
+  * socket_pbuf_trim - the function will remove the bytes read from the head of
+  *                    the package chain
+  *
+  * @param pbuf the point of the package chain
+  * @param size the bytes to be removed
+  *
+  * @return the rest of the package chain
+  */
+static struct pbuf *socket_pbuf_trim(struct pbuf *pbuf, u16_t size)
+{
+    struct pbuf *next;
+  
+    while (pbuf && size >= pbuf->len)
+    {
+        size -= pbuf->len;
+        
+        /* hold the next node so that only the head is freed */
+        if ((next = pbuf->next))
+            pbuf_ref(next);
+        pbuf_free(pbuf);
+        
+        pbuf = next;
+    }
+    
+    if (pbuf && size)
+        pbuf_header(pbuf, -(s16_t)size);
+    
+    return pbuf;
+}
+
+/**
+  * socket_rx_copy - the function will scatter the received package chain to
+  *                  the I/O vector
+  *
+  * @param socket the point of the socket
+  * @param iov    the I/O vector
+  * @param iovcnt the number of the I/O vector
+  * @param flags  the flags of the message to be filled
+  *
+  * @return the bytes read, or the error code
+  */
+static ssize_t socket_rx_copy(struct socket *socket,
+                              const struct iovec *iov,
+                              int iovcnt,
+                              int *flags)
+{
+    struct pbuf *pbuf;
+    u16_t offset = 0;
+    int i;
+    
+    if (!(pbuf = socket_rx_fetch(socket)))
+        return socket->rx_closed ? 0 : -1;
+    
+    for (i = 0; i < iovcnt && offset < pbuf->tot_len; i++)
+    {
+        u16_t len = iov[i].iov_len > 0xffff ? 0xffff : iov[i].iov_len;
+      
+        offset += pbuf_copy_partial(pbuf, iov[i].iov_base, len, offset);
+    }
+    
+    if (SOCK_STREAM == socket->type)
+    {
+        /* the rest of the stream is kept for the next reading */
+        socket->rx_pbuf = socket_pbuf_trim(pbuf, offset);
+        
+        /* the window is of the connection, the listen pcb has none */
+        if (socket->conn)
+            tcp_recved(socket->conn, offset);
+    }
+    else
+    {
+        /* the rest of the datagram is discarded */
+        if (offset < pbuf->tot_len && flags)
+            *flags |= MSG_TRUNC;
+      
+        socket->rx_pbuf = NULL;
+      
+        pbuf_free(pbuf);
+    }
+  
+    return offset;
+}
+
 /**
   * socket_udp_recv - the function will be callbacked by LWIP when LWIP recieve 
   *                   a udp
@@ -49,11 +328,11 @@ static void socket_udp_recv(void *arg,
 {
     if (pbuf != NULL)
     {
-        char ret = 0;
-      
         struct socket *socket= (struct socket *)arg;
       
-        mq_send(socket->rx_mqd, &ret, 1, 0);
+        /* the receiver owns the pbuf, drop it if the queue is full */
+        if (mq_send(socket->rx_mqd, (const char *)&pbuf, sizeof(struct pbuf *), 0))
+            pbuf_free(pbuf);
     }
 }
 
@@ -74,9 +353,10 @@ static err_t socket_tcp_recv(void *arg,
                              err_t err)
 {
     struct socket *socket = (struct socket *)arg;
-    char ret = 0;
   
-    mq_send(socket->rx_mqd, &ret, 1, 0);
+    /* NULL pbuf means the connection is closed, report it as well */
+    if (mq_send(socket->rx_mqd, (const char *)&pbuf, sizeof(struct pbuf *), 0))
+        return ERR_MEM;
     
     return 0;
 }
@@ -93,11 +373,289 @@ static err_t socket_tcp_recv(void *arg,
   */
 static err_t socket_tcp_accept(void *arg, struct tcp_pcb *pcb, err_t err)
 {     
+    struct socket *socket = (struct socket *)arg;
+    
+    /* the socket serves one connection */
+    if (!socket || socket->conn)
+    {
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    
+    socket->conn = pcb;
+    
+    tcp_arg(pcb, socket);
     tcp_recv(pcb, socket_tcp_recv);
+    tcp_sent(pcb, socket_tcp_sent);
+    tcp_err(pcb, socket_tcp_err);
   
     return 0;
 }
 
+/**
+  * socket_read - the function will read bytes from the socket
+  *                    
+  * @param ops   the operations of the socket
+  * @param buf   the recieving buffer point
+  * @param count the maximum bytes to be read
+  * @param loff  the offset, not used by the socket
+  *
+  * @return the result
+  */
+static ssize_t socket_read(struct stdops *ops, char *buf, size_t count, loff_t loff)
+{
+    struct socket *socket = (struct socket *)ops->priv;
+    struct iovec iov;
+    
+    iov.iov_base = buf;
+    iov.iov_len = count;
+  
+    return socket_rx_copy(socket, &iov, 1, NULL);
+}
+
+/**
+  * socket_write - the function will write bytes to the socket
+  *                    
+  * @param ops   the operations of the socket
+  * @param buf   the sending buffer point
+  * @param count the maximum bytes to be sent
+  * @param loff  the offset, not used by the socket
+  *
+  * @return the result
+  */
+static ssize_t socket_write(struct stdops *ops, const char *buf, size_t count, loff_t loff)
+{
+    struct socket *socket = (struct socket *)ops->priv;
+    ssize_t size = -1;
+   
+    if (SOCK_STREAM == socket->type)
+    {
+        if (!socket->conn)
+            return -ENOTCONN;
+        
+        if ((size = tcp_write(socket->conn, buf, count, TCP_WRITE_FLAG_COPY)) == ERR_OK)
+        {
+            socket->tx_queued += count;
+            size = count;
+        }
+    }
+    else if (SOCK_PACKET == socket->type)
+    {
+        struct pbuf *pbuf;
+        
+        if ((pbuf = ippkg_pack((os_u8 *)buf, count)) == NULL)
+            return -1;
+              
+        size = udp_send(socket->pcb, pbuf);
+        
+        pbuf_free(pbuf);
+    }
+  
+    return size;
+}
+
+/**
+  * socket_release - the function will close the socket when its file handle
+  *                  is closed
+  *                    
+  * @param ops the operations of the socket
+  *
+  * @return the result
+  */
+static err_t socket_release(struct stdops *ops)
+{
+    struct socket *socket = (struct socket *)ops->priv;
+    struct tcp_pcb *conn = socket->conn;
+    int ret = -1;
+   
+    if (SOCK_STREAM == socket->type)
+    {
+        /* the listen pcb of the server, or the pcb never connected */
+        if (socket->pcb && socket->pcb != conn)
+        {
+            tcp_arg(socket->pcb, NULL);
+            tcp_close(socket->pcb);
+        }
+        
+        if (!conn)
+        {
+            socket_free(socket);
+            return 0;
+        }
+        
+        /* the data received after closing is dropped by LWIP */
+        tcp_recv(conn, NULL);
+        
+        /*
+         * LWIP refers to the zero-copy buffers until they are acknowledged, so
+         * the socket is freed by the callbacks after them
+         */
+        if (!list_is_empty(&socket->zc_tx_list))
+        {
+            socket->closing = 1;
+          
+            if ((ret = tcp_close(conn)) != ERR_OK)
+            {
+                /* the abort frees the segments and callbacks socket_tcp_err */
+                tcp_abort(conn);
+                ret = 0;
+            }
+          
+            return ret;
+        }
+        
+        socket_tcp_detach(conn);
+        
+        if ((ret = tcp_close(conn)) != ERR_OK)
+        {
+            tcp_abort(conn);
+            ret = 0;
+        }
+    }
+    else if (SOCK_PACKET == socket->type)
+    {
+        udp_disconnect(socket->pcb);
+        ret = 0;
+    }
+    
+    socket_free(socket);
+  
+    return ret;
+}
+
+/**
+  * socket_send_iov - the function will send the I/O vector as one message
+  *                   without coalescing them to a staging buffer
+  *
+  * @param socket the point of the socket
+  * @param iov    the I/O vector
+  * @param iovcnt the number of the I/O vector
+  *
+  * @return the bytes sent, or the error code. The TCP stream returns the
+  *         bytes queued when a vector after the first one fails, as writev
+  */
+static ssize_t socket_send_iov(struct socket *socket, const struct iovec *iov, int iovcnt)
+{
+    ssize_t ret = -1;
+    size_t total = 0;
+    int i;
+    
+    for (i = 0; i < iovcnt; i++)
+        total += iov[i].iov_len;
+   
+    if (SOCK_STREAM == socket->type)
+    {
+        size_t queued = 0;
+        err_t err;
+        
+        if (!socket->conn)
+            return -ENOTCONN;
+      
+        if (total > tcp_sndbuf(socket->conn))
+            return -ENOMEM;
+      
+        /* LWIP copies every vector into the segments directly */
+        for (i = 0; i < iovcnt; i++)
+        {
+            u8_t apiflags = TCP_WRITE_FLAG_COPY;
+            
+            if (!iov[i].iov_len)
+                continue;
+            
+            if (i < iovcnt - 1)
+                apiflags |= TCP_WRITE_FLAG_MORE;
+            
+            if ((err = tcp_write(socket->conn,
+                                 iov[i].iov_base,
+                                 iov[i].iov_len,
+                                 apiflags)) != ERR_OK)
+            {
+                /* the vectors queued are sent, the caller writes the rest again */
+                if (!queued)
+                    return err;
+                break;
+            }
+            
+            socket->tx_queued += iov[i].iov_len;
+            queued += iov[i].iov_len;
+        }
+        
+        tcp_output(socket->conn);
+        
+        ret = queued;
+    }
+    else if (SOCK_PACKET == socket->type)
+    {
+        struct pbuf *head = NULL, *pbuf;
+        
+        /* chain the vectors by referencing package without copying */
+        for (i = 0; i < iovcnt; i++)
+        {
+            if (!iov[i].iov_len)
+                continue;
+          
+            if (!(pbuf = pbuf_alloc(head ? PBUF_RAW : PBUF_TRANSPORT,
+                                    iov[i].iov_len,
+                                    PBUF_REF)))
+            {
+                if (head)
+                    pbuf_free(head);
+              
+                return -ENOMEM;
+            }
+            
+            pbuf->payload = iov[i].iov_base;
+            
+            if (head)
+                pbuf_cat(head, pbuf);
+            else
+                head = pbuf;
+        }
+        
+        if (!head)
+            return 0;
+        
+        ret = udp_send(socket->pcb, head);
+        
+        pbuf_free(head);
+        
+        if (ERR_OK == ret)
+            ret = total;
+    }
+  
+    return ret;
+}
+
+/**
+  * socket_readv - the function will scatter the received data to the I/O vector
+  *
+  * @param ops    the operations of the socket
+  * @param iov    the I/O vector
+  * @param iovcnt the number of the I/O vector
+  * @param loff   the offset, not used by the socket
+  *
+  * @return the result
+  */
+static ssize_t socket_readv(struct stdops *ops, const struct iovec *iov, int iovcnt, loff_t loff)
+{
+    return socket_rx_copy((struct socket *)ops->priv, iov, iovcnt, NULL);
+}
+
+/**
+  * socket_writev - the function will send the I/O vector
+  *
+  * @param ops    the operations of the socket
+  * @param iov    the I/O vector
+  * @param iovcnt the number of the I/O vector
+  * @param loff   the offset, not used by the socket
+  *
+  * @return the result
+  */
+static ssize_t socket_writev(struct stdops *ops, const struct iovec *iov, int iovcnt, loff_t loff)
+{
+    return socket_send_iov((struct socket *)ops->priv, iov, iovcnt);
+}
+
 /**
   * socket - the function will create a socket
   *                    
@@ -110,8 +668,12 @@ static err_t socket_tcp_accept(void *arg, struct tcp_pcb *pcb, err_t err)
   */
 int socket(int domain, int type, int protocol)
 {
-    struct socket *socket = malloc(sizeof(struct socket));
+    struct socket *socket;
     struct mq_attr mq_attr;
+    int fd;
+    
+    if (!(socket = calloc(sizeof(struct socket))))
+        return 0;
   
     mq_attr.mq_maxmsg  = 16;
     mq_attr.mq_msgsize = 4;
@@ -124,6 +686,13 @@ int socket(int domain, int type, int protocol)
     socket->type = type;
     socket->protocol = protocol;
     
+    socket->rx_pbuf = NULL;
+    socket->rx_closed = 0;
+    
+    socket->tx_queued = 0;
+    socket->tx_acked = 0;
+    list_init(&socket->zc_tx_list);
+    
     if (SOCK_STREAM == type)
     {
         /* create a tcp pcb */
@@ -136,8 +705,23 @@ int socket(int domain, int type, int protocol)
         if (!(socket->pcb = udp_new()))
             goto free_socket;
     }  
+    
+    /* the socket is accessed by the file handle */
+    socket->stdops.type     = STDOBJ_SOCKET;
+    socket->stdops.read     = socket_read;
+    socket->stdops.write    = socket_write;
+    socket->stdops.readv    = socket_readv;
+    socket->stdops.writev   = socket_writev;
+    socket->stdops.release  = socket_release;
+    socket->stdops.priv     = socket;
+    
+    if ((fd = stdfd_alloc(&socket->stdops, O_RDWR)) <= 0)
+    {
+        socket_release(&socket->stdops);
+        return 0;
+    }
   
-    return (int)socket;
+    return fd;
     
 free_socket:
     free(socket);
@@ -157,8 +741,11 @@ free_socket:
   */
 int bind(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
 {
-    struct socket *socket = (struct socket *)sockfd;
+    struct socket *socket = socket_get(sockfd);
     int ret = -1;
+    
+    if (!socket)
+        return -EBADF;
    
     if (SOCK_STREAM == socket->type)
     {
@@ -182,8 +769,11 @@ int bind(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
   */
 int listen(int sockfd, int backlog)
 {
-    struct socket *socket = (struct socket *)sockfd;
+    struct socket *socket = socket_get(sockfd);
     int ret = -1;
+    
+    if (!socket)
+        return -EBADF;
    
     if (SOCK_STREAM == socket->type)
     {
@@ -210,11 +800,20 @@ int listen(int sockfd, int backlog)
   */
 int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
 {
-    struct socket *socket = (struct socket *)sockfd;
+    struct socket *socket = socket_get(sockfd);
     int ret = -1;
+    
+    if (!socket)
+        return -EBADF;
    
     if (SOCK_STREAM == socket->type)
     {
+         socket->conn = socket->pcb;
+         
+         tcp_arg(socket->pcb, socket);
+         tcp_recv(socket->pcb, socket_tcp_recv);
+         tcp_sent(socket->pcb, socket_tcp_sent);
+         tcp_err(socket->pcb, socket_tcp_err);
          ret = tcp_connect(socket->pcb, (struct ip_addr *)&addr->sin_addr, addr->sin_port, NULL);
     }
     else if (SOCK_PACKET == socket->type)
@@ -237,8 +836,11 @@ int connect(int sockfd, const struct sockaddr *addr, socklen_t addrlen)
   */
 int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
 {
-    struct socket *socket = (struct socket *)sockfd;
+    struct socket *socket = socket_get(sockfd);
     int ret = -1;
+    
+    if (!socket)
+        return -EBADF;
    
     if (SOCK_STREAM == socket->type)
     {
@@ -255,116 +857,211 @@ int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
 }
 
 /**
-  * read - the function will read bytes from the file
-  *                    
-  * @param fd    the file handle
-  * @param buf   the recieving buffer point
-  * @param count the maximum bytes to be read
+  * sendmsg - the function will send the I/O vector as one message without
+  *           coalescing them to a staging buffer
   *
-  * @return the result
+  * @param sockfd the handle of the socket
+  * @param msg    the message to be sent
+  * @param flags  the flags of sending, not used now
+  *
+  * @return the bytes sent, or the error code
   */
-ssize_t _read(int fd, void *buf, size_t count)
+ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags)
 {
-    struct socket *socket = (struct socket *)fd;
-    ssize_t size = -1;
+    struct socket *socket = socket_get(sockfd);
+    
+    if (!socket)
+        return -EBADF;
+    
+    if (!msg || msg->msg_iovlen <= 0 || msg->msg_iovlen > IOV_MAX)
+        return -EINVAL;
+    
+    return socket_send_iov(socket, msg->msg_iov, msg->msg_iovlen);
+}
 
-    os_u32 data;
-   
-    if (mq_receive(socket->rx_mqd, (char *)&data, sizeof(os_u32), 0))
-    {
-        struct pbuf *pbuf = (struct pbuf *)data;
-                
-        size = ippkg_unpack(pbuf, (os_u8 *)buf, count);
-                
-        pbuf_free(pbuf);
-    }
-  
-    return size;
+/**
+  * recvmsg - the function will scatter one received message to the I/O vector
+  *
+  * @param sockfd the handle of the socket
+  * @param msg    the message to be filled
+  * @param flags  the flags of recieving, not used now
+  *
+  * @return the bytes received, or the error code
+  */
+ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags)
+{
+    struct socket *socket = socket_get(sockfd);
+    
+    if (!socket)
+        return -EBADF;
+    
+    if (!msg || msg->msg_iovlen <= 0 || msg->msg_iovlen > IOV_MAX)
+        return -EINVAL;
+    
+    msg->msg_flags = 0;
+    
+    return socket_rx_copy(socket, msg->msg_iov, msg->msg_iovlen, &msg->msg_flags);
 }
 
 /**
-  * read - the function will write bytes to the file
-  *                    
-  * @param fd    the file handle
-  * @param buf   the sending buffer point
-  * @param count the maximum bytes to be sent
+  * recv_zc - the function will take the received package chain without copying,
+  *           the caller reads the data by "pbuf->payload" and "pbuf->next" and
+  *           must give the chain back by "recv_zc_release"
   *
-  * @return the result
+  * @param sockfd the handle of the socket
+  * @param pbuf   the point of the package chain point
+  * @param flags  the flags of recieving, not used now
+  *
+  * @return the total bytes of the chain, 0 when the connection is closed
   */
-ssize_t _write(int fd, const void *buf, size_t count)
+ssize_t recv_zc(int sockfd, struct pbuf **pbuf, int flags)
 {
-    struct socket *socket = (struct socket *)fd;
-    ssize_t size = -1;
-   
-    if (SOCK_STREAM == socket->type)
-    {
-        size = tcp_write(socket->pcb, buf, count, TCP_WRITE_FLAG_COPY);
-    }
-    else if (SOCK_PACKET == socket->type)
-    {
-        struct pbuf *pbuf = pbuf_alloc(PBUF_RAW, count, PBUF_POOL);
-        
-        if ((pbuf = ippkg_pack((os_u8 *)buf, count)) == NULL)
-            return -1;
-              
-        size = udp_send(socket->pcb, pbuf);
-    }
+    struct socket *socket = socket_get(sockfd);
+    
+    *pbuf = NULL;
+    
+    if (!socket)
+        return -EBADF;
+    
+    if (!(*pbuf = socket_rx_fetch(socket)))
+        return socket->rx_closed ? 0 : -1;
+    
+    /* the caller owns the chain now */
+    socket->rx_pbuf = NULL;
   
-    return size;
+    return (*pbuf)->tot_len;
 }
 
 /**
-  * close - the function will close the file
-  *                    
-  * @param fd the file handle
+  * recv_zc_release - the function will give the package chain taken by
+  *                   "recv_zc" back to LWIP and open the TCP receiving window
   *
-  * @return the result
+  * @param sockfd the handle of the socket
+  * @param pbuf   the point of the package chain
   */
-int _close(int fd)
+void recv_zc_release(int sockfd, struct pbuf *pbuf)
 {
-    struct socket *socket = (struct socket *)fd;
-    int ret = -1;
+    struct socket *socket = socket_get(sockfd);
+    
+    if (!socket || !pbuf)
+        return ;
+    
+    /* the window is of the connection, the listen pcb has none */
+    if (SOCK_STREAM == socket->type && socket->conn)
+        tcp_recved(socket->conn, pbuf->tot_len);
+    
+    pbuf_free(pbuf);
+}
+
+/**
+  * send_zc - the function will send the buffer without copying it, the buffer
+  *           must not be modified until the "done" is callbacked
+  *
+  * @param sockfd the handle of the socket
+  * @param buf    the sending buffer point
+  * @param len    the bytes to be sent
+  * @param done   the completion callback, it can be NULL
+  * @param arg    the paramter of the completion callback
+  *
+  * @return the bytes queued, or the error code
+  */
+ssize_t send_zc(int sockfd, const void *buf, size_t len, sock_zc_done_t done, void *arg)
+{
+    struct socket *socket = socket_get(sockfd);
+    ssize_t ret = -1;
+    
+    if (!socket)
+        return -EBADF;
    
     if (SOCK_STREAM == socket->type)
     {
-        ret = tcp_close(socket->pcb);
+        struct socket_zc_tx *zc_tx;
+        
+        if (!socket->conn)
+            return -ENOTCONN;
+        
+        /* LWIP limits the length of one writing */
+        if (len > 0xffff || len > tcp_sndbuf(socket->conn))
+            return -ENOMEM;
+        
+        if (!(zc_tx = malloc(sizeof(struct socket_zc_tx))))
+            return -ENOMEM;
+        
+        /* the LWIP segments refer to the buffer directly */
+        if ((ret = tcp_write(socket->conn, buf, len, 0)) != ERR_OK)
+        {
+            free(zc_tx);
+            return ret;
+        }
+        
+        socket->tx_queued += len;
+        
+        zc_tx->buf = buf;
+        zc_tx->end = socket->tx_queued;
+        zc_tx->done = done;
+        zc_tx->arg = arg;
+        list_insert_tail(&socket->zc_tx_list, &zc_tx->list);
+        
+        tcp_output(socket->conn);
+        
+        ret = len;
     }
     else if (SOCK_PACKET == socket->type)
     {
-        udp_disconnect(socket->pcb);
-        ret = 0;
+        struct pbuf *pbuf;
+        
+        if (!(pbuf = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_REF)))
+            return -ENOMEM;
+        
+        pbuf->payload = (void *)buf;
+        
+        ret = udp_send(socket->pcb, pbuf);
+        
+        /* the package has been sent out by the netif when returning */
+        pbuf_free(pbuf);
+        
+        if (done)
+            done((void *)buf, arg);
+        
+        if (ERR_OK == ret)
+            ret = len;
     }
-    
-    free(socket);
   
     return ret;
 }
 
-
 /**
-  * select - the function will select the target file handle and take it
+  * select - the function will wait until the socket can be read, the package
+  *          chain received is kept at the socket for the next reading
   *
-  * @param maxfdp the maximum number of the file handle
-  * @param 
+  * @param maxfdp the handle of the socket
+  * @param readfds set to 1 when the socket can be read
+  * @param writefds not used now
+  * @param errorfds set to -1 when the connection is closed
+  * @param timeout not used now
+  *
+  * @return the sockets can be read, or -1 when the connection is closed
   */
 int select(int maxfdp, fd_set *readfds, fd_set *writefds, fd_set *errorfds, struct timeval *timeout)
 { 
-    os_u32 data;
-    struct socket *socket = (struct socket *)maxfdp;
+    struct socket *socket = socket_get(maxfdp);
+    
+    if (!socket)
+        return -EBADF;
   
-    if (mq_receive(socket->rx_mqd, (char *)&data, sizeof(os_u32), 0))
+    /* the chain fetched stays at rx_pbuf, so the reading after it gets it firstly */
+    if (!socket_rx_fetch(socket))
     {
-        if (!data)
-        {
-           *errorfds = -1;
-           
-           return -1;
-        }
+        if (errorfds)
+            *errorfds = -1;
         
-        *readfds = (fd_set)data;
-    } 
+        return -1;
+    }
+    
+    if (readfds)
+        *readfds = 1;
   
-    return 0;
+    return 1;
 }
 
 /**
@@ -358,6 +358,7 @@ struct shell_dev* shell_dev_create(const char *name, err_t *err, os_u8 ack)
     
     if (shell_dev_find(file))
     {
+        close(file);
         *err = -EINVAL;
         return NULL;
     }
@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+#
+# File         : trace2json.py
+# This file is part of POSIX-RTOS
+# COPYRIGHT (C) 2015 - 2016, DongHeng
+#
+# Change Logs:
+# DATA             Author          Note
+# 2016-03-26       DongHeng        create
+#
+# Decode the dump of the "trace" shell command to the Chrome trace JSON, open
+# it by chrome://tracing or https://ui.perfetto.dev
+#
+#   python3 trace2json.py uart.log -o trace.json
+#
+# The log can have the other lines of the shell, only the lines from "#trace"
+# to "#end" are read, the last dump is decoded when there are several.
+#
+# The dump is
+#
+#   #trace <version> <cycle frequency> <events> <events lost> <cycle high word>
+#   #thread <thread> <priority> <name>
+#   <cycle> <thread> <arg> <data> <info> <type>
+#   ...
+#   #end
+#
+
+import argparse
+import json
+import sys
+
+TRACE_EV_WRAP = 0
+TRACE_EV_SWITCH = 1
+TRACE_EV_READY = 2
+TRACE_EV_SUSPEND = 3
+TRACE_EV_SLEEP = 4
+TRACE_EV_ISR_ENTER = 5
+TRACE_EV_ISR_EXIT = 6
+TRACE_EV_MUTEX_LOCK = 7
+TRACE_EV_MUTEX_UNLOCK = 8
+TRACE_EV_SEM_WAIT = 9
+TRACE_EV_SEM_POST = 10
+TRACE_EV_MQ_SEND = 11
+TRACE_EV_MQ_RECEIVE = 12
+TRACE_EV_MARK = 13
+
+# the events shown as instants at the track of the thread running
+INSTANTS = {
+    TRACE_EV_MUTEX_LOCK: "mutex_lock",
+    TRACE_EV_MUTEX_UNLOCK: "mutex_unlock",
+    TRACE_EV_SEM_WAIT: "sem_wait",
+    TRACE_EV_SEM_POST: "sem_post",
+    TRACE_EV_MQ_SEND: "mq_send",
+    TRACE_EV_MQ_RECEIVE: "mq_receive",
+}
+
+# the events of the state shown as instants at the track of the thread changed
+STATES = {
+    TRACE_EV_READY: "ready",
+    TRACE_EV_SUSPEND: "suspend",
+    TRACE_EV_SLEEP: "sleep",
+}
+
+# the state of the thread switched out
+SWITCH_STATES = ["init", "ready", "suspend", "sleep", "closed", "int"]
+
+# the track of the interrupts
+ISR_TID = 0xFFFFFFFF
+
+PID = 1
+
+
+class DumpError(Exception):
+    pass
+
+
+def read_dump(lines):
+    """return the header, the threads and the events of the last dump"""
+    dump = None
+    current = None
+
+    for line in lines:
+        line = line.strip()
+        if line.startswith("#trace"):
+            fields = line.split()
+            if len(fields) != 6 or int(fields[1]) != 1:
+                raise DumpError("unknown dump: %s" % line)
+            current = {
+                "freq": int(fields[2]),
+                "events": int(fields[3]),
+                "lost": int(fields[4]),
+                "hi": int(fields[5]),
+                "threads": {},
+                "records": [],
+            }
+        elif current is None:
+            continue
+        elif line.startswith("#thread"):
+            fields = line.split(None, 3)
+            name = fields[3] if len(fields) > 3 else ""
+            current["threads"][int(fields[1], 16)] = (name, int(fields[2]))
+        elif line == "#end":
+            dump = current
+            current = None
+        elif line:
+            fields = line.split()
+            if len(fields) != 6:
+                raise DumpError("bad event: %s" % line)
+            cycle, thread, arg, data, info, type_ = (int(f, 16) for f in fields)
+            current["records"].append((cycle, thread, arg, data, info, type_))
+
+    if dump is None:
+        raise DumpError("no complete dump is found")
+
+    return dump
+
+
+def unwrap(dump):
+    """give every event the 64 bit cycle by the wrap events"""
+    records = dump["records"]
+
+    # the events before the first wrap kept are at the high word before it
+    hi = dump["hi"]
+    for record in records:
+        if record[5] == TRACE_EV_WRAP:
+            hi = (record[2] - 1) & 0xFFFFFFFF
+            break
+
+    events = []
+    for cycle, thread, arg, data, info, type_ in records:
+        if type_ == TRACE_EV_WRAP:
+            hi = arg
+        events.append(((hi << 32) | cycle, thread, arg, data, info, type_))
+
+    return events
+
+
+def thread_name(dump, thread):
+    if thread == 0:
+        return "boot"
+    name, prio = dump["threads"].get(thread, ("", None))
+    if not name:
+        name = "0x%08x" % thread
+    return name if prio is None else "%s (%d)" % (name, prio)
+
+
+def to_chrome(dump):
+    events = unwrap(dump)
+    out = []
+
+    if not events:
+        return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+    freq = dump["freq"] or 1
+    base = events[0][0]
+
+    def us(cycle):
+        return (cycle - base) * 1e6 / freq
+
+    threads = set(dump["threads"])
+
+    # the thread runs from the switch to it until the next switch
+    running = events[0][1]
+    start = events[0][0]
+    isr = []
+
+    for cycle, thread, arg, data, info, type_ in events:
+        threads.add(thread)
+        ts = us(cycle)
+
+        if type_ == TRACE_EV_SWITCH:
+            threads.add(arg)
+            # nothing ran before the scheduler started
+            if running or cycle != start:
+                out.append({"name": "run", "ph": "X", "pid": PID, "tid": running,
+                            "ts": us(start), "dur": ts - us(start),
+                            "args": {"out": SWITCH_STATES[data] if data < len(SWITCH_STATES) else data}})
+            running = arg
+            start = cycle
+        elif type_ in STATES:
+            threads.add(arg)
+            args = {"priority": info}
+            if type_ == TRACE_EV_SLEEP:
+                args["ticks"] = data
+            out.append({"name": STATES[type_], "ph": "i", "s": "t", "pid": PID, "tid": arg,
+                        "ts": ts, "args": args})
+        elif type_ == TRACE_EV_ISR_ENTER:
+            isr.append(info)
+            out.append({"name": "isr %d" % info, "ph": "B", "pid": PID, "tid": ISR_TID, "ts": ts})
+        elif type_ == TRACE_EV_ISR_EXIT:
+            # the exit of the interrupt entered before the dump is dropped
+            if isr:
+                isr.pop()
+                out.append({"name": "isr %d" % info, "ph": "E", "pid": PID, "tid": ISR_TID, "ts": ts})
+        elif type_ in INSTANTS:
+            value = data - 0x10000 if data & 0x8000 else data
+            out.append({"name": INSTANTS[type_], "ph": "i", "s": "t", "pid": PID, "tid": thread,
+                        "ts": ts, "args": {"object": "0x%08x" % arg, "value": value}})
+        elif type_ == TRACE_EV_MARK:
+            out.append({"name": "mark %d" % data, "ph": "i", "s": "t", "pid": PID, "tid": thread,
+                        "ts": ts, "args": {"value": arg}})
+
+    out.append({"name": "run", "ph": "X", "pid": PID, "tid": running,
+                "ts": us(start), "dur": us(events[-1][0]) - us(start)})
+
+    for isr_vector in reversed(isr):
+        out.append({"name": "isr %d" % isr_vector, "ph": "E", "pid": PID, "tid": ISR_TID,
+                    "ts": us(events[-1][0])})
+
+    meta = [{"name": "process_name", "ph": "M", "pid": PID, "args": {"name": "POSIX-RTOS"}},
+            {"name": "thread_name", "ph": "M", "pid": PID, "tid": ISR_TID, "args": {"name": "interrupts"}}]
+    for thread in sorted(threads):
+        meta.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": thread,
+                     "args": {"name": thread_name(dump, thread)}})
+        prio = dump["threads"].get(thread, ("", 0))[1]
+        meta.append({"name": "thread_sort_index", "ph": "M", "pid": PID, "tid": thread,
+                     "args": {"sort_index": -prio}})
+
+    return {"traceEvents": meta + out,
+            "displayTimeUnit": "ns",
+            "otherData": {"cycle_frequency": dump["freq"], "events": dump["events"],
+                          "events_lost": dump["lost"]}}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode the trace dump of POSIX-RTOS to the Chrome trace JSON")
+    parser.add_argument("log", nargs="?", help="the log of the shell, the standard input by default")
+    parser.add_argument("-o", "--output", help="the JSON file, the standard output by default")
+    args = parser.parse_args()
+
+    try:
+        if args.log:
+            with open(args.log, errors="replace") as f:
+                dump = read_dump(f)
+        else:
+            dump = read_dump(sys.stdin)
+    except DumpError as e:
+        sys.stderr.write("trace2json: %s\n" % e)
+        return 1
+
+    trace = to_chrome(dump)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+
+    sys.stderr.write("trace2json: %d events, %d lost, %d threads\n"
+                     % (dump["events"], dump["lost"], len(dump["threads"])))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())